@@ -0,0 +1,142 @@
+#include <stdio.h>
+
+#include "miniAHRS.h"
+#include "BatchAHRS.h"
+#include "benchUtils.h"
+#include "simUtils.h"
+
+// Reprocesses N_SESSIONS simulated sessions (own seed and gyro bias each)
+// with the scalar EKF_AHRSUpdate, one session after the other, and with
+// BatchAHRS at 1, 4, 8 and 16 lanes. Reports the time per filter update, the
+// speedup over the scalar filter, the attitude error over the second half
+// of the sessions and the largest difference between a batch and a scalar
+// quaternion component. One lane is slower than the scalar filter (x 0.8 to
+// 0.9 on a Xeon): skipping the zeros of F and H does not pay for the lane
+// layout and the SIMD kernels the scalar EKF uses. The speedup comes from
+// the vector lanes of the other widths.
+
+#define N_SESSIONS 16
+#define N_SAMPLES 6000
+#define N_REPEAT 5
+
+static SimSample samples[N_SESSIONS][N_SAMPLES];
+static float scalarQ[N_SESSIONS][N_SAMPLES][4];
+static SimConfig cfg[N_SESSIONS];
+
+static double scalarTime;
+
+// back to the initial P and a zero bias. EKF_AHRSInit takes the up vector
+static void reset(const float *accel, float *mag) {
+	static const Mat<EKF_STATE_DIM, EKF_STATE_DIM> P0 = P;
+	float up[3] = {-accel[0], -accel[1], -accel[2]};
+	Mat_Copy(P0, P);
+	for (int i = 0; i < EKF_STATE_DIM; i++) X[i] = 0.0f;
+	EKF_AHRSInit(up, mag);
+}
+
+static void runScalar() {
+	long long best = 0;
+	double sum = 0.0;
+	float accel[3], mag[3];
+
+	for (int n = 0; n < N_REPEAT; n++) {
+		long long t = 0;
+		sum = 0.0;
+		for (int f = 0; f < N_SESSIONS; f++) {
+			for (int k = 0; k < 3; k++) { accel[k] = samples[f][0].accel[k]; mag[k] = samples[f][0].mag[k]; }
+			reset(accel, mag);
+			long long t0 = getCurrentNanoseconds();
+			for (int i = 1; i < N_SAMPLES; i++) {
+				for (int k = 0; k < 3; k++) { accel[k] = samples[f][i].accel[k]; mag[k] = samples[f][i].mag[k]; }
+				EKF_AHRSUpdate(samples[f][i - 1].gyro, accel, mag, cfg[f].dt);
+				EKF_AHRSGetQ(scalarQ[f][i]);
+			}
+			t += getCurrentNanoseconds() - t0;
+			for (int i = N_SAMPLES / 2; i < N_SAMPLES; i++) {
+				double e = simAttitudeError(samples[f][i].q, scalarQ[f][i]);
+				sum += e * e;
+			}
+		}
+		if (n == 0 || t < best) best = t;
+	}
+	scalarTime = (double)best / (N_SESSIONS * (N_SAMPLES - 1));
+	printf("scalar    %8.1f ns/filter update              rms %6.3f deg\n", scalarTime,
+			sqrt(sum / (N_SESSIONS * (N_SAMPLES - N_SAMPLES / 2))));
+}
+
+template <int LANES>
+static void runBatch() {
+	static BatchAHRS<LANES> batch[N_SESSIONS / LANES];
+	float gyro[3][LANES], accel[3][LANES], mag[3][LANES], dt[LANES], q[4];
+	long long best = 0;
+	double sum = 0.0, dev = 0.0;
+
+	for (int n = 0; n < N_REPEAT; n++) {
+		long long t = 0;
+		sum = 0.0;
+		dev = 0.0;
+		for (int b = 0; b < N_SESSIONS / LANES; b++) {
+			BatchAHRS<LANES> &filter = batch[b];
+			filter = BatchAHRS<LANES>();
+			for (int l = 0; l < LANES; l++) {
+				const SimSample &s = samples[b * LANES + l][0];
+				float a[3] = {s.accel[0], s.accel[1], s.accel[2]};
+				float m[3] = {s.mag[0], s.mag[1], s.mag[2]};
+				filter.initialize(l, a, m);
+				dt[l] = cfg[b * LANES + l].dt;
+			}
+			long long t0 = getCurrentNanoseconds();
+			for (int i = 1; i < N_SAMPLES; i++) {
+				for (int l = 0; l < LANES; l++) {
+					const SimSample &p = samples[b * LANES + l][i - 1];
+					const SimSample &s = samples[b * LANES + l][i];
+					for (int k = 0; k < 3; k++) {
+						gyro[k][l] = p.gyro[k];
+						accel[k][l] = s.accel[k];
+						mag[k][l] = s.mag[k];
+					}
+				}
+				filter.update(gyro, accel, mag, dt);
+				if (i >= N_SAMPLES / 2) {
+					t += getCurrentNanoseconds() - t0;
+					for (int l = 0; l < LANES; l++) {
+						int f = b * LANES + l;
+						filter.getQuaternion(l, q);
+						double e = simAttitudeError(samples[f][i].q, q);
+						sum += e * e;
+						for (int k = 0; k < 4; k++) {
+							e = fabs(q[k] - scalarQ[f][i][k]);
+							if (e > dev) dev = e;
+						}
+					}
+					t0 = getCurrentNanoseconds();
+				}
+			}
+			t += getCurrentNanoseconds() - t0;
+		}
+		if (n == 0 || t < best) best = t;
+	}
+	double ns = (double)best / (N_SESSIONS * (N_SAMPLES - 1));
+	printf("%2d lanes  %8.1f ns/filter update  x%5.1f    rms %6.3f deg  max dev %.1e\n", LANES, ns,
+			scalarTime / ns, sqrt(sum / (N_SESSIONS * (N_SAMPLES - N_SAMPLES / 2))), dev);
+}
+
+int main(int argc, char **argv) {
+
+	for (int f = 0; f < N_SESSIONS; f++) {
+		simDefaultConfig(&cfg[f]);
+		cfg[f].seed = f + 1;
+		cfg[f].gyroBias[0] = 0.02f * (f % 3 - 1);
+		cfg[f].gyroBias[1] = 0.01f * (f % 5 - 2);
+		cfg[f].gyroBias[2] = 0.015f * (f % 2 - 0.5f);
+		simGenerate(&cfg[f], samples[f], N_SAMPLES);
+	}
+
+	printf("%d sessions of %d samples, SIMD kernels of the scalar EKF: %s\n", N_SESSIONS, N_SAMPLES, MAT_SIMD_NAME);
+	runScalar();
+	runBatch<1>();
+	runBatch<4>();
+	runBatch<8>();
+	runBatch<16>();
+	return 0;
+}
@@ -0,0 +1,488 @@
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <algorithm>
+
+// Offline generator of miniAHRS/EKFKernels.h, the straight-line covariance
+// kernels of EKF_GENERATED_KERNELS. The models of miniAHRS.h are written
+// below once, over symbols: the transition matrix F = [A B; 0 I] of the
+// predictions and the Jacobians H of EKF_AHRSUpdate, EKF_AHRSUpdateAccel and
+// EKF_AHRSUpdateMag as functions of the quaternion and the reference field.
+// Every product of the propagation and of the Joseph form update is expanded
+// into one expression graph: identical subexpressions are built once (hash
+// consing), products by 0, 1 and -1 and sums with 0 fold away, signs move
+// into subtractions, and only the upper triangle of a symmetric result is
+// formed. The inverse of S becomes an unrolled LDL' factorization and solve.
+// A node used more than once becomes a local, the others are written inline.
+//
+//   ekfCodeGen [file]   writes the header to file, or to stdout
+//
+// "make codegen" rebuilds this program and regenerates the header, to be run
+// after any change of the models below.
+
+#define N 7 // EKF_STATE_DIM
+
+enum Op { OP_CONST, OP_INPUT, OP_NEG, OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_RSQRT };
+
+struct Node {
+	Op op;
+	int a, b;
+	float value;      // OP_CONST
+	std::string name; // OP_INPUT, or the local of a shared node
+	std::string load; // OP_INPUT, empty for a parameter
+};
+
+static std::vector<Node> nodes;
+static std::map<std::tuple<int, int, int>, int> opIndex;
+static std::map<float, int> constIndex;
+static std::map<std::string, int> inputIndex;
+
+static int newNode(Op op, int a, int b, float value, const std::string &name, const std::string &load) {
+	Node n;
+	n.op = op; n.a = a; n.b = b; n.value = value; n.name = name; n.load = load;
+	nodes.push_back(n);
+	return (int)nodes.size() - 1;
+}
+
+static int Const(float v) {
+	if (v == 0.0f) v = 0.0f; // no -0
+	std::map<float, int>::iterator it = constIndex.find(v);
+	if (it != constIndex.end()) return it->second;
+	return constIndex[v] = newNode(OP_CONST, -1, -1, v, "", "");
+}
+
+static int Input(const std::string &name, const std::string &load) {
+	std::map<std::string, int>::iterator it = inputIndex.find(name);
+	if (it != inputIndex.end()) return it->second;
+	return inputIndex[name] = newNode(OP_INPUT, -1, -1, 0.0f, name, load);
+}
+
+static int make(Op op, int a, int b) {
+	std::tuple<int, int, int> key(op, a, b);
+	std::map<std::tuple<int, int, int>, int>::iterator it = opIndex.find(key);
+	if (it != opIndex.end()) return it->second;
+	return opIndex[key] = newNode(op, a, b, 0.0f, "", "");
+}
+
+static bool isConst(int n) { return nodes[n].op == OP_CONST; }
+static bool isConst(int n, float v) { return isConst(n) && nodes[n].value == v; }
+static bool isNeg(int n) { return nodes[n].op == OP_NEG; }
+static bool isNegConst(int n) { return isConst(n) && nodes[n].value < 0.0f; }
+
+static int Neg(int a) {
+	if (isConst(a)) return Const(-nodes[a].value);
+	if (isNeg(a)) return nodes[a].a;
+	return make(OP_NEG, a, -1);
+}
+
+static int Sub(int a, int b);
+
+static int Add(int a, int b) {
+	if (isConst(a) && isConst(b)) return Const(nodes[a].value + nodes[b].value);
+	if (isConst(a, 0.0f)) return b;
+	if (isConst(b, 0.0f)) return a;
+	if (isNeg(b)) return Sub(a, nodes[b].a);
+	if (isNegConst(b)) return Sub(a, Const(-nodes[b].value));
+	if (isNeg(a)) return Sub(b, nodes[a].a);
+	if (isNegConst(a)) return Sub(b, Const(-nodes[a].value));
+	if (a > b) std::swap(a, b);
+	return make(OP_ADD, a, b);
+}
+
+static int Sub(int a, int b) {
+	if (isConst(a) && isConst(b)) return Const(nodes[a].value - nodes[b].value);
+	if (isConst(b, 0.0f)) return a;
+	if (isConst(a, 0.0f)) return Neg(b);
+	if (a == b) return Const(0.0f);
+	if (isNeg(b)) return Add(a, nodes[b].a);
+	if (isNegConst(b)) return Add(a, Const(-nodes[b].value));
+	if (isNeg(a)) return Neg(Add(nodes[a].a, b));
+	return make(OP_SUB, a, b);
+}
+
+static int Mul(int a, int b) {
+	if (isConst(a) && isConst(b)) return Const(nodes[a].value * nodes[b].value);
+	if (isConst(a, 0.0f) || isConst(b, 0.0f)) return Const(0.0f);
+	if (isConst(a, 1.0f)) return b;
+	if (isConst(b, 1.0f)) return a;
+	if (isNeg(a)) return Neg(Mul(nodes[a].a, b));
+	if (isNeg(b)) return Neg(Mul(a, nodes[b].a));
+	if (isNegConst(a)) return Neg(Mul(Const(-nodes[a].value), b));
+	if (isNegConst(b)) return Neg(Mul(a, Const(-nodes[b].value)));
+	// constants first, then by creation
+	if (isConst(b) || (!isConst(a) && a > b)) std::swap(a, b);
+	return make(OP_MUL, a, b);
+}
+
+static int Div(int a, int b) {
+	if (isConst(a) && isConst(b)) return Const(nodes[a].value / nodes[b].value);
+	return make(OP_DIV, a, b);
+}
+
+static int Rsqrt(int a) {
+	return make(OP_RSQRT, a, -1);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// symbolic matrices
+
+struct Sym {
+	int rows, cols;
+	std::vector<int> e;
+	Sym(int r, int c) : rows(r), cols(c), e(r * c, Const(0.0f)) {}
+	int &operator()(int i, int j) { return e[i * cols + j]; }
+	int operator()(int i, int j) const { return e[i * cols + j]; }
+};
+
+static int dot(const Sym &A, int i, const Sym &B, int j, bool transB) {
+	int s = Const(0.0f);
+	for (int k = 0; k < A.cols; k++) s = Add(s, Mul(A(i, k), transB ? B(j, k) : B(k, j)));
+	return s;
+}
+
+// A * B, only the upper triangle when the result is symmetric
+static Sym multiply(const Sym &A, const Sym &B, bool upper = false) {
+	Sym C(A.rows, B.cols);
+	for (int i = 0; i < C.rows; i++) for (int j = upper ? i : 0; j < C.cols; j++) C(i, j) = dot(A, i, B, j, false);
+	return C;
+}
+
+// A * B'
+static Sym multiplyTransB(const Sym &A, const Sym &B, bool upper) {
+	Sym C(A.rows, B.rows);
+	for (int i = 0; i < C.rows; i++) for (int j = upper ? i : 0; j < C.cols; j++) C(i, j) = dot(A, i, B, j, true);
+	return C;
+}
+
+static std::string str(const char *fmt, int i, int j = 0) {
+	char buf[32];
+	snprintf(buf, sizeof(buf), fmt, i, j);
+	return buf;
+}
+
+// the symmetric P of the filter, upper triangle loaded
+static Sym covariance() {
+	Sym P(N, N);
+	for (int i = 0; i < N; i++) for (int j = i; j < N; j++) {
+		P(i, j) = P(j, i) = Input(str("p%d%d", i, j), str("P[%d]", i * N + j));
+	}
+	return P;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// kernels
+
+struct Store {
+	std::vector<std::string> lhs;
+	int node;
+};
+
+struct Kernel {
+	std::string comment, signature;
+	std::vector<Store> stores;
+};
+
+static void store(Kernel &k, const std::string &lhs, int node) {
+	Store s;
+	s.lhs.push_back(lhs);
+	s.node = node;
+	k.stores.push_back(s);
+}
+
+// P = the upper triangle of C, mirrored
+static void storeCovariance(Kernel &k, const Sym &C) {
+	for (int i = 0; i < N; i++) for (int j = i; j < N; j++) {
+		Store s;
+		s.lhs.push_back(str("P[%d]", i * N + j));
+		if (j != i) s.lhs.push_back(str("P[%d]", j * N + i));
+		s.node = C(i, j);
+		k.stores.push_back(s);
+	}
+}
+
+// P = F * P * F' + Q * qdt, F = [A B; 0 I] with rows 0-3 loaded: the
+// predictions of EKF_AHRSPredict and EKF_AHRSPredictPreint and their
+// products in EKF_AHRSFlushCovariance
+static Kernel propagate() {
+	Kernel k;
+	Sym F(N, N), P = covariance();
+	for (int i = 0; i < 4; i++) for (int j = 0; j < N; j++) F(i, j) = Input(str("f%d%d", i, j), str("F[%d]", i * N + j));
+	for (int i = 4; i < N; i++) F(i, i) = Const(1.0f);
+	Sym C = multiplyTransB(multiply(F, P), F, true);
+	int qdt = Input("qdt", "");
+	for (int i = 0; i < N; i++) C(i, i) = Add(C(i, i), Mul(Input(str("q%d", i), str("Q[%d]", i * (N + 1))), qdt));
+	k.comment = "P = F * P * F' + Q * qdt, F = [A B; 0 I] (rows 0-3 read) and Q diagonal";
+	k.signature = "void EKF_GenPropagate(float *P, const float *F, const float *Q, float qdt)";
+	storeCovariance(k, C);
+	return k;
+}
+
+// H of the quaternion for the accel (rows 0-2) and the mag (rows 3-5) of
+// EKF_AHRSUpdate, the bias columns are zero
+static void jacobian(Sym &H, int row, bool mag) {
+	int q[4], _2q[4], bx = Input("bx", ""), bz = Input("bz", "");
+	for (int i = 0; i < 4; i++) {
+		q[i] = Input(str("x%d", i), str("X[%d]", i));
+		_2q[i] = Mul(Const(2.0f), q[i]);
+	}
+	int h[3][4];
+	if (!mag) {
+		int a[3][4] = {
+			{_2q[2], Neg(_2q[3]), _2q[0], Neg(_2q[1])},
+			{Neg(_2q[1]), Neg(_2q[0]), Neg(_2q[3]), Neg(_2q[2])},
+			{Neg(_2q[0]), _2q[1], _2q[2], Neg(_2q[3])}};
+		for (int i = 0; i < 3; i++) for (int j = 0; j < 4; j++) h[i][j] = a[i][j];
+	} else {
+		int m[3][4] = {
+			{Sub(Mul(bx, _2q[0]), Mul(bz, _2q[2])), Add(Mul(bx, _2q[1]), Mul(bz, _2q[3])),
+				Sub(Neg(Mul(bx, _2q[2])), Mul(bz, _2q[0])), Sub(Mul(bz, _2q[1]), Mul(bx, _2q[3]))},
+			{Sub(Mul(bz, _2q[1]), Mul(bx, _2q[3])), Add(Mul(bx, _2q[2]), Mul(bz, _2q[0])),
+				Add(Mul(bx, _2q[1]), Mul(bz, _2q[3])), Sub(Mul(bz, _2q[2]), Mul(bx, _2q[0]))},
+			{Add(Mul(bx, _2q[2]), Mul(bz, _2q[0])), Sub(Mul(bx, _2q[3]), Mul(bz, _2q[1])),
+				Sub(Mul(bx, _2q[0]), Mul(bz, _2q[2])), Add(Mul(bx, _2q[1]), Mul(bz, _2q[3]))}};
+		for (int i = 0; i < 3; i++) for (int j = 0; j < 4; j++) h[i][j] = m[i][j];
+	}
+	for (int i = 0; i < 3; i++) for (int j = 0; j < 4; j++) H(row + i, j) = h[i][j];
+}
+
+// the measurement update of a model H with innovations y and R = diag(r):
+// K = P * H' / S with S = H * P * H' + R, X = X + K * y, the quaternion
+// normalized, and P = (I - K * H) * P * (I - K * H)' + K * R * K'
+static void update(Kernel &k, const Sym &H, const std::vector<int> &y, const std::vector<int> &r) {
+	int m = H.rows;
+	Sym P = covariance();
+	Sym PHt = multiplyTransB(P, H, false);
+	Sym S = multiply(H, PHt, true);
+	for (int i = 0; i < m; i++) S(i, i) = Add(S(i, i), r[i]);
+
+	// S = L * D * L', E holds L * D below the diagonal
+	Sym L(m, m), E(m, m);
+	std::vector<int> dinv(m);
+	for (int j = 0; j < m; j++) {
+		for (int i = j; i < m; i++) {
+			int a = S(j, i);
+			for (int c = 0; c < j; c++) a = Sub(a, Mul(E(i, c), L(j, c)));
+			E(i, j) = a;
+		}
+		dinv[j] = Div(Const(1.0f), E(j, j));
+		for (int i = j + 1; i < m; i++) L(i, j) = Mul(E(i, j), dinv[j]);
+	}
+
+	// K' = S^-1 * PHt', a forward and a back substitution per state
+	Sym K(N, m);
+	for (int i = 0; i < N; i++) {
+		std::vector<int> z(m);
+		for (int j = 0; j < m; j++) {
+			z[j] = PHt(i, j);
+			for (int c = 0; c < j; c++) z[j] = Sub(z[j], Mul(L(j, c), z[c]));
+		}
+		for (int j = m - 1; j >= 0; j--) {
+			int x = Mul(z[j], dinv[j]);
+			for (int c = j + 1; c < m; c++) x = Sub(x, Mul(L(c, j), K(i, c)));
+			K(i, j) = x;
+		}
+	}
+
+	// X = X + K * y, the quaternion normalized
+	int x[N], n2 = Const(0.0f);
+	for (int i = 0; i < N; i++) {
+		x[i] = Input(str("x%d", i), str("X[%d]", i));
+		for (int j = 0; j < m; j++) x[i] = Add(x[i], Mul(K(i, j), y[j]));
+		if (i < 4) n2 = Add(n2, Mul(x[i], x[i]));
+	}
+	int norm = Rsqrt(n2);
+	for (int i = 0; i < N; i++) store(k, str("X[%d]", i), i < 4 ? Mul(x[i], norm) : x[i]);
+
+	// Joseph form, K * H has the zero bias columns of H
+	Sym KH = multiply(K, H), IKH(N, N);
+	for (int i = 0; i < N; i++) for (int j = 0; j < N; j++) IKH(i, j) = Sub(Const(i == j ? 1.0f : 0.0f), KH(i, j));
+	Sym C = multiplyTransB(multiply(IKH, P), IKH, true);
+	Sym KR(N, m);
+	for (int i = 0; i < N; i++) for (int j = 0; j < m; j++) KR(i, j) = Mul(K(i, j), r[j]);
+	Sym KRK = multiplyTransB(KR, K, true);
+	for (int i = 0; i < N; i++) for (int j = i; j < N; j++) C(i, j) = Add(C(i, j), KRK(i, j));
+	storeCovariance(k, C);
+}
+
+static std::vector<int> innovations(int m) {
+	std::vector<int> y(m);
+	for (int i = 0; i < m; i++) y[i] = Input(str("y%d", i), str("y[%d]", i));
+	return y;
+}
+
+static Kernel updateJoint() {
+	Kernel k;
+	Sym H(6, N);
+	std::vector<int> r(6);
+	jacobian(H, 0, false);
+	jacobian(H, 3, true);
+	for (int i = 0; i < 6; i++) r[i] = Input(str("r%d", i), str("r[%d]", i));
+	update(k, H, innovations(6), r);
+	k.comment = "the joint accel and mag update of EKF_AHRSUpdate, R = diag(r)";
+	k.signature = "void EKF_GenUpdate(float *P, float *X, const float *y, const float *r, float bx, float bz)";
+	return k;
+}
+
+static Kernel updateBlock(bool mag) {
+	Kernel k;
+	Sym H(3, N);
+	jacobian(H, 0, mag);
+	update(k, H, innovations(3), std::vector<int>(3, Input("r", "")));
+	if (mag) {
+		k.comment = "the mag update of EKF_AHRSUpdateMag, R = r * I";
+		k.signature = "void EKF_GenUpdateMag(float *P, float *X, const float *y, float r, float bx, float bz)";
+	} else {
+		k.comment = "the accel update of EKF_AHRSUpdateAccel, R = r * I";
+		k.signature = "void EKF_GenUpdateAccel(float *P, float *X, const float *y, float r)";
+	}
+	return k;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// emission
+
+static std::string constant(float v) {
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%.9g", v);
+	std::string s = buf;
+	if (s.find_first_of(".e") == std::string::npos) s += ".0";
+	return s + "f";
+}
+
+static int precedence(int n) {
+	const Node &d = nodes[n];
+	if (!d.name.empty()) return 4;
+	switch (d.op) {
+	case OP_CONST: return d.value < 0.0f ? 3 : 4;
+	case OP_NEG: return 3;
+	case OP_MUL: case OP_DIV: return 2;
+	case OP_ADD: case OP_SUB: return 1;
+	default: return 4;
+	}
+}
+
+// the right operand binds tighter, so the order of the sums and products of
+// the graph is kept
+static std::string expression(int n, int minPrecedence) {
+	const Node &d = nodes[n];
+	std::string s;
+	if (!d.name.empty()) return d.name;
+	switch (d.op) {
+	case OP_CONST: s = constant(d.value); break;
+	case OP_NEG: s = "-" + expression(d.a, 3); break;
+	case OP_ADD: s = expression(d.a, 1) + " + " + expression(d.b, 2); break;
+	case OP_SUB: s = expression(d.a, 1) + " - " + expression(d.b, 2); break;
+	case OP_MUL: s = expression(d.a, 2) + " * " + expression(d.b, 3); break;
+	case OP_DIV: s = expression(d.a, 2) + " / " + expression(d.b, 3); break;
+	case OP_RSQRT: s = "FastSqrtI(" + expression(d.a, 0) + ")"; break;
+	default: break;
+	}
+	return precedence(n) < minPrecedence ? "(" + s + ")" : s;
+}
+
+// long sums are broken before a + or a - once past LINE_WIDTH
+#define LINE_WIDTH 100
+
+static void statement(FILE *f, const std::string &s) {
+	size_t start = 0, width = 4;
+	for (size_t i = 0; i + 3 <= s.size(); i++) {
+		if (i - start + width > LINE_WIDTH && (s.compare(i, 3, " + ") == 0 || s.compare(i, 3, " - ") == 0)) {
+			fprintf(f, "%s%s\n", start == 0 ? "\t" : "\t\t", s.substr(start, i - start).c_str());
+			start = i + 1;
+			width = 8;
+		}
+	}
+	fprintf(f, "%s%s\n", start == 0 ? "\t" : "\t\t", s.substr(start).c_str());
+}
+
+static void visit(int n, std::vector<int> &uses) {
+	if (uses[n]++ > 0) return;
+	if (nodes[n].a >= 0) visit(nodes[n].a, uses);
+	if (nodes[n].b >= 0) visit(nodes[n].b, uses);
+}
+
+static void emit(FILE *f, const Kernel &k) {
+	std::vector<int> uses(nodes.size(), 0);
+	int counts[OP_RSQRT + 1] = {0}, locals = 0;
+
+	for (size_t i = 0; i < k.stores.size(); i++) visit(k.stores[i].node, uses);
+	for (size_t i = 0; i < nodes.size(); i++) {
+		if (uses[i] == 0) continue;
+		counts[nodes[i].op]++;
+		if (nodes[i].op != OP_INPUT && nodes[i].op != OP_CONST) nodes[i].name = uses[i] > 1 ? str("t%d", locals++) : "";
+	}
+
+	fprintf(f, "//%s\n", k.comment.c_str());
+	fprintf(f, "//%d multiplications, %d additions, %d negations, %d divisions, %d rsqrt\n",
+			counts[OP_MUL], counts[OP_ADD] + counts[OP_SUB], counts[OP_NEG], counts[OP_DIV], counts[OP_RSQRT]);
+	fprintf(f, "%s\n{\n", k.signature.c_str());
+	// a declaration per row of P and F and per vector
+	std::string key;
+	for (size_t i = 0; i < nodes.size(); i++) {
+		if (uses[i] == 0 || nodes[i].op != OP_INPUT || nodes[i].load.empty()) continue;
+		const std::string &name = nodes[i].name;
+		std::string next = name.substr(0, name.size() - 1);
+		fprintf(f, "%s%s = %s", key.empty() ? "\tconst float " : next == key ? ", " : ";\n\tconst float ",
+				name.c_str(), nodes[i].load.c_str());
+		key = next;
+	}
+	fprintf(f, ";\n\n");
+	for (size_t i = 0; i < nodes.size(); i++) {
+		if (uses[i] > 0 && nodes[i].op > OP_INPUT && !nodes[i].name.empty()) {
+			std::string name = nodes[i].name;
+			nodes[i].name = "";
+			statement(f, "const float " + name + " = " + expression((int)i, 0) + ";");
+			nodes[i].name = name;
+		}
+	}
+	fprintf(f, "\n");
+	for (size_t i = 0; i < k.stores.size(); i++) {
+		std::string s;
+		for (size_t j = 0; j < k.stores[i].lhs.size(); j++) s += k.stores[i].lhs[j] + " = ";
+		statement(f, s + expression(k.stores[i].node, 0) + ";");
+	}
+	fprintf(f, "}\n\n");
+
+	for (size_t i = 0; i < nodes.size(); i++) if (nodes[i].op > OP_INPUT) nodes[i].name = "";
+}
+
+int main(int argc, char **argv) {
+	FILE *f = stdout;
+	if (argc > 1 && !(f = fopen(argv[1], "w"))) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	fprintf(f,
+			"/*\n"
+			" * EKFKernels.h\n"
+			" *\n"
+			" *  Created on: 18 oct. 2026\n"
+			" */\n"
+			"\n"
+			"//generated by AHRSTools/ekfCodeGen (MainCodeGen.cpp), do not edit: the\n"
+			"//models are there, \"make codegen\" in AHRSTools regenerates this file.\n"
+			"//\n"
+			"//straight-line covariance propagation and measurement updates of the 7\n"
+			"//state EKF of miniAHRS.h, see EKF_GENERATED_KERNELS. each kernel is the\n"
+			"//Mat_* sequence of the Joseph form path with the zeros and ones of F and\n"
+			"//H dropped, the shared subexpressions computed once, the inverse of S\n"
+			"//replaced by an LDL' solve and only the upper triangle of P formed. the\n"
+			"//inputs are read before any output is written, so P and X are updated\n"
+			"//in place. P is read from its upper triangle and written in full.\n"
+			"\n"
+			"#ifndef _EKFKERNELS_H_\n"
+			"#define _EKFKERNELS_H_\n"
+			"\n"
+			"#include \"FastMath.h\"\n"
+			"\n");
+
+	Kernel kernels[] = {propagate(), updateJoint(), updateBlock(false), updateBlock(true)};
+	for (size_t i = 0; i < sizeof(kernels) / sizeof(kernels[0]); i++) emit(f, kernels[i]);
+
+	fprintf(f, "#endif\n");
+	if (f != stdout) fclose(f);
+	return 0;
+}
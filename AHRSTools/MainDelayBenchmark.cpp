@@ -0,0 +1,75 @@
+#include <stdio.h>
+
+#include "miniAHRS.h"
+#include "EKFHistory.h"
+#include "benchUtils.h"
+#include "simUtils.h"
+
+// Runs the multi-rate EKF at 200 Hz with the accel every other sample and
+// the mag at 50 Hz arriving a few samples late. Compares applying each mag
+// sample when it arrives, as if it were current, with applying it at its
+// time stamp through the history ring of EKFHistory.h. Reports the time per
+// gyro sample and the attitude error over the second half of the run.
+
+#define N_SAMPLES 60000
+#define N_REPEAT 5
+#define ACC_EVERY 2
+#define MAG_EVERY 4
+
+static SimSample samples[N_SAMPLES];
+
+static void run(int delay, bool history, float dt) {
+	long long best = 0;
+	double sum = 0.0;
+	float up[3], accel[3], mag[3], q[4];
+
+	for (int n = 0; n < N_REPEAT; n++) {
+		sum = 0.0;
+		// EKF_AHRSInit takes the up vector, the accel reads -C' * [0 0 1]
+		for (int k = 0; k < 3; k++) { up[k] = -samples[0].accel[k]; mag[k] = samples[0].mag[k]; }
+		EKF_AHRSInit(up, mag);
+		EKF_HistoryReset();
+		long long t0 = getCurrentNanoseconds();
+		for (int i = 1; i < N_SAMPLES; i++) {
+			long time = (long)(i * dt * 1e6f);
+			EKF_AHRSPredictTimed(samples[i - 1].gyro, dt, time);
+			if (i % ACC_EVERY == 0) {
+				for (int k = 0; k < 3; k++) accel[k] = samples[i].accel[k];
+				EKF_AHRSUpdateAccelAt(accel, time);
+			}
+			// the mag sample taken at j arrives at i
+			int j = i - delay;
+			if (j > 0 && j % MAG_EVERY == 0) {
+				for (int k = 0; k < 3; k++) mag[k] = samples[j].mag[k];
+				if (history) EKF_AHRSUpdateMagAt(mag, (long)(j * dt * 1e6f));
+				else EKF_AHRSUpdateMagAt(mag, time);
+			}
+			EKF_AHRSGetQ(q);
+			if (i >= N_SAMPLES / 2) {
+				double e = simAttitudeError(samples[i].q, q);
+				sum += e * e;
+			}
+		}
+		long long t = getCurrentNanoseconds() - t0;
+		if (n == 0 || t < best) best = t;
+	}
+	printf("mag %2d samples late, %-12s %8.1f ns/sample  rms %6.3f deg\n", delay,
+			history ? "at its time" : "on arrival", (double)best / (N_SAMPLES - 1),
+			sqrt(sum / (N_SAMPLES - N_SAMPLES / 2)));
+}
+
+int main(int argc, char **argv) {
+
+	SimConfig cfg;
+	simDefaultConfig(&cfg);
+	cfg.dt = 0.005f;
+	simGenerate(&cfg, samples, N_SAMPLES);
+
+	printf("%d samples at %.0f Hz, accel 1/%d, mag 1/%d\n", N_SAMPLES, 1.0 / cfg.dt, ACC_EVERY, MAG_EVERY);
+	run(0, false, cfg.dt);
+	for (int delay = 4; delay <= 16; delay *= 2) {
+		run(delay, false, cfg.dt);
+		run(delay, true, cfg.dt);
+	}
+	return 0;
+}
@@ -0,0 +1,99 @@
+#include <stdio.h>
+
+#include "EigenAHRS.h"
+#include "benchUtils.h"
+#include "simUtils.h"
+
+// Replays the same simulated motion through EKF_AHRSUpdate (miniAHRS.h)
+// and EigenAHRS, and reports the time per update and the attitude error
+// against the ground truth. The error is taken over the second half of
+// the run, once both filters have converged from the accel/mag start.
+
+#define N_SAMPLES 60000
+#define N_REPEAT 5
+
+static SimSample samples[N_SAMPLES];
+
+struct Result {
+	long long ns;
+	double rms;
+	double worst;
+};
+
+static void accumulateError(const SimSample &s, const float *q, int i, double *sum, double *worst) {
+	if (i < N_SAMPLES / 2) return;
+	double e = simAttitudeError(s.q, q);
+	*sum += e * e;
+	if (e > *worst) *worst = e;
+}
+
+static Result runMiniAHRS(float dt) {
+	Result r = {0, 0.0, 0.0};
+	double sum = 0.0;
+	float up[3], accel[3], mag[3], q[4];
+
+	for (int n = 0; n < N_REPEAT; n++) {
+		sum = 0.0;
+		r.worst = 0.0;
+		// EKF_AHRSInit takes the up vector, the accel reads -C' * [0 0 1];
+		// EKF_AHRSUpdate normalizes its inputs in place
+		for (int k = 0; k < 3; k++) { up[k] = -samples[0].accel[k]; mag[k] = samples[0].mag[k]; }
+		EKF_AHRSInit(up, mag);
+		long long t0 = getCurrentNanoseconds();
+		for (int i = 1; i < N_SAMPLES; i++) {
+			for (int k = 0; k < 3; k++) { accel[k] = samples[i].accel[k]; mag[k] = samples[i].mag[k]; }
+			EKF_AHRSUpdate(samples[i - 1].gyro, accel, mag, dt);
+			EKF_AHRSGetQ(q);
+			accumulateError(samples[i], q, i, &sum, &r.worst);
+		}
+		long long t = getCurrentNanoseconds() - t0;
+		if (n == 0 || t < r.ns) r.ns = t;
+	}
+	r.rms = sqrt(sum / (N_SAMPLES - N_SAMPLES / 2));
+	return r;
+}
+
+static Result runEigenAHRS(float dt) {
+	Result r = {0, 0.0, 0.0};
+	double sum = 0.0;
+	float q[4];
+
+	for (int n = 0; n < N_REPEAT; n++) {
+		EigenAHRS ahrs;
+		sum = 0.0;
+		r.worst = 0.0;
+		ahrs.initialize(samples[0].accel, samples[0].mag);
+		long long t0 = getCurrentNanoseconds();
+		for (int i = 1; i < N_SAMPLES; i++) {
+			ahrs.update(samples[i - 1].gyro, samples[i].accel, samples[i].mag, dt);
+			ahrs.getQuaternion(q);
+			accumulateError(samples[i], q, i, &sum, &r.worst);
+		}
+		long long t = getCurrentNanoseconds() - t0;
+		if (n == 0 || t < r.ns) r.ns = t;
+	}
+	r.rms = sqrt(sum / (N_SAMPLES - N_SAMPLES / 2));
+	return r;
+}
+
+static void report(const char *name, const Result &r) {
+	printf("%-12s %9.1f ns/update  rms %7.3f deg  max %7.3f deg\n", name,
+			(double)r.ns / (N_SAMPLES - 1), r.rms, r.worst);
+}
+
+int main(int argc, char **argv) {
+
+	SimConfig cfg;
+	simDefaultConfig(&cfg);
+	simGenerate(&cfg, samples, N_SAMPLES);
+
+	printf("%d samples at %.0f Hz, Eigen SIMD: %s\n", N_SAMPLES, 1.0 / cfg.dt,
+			Eigen::SimdInstructionSetsInUse());
+
+	Result mini = runMiniAHRS(cfg.dt);
+	Result eigen = runEigenAHRS(cfg.dt);
+	report("miniAHRS", mini);
+	report("EigenAHRS", eigen);
+	printf("speedup x%.2f\n", (double)mini.ns / (double)eigen.ns);
+	return 0;
+}
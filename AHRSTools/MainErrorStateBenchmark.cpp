@@ -0,0 +1,134 @@
+#include <stdio.h>
+
+#include "Dense"
+#include "ErrorStateAHRS.h"
+#include "benchUtils.h"
+#include "simUtils.h"
+
+// Replays the same simulated motion through EKF_AHRSUpdate (7 state
+// quaternion EKF) and ErrorStateAHRS (6 state error-state EKF). Reports the
+// time per update, the attitude error over the second half of the run and
+// the conditioning of the covariance: its smallest eigenvalue, the condition
+// number of the correlation matrix (independent of the units of each state)
+// and the largest asymmetry. For the quaternion EKF it also reports the
+// share of the quaternion variance that lies along q itself, a direction
+// the unit norm constraint makes unobservable.
+
+#define N_SAMPLES 60000
+#define N_REPEAT 5
+#define N_CHECK 100 // covariance check period (samples)
+
+static SimSample samples[N_SAMPLES];
+
+struct Result {
+	long long ns;
+	double rms;
+	double minEig;     // smallest eigenvalue seen
+	double maxCond;    // largest correlation condition number seen
+	double asym;       // largest |P(i,j) - P(j,i)|
+	double normShare;  // largest q' * Pqq * q / trace(Pqq)
+};
+
+template <unsigned short N>
+static void checkCovariance(const Mat<N, N> &P, Result *r) {
+	Eigen::Matrix<double, N, N> A;
+	for (unsigned int i = 0; i < N; i++) {
+		for (unsigned int j = 0; j < N; j++) {
+			A(i, j) = P(i, j);
+			double d = fabs((double)P(i, j) - (double)P(j, i));
+			if (d > r->asym) r->asym = d;
+		}
+	}
+	Eigen::SelfAdjointEigenSolver<Eigen::Matrix<double, N, N> > es(A, Eigen::EigenvaluesOnly);
+	if (es.eigenvalues()(0) < r->minEig) r->minEig = es.eigenvalues()(0);
+	Eigen::Matrix<double, N, 1> d = A.diagonal().cwiseSqrt().cwiseInverse();
+	Eigen::Matrix<double, N, N> C = d.asDiagonal() * A * d.asDiagonal();
+	es.compute(C, Eigen::EigenvaluesOnly);
+	double lo = es.eigenvalues()(0), hi = es.eigenvalues()(N - 1);
+	double cond = lo > 0.0 ? hi / lo : INFINITY;
+	if (cond > r->maxCond) r->maxCond = cond;
+}
+
+// The quaternion EKF keeps its covariance in the file-static P of miniAHRS.h
+static Result runMiniAHRS(float dt) {
+	Result r = {0, 0.0, INFINITY, 0.0, 0.0, 0.0};
+	float up[3], accel[3], mag[3], q[4];
+
+	for (int n = 0; n < N_REPEAT; n++) {
+		double sum = 0.0;
+		// EKF_AHRSInit takes the up vector, the accel reads -C' * [0 0 1];
+		// EKF_AHRSUpdate normalizes its inputs in place
+		for (int k = 0; k < 3; k++) { up[k] = -samples[0].accel[k]; mag[k] = samples[0].mag[k]; }
+		EKF_AHRSInit(up, mag);
+		long long t0 = getCurrentNanoseconds();
+		for (int i = 1; i < N_SAMPLES; i++) {
+			for (int k = 0; k < 3; k++) { accel[k] = samples[i].accel[k]; mag[k] = samples[i].mag[k]; }
+			EKF_AHRSUpdate(samples[i - 1].gyro, accel, mag, dt);
+			EKF_AHRSGetQ(q);
+			if (i >= N_SAMPLES / 2) {
+				double e = simAttitudeError(samples[i].q, q);
+				sum += e * e;
+			}
+			if (n == 0 && i % N_CHECK == 0) {
+				checkCovariance(P, &r);
+				double v = 0.0, tr = 0.0;
+				for (int a = 0; a < 4; a++) {
+					tr += P(a, a);
+					for (int b = 0; b < 4; b++) v += q[a] * P(a, b) * q[b];
+				}
+				if (v / tr > r.normShare) r.normShare = v / tr;
+			}
+		}
+		long long t = getCurrentNanoseconds() - t0;
+		// the first pass also checks the covariance and is not timed
+		if (n == 1 || (n > 1 && t < r.ns)) r.ns = t;
+		r.rms = sqrt(sum / (N_SAMPLES - N_SAMPLES / 2));
+	}
+	return r;
+}
+
+static Result runErrorState(float dt) {
+	Result r = {0, 0.0, INFINITY, 0.0, 0.0, 0.0};
+	float accel[3], mag[3], q[4];
+
+	for (int n = 0; n < N_REPEAT; n++) {
+		ErrorStateAHRS ahrs;
+		double sum = 0.0;
+		ahrs.initialize(samples[0].accel, samples[0].mag);
+		long long t0 = getCurrentNanoseconds();
+		for (int i = 1; i < N_SAMPLES; i++) {
+			for (int k = 0; k < 3; k++) { accel[k] = samples[i].accel[k]; mag[k] = samples[i].mag[k]; }
+			ahrs.update(samples[i - 1].gyro, accel, mag, dt);
+			ahrs.getQuaternion(q);
+			if (i >= N_SAMPLES / 2) {
+				double e = simAttitudeError(samples[i].q, q);
+				sum += e * e;
+			}
+			if (n == 0 && i % N_CHECK == 0) checkCovariance(ahrs.getCovariance(), &r);
+		}
+		long long t = getCurrentNanoseconds() - t0;
+		// the first pass also checks the covariance and is not timed
+		if (n == 1 || (n > 1 && t < r.ns)) r.ns = t;
+		r.rms = sqrt(sum / (N_SAMPLES - N_SAMPLES / 2));
+	}
+	return r;
+}
+
+static void report(const char *name, const Result &r) {
+	printf("%-16s %8.1f ns/update  rms %6.3f deg  min eig %9.3e  cond %9.3e  asym %9.3e",
+			name, (double)r.ns / (N_SAMPLES - 1), r.rms, r.minEig, r.maxCond, r.asym);
+	if (r.normShare > 0.0) printf("  along q %.1f%%", 100.0 * r.normShare);
+	printf("\n");
+}
+
+int main(int argc, char **argv) {
+
+	SimConfig cfg;
+	simDefaultConfig(&cfg);
+	simGenerate(&cfg, samples, N_SAMPLES);
+
+	printf("%d samples at %.0f Hz, SIMD kernels: %s\n", N_SAMPLES, 1.0 / cfg.dt, MAT_SIMD_NAME);
+	report("miniAHRS (7)", runMiniAHRS(cfg.dt));
+	report("ErrorState (6)", runErrorState(cfg.dt));
+	return 0;
+}
@@ -0,0 +1,255 @@
+#include <stdio.h>
+#include <math.h>
+
+#include "FastMath.h"
+#include "Quaternion.h"
+#include "benchUtils.h"
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Error and speed of FastMath.h against libm. The inputs sweep the domain
+// of each function on a regular grid (logarithmic for sqrt and ln); the
+// error is the largest absolute difference to the double precision libm
+// result, and the largest and RMS difference in ulp of the float nearest to
+// that result. The time is the best of N_REPEAT passes over N elements.
+//
+// The precision tier of FastMath.h is a compile time choice, the program is
+// built once per tier: fastMathBenchmark, fastMathBenchmarkBalanced and
+// fastMathBenchmarkExact. The batch functions and the hardware reciprocal
+// square root estimate (rsqrtss on x86, frsqrte/vrsqrte on ARM) do not
+// depend on the tier.
+
+#define N (1 << 20)
+#define N_REPEAT 10
+
+static float in0[N], in1[N], out0[N], out1[N];
+static double ref0[N], ref1[N];
+static float quat[4 * N], euler[3 * N];
+static volatile float sink;
+
+static const char *tierName[] = {"fast", "balanced", "exact"};
+
+#if defined(__SSE__)
+#define HARDWARE_RSQRT "rsqrtss"
+static inline float hardwareRsqrt(float x) {
+	return _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+}
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define HARDWARE_RSQRT "frsqrte"
+static inline float hardwareRsqrt(float x) {
+	return vrsqrtes_f32(x);
+}
+#elif defined(__ARM_NEON)
+#define HARDWARE_RSQRT "vrsqrte"
+static inline float hardwareRsqrt(float x) {
+	return vget_lane_f32(vrsqrte_f32(vdup_n_f32(x)), 0);
+}
+#endif
+
+static double nsPerElement(long long t) {
+	return (double)t / N;
+}
+
+#define TIME(best, body) { \
+	best = 0; \
+	for (int r = 0; r < N_REPEAT; r++) { \
+		long long t0 = getCurrentNanoseconds(); \
+		body; \
+		long long dt = getCurrentNanoseconds() - t0; \
+		if (r == 0 || dt < best) best = dt; \
+	} \
+	sink = out0[N / 2] + out1[N / 2] + euler[N / 2]; \
+}
+
+// float spacing at the float nearest to r, the smallest subnormal at 0
+static double ulp(double r) {
+	int e;
+	float f = FastAbs((float)r);
+	if (f == 0.0f || f < 1.17549435e-38f) return ldexp(1.0, -149);
+	frexp(f, &e);
+	return ldexp(1.0, e - 24);
+}
+
+struct Error {
+	double abs, ulp, rmsUlp;
+};
+
+static void addError(Error *e, const float *out, const double *ref) {
+	double sum = e->rmsUlp * e->rmsUlp * N;
+	for (int i = 0; i < N; i++) {
+		double d = fabs(out[i] - ref[i]);
+		double u = d / ulp(ref[i]);
+		e->abs = fmax(e->abs, d);
+		e->ulp = fmax(e->ulp, u);
+		sum += u * u;
+	}
+	e->rmsUlp = sqrt(sum / N);
+}
+
+static void report(const char *name, long long t, const Error &e) {
+	printf("%-24s %6.2f ns  max %.1e  max %10.1f ulp  rms %8.2f ulp\n", name, nsPerElement(t), e.abs, e.ulp, e.rmsUlp);
+}
+
+// time of body, error of out0 against ref0
+#define SCALAR(name, body) { \
+	long long t; \
+	Error e = {0.0, 0.0, 0.0}; \
+	TIME(t, body); \
+	addError(&e, out0, ref0); \
+	report(name, t, e); \
+}
+
+// the same with out1 against ref1, for sin and cos together
+#define PAIR(name, body) { \
+	long long t; \
+	Error e = {0.0, 0.0, 0.0}; \
+	TIME(t, body); \
+	addError(&e, out0, ref0); \
+	addError(&e, out1, ref1); \
+	report(name, t, e); \
+}
+
+static void logSweep(double lo, double hi) {
+	for (int i = 0; i < N; i++) in0[i] = (float)(lo * pow(hi / lo, (double)i / (N - 1)));
+}
+
+static void linearSweep(float *in, double lo, double hi) {
+	for (int i = 0; i < N; i++) in[i] = (float)(lo + (hi - lo) * i / (N - 1));
+}
+
+static void sqrtBench() {
+	logSweep(1e-6, 1e6);
+	printf("rsqrt, %d points in [1e-6, 1e6]\n", N);
+	for (int i = 0; i < N; i++) ref0[i] = 1.0 / sqrt((double)in0[i]);
+	SCALAR("FastSqrtI", for (int i = 0; i < N; i++) out0[i] = FastSqrtI(in0[i]));
+	SCALAR("1 / sqrtf", for (int i = 0; i < N; i++) out0[i] = 1.0f / sqrtf(in0[i]));
+#ifdef HARDWARE_RSQRT
+	SCALAR(HARDWARE_RSQRT, for (int i = 0; i < N; i++) out0[i] = hardwareRsqrt(in0[i]));
+	SCALAR(HARDWARE_RSQRT " + Newton", for (int i = 0; i < N; i++) {
+		float y = hardwareRsqrt(in0[i]);
+		out0[i] = y * (1.5f - 0.5f * in0[i] * y * y);
+	});
+#endif
+	printf("sqrt, %d points in [1e-6, 1e6]\n", N);
+	for (int i = 0; i < N; i++) ref0[i] = sqrt((double)in0[i]);
+	SCALAR("FastSqrt", for (int i = 0; i < N; i++) out0[i] = FastSqrt(in0[i]));
+	SCALAR("sqrtf", for (int i = 0; i < N; i++) out0[i] = sqrtf(in0[i]));
+}
+
+static void atan2Bench() {
+	// angles of the full circle at radii from 1e-3 to 1e3
+	for (int i = 0; i < N; i++) {
+		double a = 2.0 * M_PI * i / N - M_PI, r = pow(10.0, 6.0 * ((i * 7919LL) % N) / N - 3.0);
+		in0[i] = (float)(r * sin(a));
+		in1[i] = (float)(r * cos(a));
+		ref0[i] = atan2((double)in0[i], (double)in1[i]);
+	}
+	printf("atan2, %d points on circles of radius 1e-3 to 1e3\n", N);
+	SCALAR("FastAtan2", for (int i = 0; i < N; i++) out0[i] = FastAtan2(in0[i], in1[i]));
+	SCALAR("FastAtan2Batch", FastAtan2Batch(in0, in1, out0, N));
+	SCALAR("atan2f", for (int i = 0; i < N; i++) out0[i] = atan2f(in0[i], in1[i]));
+}
+
+static void asinBench() {
+	linearSweep(in0, -1.0, 1.0);
+	for (int i = 0; i < N; i++) ref0[i] = asin((double)in0[i]);
+	printf("asin, %d points in [-1, 1]\n", N);
+	SCALAR("FastAsin", for (int i = 0; i < N; i++) out0[i] = FastAsin(in0[i]));
+	SCALAR("FastAsinBatch", FastAsinBatch(in0, out0, N));
+	SCALAR("asinf", for (int i = 0; i < N; i++) out0[i] = asinf(in0[i]));
+}
+
+static void sinCosBench(double range) {
+	linearSweep(in0, -range, range);
+	for (int i = 0; i < N; i++) {
+		ref0[i] = sin((double)in0[i]);
+		ref1[i] = cos((double)in0[i]);
+	}
+	printf("sin and cos, %d points in [-%g, %g]\n", N, range, range);
+	if (range < 4.0) {
+		SCALAR("FastSin", for (int i = 0; i < N; i++) out0[i] = FastSin(in0[i]));
+		SCALAR("sinf", for (int i = 0; i < N; i++) out0[i] = sinf(in0[i]));
+	}
+	PAIR("FastSinCos", for (int i = 0; i < N; i++) FastSinCos(in0[i], &out0[i], &out1[i]));
+	PAIR("FastSinCosBatch", FastSinCosBatch(in0, out0, out1, N));
+	PAIR("sinf + cosf", for (int i = 0; i < N; i++) { out0[i] = sinf(in0[i]); out1[i] = cosf(in0[i]); });
+}
+
+static void tanBench() {
+	linearSweep(in0, -1.5, 1.5);
+	for (int i = 0; i < N; i++) ref0[i] = tan((double)in0[i]);
+	printf("tan, %d points in [-1.5, 1.5]\n", N);
+	SCALAR("FastTan", for (int i = 0; i < N; i++) out0[i] = FastTan(in0[i]));
+	SCALAR("tanf", for (int i = 0; i < N; i++) out0[i] = tanf(in0[i]));
+}
+
+static void lnPowBench() {
+	logSweep(1e-6, 1e6);
+	for (int i = 0; i < N; i++) ref0[i] = log((double)in0[i]);
+	printf("ln, %d points in [1e-6, 1e6]\n", N);
+	SCALAR("FastLn", for (int i = 0; i < N; i++) out0[i] = FastLn(in0[i]));
+	SCALAR("logf", for (int i = 0; i < N; i++) out0[i] = logf(in0[i]));
+
+	// x in [0.01, 100] against exponents in [-3, 3]
+	logSweep(0.01, 100.0);
+	for (int i = 0; i < N; i++) {
+		in1[i] = (float)(6.0 * ((i * 7919LL) % N) / N - 3.0);
+		ref0[i] = pow((double)in0[i], (double)in1[i]);
+	}
+	printf("pow, %d points, x in [0.01, 100], y in [-3, 3]\n", N);
+	SCALAR("FastPow", for (int i = 0; i < N; i++) out0[i] = FastPow(in0[i], in1[i]));
+	SCALAR("powf", for (int i = 0; i < N; i++) out0[i] = powf(in0[i], in1[i]));
+}
+
+// largest difference of the angles to those of the quaternions in double
+// precision, roll and yaw modulo 2 pi
+static double eulerError() {
+	double err = 0.0;
+	for (int i = 0; i < N; i++) {
+		const float *q = &quat[4 * i];
+		double q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3], ref[3];
+		ref[0] = atan2(2.0 * (q2 * q3 + q0 * q1), 2.0 * (q0 * q0 + q3 * q3) - 1.0);
+		ref[1] = asin(fmax(-1.0, fmin(1.0, -2.0 * (q1 * q3 - q0 * q2))));
+		ref[2] = atan2(2.0 * (q1 * q2 + q0 * q3), 2.0 * (q0 * q0 + q1 * q1) - 1.0);
+		for (int k = 0; k < 3; k++) {
+			double d = fabs(euler[3 * i + k] - ref[k]);
+			err = fmax(err, fmin(d, fabs(d - 2.0 * M_PI)));
+		}
+	}
+	return err;
+}
+
+static void eulerBench() {
+	long long t;
+
+	// a grid of attitudes, roll off +-pi, pitch within +-89 deg
+	for (int i = 0; i < N; i++) {
+		float rpy[3] = {(float)(M_PI * (2.0 * (i % 128 + 0.5) / 128 - 1.0)),
+				(float)(1.55 * (2.0 * ((i / 128) % 64) / 64 - 1.0)),
+				(float)(2.0 * M_PI * (i / 8192) / 128)};
+		Quaternion_FromEuler(&quat[4 * i], rpy);
+		Quaternion_Normalize(&quat[4 * i]);
+	}
+	printf("quaternion to Euler, %d attitudes\n", N);
+	TIME(t, for (int i = 0; i < N; i++) Quaternion_ToEuler(&quat[4 * i], &euler[3 * i]));
+	printf("%-24s %6.2f ns  max %.1e\n", "Quaternion_ToEuler", nsPerElement(t), eulerError());
+	TIME(t, Quaternion_ToEulerBatch(quat, euler, N));
+	printf("%-24s %6.2f ns  max %.1e\n", "Quaternion_ToEulerBatch", nsPerElement(t), eulerError());
+}
+
+int main(int argc, char **argv) {
+	printf("FAST_MATH_TIER %s, batch blocks of %d elements\n", tierName[FAST_MATH_TIER], FAST_BATCH_SIZE);
+	sqrtBench();
+	atan2Bench();
+	asinBench();
+	sinCosBench(M_PI);
+	sinCosBench(8192.0);
+	tanBench();
+	lnPowBench();
+	eulerBench();
+	return 0;
+}
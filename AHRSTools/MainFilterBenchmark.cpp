@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "MiniAHRSFilter.h"
+#include "ErrorStateAHRS.h"
+#include "GDKalmanAHRS.h"
+#include "MadgwickAHRS.h"
+#include "MahonyAHRS.h"
+#include "SRUKFAHRS.h"
+#include "KalmanRollPitch.hpp"
+#include "benchUtils.h"
+#include "simUtils.h"
+
+// Replays the same simulated motion through every filter engine and
+// reports the time per update and the attitude error against the ground
+// truth, taken over the second half of the run once all of them have
+// converged. A second pass repeats it with a higher peak rate (the first
+// argument, rad/s), where the linearization of the EKFs costs accuracy.
+// KalmanRollPitch (IMU/) has no heading, it is scored on the tilt alone.
+// Its Euler rates are singular at +-90 deg pitch, which both passes come
+// close to; the fast one crosses it at a high rate and the filter diverges.
+
+#define N_SAMPLES 60000
+#define N_REPEAT 5
+
+static SimSample samples[N_SAMPLES];
+
+// angle between the vertical axes of two attitudes (deg), whatever the heading
+static double tiltError(const double *p, const float *q) {
+	double u[3] = {2.0 * (p[1] * p[3] - p[0] * p[2]), 2.0 * (p[2] * p[3] + p[0] * p[1]),
+			p[0] * p[0] - p[1] * p[1] - p[2] * p[2] + p[3] * p[3]};
+	double v[3] = {2.0 * ((double)q[1] * q[3] - (double)q[0] * q[2]), 2.0 * ((double)q[2] * q[3] + (double)q[0] * q[1]),
+			(double)q[0] * q[0] - (double)q[1] * q[1] - (double)q[2] * q[2] + (double)q[3] * q[3]};
+	double d = (u[0] * v[0] + u[1] * v[1] + u[2] * v[2])
+			/ sqrt((u[0] * u[0] + u[1] * u[1] + u[2] * u[2]) * (v[0] * v[0] + v[1] * v[1] + v[2] * v[2]));
+	return acos(fmax(-1.0, fmin(1.0, d))) * 57.29577951308232;
+}
+
+template <class Filter>
+static void run(const char *name, float dt, bool tilt = false) {
+	long long best = 0;
+	double sum = 0.0, worst = 0.0;
+	float accel[3], mag[3], q[4];
+
+	for (int n = 0; n < N_REPEAT; n++) {
+		Filter filter;
+		sum = 0.0;
+		worst = 0.0;
+		// the filters normalize their inputs in place
+		for (int k = 0; k < 3; k++) { accel[k] = samples[0].accel[k]; mag[k] = samples[0].mag[k]; }
+		filter.initialize(accel, mag);
+		long long t0 = getCurrentNanoseconds();
+		for (int i = 1; i < N_SAMPLES; i++) {
+			for (int k = 0; k < 3; k++) { accel[k] = samples[i].accel[k]; mag[k] = samples[i].mag[k]; }
+			filter.update(samples[i - 1].gyro, accel, mag, dt);
+			filter.getQuaternion(q);
+			if (i >= N_SAMPLES / 2) {
+				double e = tilt ? tiltError(samples[i].q, q) : simAttitudeError(samples[i].q, q);
+				sum += e * e;
+				if (e > worst) worst = e;
+			}
+		}
+		long long t = getCurrentNanoseconds() - t0;
+		if (n == 0 || t < best) best = t;
+	}
+	printf("%-14s %8.1f ns/update  rms %6.3f deg  max %6.3f deg\n", name,
+			(double)best / (N_SAMPLES - 1), sqrt(sum / (N_SAMPLES - N_SAMPLES / 2)), worst);
+}
+
+int main(int argc, char **argv) {
+
+	SimConfig cfg;
+	float fast = argc > 1 ? atof(argv[1]) : 8.0f;
+
+	simDefaultConfig(&cfg);
+	for (int pass = 0; pass < 2; pass++) {
+		if (pass == 1) cfg.rate = fast;
+		simGenerate(&cfg, samples, N_SAMPLES);
+
+		printf("%d samples at %.0f Hz, peak rate %.1f rad/s, SIMD kernels: %s\n", N_SAMPLES,
+				1.0 / cfg.dt, cfg.rate, MAT_SIMD_NAME);
+		run<MiniAHRSFilter>("miniAHRS", cfg.dt);
+		run<ErrorStateAHRS>("ErrorState", cfg.dt);
+		run<SRUKFAHRS>("SR-UKF", cfg.dt);
+		run<GDKalmanAHRS>("GDKalman", cfg.dt);
+		run<MahonyAHRS>("Mahony", cfg.dt);
+		run<MadgwickAHRS>("Madgwick", cfg.dt);
+		run<KalmanRollPitch>("RollPitch tilt", cfg.dt, true);
+		printf("\n");
+	}
+	return 0;
+}
@@ -0,0 +1,226 @@
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+
+#include "FixedPointAHRS.h"
+#include "ErrorStateAHRS.h"
+#include "MiniAHRSFilter.h"
+#include "benchUtils.h"
+#include "imuSynth.h"
+
+// the register scaling of the driver, after the headers that use X, Y and Z
+#include "MPU9250.hpp"
+
+// FixedPointAHRS against the float engines on the same raw samples. A
+// session of imuSynth.h (gyro bias, scale and misalignment errors,
+// vibration and magnetic disturbances), quantized as in imuGenerator, is
+// replayed through MiniAHRSFilter (7 state EKF), ErrorStateAHRS (the float
+// twin of the fixed point engine) and FixedPointAHRS. The float engines get
+// the counts through ImuLog_Calibrate, the fixed point one the counts and
+// the integer calibration. It reports the time per update (best of
+// N_REPEAT), the attitude error to the truth over the second half of the
+// first run, and the difference between the fixed point engine and its
+// twin. The float engines keep their bias and covariance from one run to
+// the next (there is no reset), so only the first run is scored.
+// The first part checks the integer sqrt, rsqrt, atan2 and asin.
+//
+// The times are those of this host: on a core without an FPU every float
+// op of the float engines becomes a library call and the ratio grows.
+
+#define N_SAMPLES 60000
+#define N_REPEAT 5
+#define N_MATH (1 << 20)
+
+// AK8963 at BITS_16, see AK8963::resolution
+#define MAG_RESOLUTION 0.15f
+
+static ImuLogRecord records[N_SAMPLES];
+static float truth[N_SAMPLES][4];
+static float quat[3][N_SAMPLES][4];
+static int32_t in0[N_MATH], in1[N_MATH], out[N_MATH];
+static volatile int32_t sink;
+
+struct Result {
+	long long ns;
+	double rms, max;
+};
+
+// angle of the rotation between two attitudes (deg)
+static double attitudeError(const float *p, const float *q) {
+	double d = (double)p[0] * q[0] + (double)p[1] * q[1] + (double)p[2] * q[2] + (double)p[3] * q[3];
+	double n = sqrt(((double)p[0] * p[0] + (double)p[1] * p[1] + (double)p[2] * p[2] + (double)p[3] * p[3])
+			* ((double)q[0] * q[0] + (double)q[1] * q[1] + (double)q[2] * q[2] + (double)q[3] * q[3]));
+	return 2.0 * acos(fmin(1.0, fabs(d / n))) * 57.29577951308232;
+}
+
+static void score(int engine, Result *r) {
+	double sum = 0.0;
+	r->max = 0.0;
+	for (int i = N_SAMPLES / 2; i < N_SAMPLES; i++) {
+		double e = attitudeError(truth[i], quat[engine][i]);
+		sum += e * e;
+		if (e > r->max) r->max = e;
+	}
+	r->rms = sqrt(sum / (N_SAMPLES - N_SAMPLES / 2));
+}
+
+static Result runFloat(IAttitudeFilter *filter, int engine, const ImuLogHeader *h) {
+	Result r = {0, 0.0, 0.0};
+	float accel[3], mag[3], q[4];
+	static float g[N_SAMPLES][3], a[N_SAMPLES][3], m[N_SAMPLES][3];
+
+	// calibrated once, outside the timed loop
+	for (int i = 0; i < N_SAMPLES; i++) ImuLog_Calibrate(h, &records[i], g[i], a[i], m[i]);
+	for (int n = 0; n < N_REPEAT; n++) {
+		for (int k = 0; k < 3; k++) { accel[k] = a[0][k]; mag[k] = m[0][k]; }
+		filter->initialize(accel, mag);
+		long long t0 = getCurrentNanoseconds();
+		for (int i = 1; i < N_SAMPLES; i++) {
+			float dt = (float)(records[i].time - records[i - 1].time) * 1e-6f;
+			for (int k = 0; k < 3; k++) { accel[k] = a[i][k]; mag[k] = m[i][k]; }
+			filter->update(g[i - 1], accel, mag, dt);
+			filter->getQuaternion(q);
+			if (n == 0) for (int k = 0; k < 4; k++) quat[engine][i][k] = q[k];
+		}
+		long long t = getCurrentNanoseconds() - t0;
+		if (n == 0 || t < r.ns) r.ns = t;
+	}
+	score(engine, &r);
+	return r;
+}
+
+static Result runFixed(int engine, const FixedCalibration *cal) {
+	Result r = {0, 0.0, 0.0};
+	int32_t q[4];
+
+	for (int n = 0; n < N_REPEAT; n++) {
+		FixedPointAHRS ahrs(cal);
+		ahrs.initialize(records[0].accel, records[0].mag);
+		long long t0 = getCurrentNanoseconds();
+		for (int i = 1; i < N_SAMPLES; i++) {
+			ahrs.update(records[i - 1].gyro, records[i].accel, records[i].mag, (int32_t)(records[i].time - records[i - 1].time));
+			ahrs.getQuaternionQ30(q);
+			if (n == 0) for (int k = 0; k < 4; k++) quat[engine][i][k] = (float)q[k] * (1.0f / FIXED_ONE);
+		}
+		long long t = getCurrentNanoseconds() - t0;
+		if (n == 0 || t < r.ns) r.ns = t;
+	}
+	score(engine, &r);
+	return r;
+}
+
+static void report(const char *name, const Result &r) {
+	printf("%-20s %8.1f ns/update  rms %6.3f deg  max %6.3f deg\n", name, (double)r.ns / (N_SAMPLES - 1), r.rms, r.max);
+}
+
+// best of N_REPEAT passes over N_MATH elements, ns per element
+#define TIME(ns, body) { \
+	long long best = 0; \
+	for (int r = 0; r < N_REPEAT; r++) { \
+		long long t0 = getCurrentNanoseconds(); \
+		body; \
+		long long dt = getCurrentNanoseconds() - t0; \
+		if (r == 0 || dt < best) best = dt; \
+	} \
+	sink = out[N_MATH / 2]; \
+	ns = (double)best / N_MATH; \
+}
+
+static void mathBench() {
+	double ns, err;
+
+	// Q2.30 in (0, 2)
+	for (int i = 0; i < N_MATH; i++) in0[i] = 1 + (int32_t)((2147483646LL * i) / N_MATH);
+	TIME(ns, for (int i = 0; i < N_MATH; i++) out[i] = FixedSqrt(in0[i]));
+	err = 0.0;
+	for (int i = 0; i < N_MATH; i++) err = fmax(err, fabs(out[i] / 1073741824.0 - sqrt(in0[i] / 1073741824.0)));
+	printf("%-20s %6.2f ns  max %.1e, (0, 2)\n", "FixedSqrt", ns, err);
+
+	// [0.25, 4)
+	for (int i = 0; i < N_MATH; i++) in0[i] = (int32_t)(268435456u + (uint32_t)((4026531839ULL * i) / N_MATH));
+	TIME(ns, for (int i = 0; i < N_MATH; i++) out[i] = FixedRsqrt((uint32_t)in0[i]));
+	err = 0.0;
+	for (int i = 0; i < N_MATH; i++) {
+		double x = (uint32_t)in0[i] / 1073741824.0;
+		err = fmax(err, fabs((uint32_t)out[i] / 1073741824.0 - 1.0 / sqrt(x)) * sqrt(x));
+	}
+	printf("%-20s %6.2f ns  max %.1e relative, [0.25, 4)\n", "FixedRsqrt", ns, err);
+
+	// the full circle at radii from 1e-3 to 1
+	for (int i = 0; i < N_MATH; i++) {
+		double a = 2.0 * M_PI * i / N_MATH - M_PI, r = pow(10.0, -3.0 * ((i * 7919LL) % N_MATH) / N_MATH);
+		in0[i] = (int32_t)lrint(r * sin(a) * 1073741824.0);
+		in1[i] = (int32_t)lrint(r * cos(a) * 1073741824.0);
+	}
+	TIME(ns, for (int i = 0; i < N_MATH; i++) out[i] = FixedAtan2(in0[i], in1[i]));
+	err = 0.0;
+	for (int i = 0; i < N_MATH; i++) {
+		double d = fabs(out[i] / 268435456.0 - atan2((double)in0[i], (double)in1[i]));
+		err = fmax(err, fmin(d, fabs(d - 2.0 * M_PI)));
+	}
+	printf("%-20s %6.2f ns  max %.1e rad, circles of radius 1e-3 to 1\n", "FixedAtan2", ns, err);
+
+	for (int i = 0; i < N_MATH; i++) in0[i] = (int32_t)(-1073741824LL + (2147483648LL * i) / (N_MATH - 1));
+	TIME(ns, for (int i = 0; i < N_MATH; i++) out[i] = FixedAsin(in0[i]));
+	err = 0.0;
+	for (int i = 0; i < N_MATH; i++) err = fmax(err, fabs(out[i] / 268435456.0 - asin(in0[i] / 1073741824.0)));
+	printf("%-20s %6.2f ns  max %.1e rad, [-1, 1]\n", "FixedAsin", ns, err);
+}
+
+int main(int argc, char **argv) {
+	SynthConfig cfg;
+	SynthModel model;
+	SynthCursor c;
+	SynthSample s;
+	ImuLogHeader h;
+	FixedCalibration cal;
+	MPU9250 mpu(0x68);
+
+	mathBench();
+
+	synthDefaultConfig(&cfg);
+	cfg.gyro.resolution = mpu.getBaseGyroRange(MPU9250::GYRO_RANGE_2000DPS);
+	cfg.accel.resolution = mpu.getBaseAccelRange(MPU9250::ACCEL_RANGE_16G);
+	cfg.mag.resolution = MAG_RESOLUTION;
+	synthModel(&cfg, &model);
+	synthSeek(&cfg, 0, &c);
+	for (int i = 0; i < N_SAMPLES; i++) {
+		synthNext(&cfg, &model, &c, &s);
+		records[i].time = (int64_t)llround((double)i * cfg.dt * 1e6);
+		for (int k = 0; k < 3; k++) {
+			records[i].gyro[k] = s.gyro[k];
+			records[i].accel[k] = s.accel[k];
+			records[i].mag[k] = s.mag[k];
+		}
+		for (int k = 0; k < 4; k++) truth[i][k] = s.q[k];
+	}
+
+	// the nominal scales of imuGenerator and the offsets a calibration would
+	// find, so what is left is the scale, misalignment, vibration and
+	// disturbance of the configuration, and the gyro bias for the filters
+	memset(&h, 0, sizeof(h));
+	for (int k = 0; k < 3; k++) {
+		h.gyroScale[k] = cfg.gyro.resolution * 0.017453292519943f;
+		h.accelScale[k] = cfg.accel.resolution;
+		h.magMatrix[k * 4] = cfg.mag.resolution;
+		h.accelOffset[k] = cfg.accel.bias[k] / cfg.accel.resolution;
+		h.magOffset[k] = cfg.mag.bias[k] / cfg.mag.resolution;
+	}
+	FixedCalibration_FromLog(&h, &cal);
+
+	MiniAHRSFilter mini;
+	ErrorStateAHRS eskf;
+	printf("%d raw samples at %.0f Hz, error over the second half\n", N_SAMPLES, 1.0 / cfg.dt);
+	report("MiniAHRSFilter (7)", runFloat(&mini, 0, &h));
+	report("ErrorStateAHRS (6)", runFloat(&eskf, 1, &h));
+	report("FixedPointAHRS (6)", runFixed(2, &cal));
+
+	double sum = 0.0, mx = 0.0;
+	for (int i = 1; i < N_SAMPLES; i++) {
+		double e = attitudeError(quat[1][i], quat[2][i]);
+		sum += e * e;
+		mx = fmax(mx, e);
+	}
+	printf("fixed point - float twin: rms %.4f deg  max %.4f deg\n", sqrt(sum / (N_SAMPLES - 1)), mx);
+	return 0;
+}
@@ -0,0 +1,157 @@
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include "ImuLog.h"
+#include "benchUtils.h"
+#include "imuSynth.h"
+
+// the register scaling of the driver, after the headers that use X, Y and Z
+#include "MPU9250.hpp"
+
+// Synthetic sessions as raw logs (ImuLog.h), with their truth:
+//   imuGenerator [-n samples] [-t threads] [-s seed] [-o out.raw] [-r truth.csv]
+// The samples of imuSynth.h are quantized with the resolutions of
+// MPU9250::getBaseGyroRange (2000 dps) and getBaseAccelRange (16 g) and the
+// 0.15 uT/LSB of the AK8963 at 16 bits. The header holds the nominal
+// calibration only, scale factors and zero offsets, so a filter replaying
+// the log sees the bias, scale, misalignment and disturbances of the
+// configuration. truth.csv has roll, pitch, yaw (deg) and the time stamp
+// (us) per sample, fixed width rows, the reference format of the tuner.
+//
+// Blocks of BLOCK samples are handed to the threads in any order and
+// written at their offset, the files do not depend on the thread count.
+// Without -o nothing is written and it reports the generation rate alone.
+
+#define BLOCK 65536
+#define CSV_ROW 58
+
+// AK8963 at BITS_16, see AK8963::resolution
+#define MAG_RESOLUTION 0.15f
+
+static SynthConfig cfg;
+static SynthModel model;
+static long long total = 10000000;
+static FILE *out = NULL;
+static int outFile = -1, truthFile = -1;
+static std::atomic<long long> nextBlock(0);
+static std::atomic<bool> failed(false);
+static std::atomic<unsigned long long> checksum(0);
+
+static void work() {
+	std::vector<ImuLogRecord> records(BLOCK);
+	std::vector<char> rows(BLOCK * CSV_ROW + 1);
+	unsigned long long sum = 0;
+	SynthSample s;
+	SynthCursor c;
+
+	for (;;) {
+		long long start = nextBlock.fetch_add(1) * BLOCK;
+		if (start >= total || failed) break;
+		int n = total - start < BLOCK ? (int)(total - start) : BLOCK;
+
+		synthSeek(&cfg, start, &c);
+		for (int j = 0; j < n; j++) {
+			uint64_t i = start + j;
+			ImuLogRecord &r = records[j];
+			synthNext(&cfg, &model, &c, &s);
+			r.time = (int64_t)llround((double)i * cfg.dt * 1e6);
+			for (int k = 0; k < 3; k++) {
+				r.gyro[k] = s.gyro[k];
+				r.accel[k] = s.accel[k];
+				r.mag[k] = s.mag[k];
+				r.reserved[k] = 0;
+				sum += (uint16_t)s.gyro[k] + (uint16_t)s.accel[k] + (uint16_t)s.mag[k];
+			}
+			if (truthFile >= 0) {
+				snprintf(&rows[j * CSV_ROW], CSV_ROW + 1, "%11.6f,%11.6f,%11.6f,%20lld\r\n",
+						s.rpy[0] * 57.29577951, s.rpy[1] * 57.29577951, s.rpy[2] * 57.29577951, (long long)r.time);
+			}
+		}
+		if (outFile >= 0) {
+			off_t at = (off_t)sizeof(ImuLogHeader) + (off_t)start * sizeof(ImuLogRecord);
+			size_t size = (size_t)n * sizeof(ImuLogRecord);
+			if (pwrite(outFile, &records[0], size, at) != (ssize_t)size) failed = true;
+		}
+		if (truthFile >= 0) {
+			size_t size = (size_t)n * CSV_ROW;
+			if (pwrite(truthFile, &rows[0], size, (off_t)start * CSV_ROW) != (ssize_t)size) failed = true;
+		}
+	}
+	checksum += sum;
+}
+
+int main(int argc, char **argv) {
+	const char *outName = NULL, *truthName = NULL;
+	int threads = (int)std::thread::hardware_concurrency();
+	MPU9250 mpu(0x68);
+
+	synthDefaultConfig(&cfg);
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "-n") == 0) total = atoll(argv[i + 1]);
+		else if (strcmp(argv[i], "-t") == 0) threads = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "-s") == 0) cfg.seed = strtoull(argv[i + 1], NULL, 10);
+		else if (strcmp(argv[i], "-o") == 0) outName = argv[i + 1];
+		else if (strcmp(argv[i], "-r") == 0) truthName = argv[i + 1];
+		else {
+			printf("usage: imuGenerator [-n samples] [-t threads] [-s seed] [-o out.raw] [-r truth.csv]\n");
+			return 1;
+		}
+	}
+	if (threads < 1) threads = 1;
+
+	cfg.gyro.resolution = mpu.getBaseGyroRange(MPU9250::GYRO_RANGE_2000DPS);
+	cfg.accel.resolution = mpu.getBaseAccelRange(MPU9250::ACCEL_RANGE_16G);
+	cfg.mag.resolution = MAG_RESOLUTION;
+	synthModel(&cfg, &model);
+
+	if (outName != NULL) {
+		ImuLogHeader h;
+		memset(&h, 0, sizeof(h));
+		for (int k = 0; k < 3; k++) {
+			h.gyroScale[k] = cfg.gyro.resolution * 0.017453292519943f;
+			h.accelScale[k] = cfg.accel.resolution;
+			h.magMatrix[k * 4] = cfg.mag.resolution;
+		}
+		// the header through stdio, the records at their offset
+		out = fopen(outName, "wb");
+		if (out == NULL || !ImuLog_WriteHeader(out, &h) || fflush(out) != 0) {
+			printf("Error writing %s\n", outName);
+			return 1;
+		}
+		outFile = fileno(out);
+	}
+	if (truthName != NULL) {
+		truthFile = open(truthName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (truthFile < 0) {
+			printf("Error writing %s\n", truthName);
+			return 1;
+		}
+	}
+
+	long long t0 = getCurrentNanoseconds();
+	std::vector<std::thread> workers;
+	for (int i = 0; i < threads; i++) workers.push_back(std::thread(work));
+	for (int i = 0; i < threads; i++) workers[i].join();
+	long long t1 = getCurrentNanoseconds();
+
+	if (out != NULL && fclose(out) != 0) failed = true;
+	if (truthFile >= 0 && close(truthFile) != 0) failed = true;
+	if (failed) {
+		printf("Error writing the output\n");
+		return 1;
+	}
+	printf("%lld samples (%.1f h at %.0f Hz), %d threads, %.2f s, %.1f Msamples/s, checksum %llx\n",
+			total, total * cfg.dt / 3600.0, 1.0 / cfg.dt, threads, (t1 - t0) * 1e-9, total * 1e3 / (t1 - t0),
+			(unsigned long long)checksum);
+	if (outName != NULL) printf("Raw samples stored in %s\n", outName);
+	if (truthName != NULL) printf("Truth stored in %s\n", truthName);
+	return 0;
+}
@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <math.h>
+
+#include "FastMath.h"
+#include "Quaternion.h"
+#include "benchUtils.h"
+
+// Attitude integration from gyro samples: Quaternion_RungeKutta4 (with and
+// without its normalization), the first order step with normalization of
+// EKF_AHRSPredict up to now, Quaternion_IntegrateExp and
+// Quaternion_IntegrateExpBatch. The rate is held constant over each sample,
+// so the reference is the exponential map in double precision over the same
+// samples, and every error is that of the method and its rounding. The
+// rates turn about all axes, with a magnitude up to the given peak (2000
+// dps is the full range of the MPU9250). It reports the time per sample
+// (best of N_REPEAT), the attitude error after N_SAMPLES samples and the
+// largest at the checkpoints every CHECK samples, and the largest distance
+// of the norm to one (before the final normalization of the batch).
+
+#define N_SAMPLES 100000
+#define N_REPEAT 5
+#define CHECK 1000
+
+static float gyro[N_SAMPLES][3];
+static double truth[N_SAMPLES / CHECK][4];
+static volatile float sink;
+
+struct Result {
+	long long ns;
+	double last, max, norm;
+};
+
+// angle of the rotation between a unit double and a float quaternion (deg),
+// whatever the norm of the second
+static double attitudeError(const double *p, const float *q) {
+	double w = p[0] * q[0] + p[1] * q[1] + p[2] * q[2] + p[3] * q[3];
+	double x = p[0] * q[1] - p[1] * q[0] - p[2] * q[3] + p[3] * q[2];
+	double y = p[0] * q[2] + p[1] * q[3] - p[2] * q[0] - p[3] * q[1];
+	double z = p[0] * q[3] - p[1] * q[2] + p[2] * q[1] - p[3] * q[0];
+	return 2.0 * atan2(sqrt(x * x + y * y + z * z), fabs(w)) * 57.29577951308232;
+}
+
+static double normError(const float *q) {
+	return fabs(sqrt((double)q[0] * q[0] + (double)q[1] * q[1] + (double)q[2] * q[2] + (double)q[3] * q[3]) - 1.0);
+}
+
+// smooth rates about changing axes, peak rad/s
+static void makeRates(double peak, double dt) {
+	for (int i = 0; i < N_SAMPLES; i++) {
+		double t = i * dt;
+		double x = sin(1.3 * t) + 0.4 * sin(7.1 * t + 1.0);
+		double y = cos(0.7 * t) * sin(3.3 * t + 0.5);
+		double z = 0.8 * sin(0.23 * t + 2.0) + 0.2 * cos(11.0 * t);
+		double n = sqrt(x * x + y * y + z * z) + 1e-9;
+		double a = peak * (0.55 + 0.45 * sin(0.9 * t));
+		gyro[i][0] = (float)(a * x / n);
+		gyro[i][1] = (float)(a * y / n);
+		gyro[i][2] = (float)(a * z / n);
+	}
+}
+
+static void makeTruth(double dt) {
+	double q[4] = {1.0, 0.0, 0.0, 0.0};
+	for (int i = 0; i < N_SAMPLES; i++) {
+		double h[3] = {0.5 * dt * gyro[i][0], 0.5 * dt * gyro[i][1], 0.5 * dt * gyro[i][2]};
+		double t = sqrt(h[0] * h[0] + h[1] * h[1] + h[2] * h[2]);
+		double s = t > 0.0 ? sin(t) / t : 1.0, d[4] = {cos(t), s * h[0], s * h[1], s * h[2]};
+		double r[4] = {q[0] * d[0] - q[1] * d[1] - q[2] * d[2] - q[3] * d[3],
+				q[0] * d[1] + q[1] * d[0] + q[2] * d[3] - q[3] * d[2],
+				q[0] * d[2] - q[1] * d[3] + q[2] * d[0] + q[3] * d[1],
+				q[0] * d[3] + q[1] * d[2] - q[2] * d[1] + q[3] * d[0]};
+		double n = 1.0 / sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2] + r[3] * r[3]);
+		for (int k = 0; k < 4; k++) q[k] = r[k] * n;
+		if ((i + 1) % CHECK == 0) for (int k = 0; k < 4; k++) truth[i / CHECK][k] = q[k];
+	}
+}
+
+// the first order step and normalization of EKF_AHRSPredict before the
+// exponential map
+static void firstOrder(float *q, const float *w, float dt) {
+	float halfdt = 0.5f * dt;
+	float hx = halfdt * w[0], hy = halfdt * w[1], hz = halfdt * w[2];
+	float q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+	q[0] = q0 - hx * q1 - hy * q2 - hz * q3;
+	q[1] = q1 + hx * q0 - hy * q3 + hz * q2;
+	q[2] = q2 + hx * q3 + hy * q0 - hz * q1;
+	q[3] = q3 - hx * q2 + hy * q1 + hz * q0;
+	Quaternion_Normalize(q);
+}
+
+// 0 RK4 normalized, 1 RK4, 2 first order, 3 exponential map
+static void step(int method, float *q, const float *w, float dt) {
+	float wq[4] = {0.0f, w[0], w[1], w[2]};
+	switch (method) {
+	case 0: Quaternion_RungeKutta4(q, wq, dt, 1); break;
+	case 1: Quaternion_RungeKutta4(q, wq, dt, 0); break;
+	case 2: firstOrder(q, w, dt); break;
+	default: Quaternion_IntegrateExp(q, w, dt); break;
+	}
+}
+
+static Result run(int method, float dt) {
+	Result r = {0, 0.0, 0.0, 0.0};
+	float q[4];
+
+	// accuracy
+	q[0] = 1.0f; q[1] = q[2] = q[3] = 0.0f;
+	for (int i = 0; i < N_SAMPLES; i += CHECK) {
+		if (method == 4) {
+			// the batch normalizes at its end, the norm is that of its products
+			Quaternion_IntegrateExpBatch(q, gyro[i], dt, CHECK);
+		} else {
+			for (int j = i; j < i + CHECK; j++) {
+				step(method, q, gyro[j], dt);
+				r.norm = fmax(r.norm, normError(q));
+			}
+		}
+		r.last = attitudeError(truth[i / CHECK], q);
+		r.max = fmax(r.max, r.last);
+	}
+	if (method == 4) r.norm = -1.0;
+
+	// speed
+	for (int n = 0; n < N_REPEAT; n++) {
+		q[0] = 1.0f; q[1] = q[2] = q[3] = 0.0f;
+		long long t0 = getCurrentNanoseconds();
+		if (method == 4) Quaternion_IntegrateExpBatch(q, gyro[0], dt, N_SAMPLES);
+		else for (int i = 0; i < N_SAMPLES; i++) step(method, q, gyro[i], dt);
+		long long t = getCurrentNanoseconds() - t0;
+		sink = q[0] + q[1];
+		if (n == 0 || t < r.ns) r.ns = t;
+	}
+	return r;
+}
+
+static const char *names[] = {"RK4, normalized", "RK4", "first order + norm", "IntegrateExp", "IntegrateExpBatch"};
+
+static void scenario(double peakDps, double rate) {
+	double dt = 1.0 / rate, peak = peakDps * M_PI / 180.0;
+	makeRates(peak, dt);
+	makeTruth(dt);
+	printf("peak %.0f dps at %.0f Hz, up to %.3f rad per sample, %d samples\n", peakDps, rate, peak * dt, N_SAMPLES);
+	for (int m = 0; m < 5; m++) {
+		Result r = run(m, (float)dt);
+		printf("  %-20s %6.2f ns  last %.2e deg  max %.2e deg  ", names[m], (double)r.ns / N_SAMPLES, r.last, r.max);
+		if (r.norm < 0.0) printf("norm  -\n");
+		else printf("norm %.1e\n", r.norm);
+	}
+}
+
+int main(int argc, char **argv) {
+	printf("FAST_MATH_TIER %d, QUATERNION_EXP_SERIES %g, batch chunks of %d samples\n",
+			FAST_MATH_TIER, QUATERNION_EXP_SERIES, FAST_BATCH_SIZE * FAST_BATCH_SIZE);
+	scenario(90.0, 100.0);
+	scenario(500.0, 100.0);
+	scenario(2000.0, 1000.0);
+	scenario(2000.0, 100.0);
+	scenario(2000.0, 25.0);
+	return 0;
+}
@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "miniMatrix.h"
+#include "miniAHRS.h"
+#include "benchUtils.h"
+
+// Compares the runtime-dimension miniMatrix.h routines against the
+// fixed-size FixedMatrix.h templates on the shapes used by the EKF, and
+// times the whole covariance/gain pipeline of EKF_AHRSUpdate with both.
+
+#define N_ITER 200000
+#define N_POOL 16
+
+static void fillRandom(float *a, int n) {
+	for (int i = 0; i < n; i++) a[i] = randomUniform(-1.0f, 1.0f);
+}
+
+// Symmetric positive definite test matrix (diagonally dominant)
+static void fillSPD(float *a, int n) {
+	fillRandom(a, n * n);
+	for (int i = 0; i < n; i++) {
+		for (int j = 0; j < i; j++) a[i * n + j] = a[j * n + i];
+		a[i * n + i] += (float)n;
+	}
+}
+
+static float maxAbsDiff(const float *a, const float *b, int n) {
+	float d = 0.0f;
+	for (int i = 0; i < n; i++) {
+		float e = FastAbs(a[i] - b[i]);
+		if (e > d) d = e;
+	}
+	return d;
+}
+
+static void report(const char *name, long long tOld, long long tNew, float diff) {
+	printf("%-28s %9.1f ns %9.1f ns  x%5.2f  maxdiff %g\n", name,
+			(double)tOld / N_ITER, (double)tNew / N_ITER,
+			(double)tOld / (double)tNew, diff);
+}
+
+// Each kernel runs over a pool of independent operands through a
+// non-inlined wrapper, so neither variant can be hoisted out of the loop.
+#define BENCH(result, call) \
+	do { \
+		long long _t0 = getCurrentNanoseconds(); \
+		for (int i = 0; i < N_ITER; i++) { \
+			int k = i & (N_POOL - 1); \
+			call; \
+		} \
+		result = getCurrentNanoseconds() - _t0; \
+	} while (0)
+
+__attribute__((noinline)) void old77x77(Mat<7, 7> *a, Mat<7, 7> *b, Mat<7, 7> *c) { Matrix_Multiply(a->m, 7, 7, b->m, 7, c->m); }
+__attribute__((noinline)) void new77x77(Mat<7, 7> *a, Mat<7, 7> *b, Mat<7, 7> *c) { Mat_Multiply(*a, *b, *c); }
+__attribute__((noinline)) void old77x67t(Mat<7, 7> *a, Mat<6, 7> *b, Mat<7, 6> *c) { Matrix_Multiply_With_Transpose(a->m, 7, 7, b->m, 6, c->m); }
+__attribute__((noinline)) void new77x67t(Mat<7, 7> *a, Mat<6, 7> *b, Mat<7, 6> *c) { Mat_MultiplyTransB(*a, *b, *c); }
+__attribute__((noinline)) void old67x76(Mat<6, 7> *a, Mat<7, 6> *b, Mat<6, 6> *c) { Matrix_Multiply(a->m, 6, 7, b->m, 6, c->m); }
+__attribute__((noinline)) void new67x76(Mat<6, 7> *a, Mat<7, 6> *b, Mat<6, 6> *c) { Mat_Multiply(*a, *b, *c); }
+__attribute__((noinline)) void old76x66(Mat<7, 6> *a, Mat<6, 6> *b, Mat<7, 6> *c) { Matrix_Multiply(a->m, 7, 6, b->m, 6, c->m); }
+__attribute__((noinline)) void new76x66(Mat<7, 6> *a, Mat<6, 6> *b, Mat<7, 6> *c) { Mat_Multiply(*a, *b, *c); }
+// Matrix_Inverse destroys its source, so both variants pay for a copy
+__attribute__((noinline)) void oldInv66(Mat<6, 6> *a, Mat<6, 6> *c) { Mat<6, 6> t = *a; Matrix_Inverse(t.m, 6, c->m); }
+__attribute__((noinline)) void newInv66(Mat<6, 6> *a, Mat<6, 6> *c) { Mat<6, 6> t = *a; Mat_Inverse(t, *c); }
+
+int main(int argc, char **argv) {
+
+	srand(1);
+
+	static Mat<7, 7> A77[N_POOL], B77[N_POOL], C77[N_POOL], D77[N_POOL];
+	static Mat<6, 7> A67[N_POOL];
+	static Mat<7, 6> C76[N_POOL], D76[N_POOL];
+	static Mat<6, 6> S66[N_POOL], C66[N_POOL], D66[N_POOL];
+	Mat<6, 6> R66;
+	long long t0, tOld, tNew;
+
+	for (int k = 0; k < N_POOL; k++) {
+		fillRandom(A77[k].m, 49);
+		fillSPD(B77[k].m, 7);
+		fillRandom(A67[k].m, 42);
+		fillSPD(S66[k].m, 6);
+	}
+	fillSPD(R66.m, 6);
+
+	printf("%-28s %12s %12s %7s\n", "kernel", "miniMatrix", "FixedMatrix", "speedup");
+
+//////////////////////////////////////////////////////////////////
+
+	BENCH(tOld, old77x77(&A77[k], &B77[k], &C77[k]));
+	BENCH(tNew, new77x77(&A77[k], &B77[k], &D77[k]));
+	report("7x7 * 7x7", tOld, tNew, maxAbsDiff(C77[0].m, D77[0].m, 49));
+
+	BENCH(tOld, old77x67t(&B77[k], &A67[k], &C76[k]));
+	BENCH(tNew, new77x67t(&B77[k], &A67[k], &D76[k]));
+	report("7x7 * (6x7)'", tOld, tNew, maxAbsDiff(C76[0].m, D76[0].m, 42));
+
+	BENCH(tOld, old67x76(&A67[k], &D76[k], &C66[k]));
+	BENCH(tNew, new67x76(&A67[k], &D76[k], &D66[k]));
+	report("6x7 * 7x6", tOld, tNew, maxAbsDiff(C66[0].m, D66[0].m, 36));
+
+	BENCH(tOld, old76x66(&D76[k], &S66[k], &C76[k]));
+	BENCH(tNew, new76x66(&D76[k], &S66[k], &C76[(k + 1) & (N_POOL - 1)]));
+	old76x66(&D76[0], &S66[0], &C76[0]);
+	new76x66(&D76[0], &S66[0], &C76[1]);
+	report("7x6 * 6x6", tOld, tNew, maxAbsDiff(C76[0].m, C76[1].m, 42));
+
+	BENCH(tOld, oldInv66(&S66[k], &C66[k]));
+	BENCH(tNew, newInv66(&S66[k], &D66[k]));
+	report("inverse 6x6", tOld, tNew, maxAbsDiff(C66[0].m, D66[0].m, 36));
+
+//////////////////////////////////////////////////////////////////
+// Covariance propagation, gain and Joseph update of EKF_AHRSUpdate
+
+	Mat<7, 7> F77, P77, Q77, I77, PX77, PXX77, Pold, Pnew;
+	Mat<6, 7> H67;
+	Mat<7, 6> PXY76, K76;
+	Mat<6, 6> S6, SI66;
+	Mat_Identity(I77);
+	fillRandom(F77.m, 49);
+	Mat_Scale(F77, 0.01f, F77);
+	Mat_Add(F77, I77, F77);
+	fillRandom(H67.m, 42);
+	fillSPD(P77.m, 7);
+	Mat_Scale(P77, 0.001f, P77);
+	Mat_Identity(Q77);
+	Mat_Scale(Q77, 0.0001f, Q77);
+	Mat_Copy(P77, Pold);
+	Mat_Copy(P77, Pnew);
+
+	t0 = getCurrentNanoseconds();
+	for (int i = 0; i < N_ITER; i++) {
+		Matrix_Multiply(F77.m, 7, 7, Pold.m, 7, PX77.m);
+		Matrix_Multiply_With_Transpose(PX77.m, 7, 7, F77.m, 7, Pold.m);
+		Maxtrix_Add(Pold.m, 7, 7, Q77.m, Pold.m);
+		Matrix_Multiply_With_Transpose(Pold.m, 7, 7, H67.m, 6, PXY76.m);
+		Matrix_Multiply(H67.m, 6, 7, PXY76.m, 6, S6.m);
+		Maxtrix_Add(S6.m, 6, 6, R66.m, S6.m);
+		Matrix_Inverse(S6.m, 6, SI66.m);
+		Matrix_Multiply(PXY76.m, 7, 6, SI66.m, 6, K76.m);
+		Matrix_Multiply(K76.m, 7, 6, H67.m, 7, PX77.m);
+		Maxtrix_Sub(I77.m, 7, 7, PX77.m, PX77.m);
+		Matrix_Multiply(PX77.m, 7, 7, Pold.m, 7, PXX77.m);
+		Matrix_Multiply_With_Transpose(PXX77.m, 7, 7, PX77.m, 7, Pold.m);
+		Matrix_Multiply(K76.m, 7, 6, R66.m, 6, PXY76.m);
+		Matrix_Multiply_With_Transpose(PXY76.m, 7, 6, K76.m, 7, PX77.m);
+		Maxtrix_Add(Pold.m, 7, 7, PX77.m, Pold.m);
+	}
+	tOld = getCurrentNanoseconds() - t0;
+
+	t0 = getCurrentNanoseconds();
+	for (int i = 0; i < N_ITER; i++) {
+		Mat_Multiply(F77, Pnew, PX77);
+		Mat_MultiplyTransB(PX77, F77, Pnew);
+		Mat_Add(Pnew, Q77, Pnew);
+		Mat_MultiplyTransB(Pnew, H67, PXY76);
+		Mat_Multiply(H67, PXY76, S6);
+		Mat_Add(S6, R66, S6);
+		Mat_Inverse(S6, SI66);
+		Mat_Multiply(PXY76, SI66, K76);
+		Mat_Multiply(K76, H67, PX77);
+		Mat_Sub(I77, PX77, PX77);
+		Mat_Multiply(PX77, Pnew, PXX77);
+		Mat_MultiplyTransB(PXX77, PX77, Pnew);
+		Mat_Multiply(K76, R66, PXY76);
+		Mat_MultiplyTransB(PXY76, K76, PX77);
+		Mat_Add(Pnew, PX77, Pnew);
+	}
+	tNew = getCurrentNanoseconds() - t0;
+	report("EKF covariance + gain", tOld, tNew, maxAbsDiff(Pold.m, Pnew.m, 49));
+
+//////////////////////////////////////////////////////////////////
+// Complete EKF_AHRSUpdate on a slowly rotating synthetic input
+
+	float accel[3], mag[3], gyro[3];
+	accel[0] = 0.0f; accel[1] = 0.0f; accel[2] = 1.0f;
+	mag[0] = 0.5f; mag[1] = 0.0f; mag[2] = -0.8f;
+	EKF_AHRSInit(accel, mag);
+	t0 = getCurrentNanoseconds();
+	for (int i = 0; i < N_ITER; i++) {
+		gyro[0] = 0.01f; gyro[1] = -0.02f; gyro[2] = 0.03f;
+		accel[0] = 0.0f; accel[1] = 0.0f; accel[2] = 1.0f;
+		mag[0] = 0.5f; mag[1] = 0.0f; mag[2] = -0.8f;
+		EKF_AHRSUpdate(gyro, accel, mag, 0.01f);
+	}
+	tNew = getCurrentNanoseconds() - t0;
+	float q[4];
+	EKF_AHRSGetQ(q);
+	consume(q, 4);
+	printf("%-28s %12s %9.1f ns\n", "EKF_AHRSUpdate", "-", (double)tNew / N_ITER);
+
+	consume(Pold.m, 49);
+	consume(Pnew.m, 49);
+	consume(C77[0].m, 49);
+	return 0;
+}
@@ -0,0 +1,74 @@
+#include <stdio.h>
+
+#include "miniAHRS.h"
+#include "AttitudePredictor.h"
+#include "benchUtils.h"
+#include "simUtils.h"
+
+// Runs EKF_AHRSUpdate at 100 Hz on a 1 kHz simulated motion and publishes
+// every estimate to an AttitudePredictor. A consumer reading the attitude
+// 2 to 15 ms after the sample gets either the last estimate as it is
+// (stale) or the one extrapolated to its own time by getAttitudeAt. Reports
+// both errors against the ground truth at the time of the read, over the
+// second half of the run, and the cost of a query.
+
+#define N_SAMPLES 120000
+#define FILTER_EVERY 10
+#define N_QUERIES 1000000
+
+static SimSample samples[N_SAMPLES];
+static const int latencies[] = {2, 5, 10, 15};
+#define N_LATENCIES (int)(sizeof(latencies) / sizeof(latencies[0]))
+
+int main(int argc, char **argv) {
+
+	SimConfig cfg;
+	simDefaultConfig(&cfg);
+	cfg.dt = 0.001f;
+	simGenerate(&cfg, samples, N_SAMPLES);
+
+	AttitudePredictor predictor;
+	double stale[N_LATENCIES] = {0}, predicted[N_LATENCIES] = {0};
+	int count = 0;
+	float up[3], accel[3], mag[3], q[4], qp[4], bias[3], rate[3];
+	float dt = cfg.dt * FILTER_EVERY;
+
+	// EKF_AHRSInit takes the up vector, the accel reads -C' * [0 0 1]
+	for (int k = 0; k < 3; k++) { up[k] = -samples[0].accel[k]; mag[k] = samples[0].mag[k]; }
+	EKF_AHRSInit(up, mag);
+	for (int i = FILTER_EVERY; i + 15 < N_SAMPLES; i += FILTER_EVERY) {
+		for (int k = 0; k < 3; k++) { accel[k] = samples[i].accel[k]; mag[k] = samples[i].mag[k]; }
+		EKF_AHRSUpdate(samples[i - FILTER_EVERY].gyro, accel, mag, dt);
+		EKF_AHRSGetQ(q);
+		EKF_AHRSGetBias(bias);
+		for (int k = 0; k < 3; k++) rate[k] = samples[i].gyro[k] - bias[k];
+		long time = (long)i * 1000;
+		predictor.publish(q, rate, time);
+
+		if (i < N_SAMPLES / 2) continue;
+		for (int n = 0; n < N_LATENCIES; n++) {
+			int l = latencies[n];
+			predictor.getAttitudeAt(time + l * 1000, qp);
+			double e = simAttitudeError(samples[i + l].q, q);
+			stale[n] += e * e;
+			e = simAttitudeError(samples[i + l].q, qp);
+			predicted[n] += e * e;
+		}
+		count++;
+	}
+
+	printf("%d samples at %.0f Hz, filter at %.0f Hz\n", N_SAMPLES, 1.0 / cfg.dt, 1.0 / dt);
+	for (int n = 0; n < N_LATENCIES; n++) {
+		printf("read %2d ms late  stale rms %6.3f deg  predicted rms %6.3f deg\n", latencies[n],
+				sqrt(stale[n] / count), sqrt(predicted[n] / count));
+	}
+
+	long long t0 = getCurrentNanoseconds();
+	for (int i = 0; i < N_QUERIES; i++) {
+		predictor.getAttitudeAt((long)N_SAMPLES * 1000 + (i & 15) * 1000, qp);
+		consume(qp, 4);
+	}
+	long long t = getCurrentNanoseconds() - t0;
+	printf("getAttitudeAt %.1f ns/query\n", (double)t / N_QUERIES);
+	return 0;
+}
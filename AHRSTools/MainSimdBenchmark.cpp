@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "miniAHRS.h"
+#include "benchUtils.h"
+
+// Checks the FixedMatrixSimd.h kernels against the scalar reference kernels
+// and times both, then times a complete EKF_AHRSUpdate. The program fails
+// when a vector kernel differs from the reference by more than MAX_ULP.
+
+#define N_ITER 200000
+#define N_POOL 16
+#define N_CHECK 1000
+#define MAX_ULP 0
+
+static void fillRandom(float *a, int n) {
+	for (int i = 0; i < n; i++) a[i] = randomUniform(-1.0f, 1.0f);
+}
+
+// Distance in units in the last place between two floats
+static int ulpDiff(float a, float b) {
+	union { float f; int32_t i; } ua, ub;
+	ua.f = a; ub.f = b;
+	if (ua.i < 0) ua.i = (int32_t)0x80000000 - ua.i;
+	if (ub.i < 0) ub.i = (int32_t)0x80000000 - ub.i;
+	int32_t d = ua.i - ub.i;
+	return d < 0 ? -d : d;
+}
+
+// Compares two results, returns the worst ulp distance and counts the
+// elements that are not bit-for-bit equal
+static int compare(const float *a, const float *b, int n, long *mismatch) {
+	int worst = 0;
+	for (int i = 0; i < n; i++) {
+		if (memcmp(&a[i], &b[i], sizeof(float)) != 0) (*mismatch)++;
+		int d = ulpDiff(a[i], b[i]);
+		if (d > worst) worst = d;
+	}
+	return worst;
+}
+
+#define BENCH(result, call) \
+	do { \
+		long long _t0 = getCurrentNanoseconds(); \
+		for (int i = 0; i < N_ITER; i++) { \
+			int k = i & (N_POOL - 1); \
+			call; \
+		} \
+		result = getCurrentNanoseconds() - _t0; \
+	} while (0)
+
+template <unsigned short R, unsigned short K, unsigned short C>
+__attribute__((noinline)) void refMul(const Mat<R, K> *a, const Mat<K, C> *b, Mat<R, C> *c) { Mat_MultiplyScalar(*a, *b, *c); }
+template <unsigned short R, unsigned short K, unsigned short C>
+__attribute__((noinline)) void vecMul(const Mat<R, K> *a, const Mat<K, C> *b, Mat<R, C> *c) { Mat_Multiply(*a, *b, *c); }
+template <unsigned short R, unsigned short K, unsigned short C>
+__attribute__((noinline)) void refMulT(const Mat<R, K> *a, const Mat<C, K> *b, Mat<R, C> *c) { Mat_MultiplyTransBScalar(*a, *b, *c); }
+template <unsigned short R, unsigned short K, unsigned short C>
+__attribute__((noinline)) void vecMulT(const Mat<R, K> *a, const Mat<C, K> *b, Mat<R, C> *c) { Mat_MultiplyTransB(*a, *b, *c); }
+
+static bool failed = false;
+
+static void report(const char *name, long long tRef, long long tVec, int ulp, long mismatch) {
+	printf("%-20s %9.1f ns %9.1f ns  x%5.2f  %6ld/%d not bit-exact, max %d ulp\n", name,
+			(double)tRef / N_ITER, (double)tVec / N_ITER,
+			(double)tRef / (double)tVec, mismatch, N_CHECK, ulp);
+	if (ulp > MAX_ULP) failed = true;
+}
+
+template <unsigned short R, unsigned short K, unsigned short C>
+void benchMultiply(const char *name) {
+	static Mat<R, K> A[N_POOL];
+	static Mat<K, C> B[N_POOL];
+	static Mat<R, C> D[N_POOL], E[N_POOL];
+	long long tRef, tVec;
+	long mismatch = 0;
+	int ulp = 0;
+
+	for (int n = 0; n < N_CHECK; n++) {
+		fillRandom(A[0].m, R * K);
+		fillRandom(B[0].m, K * C);
+		refMul(&A[0], &B[0], &D[0]);
+		vecMul(&A[0], &B[0], &E[0]);
+		int u = compare(D[0].m, E[0].m, R * C, &mismatch);
+		if (u > ulp) ulp = u;
+	}
+	for (int k = 0; k < N_POOL; k++) {
+		fillRandom(A[k].m, R * K);
+		fillRandom(B[k].m, K * C);
+	}
+	BENCH(tRef, (refMul<R, K, C>(&A[k], &B[k], &D[k])));
+	BENCH(tVec, (vecMul<R, K, C>(&A[k], &B[k], &E[k])));
+	consume(D[0].m, R * C);
+	consume(E[0].m, R * C);
+	report(name, tRef, tVec, ulp, mismatch);
+}
+
+template <unsigned short R, unsigned short K, unsigned short C>
+void benchMultiplyTransB(const char *name) {
+	static Mat<R, K> A[N_POOL];
+	static Mat<C, K> B[N_POOL];
+	static Mat<R, C> D[N_POOL], E[N_POOL];
+	long long tRef, tVec;
+	long mismatch = 0;
+	int ulp = 0;
+
+	for (int n = 0; n < N_CHECK; n++) {
+		fillRandom(A[0].m, R * K);
+		fillRandom(B[0].m, C * K);
+		refMulT(&A[0], &B[0], &D[0]);
+		vecMulT(&A[0], &B[0], &E[0]);
+		int u = compare(D[0].m, E[0].m, R * C, &mismatch);
+		if (u > ulp) ulp = u;
+	}
+	for (int k = 0; k < N_POOL; k++) {
+		fillRandom(A[k].m, R * K);
+		fillRandom(B[k].m, C * K);
+	}
+	BENCH(tRef, (refMulT<R, K, C>(&A[k], &B[k], &D[k])));
+	BENCH(tVec, (vecMulT<R, K, C>(&A[k], &B[k], &E[k])));
+	consume(D[0].m, R * C);
+	consume(E[0].m, R * C);
+	report(name, tRef, tVec, ulp, mismatch);
+}
+
+int main(int argc, char **argv) {
+
+	srand(1);
+
+	printf("SIMD kernels: %s\n", MAT_SIMD_NAME);
+	printf("%-20s %12s %12s\n", "kernel", "scalar", "simd");
+
+	benchMultiply<7, 7, 7>("7x7 * 7x7");
+	benchMultiplyTransB<7, 7, 6>("7x7 * (6x7)'");
+	benchMultiply<6, 7, 6>("6x7 * 7x6");
+	benchMultiply<7, 6, 6>("7x6 * 6x6");
+	benchMultiply<7, 6, 7>("7x6 * 6x7");
+	benchMultiplyTransB<7, 7, 7>("7x7 * (7x7)'");
+	benchMultiplyTransB<7, 6, 7>("7x6 * (7x6)'");
+	benchMultiply<6, 6, 6>("6x6 * 6x6");
+	benchMultiply<6, 3, 6>("6x3 * 3x6");
+	benchMultiplyTransB<6, 6, 6>("6x6 * (6x6)'");
+
+//////////////////////////////////////////////////////////////////
+// Complete EKF_AHRSUpdate
+
+	float accel[3], mag[3], gyro[3];
+	accel[0] = 0.0f; accel[1] = 0.0f; accel[2] = 1.0f;
+	mag[0] = 0.5f; mag[1] = 0.0f; mag[2] = -0.8f;
+	EKF_AHRSInit(accel, mag);
+	long long t0 = getCurrentNanoseconds();
+	for (int i = 0; i < N_ITER; i++) {
+		gyro[0] = 0.01f; gyro[1] = -0.02f; gyro[2] = 0.03f;
+		accel[0] = 0.0f; accel[1] = 0.0f; accel[2] = 1.0f;
+		mag[0] = 0.5f; mag[1] = 0.0f; mag[2] = -0.8f;
+		EKF_AHRSUpdate(gyro, accel, mag, 0.01f);
+	}
+	long long t = getCurrentNanoseconds() - t0;
+	float q[4];
+	EKF_AHRSGetQ(q);
+	consume(q, 4);
+	printf("EKF_AHRSUpdate %.1f ns/update (%.0f updates/s)\n",
+			(double)t / N_ITER, 1e9 * N_ITER / (double)t);
+
+	if (failed) {
+		printf("FAILED: SIMD kernels differ from the scalar reference\n");
+		return 1;
+	}
+	return 0;
+}
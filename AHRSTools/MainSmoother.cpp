@@ -0,0 +1,207 @@
+// 64-bit file offsets for the state store on 32-bit targets
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <string.h>
+
+#include "miniAHRS.h"
+#include "ImuLog.h"
+#include "RTSSmoother.h"
+#include "benchUtils.h"
+#include "simUtils.h"
+
+// Offline smoothing of a raw IMU log (ImuLog.h, imu.raw of IMU/MainAngles):
+//   smoother imu.raw [smoothed.csv]
+// runs the EKF forward over the log, streaming the RTS records to
+// <output>.store, smooths the store backwards block by block and writes
+// roll, pitch, yaw (deg) and the time stamp (us) of every sample, the
+// columns of angles.csv. The update of a sample uses its own gyro sample,
+// as MainAngles does.
+// Without arguments it first writes a simulated log, sim.raw, quantized like
+// the MPU9250 at 2000 dps and 16 g, and also reports the attitude error of
+// the forward and of the smoothed pass against the simulation, after the
+// first N_SKIP samples. Memory does not grow with the log length, only the
+// two files do. The throughput of each pass includes its file traffic, and
+// the simulation of the truth without arguments.
+
+#define N_SIM 360000
+#define N_SKIP 1000
+#define CHUNK 4096
+
+static ImuLogRecord logChunk[CHUNK];
+static RTSRecord storeChunk[CHUNK];
+
+static SimConfig cfg;
+
+static int16_t quantize(float v, float scale) {
+	float c = v / scale;
+	if (c > 32767.0f) c = 32767.0f;
+	if (c < -32768.0f) c = -32768.0f;
+	return (int16_t)lrintf(c);
+}
+
+// N_SIM samples of the default simulation. The record of sample i carries
+// the gyro of sample i - 1, the simUtils convention, so that the update with
+// the record's own gyro integrates over the right interval
+static int writeSimLog(const char *name) {
+	ImuLogHeader h;
+	SimStream s;
+	SimSample sample;
+	float gyro[3] = {0.0f, 0.0f, 0.0f};
+	FILE *f = fopen(name, "wb");
+
+	if (f == NULL) return 0;
+	memset(&h, 0, sizeof(h));
+	for (int k = 0; k < 3; k++) {
+		h.gyroScale[k] = 2000.0f / 32768.0f * (float)M_PI / 180.0f;
+		h.accelScale[k] = 16.0f / 32768.0f;
+		h.magMatrix[k * 4] = 1.0f / 1000.0f;
+	}
+	if (!ImuLog_WriteHeader(f, &h)) return 0;
+
+	simStart(&cfg, &s);
+	for (long long i = 0; i < N_SIM; i += CHUNK) {
+		int n = N_SIM - i < CHUNK ? (int)(N_SIM - i) : CHUNK;
+		for (int j = 0; j < n; j++) {
+			ImuLogRecord &r = logChunk[j];
+			simNext(&cfg, &s, &sample);
+			r.time = (int64_t)llround((i + j) * (double)cfg.dt * 1e6);
+			for (int k = 0; k < 3; k++) {
+				r.gyro[k] = quantize(gyro[k], h.gyroScale[k]);
+				r.accel[k] = quantize(sample.accel[k], h.accelScale[k]);
+				r.mag[k] = quantize(sample.mag[k], h.magMatrix[k * 4]);
+				r.reserved[k] = 0;
+				gyro[k] = sample.gyro[k];
+			}
+		}
+		if (fwrite(logChunk, sizeof(ImuLogRecord), n, f) != (size_t)n) return 0;
+	}
+	return fclose(f) == 0;
+}
+
+// EKF over the log into the store, returns the number of records or -1
+static long long forward(FILE *in, FILE *store, bool sim, double *rms) {
+	ImuLogHeader h;
+	SimStream s;
+	SimSample sample;
+	float gyro[3], accel[3], mag[3], q[4];
+	long long count = 0, last = 0;
+	double sum = 0.0;
+	size_t n;
+
+	if (!ImuLog_ReadHeader(in, &h)) return -1;
+	simStart(&cfg, &s);
+	while ((n = fread(logChunk, sizeof(ImuLogRecord), CHUNK, in)) > 0) {
+		for (size_t j = 0; j < n; j++, count++) {
+			float dt = 0.0f;
+			ImuLog_Calibrate(&h, &logChunk[j], gyro, accel, mag);
+			if (count == 0) {
+				float up[3] = {-accel[0], -accel[1], -accel[2]};
+				EKF_AHRSInit(up, mag);
+				gyro[0] = gyro[1] = gyro[2] = 0.0f;
+			} else {
+				dt = (logChunk[j].time - last) * 1e-6f;
+				EKF_AHRSUpdate(gyro, accel, mag, dt);
+			}
+			last = logChunk[j].time;
+			RTS_Record(&storeChunk[j], gyro, dt, logChunk[j].time);
+			if (sim) {
+				simNext(&cfg, &s, &sample);
+				if (count >= N_SKIP) {
+					EKF_AHRSGetQ(q);
+					double e = simAttitudeError(sample.q, q);
+					sum += e * e;
+				}
+			}
+		}
+		if (fwrite(storeChunk, sizeof(RTSRecord), n, store) != n) return -1;
+	}
+	if (fflush(store) != 0) return -1;
+	if (sim && count > N_SKIP) *rms = sqrt(sum / (count - N_SKIP));
+	return count;
+}
+
+// smoothed angles from the store, returns 0 on error
+static int output(FILE *store, FILE *csv, bool sim, double *rms) {
+	SimStream s;
+	SimSample sample;
+	float q[4], rpy[3];
+	long long count = 0;
+	double sum = 0.0;
+	size_t n;
+
+	simStart(&cfg, &s);
+	rewind(store);
+	while ((n = fread(storeChunk, sizeof(RTSRecord), CHUNK, store)) > 0) {
+		for (size_t j = 0; j < n; j++, count++) {
+			const RTSRecord &r = storeChunk[j];
+			q[0] = r.x[0]; q[1] = r.x[1]; q[2] = r.x[2]; q[3] = r.x[3];
+			Quaternion_ToEuler(q, rpy);
+			fprintf(csv, "%f,%f,%f,%lld\r\n", EKF_TODEG(rpy[0]), EKF_TODEG(rpy[1]), EKF_TODEG(rpy[2]), r.time);
+			if (sim) {
+				simNext(&cfg, &s, &sample);
+				if (count >= N_SKIP) {
+					double e = simAttitudeError(sample.q, q);
+					sum += e * e;
+				}
+			}
+		}
+	}
+	if (sim && count > N_SKIP) *rms = sqrt(sum / (count - N_SKIP));
+	return !ferror(store);
+}
+
+int main(int argc, char **argv) {
+	bool sim = argc < 2;
+	const char *logName = sim ? "sim.raw" : argv[1];
+	const char *csvName = argc > 2 ? argv[2] : (sim ? "sim.csv" : "smoothed.csv");
+	char storeName[512];
+	double forwardRms = 0.0, smoothRms = 0.0;
+	long long t0, t1, t2, t3, count;
+
+	simDefaultConfig(&cfg);
+	if (sim && !writeSimLog(logName)) {
+		printf("Error writing %s\n", logName);
+		return 1;
+	}
+
+	snprintf(storeName, sizeof(storeName), "%s.store", csvName);
+	FILE *in = fopen(logName, "rb");
+	FILE *store = fopen(storeName, "w+b");
+	FILE *csv = fopen(csvName, "w");
+	if (in == NULL || store == NULL || csv == NULL) {
+		printf("Error opening %s, %s or %s\n", logName, storeName, csvName);
+		return 1;
+	}
+
+	t0 = getCurrentNanoseconds();
+	count = forward(in, store, sim, &forwardRms);
+	t1 = getCurrentNanoseconds();
+	if (count <= 0) {
+		printf("Error reading %s\n", logName);
+		return 1;
+	}
+	if (!RTS_Smooth(store, count)) {
+		printf("Error smoothing %s\n", storeName);
+		return 1;
+	}
+	t2 = getCurrentNanoseconds();
+	if (!output(store, csv, sim, &smoothRms)) {
+		printf("Error reading %s\n", storeName);
+		return 1;
+	}
+	t3 = getCurrentNanoseconds();
+	fclose(in);
+	fclose(store);
+	fclose(csv);
+
+	printf("%lld samples, %u byte records in %s (%d per block)\n", count, (unsigned)sizeof(RTSRecord), storeName, RTS_BLOCK);
+	printf("forward   %6.2f Msamples/s\n", count * 1e3 / (t1 - t0));
+	printf("backward  %6.2f Msamples/s\n", count * 1e3 / (t2 - t1));
+	printf("csv       %6.2f Msamples/s\n", count * 1e3 / (t3 - t2));
+	if (sim) {
+		printf("rms attitude error: filtered %.3f deg, smoothed %.3f deg\n", forwardRms, smoothRms);
+	}
+	printf("Smoothed angles stored in %s\n", csvName);
+	return 0;
+}
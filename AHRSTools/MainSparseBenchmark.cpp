@@ -0,0 +1,70 @@
+#include <stdio.h>
+
+#include "miniAHRS.h"
+#include "benchUtils.h"
+#include "simUtils.h"
+
+// Runs the multi-rate EKF with a prediction per gyro sample (1 kHz) and the
+// accel and mag updates only every few samples, as when the mag is not
+// ready or the accel is rejected. Reports the time per gyro sample and the
+// attitude error over the second half of the run. Built twice by the
+// Makefile, as sparseBenchmark and as sparseBenchmarkLazy with
+// EKF_LAZY_COVARIANCE.
+
+#define N_SAMPLES 60000
+#define N_REPEAT 5
+
+static SimSample samples[N_SAMPLES];
+
+static void run(int accEvery, int magEvery, float dt) {
+	long long best = 0;
+	double sum = 0.0;
+	float up[3], accel[3], mag[3], q[4];
+
+	for (int n = 0; n < N_REPEAT; n++) {
+		sum = 0.0;
+		// EKF_AHRSInit takes the up vector, the accel reads -C' * [0 0 1]
+		for (int k = 0; k < 3; k++) { up[k] = -samples[0].accel[k]; mag[k] = samples[0].mag[k]; }
+		EKF_AHRSInit(up, mag);
+		long long t0 = getCurrentNanoseconds();
+		for (int i = 1; i < N_SAMPLES; i++) {
+			EKF_AHRSPredict(samples[i - 1].gyro, dt);
+			if (i % accEvery == 0) {
+				for (int k = 0; k < 3; k++) accel[k] = samples[i].accel[k];
+				EKF_AHRSUpdateAccel(accel);
+			}
+			if (i % magEvery == 0) {
+				for (int k = 0; k < 3; k++) mag[k] = samples[i].mag[k];
+				EKF_AHRSUpdateMag(mag);
+			}
+			EKF_AHRSGetQ(q);
+			if (i >= N_SAMPLES / 2) {
+				double e = simAttitudeError(samples[i].q, q);
+				sum += e * e;
+			}
+		}
+		long long t = getCurrentNanoseconds() - t0;
+		if (n == 0 || t < best) best = t;
+	}
+	printf("accel 1/%-3d mag 1/%-3d %8.1f ns/sample  rms %6.3f deg\n", accEvery, magEvery,
+			(double)best / (N_SAMPLES - 1), sqrt(sum / (N_SAMPLES - N_SAMPLES / 2)));
+}
+
+int main(int argc, char **argv) {
+
+	SimConfig cfg;
+	simDefaultConfig(&cfg);
+	cfg.dt = 0.001f;
+	simGenerate(&cfg, samples, N_SAMPLES);
+
+#ifdef EKF_LAZY_COVARIANCE
+	printf("%d samples at %.0f Hz, lazy covariance\n", N_SAMPLES, 1.0 / cfg.dt);
+#else
+	printf("%d samples at %.0f Hz, covariance propagated every sample\n", N_SAMPLES, 1.0 / cfg.dt);
+#endif
+	run(1, 1, cfg.dt);
+	run(10, 10, cfg.dt);
+	run(10, 50, cfg.dt);
+	run(50, 100, cfg.dt);
+	return 0;
+}
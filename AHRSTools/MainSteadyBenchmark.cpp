@@ -0,0 +1,65 @@
+#include <stdio.h>
+
+#include "miniAHRS.h"
+#include "benchUtils.h"
+#include "simUtils.h"
+
+// Runs EKF_AHRSUpdate on static, slow and normal motion and reports the
+// time per update, the attitude error over the second half of the run and
+// the share of updates that used a stored steady-state gain. Built twice by
+// the Makefile, as steadyBenchmark and as steadyBenchmarkGain with
+// EKF_STEADY_STATE_GAIN.
+
+#define N_SAMPLES 60000
+#define N_REPEAT 5
+
+static SimSample samples[N_SAMPLES];
+
+static void run(const char *name, float rate) {
+	long long best = 0;
+	double sum = 0.0;
+	int steady = 0;
+	float up[3], accel[3], mag[3], q[4];
+	SimConfig cfg;
+
+	simDefaultConfig(&cfg);
+	cfg.rate = rate;
+	simGenerate(&cfg, samples, N_SAMPLES);
+
+	for (int n = 0; n < N_REPEAT; n++) {
+		sum = 0.0;
+		steady = 0;
+		// EKF_AHRSInit takes the up vector, the accel reads -C' * [0 0 1]
+		for (int k = 0; k < 3; k++) { up[k] = -samples[0].accel[k]; mag[k] = samples[0].mag[k]; }
+		EKF_AHRSInit(up, mag);
+		long long t0 = getCurrentNanoseconds();
+		for (int i = 1; i < N_SAMPLES; i++) {
+			for (int k = 0; k < 3; k++) { accel[k] = samples[i].accel[k]; mag[k] = samples[i].mag[k]; }
+			EKF_AHRSUpdate(samples[i - 1].gyro, accel, mag, cfg.dt);
+			steady += EKF_AHRSIsSteady();
+			EKF_AHRSGetQ(q);
+			if (i >= N_SAMPLES / 2) {
+				double e = simAttitudeError(samples[i].q, q);
+				sum += e * e;
+			}
+		}
+		long long t = getCurrentNanoseconds() - t0;
+		if (n == 0 || t < best) best = t;
+	}
+	printf("%-8s %8.1f ns/update  rms %6.3f deg  steady %5.1f%%\n", name,
+			(double)best / (N_SAMPLES - 1), sqrt(sum / (N_SAMPLES - N_SAMPLES / 2)),
+			100.0 * steady / (N_SAMPLES - 1));
+}
+
+int main(int argc, char **argv) {
+
+#ifdef EKF_STEADY_STATE_GAIN
+	printf("%d samples at 100 Hz, steady-state gain\n", N_SAMPLES);
+#else
+	printf("%d samples at 100 Hz, full update\n", N_SAMPLES);
+#endif
+	run("static", 0.0f);
+	run("slow", 0.05f);
+	run("moving", 1.0f);
+	return 0;
+}
@@ -0,0 +1,428 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+
+#include "miniAHRS.h"
+#include "BatchAHRS.h"
+#include "EKFParameters.h"
+#include "ImuLog.h"
+#include "benchUtils.h"
+#include "simUtils.h"
+
+// Q/R tuning of the EKF of miniAHRS.h against a reference attitude:
+//   tuner [-o ekf.params] log.raw ref.csv [log.raw ref.csv ...]
+// log.raw is a raw log of IMU/MainAngles (ImuLog.h) and ref.csv holds roll,
+// pitch and yaw (deg) of every record, one row per record and more columns
+// ignored, the layout of angles.csv. Without logs it tunes on N_SIM_SETS
+// simulated sessions against their truth.
+//
+// The cost is the rms attitude error over all sessions after the first
+// N_SKIP samples. A grid over the parameters comes first and Nelder-Mead
+// refines its best point, both in log10 of the parameters. Every
+// evaluation replays each session through BatchAHRS with one candidate per
+// lane, and the (session, group of lanes) jobs run on a pool of one thread
+// per core. The result is written as a parameter file (EKFParameters.h) that
+// the EKF loads at run time with EKF_AHRSLoadParameters.
+//
+// Scaling Q, R and P together does not change the estimate, so EKF_RA_INITIAL
+// is kept and QQ, QWB and RM are searched relative to it. The initial P only
+// shapes the first samples, skipped by the cost, and is kept too.
+
+#define TUNER_LANES 8
+#define N_SIM_SETS 4
+#define N_SIM_SAMPLES 30000
+#define N_SKIP 500
+#define N_DIM 3
+#define GRID 7
+#define NM_ITERATIONS 80
+#define NM_TOLERANCE 0.005
+
+struct Dataset {
+	std::vector<float> gyro, accel, mag, dt, ref; // 3, 3, 3, 1 and 4 per sample
+	int n;
+};
+
+static std::vector<Dataset> sets;
+
+// one thread per core, jobs run in any order and run() returns when all are
+// done
+class ThreadPool {
+public:
+	ThreadPool(int threads) : pending(0), done(false) {
+		for (int i = 0; i < threads; i++) {
+			workers.push_back(std::thread(&ThreadPool::work, this));
+		}
+	}
+
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			done = true;
+		}
+		wake.notify_all();
+		for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+	}
+
+	void run(std::vector<std::function<void()> > &jobs) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (size_t i = 0; i < jobs.size(); i++) queue.push_back(jobs[i]);
+			pending += (int)jobs.size();
+		}
+		wake.notify_all();
+		std::unique_lock<std::mutex> lock(mutex);
+		idle.wait(lock, [this] { return pending == 0; });
+	}
+
+	int size() { return (int)workers.size(); }
+
+private:
+	void work() {
+		for (;;) {
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [this] { return done || !queue.empty(); });
+				if (queue.empty()) return;
+				job = queue.front();
+				queue.pop_front();
+			}
+			job();
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--pending == 0) idle.notify_all();
+		}
+	}
+
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()> > queue;
+	std::mutex mutex;
+	std::condition_variable wake, idle;
+	int pending;
+	bool done;
+};
+
+static EKF_Parameters toParameters(const double *v) {
+	EKF_Parameters p;
+	EKF_ParametersDefault(&p);
+	p.qq = (float)pow(10.0, v[0]);
+	p.qwb = (float)pow(10.0, v[1]);
+	p.rm = (float)pow(10.0, v[2]);
+	return p;
+}
+
+// between the reference and an estimate (rad), NaN once the filter diverged
+static double angle(const float *r, const float *q) {
+	double d = fabs((double)r[0] * q[0] + (double)r[1] * q[1] + (double)r[2] * q[2] + (double)r[3] * q[3]);
+	d /= sqrt((double)q[0] * q[0] + (double)q[1] * q[1] + (double)q[2] * q[2] + (double)q[3] * q[3]);
+	return d < 1.0 ? 2.0 * acos(d) : (d == d ? 0.0 : d);
+}
+
+// squared errors (rad^2) of up to TUNER_LANES candidates over one session
+static void replay(const Dataset &d, const EKF_Parameters *p, int n, double *sse) {
+	BatchAHRS<TUNER_LANES> filter;
+	float gyro[3][TUNER_LANES], accel[3][TUNER_LANES], mag[3][TUNER_LANES], dt[TUNER_LANES], q[4];
+
+	for (int l = 0; l < TUNER_LANES; l++) {
+		float a[3] = {d.accel[0], d.accel[1], d.accel[2]};
+		float m[3] = {d.mag[0], d.mag[1], d.mag[2]};
+		filter.setParameters(l, &p[l < n ? l : 0]);
+		filter.initialize(l, a, m);
+		sse[l] = 0.0;
+	}
+	for (int i = 1; i < d.n; i++) {
+		for (int l = 0; l < TUNER_LANES; l++) {
+			for (int k = 0; k < 3; k++) {
+				gyro[k][l] = d.gyro[i * 3 + k];
+				accel[k][l] = d.accel[i * 3 + k];
+				mag[k][l] = d.mag[i * 3 + k];
+			}
+			dt[l] = d.dt[i];
+		}
+		filter.update(gyro, accel, mag, dt);
+		if (i < N_SKIP) continue;
+		const float *r = &d.ref[i * 4];
+		for (int l = 0; l < n; l++) {
+			filter.getQuaternion(l, q);
+			double a = angle(r, q);
+			// a diverged lane reads NaN, the worst cost
+			sse[l] += a == a ? a * a : 1e30;
+		}
+	}
+}
+
+static ThreadPool *pool;
+static long long filterUpdates;
+
+// rms error (deg) of n candidates
+static void evaluate(const double (*v)[N_DIM], int n, double *cost) {
+	int groups = (n + TUNER_LANES - 1) / TUNER_LANES;
+	std::vector<double> sse(sets.size() * groups * TUNER_LANES);
+	std::vector<EKF_Parameters> p(groups * TUNER_LANES);
+	std::vector<std::function<void()> > jobs;
+	long long samples = 0;
+
+	for (int c = 0; c < n; c++) p[c] = toParameters(v[c]);
+	for (size_t s = 0; s < sets.size(); s++) {
+		samples += sets[s].n - N_SKIP;
+		for (int g = 0; g < groups; g++) {
+			int lanes = n - g * TUNER_LANES < TUNER_LANES ? n - g * TUNER_LANES : TUNER_LANES;
+			double *out = &sse[(s * groups + g) * TUNER_LANES];
+			const EKF_Parameters *in = &p[g * TUNER_LANES];
+			const Dataset *d = &sets[s];
+			jobs.push_back([d, in, lanes, out] { replay(*d, in, lanes, out); });
+			filterUpdates += (long long)lanes * (d->n - 1);
+		}
+	}
+	pool->run(jobs);
+	for (int c = 0; c < n; c++) {
+		double sum = 0.0;
+		for (size_t s = 0; s < sets.size(); s++) {
+			sum += sse[(s * groups + c / TUNER_LANES) * TUNER_LANES + c % TUNER_LANES];
+		}
+		cost[c] = EKF_TODEG(sqrt(sum / samples));
+	}
+}
+
+// log10 ranges of the grid, qq, qwb and rm
+static const double gridLow[N_DIM] = {-6.0, -12.0, -5.0};
+static const double gridHigh[N_DIM] = {0.0, -6.0, 0.0};
+
+static double searchGrid(double *best) {
+	static double v[GRID * GRID * GRID][N_DIM];
+	static double cost[GRID * GRID * GRID];
+	int n = 0, b = 0;
+
+	for (int i = 0; i < GRID; i++) {
+		for (int j = 0; j < GRID; j++) {
+			for (int k = 0; k < GRID; k++, n++) {
+				v[n][0] = gridLow[0] + (gridHigh[0] - gridLow[0]) * i / (GRID - 1);
+				v[n][1] = gridLow[1] + (gridHigh[1] - gridLow[1]) * j / (GRID - 1);
+				v[n][2] = gridLow[2] + (gridHigh[2] - gridLow[2]) * k / (GRID - 1);
+			}
+		}
+	}
+	evaluate(v, n, cost);
+	for (int c = 1; c < n; c++) {
+		if (cost[c] < cost[b]) b = c;
+	}
+	memcpy(best, v[b], sizeof(v[b]));
+	return cost[b];
+}
+
+// Nelder-Mead from best, step in decades. The reflection, expansion and both
+// contractions of an iteration are evaluated together, one parallel call
+static double searchNelderMead(double *best, double cost, double step) {
+	double s[N_DIM + 1][N_DIM], f[N_DIM + 1];
+	int it;
+
+	memcpy(s[0], best, sizeof(s[0]));
+	f[0] = cost;
+	for (int i = 1; i <= N_DIM; i++) {
+		memcpy(s[i], best, sizeof(s[i]));
+		s[i][i - 1] += step;
+	}
+	evaluate(s + 1, N_DIM, f + 1);
+
+	for (it = 0; it < NM_ITERATIONS; it++) {
+		double c[N_DIM] = {0.0, 0.0, 0.0}, t[4][N_DIM], ft[4];
+
+		// best first, worst last
+		for (int i = 1; i <= N_DIM; i++) {
+			for (int j = i; j > 0 && f[j] < f[j - 1]; j--) {
+				double x[N_DIM];
+				memcpy(x, s[j], sizeof(x)); memcpy(s[j], s[j - 1], sizeof(x)); memcpy(s[j - 1], x, sizeof(x));
+				double y = f[j]; f[j] = f[j - 1]; f[j - 1] = y;
+			}
+		}
+		if (f[N_DIM] - f[0] < NM_TOLERANCE) break;
+
+		for (int i = 0; i < N_DIM; i++) {
+			for (int j = 0; j < N_DIM; j++) c[j] += s[i][j] / N_DIM;
+		}
+		// reflection, expansion, outside and inside contraction
+		static const double coef[4] = {1.0, 2.0, 0.5, -0.5};
+		for (int k = 0; k < 4; k++) {
+			for (int j = 0; j < N_DIM; j++) t[k][j] = c[j] + coef[k] * (c[j] - s[N_DIM][j]);
+		}
+		evaluate(t, 4, ft);
+
+		int pick = -1;
+		if (ft[0] < f[0]) {
+			pick = ft[1] < ft[0] ? 1 : 0;
+		} else if (ft[0] < f[N_DIM - 1]) {
+			pick = 0;
+		} else if (ft[0] < f[N_DIM]) {
+			pick = ft[2] <= ft[0] ? 2 : -1;
+		} else {
+			pick = ft[3] < f[N_DIM] ? 3 : -1;
+		}
+		if (pick >= 0) {
+			memcpy(s[N_DIM], t[pick], sizeof(s[N_DIM]));
+			f[N_DIM] = ft[pick];
+		} else {
+			// shrink towards the best point
+			for (int i = 1; i <= N_DIM; i++) {
+				for (int j = 0; j < N_DIM; j++) s[i][j] = s[0][j] + 0.5 * (s[i][j] - s[0][j]);
+			}
+			evaluate(s + 1, N_DIM, f + 1);
+		}
+	}
+
+	int b = 0;
+	for (int i = 1; i <= N_DIM; i++) {
+		if (f[i] < f[b]) b = i;
+	}
+	memcpy(best, s[b], sizeof(s[b]));
+	printf("nelder-mead  %d iterations\n", it);
+	return f[b];
+}
+
+static void addSample(Dataset &d, const float *gyro, const float *accel, const float *mag, float dt, const float *q) {
+	for (int k = 0; k < 3; k++) {
+		d.gyro.push_back(gyro[k]);
+		d.accel.push_back(accel[k]);
+		d.mag.push_back(mag[k]);
+	}
+	d.dt.push_back(dt);
+	for (int k = 0; k < 4; k++) d.ref.push_back(q[k]);
+	d.n++;
+}
+
+static void simulate() {
+	static SimSample samples[N_SIM_SAMPLES];
+	SimConfig cfg;
+	float q[4];
+
+	for (int s = 0; s < N_SIM_SETS; s++) {
+		Dataset d;
+		d.n = 0;
+		simDefaultConfig(&cfg);
+		cfg.seed = s + 1;
+		cfg.rate = 0.5f + s;
+		simGenerate(&cfg, samples, N_SIM_SAMPLES);
+		for (int i = 0; i < N_SIM_SAMPLES; i++) {
+			for (int k = 0; k < 4; k++) q[k] = (float)samples[i].q[k];
+			addSample(d, samples[i > 0 ? i - 1 : 0].gyro, samples[i].accel, samples[i].mag, cfg.dt, q);
+		}
+		sets.push_back(d);
+	}
+}
+
+// returns 0 if the files cannot be read or do not match
+static int load(const char *logName, const char *refName) {
+	ImuLogHeader h;
+	ImuLogRecord r;
+	Dataset d;
+	float gyro[3], accel[3], mag[3], rpy[3], q[4];
+	char line[256];
+	long long last = 0;
+	FILE *log = fopen(logName, "rb");
+	FILE *ref = fopen(refName, "r");
+	int ok = log != NULL && ref != NULL && ImuLog_ReadHeader(log, &h);
+
+	d.n = 0;
+	while (ok && fread(&r, sizeof(r), 1, log) == 1) {
+		if (fgets(line, sizeof(line), ref) == NULL || sscanf(line, "%f,%f,%f", &rpy[0], &rpy[1], &rpy[2]) != 3) {
+			ok = 0;
+			break;
+		}
+		for (int k = 0; k < 3; k++) rpy[k] *= (float)(M_PI / 180.0);
+		Quaternion_FromEuler(q, rpy);
+		ImuLog_Calibrate(&h, &r, gyro, accel, mag);
+		addSample(d, gyro, accel, mag, d.n > 0 ? (r.time - last) * 1e-6f : 0.0f, q);
+		last = r.time;
+	}
+	if (log != NULL) fclose(log);
+	if (ref != NULL) fclose(ref);
+	if (ok && d.n > N_SKIP) sets.push_back(d);
+	return ok && d.n > N_SKIP;
+}
+
+// rms error (deg) of the scalar EKF over the sessions, after
+// EKF_AHRSLoadParameters, as the runtime would use the file
+static double checkScalar(const char *file) {
+	static const Mat<EKF_STATE_DIM, EKF_STATE_DIM> P0 = P;
+	double sum = 0.0;
+	long long samples = 0;
+	float q[4];
+
+	for (size_t s = 0; s < sets.size(); s++) {
+		Dataset &d = sets[s];
+		float up[3] = {-d.accel[0], -d.accel[1], -d.accel[2]};
+		Mat_Copy(P0, P);
+		for (int i = 0; i < EKF_STATE_DIM; i++) X[i] = 0.0f;
+		if (!EKF_AHRSLoadParameters(file)) return -1.0;
+		EKF_AHRSInit(up, &d.mag[0]);
+		for (int i = 1; i < d.n; i++) {
+			EKF_AHRSUpdate(&d.gyro[i * 3], &d.accel[i * 3], &d.mag[i * 3], d.dt[i]);
+			if (i < N_SKIP) continue;
+			EKF_AHRSGetQ(q);
+			double a = angle(&d.ref[i * 4], q);
+			sum += a * a;
+			samples++;
+		}
+	}
+	return EKF_TODEG(sqrt(sum / samples));
+}
+
+int main(int argc, char **argv) {
+	const char *outName = "ekf.params";
+	double v[1][N_DIM], best[N_DIM], defaultCost, gridCost, cost, scalarCost;
+	EKF_Parameters p;
+	char comment[256];
+	int arg = 1;
+
+	if (argc > 2 && strcmp(argv[1], "-o") == 0) {
+		outName = argv[2];
+		arg = 3;
+	}
+	if (arg == argc) {
+		simulate();
+	}
+	for (; arg + 1 < argc; arg += 2) {
+		if (!load(argv[arg], argv[arg + 1])) {
+			printf("Error reading %s and %s\n", argv[arg], argv[arg + 1]);
+			return 1;
+		}
+	}
+	if (sets.empty()) {
+		printf("usage: tuner [-o ekf.params] log.raw ref.csv [log.raw ref.csv ...]\n");
+		return 1;
+	}
+
+	unsigned int threads = std::thread::hardware_concurrency();
+	pool = new ThreadPool(threads > 0 ? threads : 1);
+	printf("%d sessions, %d threads, %d lanes per job\n", (int)sets.size(), pool->size(), TUNER_LANES);
+
+	long long t0 = getCurrentNanoseconds();
+	EKF_ParametersDefault(&p);
+	v[0][0] = log10(p.qq); v[0][1] = log10(p.qwb); v[0][2] = log10(p.rm);
+	evaluate(v, 1, &defaultCost);
+	printf("defaults     rms %.3f deg\n", defaultCost);
+
+	gridCost = searchGrid(best);
+	printf("grid         rms %.3f deg  qq %.3g  qwb %.3g  rm %.3g\n", gridCost, pow(10.0, best[0]), pow(10.0, best[1]), pow(10.0, best[2]));
+
+	cost = searchNelderMead(best, gridCost, 0.5);
+	p = toParameters(best);
+	printf("tuned        rms %.3f deg  qq %.3g  qwb %.3g  rm %.3g\n", cost, p.qq, p.qwb, p.rm);
+	long long t1 = getCurrentNanoseconds();
+	printf("%lld filter updates in %.2f s, %.1f M/s\n", filterUpdates, (t1 - t0) * 1e-9, filterUpdates * 1e3 / (t1 - t0));
+	delete pool;
+
+	snprintf(comment, sizeof(comment), "tuner, %d sessions, rms %.3f deg (defaults %.3f deg)", (int)sets.size(), cost, defaultCost);
+	if (!EKF_ParametersSave(outName, &p, comment)) {
+		printf("Error writing %s\n", outName);
+		return 1;
+	}
+	scalarCost = checkScalar(outName);
+	printf("EKF_AHRSUpdate with %s  rms %.3f deg\n", outName, scalarCost);
+	printf("Parameters stored in %s\n", outName);
+	return 0;
+}
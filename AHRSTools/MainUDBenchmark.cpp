@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Dense"
+#include "miniAHRS.h"
+#include "benchUtils.h"
+#include "simUtils.h"
+
+// Long run stability of the covariance update of EKF_AHRSUpdate, built once
+// per form: Joseph (default), UD with -DEKF_UD_COVARIANCE, P - K*H*P with
+// -DEKF_SIMPLE_COVARIANCE_UPDATE, the float-float accumulation of
+// -DEKF_MIXED_COVARIANCE and the generated Joseph form kernels of
+// -DEKF_GENERATED_KERNELS. Times the update on a short stored run, then
+// streams hours of simulated motion (24 by default, or the first argument)
+// and reports for every hour the attitude error and the worst covariance
+// seen: smallest eigenvalue and largest asymmetry of P, and its largest
+// relative distance to a double precision twin. The twin runs the Joseph
+// form on the F, H and R of every filter step, so the distance is the
+// rounding error of the form alone. The second argument scales the process
+// noise Q, a smaller Q gives a smaller, worse conditioned P.
+
+#define N_SAMPLES 60000
+#define N_REPEAT 5
+#define N_CHECK 1000 // covariance check period (samples)
+
+static SimSample samples[N_SAMPLES];
+
+#if defined(EKF_UD_COVARIANCE)
+#define FORM_NAME "UD (Bierman-Thornton)"
+#elif defined(EKF_MIXED_COVARIANCE)
+#define FORM_NAME "float-float accumulated"
+#elif defined(EKF_GENERATED_KERNELS)
+#define FORM_NAME "Joseph, generated kernels"
+#elif defined(UPDATE_P_COMPLICATED)
+#define FORM_NAME "Joseph"
+#else
+#define FORM_NAME "P - K*H*P"
+#endif
+
+static double minEigenvalue(const float *cov, double *asym) {
+	Eigen::Matrix<double, EKF_STATE_DIM, EKF_STATE_DIM> A;
+	for (unsigned int i = 0; i < EKF_STATE_DIM; i++) {
+		for (unsigned int j = 0; j < EKF_STATE_DIM; j++) {
+			A(i, j) = cov[i * EKF_STATE_DIM + j];
+			double d = fabs((double)cov[i * EKF_STATE_DIM + j] - (double)cov[j * EKF_STATE_DIM + i]);
+			if (d > *asym) *asym = d;
+		}
+	}
+	Eigen::SelfAdjointEigenSolver<Eigen::Matrix<double, EKF_STATE_DIM, EKF_STATE_DIM> > es(A, Eigen::EigenvaluesOnly);
+	return es.eigenvalues()(0);
+}
+
+typedef Eigen::Matrix<double, EKF_STATE_DIM, EKF_STATE_DIM> MatP;
+
+template <unsigned short M, unsigned short N>
+static Eigen::Matrix<double, M, N> toDouble(const Mat<M, N> &A) {
+	Eigen::Matrix<double, M, N> D;
+	for (unsigned int i = 0; i < M; i++) {
+		for (unsigned int j = 0; j < N; j++) D(i, j) = A(i, j);
+	}
+	return D;
+}
+
+// one step of the double precision twin with the F, H and R the filter used
+static void twinStep(MatP &Pd, double qdt) {
+	MatP Fd = toDouble(F);
+	Eigen::Matrix<double, EKF_MEASUREMENT_DIM, EKF_STATE_DIM> Hd = toDouble(H);
+	Eigen::Matrix<double, EKF_MEASUREMENT_DIM, EKF_MEASUREMENT_DIM> Rd = toDouble(R);
+	Pd = Fd * Pd * Fd.transpose();
+	for (int i = 0; i < EKF_STATE_DIM; i++) Pd(i, i) += Q(i, i) * qdt;
+	Eigen::Matrix<double, EKF_STATE_DIM, EKF_MEASUREMENT_DIM> Kd =
+			Pd * Hd.transpose() * (Hd * Pd * Hd.transpose() + Rd).inverse();
+	MatP A = MatP::Identity() - Kd * Hd;
+	Pd = A * Pd * A.transpose() + Kd * Rd * Kd.transpose();
+}
+
+// largest |P - Pd| over the largest |Pd|
+static double twinDistance(const float *cov, const MatP &Pd) {
+	double d = 0.0;
+	for (int i = 0; i < EKF_STATE_DIM; i++) {
+		for (int j = 0; j < EKF_STATE_DIM; j++) d = fmax(d, fabs(cov[i * EKF_STATE_DIM + j] - Pd(i, j)));
+	}
+	return d / Pd.cwiseAbs().maxCoeff();
+}
+
+// back to the initial P (diagonal, so also valid U and D factors) and a
+// zero bias. EKF_AHRSInit takes the up vector, the accel reads -C' * [0 0 1]
+static void reset(const float *accel, float *mag) {
+	static const Mat<EKF_STATE_DIM, EKF_STATE_DIM> P0 = P;
+	float up[3] = {-accel[0], -accel[1], -accel[2]};
+	Mat_Copy(P0, P);
+	for (int i = 0; i < EKF_STATE_DIM; i++) X[i] = 0.0f;
+	EKF_AHRSInit(up, mag);
+}
+
+int main(int argc, char **argv) {
+	SimConfig cfg;
+	SimStream stream;
+	SimSample s;
+	float accel[3], mag[3], q[4], cov[EKF_STATE_DIM * EKF_STATE_DIM];
+	long long best = 0;
+	int hours = argc > 1 ? atoi(argv[1]) : 24;
+	float qscale = argc > 2 ? atof(argv[2]) : 1.0f;
+
+	for (int i = 0; i < EKF_STATE_DIM; i++) Q(i, i) *= qscale;
+	simDefaultConfig(&cfg);
+	simGenerate(&cfg, samples, N_SAMPLES);
+	printf("%s covariance update, SIMD kernels: %s\n", FORM_NAME, MAT_SIMD_NAME);
+
+	for (int n = 0; n < N_REPEAT; n++) {
+		// EKF_AHRSUpdate normalizes its inputs in place
+		for (int k = 0; k < 3; k++) { accel[k] = samples[0].accel[k]; mag[k] = samples[0].mag[k]; }
+		reset(accel, mag);
+		long long t0 = getCurrentNanoseconds();
+		for (int i = 1; i < N_SAMPLES; i++) {
+			for (int k = 0; k < 3; k++) { accel[k] = samples[i].accel[k]; mag[k] = samples[i].mag[k]; }
+			EKF_AHRSUpdate(samples[i - 1].gyro, accel, mag, cfg.dt);
+		}
+		long long t = getCurrentNanoseconds() - t0;
+		if (n == 0 || t < best) best = t;
+	}
+	printf("%.1f ns/update over %d samples\n\n", (double)best / (N_SAMPLES - 1), N_SAMPLES);
+
+	// same motion, streamed
+	int perHour = (int)(3600.0f / cfg.dt + 0.5f);
+	simStart(&cfg, &stream);
+	simNext(&cfg, &stream, &s);
+	for (int k = 0; k < 3; k++) { accel[k] = s.accel[k]; mag[k] = s.mag[k]; }
+	reset(accel, mag);
+	MatP Pd = toDouble(P);
+	printf("hour   rms (deg)   max (deg)     min eig        asym   twin dist\n");
+	for (int h = 0; h < hours; h++) {
+		double sum = 0.0, worst = 0.0, eig = INFINITY, asym = 0.0, dist = 0.0;
+		for (int i = 0; i < perHour; i++) {
+			float gyro[3] = {s.gyro[0], s.gyro[1], s.gyro[2]};
+			simNext(&cfg, &stream, &s);
+			for (int k = 0; k < 3; k++) { accel[k] = s.accel[k]; mag[k] = s.mag[k]; }
+			EKF_AHRSUpdate(gyro, accel, mag, cfg.dt);
+			twinStep(Pd, cfg.dt / EKF_QDT_NOMINAL);
+			EKF_AHRSGetQ(q);
+			double e = simAttitudeError(s.q, q);
+			// a diverged filter shows up as nan
+			if (!(e == e)) e = 180.0;
+			sum += e * e;
+			if (e > worst) worst = e;
+			if (i % N_CHECK == 0) {
+				EKF_AHRSGetCovariance(cov);
+				double m = minEigenvalue(cov, &asym);
+				if (!(m >= eig)) eig = m;
+				dist = fmax(dist, twinDistance(cov, Pd));
+			}
+		}
+		printf("%4d %11.3f %11.3f %11.3e %11.3e %11.3e\n", h + 1, sqrt(sum / perHour), worst, eig, asym, dist);
+		fflush(stdout);
+	}
+	return 0;
+}
@@ -0,0 +1,37 @@
+#include <time.h>
+#include <stdint.h>
+#include <stdlib.h>
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+
+#ifndef BENCHUTILS_H_
+#define BENCHUTILS_H_
+
+// Also starts the timed code with a clean upper AVX state: the compiler
+// does not always clear it after 256-bit code, and the SSE code of libm
+// then pays a transition on every call
+long long getCurrentNanoseconds() {
+	struct timespec currentTime;
+#ifdef __AVX__
+	_mm256_zeroupper();
+#endif
+	clock_gettime(CLOCK_MONOTONIC, &currentTime);
+	return (long long)currentTime.tv_sec * 1000000000LL + currentTime.tv_nsec;
+}
+
+// Uniform random value in [lo, hi) (deterministic through srand)
+float randomUniform(float lo, float hi) {
+	return lo + (hi - lo) * ((float)rand() / ((float)RAND_MAX + 1.0f));
+}
+
+// Keep the optimizer from dropping a benchmarked result
+volatile float benchSink;
+
+void consume(const float *data, int n) {
+	float acc = 0.0f;
+	for (int i = 0; i < n; i++) acc += data[i];
+	benchSink += acc;
+}
+
+#endif
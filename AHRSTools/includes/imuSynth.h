@@ -0,0 +1,233 @@
+#include <math.h>
+#include <stdint.h>
+
+#ifndef IMUSYNTH_H_
+#define IMUSYNTH_H_
+
+// Synthetic trajectories and raw MPU9250/AK8963 samples for benchmarking at
+// scale. Unlike simUtils.h nothing is integrated: the attitude is a closed
+// form of the time (Z-Y-X Euler angles made of sinusoids and a yaw rate),
+// the body rate its exact derivative, and the noise comes from a counter
+// based generator keyed by (seed, sample, channel). Any sample can be
+// computed on its own, so blocks of a session are generated in parallel in
+// any order and the output does not depend on the number of threads.
+//
+// The sensor models, per sensor, are
+//   raw = round((A * true + bias + vibration + noise) / resolution)
+// with A = (I + misalignment) * diag(1 + scale), saturated to int16, and
+// the attitude convention of miniAHRS.h and simUtils.h: accel = -C' * [0 0 1]
+// (g), mag = C' * field (uT), gyro the body rate (deg/s).
+
+struct SynthSensor {
+	float bias[3];       // sensor units (deg/s, g, uT)
+	float scale[3];      // scale factor error, 0.01 = +1%
+	float misalign;      // largest cross-axis term (rad), drawn per pair from the seed
+	float noise;         // sensor units, standard deviation
+	float resolution;    // sensor units per LSB
+};
+
+struct SynthConfig {
+	double dt;             // sample period (s)
+	float rollAmp, rollFreq;     // rad, Hz
+	float pitchAmp, pitchFreq;   // rad, Hz, keep pitchAmp under pi/2
+	float yawAmp, yawFreq;       // rad, Hz
+	float yawRate;               // rad/s, added to the yaw sinusoid
+	SynthSensor gyro, accel, mag;
+	float field, dip;            // earth field (uT) and inclination (rad)
+	float vibAccel, vibGyro;     // vibration amplitude (g, deg/s)
+	float vibFreq;               // Hz
+	float distField;             // magnetic disturbance (uT, east in the nav frame)
+	float distPeriod, distLength;  // s, the disturbance is on for distLength every distPeriod
+	uint64_t seed;
+};
+
+struct SynthSample {
+	int16_t gyro[3], accel[3], mag[3];
+	float rpy[3];        // true roll, pitch and yaw (rad), yaw in [0, 2 pi)
+	float q[4];          // true attitude, body to nav
+};
+
+// Sensor matrices of a configuration, computed once
+struct SynthModel {
+	float A[3][9];       // gyro, accel and mag
+};
+
+// Resolutions left at 0, taken from the driver by the caller
+void synthDefaultConfig(SynthConfig *cfg) {
+	SynthSensor *s[3] = {&cfg->gyro, &cfg->accel, &cfg->mag};
+	static const float bias[3][3] = {{0.6f, -1.1f, 0.9f}, {0.02f, -0.015f, 0.03f}, {4.0f, -6.0f, 3.0f}};
+	static const float noise[3] = {0.3f, 0.01f, 0.5f};
+
+	cfg->dt = 0.01;
+	cfg->rollAmp = 0.6f; cfg->rollFreq = 0.11f;
+	cfg->pitchAmp = 0.4f; cfg->pitchFreq = 0.07f;
+	cfg->yawAmp = 1.0f; cfg->yawFreq = 0.03f;
+	cfg->yawRate = 0.05f;
+	for (int k = 0; k < 3; k++) {
+		for (int i = 0; i < 3; i++) {
+			s[k]->bias[i] = bias[k][i];
+			s[k]->scale[i] = 0.005f * (i - 1);
+		}
+		s[k]->misalign = 0.005f;
+		s[k]->noise = noise[k];
+		s[k]->resolution = 0.0f;
+	}
+	cfg->field = 48.0f;
+	cfg->dip = 1.0f;
+	cfg->vibAccel = 0.05f;
+	cfg->vibGyro = 0.5f;
+	cfg->vibFreq = 23.0f;
+	cfg->distField = 15.0f;
+	cfg->distPeriod = 120.0f;
+	cfg->distLength = 5.0f;
+	cfg->seed = 1;
+}
+
+// splitmix64 of a counter
+static inline uint64_t synthHash(uint64_t x) {
+	x += 0x9E3779B97F4A7C15ull;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+	return x ^ (x >> 31);
+}
+
+// Unit normal approximated by the sum of four 16-bit uniforms of one hash
+// (Irwin-Hall), no tails beyond 3.46 sigma
+static inline float synthNormal(uint64_t seed, uint64_t sample, unsigned int channel) {
+	uint64_t h = synthHash(seed ^ synthHash(sample * 16 + channel));
+	float sum = (float)(h & 0xFFFF) + (float)((h >> 16) & 0xFFFF) + (float)((h >> 32) & 0xFFFF) + (float)(h >> 48);
+	return (sum - 2.0f * 65535.0f) * (1.7320508f / 65535.0f);
+}
+
+void synthModel(const SynthConfig *cfg, SynthModel *m) {
+	const SynthSensor *s[3] = {&cfg->gyro, &cfg->accel, &cfg->mag};
+
+	for (int k = 0; k < 3; k++) {
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				// uniform in [-misalign, misalign] per axis pair
+				float u = (float)(synthHash(cfg->seed * 64 + k * 9 + i * 3 + j) >> 40) / (float)(1 << 24);
+				float e = i == j ? 1.0f : s[k]->misalign * (2.0f * u - 1.0f);
+				m->A[k][i * 3 + j] = e * (1.0f + s[k]->scale[j]);
+			}
+		}
+	}
+}
+
+static inline int16_t synthCounts(float v, float resolution) {
+	float c = v / resolution;
+	c = c > 32767.0f ? 32767.0f : (c < -32768.0f ? -32768.0f : c);
+	return (int16_t)lrintf(c);
+}
+
+static inline void synthSensor(const SynthSensor *s, const float *A, const float *v, const float *vib,
+		uint64_t seed, uint64_t i, unsigned int channel, int16_t *out) {
+	for (int k = 0; k < 3; k++) {
+		float m = A[k * 3] * v[0] + A[k * 3 + 1] * v[1] + A[k * 3 + 2] * v[2];
+		m += s->bias[k] + vib[k] + s->noise * synthNormal(seed, i, channel + k);
+		out[k] = synthCounts(m, s->resolution);
+	}
+}
+
+// Position in a session. The sinusoids of the time (roll, pitch, yaw and
+// vibration) advance by a rotation per sample instead of four sin and cos
+// calls; synthSeek sets them exactly, so a block started with it does not
+// depend on the blocks before
+struct SynthCursor {
+	uint64_t i;
+	double s[4], c[4];     // sin and cos of the phases at sample i
+	double ds[4], dc[4];   // sin and cos of the step
+};
+
+static inline void synthFrequencies(const SynthConfig *cfg, double *w) {
+	const double TWOPI = 6.283185307179586;
+	w[0] = TWOPI * cfg->rollFreq;
+	w[1] = TWOPI * cfg->pitchFreq;
+	w[2] = TWOPI * cfg->yawFreq;
+	w[3] = TWOPI * cfg->vibFreq;
+}
+
+void synthSeek(const SynthConfig *cfg, uint64_t i, SynthCursor *c) {
+	double w[4], t = (double)i * cfg->dt;
+
+	synthFrequencies(cfg, w);
+	c->i = i;
+	for (int k = 0; k < 4; k++) {
+		c->s[k] = sin(w[k] * t);
+		c->c[k] = cos(w[k] * t);
+		c->ds[k] = sin(w[k] * cfg->dt);
+		c->dc[k] = cos(w[k] * cfg->dt);
+	}
+}
+
+// The sample at the cursor, then the cursor to the next one
+void synthNext(const SynthConfig *cfg, const SynthModel *m, SynthCursor *c, SynthSample *out) {
+	const double TWOPI = 6.283185307179586;
+	const float TODEG = 57.29577951f;
+	double w[4], t = (double)c->i * cfg->dt;
+
+	synthFrequencies(cfg, w);
+	float phi = (float)(cfg->rollAmp * c->s[0]), theta = (float)(cfg->pitchAmp * c->s[1]);
+	double psi = fmod(cfg->yawRate * t + cfg->yawAmp * c->s[2], TWOPI);
+	if (psi < 0.0) psi += TWOPI;
+	float dphi = (float)(cfg->rollAmp * w[0] * c->c[0]), dtheta = (float)(cfg->pitchAmp * w[1] * c->c[1]);
+	float dpsi = (float)(cfg->yawRate + cfg->yawAmp * w[2] * c->c[2]);
+	float sv = (float)c->s[3];
+
+	// half angles, the quaternion q = qz * qy * qx, and the full angles
+	float hs0 = sinf(0.5f * phi), hc0 = cosf(0.5f * phi);
+	float hs1 = sinf(0.5f * theta), hc1 = cosf(0.5f * theta);
+	float hs2 = sinf(0.5f * (float)psi), hc2 = cosf(0.5f * (float)psi);
+	out->q[0] = hc2 * hc1 * hc0 + hs2 * hs1 * hs0;
+	out->q[1] = hc2 * hc1 * hs0 - hs2 * hs1 * hc0;
+	out->q[2] = hc2 * hs1 * hc0 + hs2 * hc1 * hs0;
+	out->q[3] = hs2 * hc1 * hc0 - hc2 * hs1 * hs0;
+	out->rpy[0] = phi; out->rpy[1] = theta; out->rpy[2] = (float)psi;
+	float sphi = 2.0f * hs0 * hc0, cphi = hc0 * hc0 - hs0 * hs0;
+	float sth = 2.0f * hs1 * hc1, cth = hc1 * hc1 - hs1 * hs1;
+	float spsi = 2.0f * hs2 * hc2, cpsi = hc2 * hc2 - hs2 * hs2;
+
+	// C = Rz(psi) * Ry(theta) * Rx(phi), body to nav
+	float C[9] = {
+		cpsi * cth, cpsi * sth * sphi - spsi * cphi, cpsi * sth * cphi + spsi * sphi,
+		spsi * cth, spsi * sth * sphi + cpsi * cphi, spsi * sth * cphi - cpsi * sphi,
+		-sth, cth * sphi, cth * cphi};
+
+	// body rate of the Euler rates (deg/s)
+	float g[3] = {
+		TODEG * (dphi - dpsi * sth),
+		TODEG * (dtheta * cphi + dpsi * cth * sphi),
+		TODEG * (-dtheta * sphi + dpsi * cth * cphi)};
+	float a[3] = {-C[6], -C[7], -C[8]};
+
+	// field, plus the disturbance for distLength every distPeriod
+	float fn[3] = {cfg->field * cosf(cfg->dip), 0.0f, cfg->field * sinf(cfg->dip)};
+	if (cfg->distPeriod > 0.0f && fmod(t, cfg->distPeriod) < cfg->distLength) fn[1] = cfg->distField;
+	float f[3];
+	for (int k = 0; k < 3; k++) f[k] = C[k] * fn[0] + C[3 + k] * fn[1] + C[6 + k] * fn[2];
+
+	float vibA[3] = {cfg->vibAccel * sv, cfg->vibAccel * 0.5f * sv, cfg->vibAccel * 0.7f * sv};
+	float vibG[3] = {cfg->vibGyro * sv, -cfg->vibGyro * sv, cfg->vibGyro * 0.3f * sv};
+	float none[3] = {0.0f, 0.0f, 0.0f};
+
+	synthSensor(&cfg->gyro, m->A[0], g, vibG, cfg->seed, c->i, 0, out->gyro);
+	synthSensor(&cfg->accel, m->A[1], a, vibA, cfg->seed, c->i, 3, out->accel);
+	synthSensor(&cfg->mag, m->A[2], f, none, cfg->seed, c->i, 6, out->mag);
+
+	for (int k = 0; k < 4; k++) {
+		double sk = c->s[k] * c->dc[k] + c->c[k] * c->ds[k];
+		c->c[k] = c->c[k] * c->dc[k] - c->s[k] * c->ds[k];
+		c->s[k] = sk;
+	}
+	c->i++;
+}
+
+// Sample i alone
+void synthSample(const SynthConfig *cfg, const SynthModel *m, uint64_t i, SynthSample *out) {
+	SynthCursor c;
+
+	synthSeek(cfg, i, &c);
+	synthNext(cfg, m, &c, out);
+}
+
+#endif
@@ -0,0 +1,138 @@
+#include <math.h>
+#include <stdlib.h>
+
+#ifndef SIMUTILS_H_
+#define SIMUTILS_H_
+
+// Ground truth + sensor samples for replaying the same motion through
+// several filters. The quaternion rotates body to navigation frame with
+// q' = 0.5 * q * (0, w), the convention of miniAHRS.h, so the expected
+// sensor outputs are accel = -C' * [0 0 1] and mag = C' * [mx 0 mz].
+struct SimSample {
+	float gyro[3];   // rad/s, with bias and noise
+	float accel[3];  // g, with noise
+	float mag[3];    // normalized field, with noise
+	double q[4];     // true attitude
+};
+
+struct SimConfig {
+	float dt;            // sample period (s)
+	float rate;          // peak angular rate (rad/s)
+	float gyroBias[3];   // rad/s
+	float gyroNoise;     // rad/s, standard deviation
+	float accelNoise;    // g, standard deviation
+	float magNoise;      // standard deviation on the unit field
+	float dip;           // magnetic inclination (rad)
+	unsigned int seed;
+};
+
+void simDefaultConfig(SimConfig *cfg) {
+	cfg->dt = 0.01f;
+	cfg->rate = 1.0f;
+	cfg->gyroBias[0] = 0.01f; cfg->gyroBias[1] = -0.02f; cfg->gyroBias[2] = 0.015f;
+	cfg->gyroNoise = 0.005f;
+	cfg->accelNoise = 0.01f;
+	cfg->magNoise = 0.01f;
+	cfg->dip = 1.0f;
+	cfg->seed = 1;
+}
+
+// Standard normal sample (Box-Muller) from a caller owned LCG state
+double simGaussian(unsigned int *state) {
+	*state = *state * 1664525u + 1013904223u;
+	double u1 = ((*state >> 8) + 1.0) / 16777217.0;
+	*state = *state * 1664525u + 1013904223u;
+	double u2 = (*state >> 8) / 16777216.0;
+	return sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+}
+
+// Smooth body rate profile, a few incommensurate sines per axis
+void simAngularRate(double t, float peak, double *w) {
+	w[0] = peak * (0.6 * sin(0.9 * t) + 0.4 * sin(2.3 * t + 0.5));
+	w[1] = peak * (0.5 * sin(0.7 * t + 1.0) + 0.5 * sin(1.9 * t));
+	w[2] = peak * (0.7 * sin(0.5 * t + 2.0) + 0.3 * sin(3.1 * t + 0.3));
+}
+
+// q = q * exp(0.5 * w * dt)
+void simIntegrate(double *q, const double *w, double dt) {
+	double a = sqrt(w[0] * w[0] + w[1] * w[1] + w[2] * w[2]) * dt;
+	double s = a > 1e-12 ? sin(0.5 * a) / a * dt : 0.5 * dt;
+	double d[4] = {cos(0.5 * a), w[0] * s, w[1] * s, w[2] * s};
+	double r[4];
+	r[0] = q[0] * d[0] - q[1] * d[1] - q[2] * d[2] - q[3] * d[3];
+	r[1] = q[0] * d[1] + q[1] * d[0] + q[2] * d[3] - q[3] * d[2];
+	r[2] = q[0] * d[2] - q[1] * d[3] + q[2] * d[0] + q[3] * d[1];
+	r[3] = q[0] * d[3] + q[1] * d[2] - q[2] * d[1] + q[3] * d[0];
+	double n = 1.0 / sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2] + r[3] * r[3]);
+	for (int i = 0; i < 4; i++) q[i] = r[i] * n;
+}
+
+// v_body = C' * v_nav
+void simToBody(const double *q, const double *v, double *b) {
+	b[0] = (1.0 - 2.0 * (q[2] * q[2] + q[3] * q[3])) * v[0] + 2.0 * (q[1] * q[2] + q[0] * q[3]) * v[1] + 2.0 * (q[1] * q[3] - q[0] * q[2]) * v[2];
+	b[1] = 2.0 * (q[1] * q[2] - q[0] * q[3]) * v[0] + (1.0 - 2.0 * (q[1] * q[1] + q[3] * q[3])) * v[1] + 2.0 * (q[2] * q[3] + q[0] * q[1]) * v[2];
+	b[2] = 2.0 * (q[1] * q[3] + q[0] * q[2]) * v[0] + 2.0 * (q[2] * q[3] - q[0] * q[1]) * v[1] + (1.0 - 2.0 * (q[1] * q[1] + q[2] * q[2])) * v[2];
+}
+
+// Generator state, for runs too long to hold every sample in memory
+struct SimStream {
+	unsigned int rng;
+	double q[4];
+	double t;
+};
+
+void simStart(const SimConfig *cfg, SimStream *s) {
+	s->rng = cfg->seed;
+	s->q[0] = 1.0; s->q[1] = 0.0; s->q[2] = 0.0; s->q[3] = 0.0;
+	s->t = 0.0;
+}
+
+// Next sample of the stream; the rate is integrated with 10 sub-steps per
+// sample
+void simNext(const SimConfig *cfg, SimStream *s, SimSample *out) {
+	double g[3] = {0.0, 0.0, -1.0};
+	double m[3] = {cos(cfg->dip), 0.0, sin(cfg->dip)};
+	double w[3], b[3];
+	double h = cfg->dt / 10.0;
+
+	simAngularRate(s->t, cfg->rate, w);
+	for (int k = 0; k < 3; k++) {
+		out->gyro[k] = (float)(w[k] + cfg->gyroBias[k] + cfg->gyroNoise * simGaussian(&s->rng));
+	}
+	simToBody(s->q, g, b);
+	for (int k = 0; k < 3; k++) {
+		out->accel[k] = (float)(b[k] + cfg->accelNoise * simGaussian(&s->rng));
+	}
+	simToBody(s->q, m, b);
+	for (int k = 0; k < 3; k++) {
+		out->mag[k] = (float)(b[k] + cfg->magNoise * simGaussian(&s->rng));
+	}
+	for (int k = 0; k < 4; k++) out->q[k] = s->q[k];
+	// advance the truth to the next sample
+	for (int i = 0; i < 10; i++) {
+		simAngularRate(s->t + (i + 0.5) * h, cfg->rate, w);
+		simIntegrate(s->q, w, h);
+	}
+	s->t += cfg->dt;
+}
+
+// Fills n samples
+void simGenerate(const SimConfig *cfg, SimSample *out, int n) {
+	SimStream s;
+
+	simStart(cfg, &s);
+	for (int i = 0; i < n; i++) {
+		simNext(cfg, &s, &out[i]);
+	}
+}
+
+// Angle between two attitudes (deg)
+double simAttitudeError(const double *qTrue, const float *q) {
+	double d = qTrue[0] * q[0] + qTrue[1] * q[1] + qTrue[2] * q[2] + qTrue[3] * q[3];
+	double n = sqrt((double)q[0] * q[0] + (double)q[1] * q[1] + (double)q[2] * q[2] + (double)q[3] * q[3]);
+	d = fabs(d / n);
+	if (d > 1.0) d = 1.0;
+	return 2.0 * acos(d) * 57.29577951308232;
+}
+
+#endif
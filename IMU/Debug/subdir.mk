@@ -7,6 +7,7 @@ CPP_SRCS += \
 ../AK8963.cpp \
 ../I2C.cpp \
 ../ImuRaw.cpp \
+../KalmanRollPitch.cpp \
 ../MPU9250.cpp \
 ../MainAngles.cpp 
 
@@ -14,6 +15,7 @@ OBJS += \
 ./AK8963.o \
 ./I2C.o \
 ./ImuRaw.o \
+./KalmanRollPitch.o \
 ./MPU9250.o \
 ./MainAngles.o 
 
@@ -21,6 +23,7 @@ CPP_DEPS += \
 ./AK8963.d \
 ./I2C.d \
 ./ImuRaw.d \
+./KalmanRollPitch.d \
 ./MPU9250.d \
 ./MainAngles.d 
 
@@ -29,7 +32,7 @@ CPP_DEPS += \
 %.o: ../%.cpp
 	@echo 'Building file: $<'
 	@echo 'Invoking: Cross G++ Compiler'
-	arm-linux-gnueabihf-g++ -I"/home/racarla/eclipse-workspace/MPU_9250_AHRS_Linux/IMU/includes" -I"/home/racarla/eclipse-workspace/MPU_9250_AHRS_Linux/IMU/interfaces" -I"/home/racarla/eclipse-workspace/MPU_9250_AHRS_Linux/libs/Eigen" -O0 -g3 -Wall -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
+	arm-linux-gnueabihf-g++ -I"/home/racarla/eclipse-workspace/MPU_9250_AHRS_Linux/IMU/includes" -I"/home/racarla/eclipse-workspace/MPU_9250_AHRS_Linux/IMU/interfaces" -I"/home/racarla/eclipse-workspace/MPU_9250_AHRS_Linux/libs/Eigen" -I"/home/racarla/eclipse-workspace/MPU_9250_AHRS_Linux/miniAHRS" -O0 -g3 -Wall -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<"
 	@echo 'Finished building: $<'
 	@echo ' '
 
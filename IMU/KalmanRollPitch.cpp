@@ -1,85 +1,122 @@
-#include <iostream>
-#include <Eigen/Dense>
+/*
+ * KalmanRollPitch.cpp
+ *
+ *  Created on: 18 oct. 2026
+ */
 
+#include <math.h>
+#include "KalmanRollPitch.hpp"
 
+#define KRP_PI 3.14159265358979f
+#define KRP_TODEG(x) ((x) * 57.2957796f)
 
-using namespace Eigen;
-
-public test(){
-
-	// Initialize matrices and variables
-	// i - integer
-	// f - float
-	// d - double
-	MatrixXd C(2,4);
-	C << 1, 0, 0, 0,
-		 0, 0, 1, 0;
-	Matrix4d P = Matrix<double, 4, 4>::Identity();
-	Matrix4d Q = Matrix<double, 4, 4>::Identity();
-	Matrix2d R = Matrix<double, 2, 2>::Identity();
-	Matrix4d  = Matrix<double, 4, 4>::Identity();
-
-	Vector4d state_estimate;
-	state_estimate << 0, 0, 0, 0;
-
-	double phi_hat = 0.0;
-	double theta_hat = 0.0;
-
-	double phi_dot = 0.0;
-	double theta_dot = 0.0;
-
-	double dt = 0.0;
-
-	// Calculate angles offsets from accelerometer
-	// Depends on test to inplement
-
-	while(True){
-		// Sampling time
-
-
-		// Get accelerometer angle measurements
-		// [ax, ay, az] = self.get_acc()
-		// phi_acc  = math.atan2(ay, math.sqrt(ax ** 2.0 + az ** 2.0))
-		// theta_acc  = math.atan2(-ax, math.sqrt(ay ** 2.0 + az ** 2.0))
-
-		// Remove offsets ??
-
-
-		// Get gyroscope angular velocity and calculate Euler angles derivates
-		// wx, wy, wz
-
-		phi_dot = wx + sin(phi_hat) * tan(theta_hat) * wy + cos(phi_hat) * tan(theta_hat) * wz;
-		theta_dot = cos(phi_hat) * wy - sin(phi_hat) * wz;
+KalmanRollPitch::KalmanRollPitch(){
+	x.setZero();
+	P = Eigen::Matrix4f::Identity() * KRP_P_INITIAL;
+}
 
-		// Kalman filter
-		MatrixXd A(4,4);
-		A << 1, -dt, 0,   0,
-			 0,   1, 0,   0,
-			 0,   0, 1, -dt,
-			 0,   0, 0,   1;
+void KalmanRollPitch::initialize(float *accel, float *mag){
+	(void)mag;
+	accelAngles(accel, x(0), x(2));
+	x(1) = 0.0f;
+	x(3) = 0.0f;
+}
 
-		MatrixXd B(4,4);
-		B << dt,  0,
-			  0,  0,
-			  0, dt,
-			  0,  0;
+void KalmanRollPitch::update(float *gyro, float *accel, float *mag, float dt){
+	(void)mag;
+	float roll, pitch, y0, y1;
+	float sr = sinf(x(0)), cr = cosf(x(0)), tp = tanf(x(2));
+
+	// Euler angle rates from the body rates
+	float rollDot = gyro[0] + (sr * gyro[1] + cr * gyro[2]) * tp;
+	float pitchDot = cr * gyro[1] - sr * gyro[2];
+
+	// x = A * x + B * u with A = [1 -dt 0 0; 0 1 0 0; 0 0 1 -dt; 0 0 0 1]
+	x(0) += (rollDot - x(1)) * dt;
+	x(2) += (pitchDot - x(3)) * dt;
+	wrap();
+
+	// P = A * P * A' + Q * dt
+	Eigen::Matrix4f A = Eigen::Matrix4f::Identity();
+	A(0, 1) = -dt;
+	A(2, 3) = -dt;
+	P = A * P * A.transpose();
+	P(0, 0) += KRP_Q_ANGLE * dt;
+	P(1, 1) += KRP_Q_BIAS * dt;
+	P(2, 2) += KRP_Q_ANGLE * dt;
+	P(3, 3) += KRP_Q_BIAS * dt;
+
+	// accel angles, the roll innovation is wrapped to +-pi
+	accelAngles(accel, roll, pitch);
+	y0 = roll - x(0);
+	if (y0 > KRP_PI) y0 -= 2.0f * KRP_PI;
+	else if (y0 < -KRP_PI) y0 += 2.0f * KRP_PI;
+	y1 = pitch - x(2);
+
+	// C = [1 0 0 0; 0 0 1 0], so C * P * C' and P * C' are entries of P and
+	// the 2x2 innovation is inverted in closed form
+	float s00 = P(0, 0) + KRP_R_ANGLE, s01 = P(0, 2), s10 = P(2, 0), s11 = P(2, 2) + KRP_R_ANGLE;
+	float det = s00 * s11 - s01 * s10;
+	if (det <= 0.0f) return;
+	float idet = 1.0f / det;
+	Eigen::Matrix2f SI;
+	SI << s11 * idet, -s01 * idet,
+		-s10 * idet, s00 * idet;
+
+	Eigen::Matrix<float, 4, 2> PC;
+	PC.col(0) = P.col(0);
+	PC.col(1) = P.col(2);
+	Eigen::Matrix<float, 4, 2> K = PC * SI;
+
+	x += K * Eigen::Vector2f(y0, y1);
+
+	// P = (I - K * C) * P = P - K * (C * P), C * P are rows 0 and 2 of P
+	Eigen::Matrix<float, 2, 4> CP;
+	CP.row(0) = P.row(0);
+	CP.row(1) = P.row(2);
+	P.noalias() -= K * CP;
+	wrap();
+}
 
-		Vector2d gyro_input;
-		gyro_input << phi_dot, theta_dot;
+// roll to +-pi and pitch to +-pi/2. past +-90 deg the same attitude is
+// roll + pi, pi - pitch, where the pitch rate and its bias change sign
+void KalmanRollPitch::wrap(){
+	if (x(2) > 0.5f * KRP_PI || x(2) < -0.5f * KRP_PI) {
+		x(2) = (x(2) > 0.0f ? KRP_PI : -KRP_PI) - x(2);
+		x(0) += KRP_PI;
+		x(3) = -x(3);
+		P.block<2, 2>(0, 2) *= -1.0f;
+		P.block<2, 2>(2, 0) *= -1.0f;
+	}
+	if (x(0) > KRP_PI) x(0) -= 2.0f * KRP_PI;
+	else if (x(0) < -KRP_PI) x(0) += 2.0f * KRP_PI;
+}
 
-		state_estimate = A * state_estimate + B * gyro_input;
-		P = A * (P * A.transpose()) + Q;
+// q for yaw 0, q = qy(pitch) * qx(roll)
+void KalmanRollPitch::getQuaternion(float *q){
+	float cr = cosf(0.5f * x(0)), sr = sinf(0.5f * x(0));
+	float cp = cosf(0.5f * x(2)), sp = sinf(0.5f * x(2));
+	q[0] = cr * cp;
+	q[1] = sr * cp;
+	q[2] = cr * sp;
+	q[3] = -sr * sp;
+}
 
-		Vector2d measurement ;
-		measurement << phi_acc, theta_acc;
+void KalmanRollPitch::getAngles(float *rpy){
+	rpy[0] = KRP_TODEG(x(0));
+	rpy[1] = KRP_TODEG(x(2));
+	rpy[2] = 0.0f;
+}
 
-		y_tilde = measurement - C * state_estimate;
-		S = R + C * (P * C.transpose());
-		K = P * (C.transpose() * S.inverse());
-		state_estimate = state_estimate + K * y_tilde;
-		P = (I - K * C) * P;
+// bias of the roll and pitch rates (rad/s), the yaw rate has none
+void KalmanRollPitch::getBias(float *b){
+	b[0] = x(1);
+	b[1] = x(3);
+	b[2] = 0.0f;
+}
 
-		phi_hat = state_estimate[0];
-		theta_hat = state_estimate[2];
-	}
+// roll and pitch of a sensor reading accel = -C' * [0 0 1]
+void KalmanRollPitch::accelAngles(const float *accel, float &roll, float &pitch){
+	roll = atan2f(-accel[1], -accel[2]);
+	pitch = atan2f(accel[0], sqrtf(accel[1] * accel[1] + accel[2] * accel[2]));
 }
@@ -0,0 +1,56 @@
+/*
+ * KalmanRollPitch.hpp
+ *
+ *  Created on: 18 oct. 2026
+ */
+
+#pragma once
+#include "Dense"
+#include "IAttitudeFilter.h"
+
+// Roll/pitch only Kalman filter with a gyro bias per angle, the cheapest
+// tilt mode for nodes that do not need heading. The state is
+// [roll, roll bias, pitch, pitch bias]; the gyro drives the Euler angle
+// rates and the accelerometer measures roll and pitch directly, so the
+// measurement matrix only picks two states and the innovation is 2x2.
+// All matrices are fixed size, nothing is allocated in update().
+//
+// Same conventions as IAttitudeFilter: gyro in rad/s, accel = -C' * [0 0 1]
+// (a level sensor reads [0 0 -1]), angles in degrees. The mag is ignored
+// and the yaw is always 0. Roll is kept in +-180 deg and pitch in +-90 deg,
+// a pitch past 90 deg is folded back with the roll turned by 180 deg.
+// The Euler rates are singular at +-90 deg pitch: on the tumbling motion
+// of AHRSTools/filterBenchmark the tilt error is 0.6 deg rms at a 1 rad/s
+// peak rate and 5.4 deg rms (37 deg max, near +-90 deg pitch) at 8 rad/s.
+// Above a few rad/s through high pitch, use a quaternion filter.
+
+// all parameters below need to be tune
+#ifndef KRP_Q_ANGLE
+#define KRP_Q_ANGLE 0.001f // rad^2/s
+#endif
+#ifndef KRP_Q_BIAS
+#define KRP_Q_BIAS 0.000003f // (rad/s)^2/s
+#endif
+#ifndef KRP_R_ANGLE
+#define KRP_R_ANGLE 0.03f // rad^2
+#endif
+#ifndef KRP_P_INITIAL
+#define KRP_P_INITIAL 0.01f
+#endif
+
+class KalmanRollPitch : public IAttitudeFilter {
+public:
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+	KalmanRollPitch();
+	void initialize(float *accel, float *mag);
+	void update(float *gyro, float *accel, float *mag, float dt);
+	void getQuaternion(float *q);
+	void getAngles(float *rpy);
+	void getBias(float *b);
+private:
+	static void accelAngles(const float *accel, float &roll, float &pitch);
+	void wrap();
+	Eigen::Vector4f x;
+	Eigen::Matrix4f P;
+};
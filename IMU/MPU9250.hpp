@@ -196,6 +196,28 @@ public:
 	 */
 	MPU9250::AccelRange getAccelRange();
 
+	/*!
+	 @brief Gyro resolution of a range of operation.
+
+	 Also becomes the gyro resolution of this instance.
+
+	 @param[in] GyroRange: Gyro range of operation.
+
+	 @return Degrees per second per LSB.
+	 */
+	float getBaseGyroRange(GyroRange grange);
+
+	/*!
+	 @brief Accel resolution of a range of operation.
+
+	 Also becomes the accel resolution of this instance.
+
+	 @param[in] AccelRange: Accel range of operation.
+
+	 @return g per LSB.
+	 */
+	float getBaseAccelRange(AccelRange arange);
+
 	/*!
 	 @brief reset.
 
@@ -490,9 +512,6 @@ private:
 	 };
 	 */
 
-	float getBaseGyroRange(GyroRange grange);
-	float getBaseAccelRange(AccelRange arange);
-
 	void (*_delay)(uint32_t time) = nullptr;
 
 	bool _writeByte(Register reg, uint8_t* data);
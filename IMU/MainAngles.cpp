@@ -9,6 +9,12 @@
 
 #include <signal.h>
 
+// before the drivers, MPU9250.hpp defines X, Y and Z
+#include "MadgwickAHRS.h"
+#include "MahonyAHRS.h"
+#include "KalmanRollPitch.hpp"
+#include "ImuLog.h"
+
 #include "MPU9250.hpp"
 #include "AK8963.hpp"
 #include "I2C.hpp"
@@ -26,7 +32,7 @@ void sigint_handler(int sig);
 #define Y 1
 #define Z 2
 
-#define PI 3.14159265
+//#define PI 3.14159265
 #define RAD2DEG 180.0 / PI
 #define DEG2RAD PI / 180.0
 
@@ -57,8 +63,9 @@ int main(int argc, char **argv) {
 	mpu.setAccelRange(MPU9250::ACCEL_RANGE_16G);
 	mpu.setGyroRange(MPU9250::GYRO_RANGE_2000DPS);
 
-	float gyroRes = MPU9250::GYRO_RANGE_2000DPS;
-	float accRes = MPU9250::ACCEL_RANGE_16G;
+	// LSB to rad/s for the selected range, the accel scale is calibrated
+	// per axis below
+	float gyroRes = 2000.0 / 32768.0 * DEG2RAD;
 
 	// Initialize the mpu and power on the
 	ret &= mpu.initialize();
@@ -91,23 +98,33 @@ int main(int argc, char **argv) {
 // Generic intergace for IMU 9 DOF
 	ImuRaw imuraw;
 	imuraw.attachInterface(&mpu, &mpu, &mag);
-	int16_t accdata[3], gyrdata[3], magdata[3];
+	int16_t accdata[3] = {0, 0, 0}, gyrdata[3] = {0, 0, 0}, magdata[3] = {0, 0, 0};
 
 	float accCalData[3], gyrCalData[3], magCalData[3];
 
-	float accResX = accRes / 2730.6;
-	float accResY = accRes / 3229.9;
-	float accResZ = accRes / 2469.1;
+	// Calibration, also stored in the header of the raw log so the session
+	// can be reprocessed offline (AHRSTools/smoother). The accel scales are
+	// one over the calibrated counts per g of each axis
+	ImuLogHeader cal = {
+		{0}, 0,
+		{12.542, -19.81, -6.555}, {gyroRes, gyroRes, gyroRes},
+		{-192.4, -94.4, -1043.5}, {1.0f / 2730.6f, 1.0f / 3229.9f, 1.0f / 2469.1f},
+		{-41.81, 96.24, -125.2},
+		{0.981,  -0.003, -0.027,
+		 -0.003, 0.981,  0.0032,
+		 -0.027, 0.0032, 0.96}
+	};
 
 	float angles[N][3];
 	long times[N][4];
+	ImuLogRecord records[N];
 
-	float cp; // Cos Pitch
-	float sp; // Sin Pitch
-	float cr; // Cos Roll
-	float sr; // Sin Roll
-
-	float mcx, mcy; // MagX Compensated, MagY Compensated
+	// Attitude engine, pick one by CPU budget (see IAttitudeFilter.h).
+	// KalmanRollPitch is the cheapest and only estimates roll and pitch.
+	MahonyAHRS mahony;
+	IAttitudeFilter *filter = &mahony;
+	bool init = true, accSeen = false;
+	long lastTime = 0;
 
 	//Register SIGINT handler for managed program termination
 	register_sig_handler();
@@ -127,47 +144,38 @@ int main(int argc, char **argv) {
 
 				while (!imuraw.isDataMagReady()) { delay(100); }
 				imuraw.getDataMagRaw(magdata);
-				if (imuraw.isDataAccReady()) imuraw.getDataAccRaw(accdata);
+				if (imuraw.isDataAccReady()) {
+					imuraw.getDataAccRaw(accdata);
+					accSeen = true;
+				}
 				if (imuraw.isDataGyroReady()) imuraw.getDataGyroRaw(gyrdata);
 
 				times[i][1] = getCurrentMicroseconds();
 
-				gyrCalData[X] = (((float)gyrdata[X]) - (12.542)) * gyroRes;
-				gyrCalData[Y] = (((float)gyrdata[Y]) - (-19.81)) * gyroRes;
-				gyrCalData[Z] = (((float)gyrdata[Z]) - (-6.555)) * gyroRes;
-
-				accCalData[X] = (((float)gyrdata[X]) - (-192.4)) * accResX;
-				accCalData[Y] = (((float)gyrdata[Y]) - (-94.4)) * accResY;
-				accCalData[Z] = (((float)gyrdata[Z]) - (-1043.5)) * accResZ;
-
-				magCalData[X] = (((float)gyrdata[X]) - (-41.81));
-				magCalData[Y] = (((float)gyrdata[Y]) - (96.24));
-				magCalData[Z] = (((float)gyrdata[Z]) - (-125.2));
-
-				magCalData[X] = 0.981  * magCalData[X] + -0.003 * magCalData[Y] + -0.027 * magCalData[Z];
-				magCalData[Y] = -0.003 * magCalData[X] + 0.981  * magCalData[Y] + 0.0032 * magCalData[Z];
-				magCalData[Z] = -0.027 * magCalData[X] + 0.0032 * magCalData[Y] + 0.96   * magCalData[Z];
+				records[i].time = times[i][1];
+				for (int k = 0; k < 3; k++) {
+					records[i].accel[k] = accdata[k];
+					records[i].gyro[k] = gyrdata[k];
+					records[i].mag[k] = magdata[k];
+					records[i].reserved[k] = 0;
+				}
+				ImuLog_Calibrate(&cal, &records[i], gyrCalData, accCalData, magCalData);
 
 				times[i][2] = getCurrentMicroseconds();
 
-				// PITCH
-				angles[i][1] =  gyrCalData[X] * 0.01 * 0.98
-						+ atan2f((float)accCalData[Y], (float)accCalData[Z]) * 0.02;
-
-				// ROLL
-				angles[i][0] =  gyrCalData[Y] * 0.01 * 0.98
-						+ atan2f((float)accCalData[X], (float)accCalData[Z]) * 0.02;
-
-				cp = cosf(angles[i][1] * DEG2RAD);
-				sp = sinf(angles[i][1] * DEG2RAD);
-
-				cr = cosf(angles[i][0] * DEG2RAD);
-				sr = sinf(angles[i][0] * DEG2RAD);
-
-				mcx = magCalData[X] * cr - magCalData[Z] * sr;
-				mcy = magCalData[X] * sp * sr + magCalData[Y] * cp + magCalData[Z] * sp * cr;
-
-				angles[i][2] = atan2f(mcy, mcx) * RAD2DEG;
+				// the first attitude needs a real accel sample
+				if (init) {
+					if (accSeen) {
+						filter->initialize(accCalData, magCalData);
+						init = false;
+					}
+				} else {
+					// real sample period from the read timestamps
+					filter->update(gyrCalData, accCalData, magCalData,
+							(times[i][1] - lastTime) * 1e-6f);
+				}
+				lastTime = times[i][1];
+				filter->getAngles(angles[i]);
 
 				times[i][3] = getCurrentMicroseconds();
 
@@ -182,8 +190,16 @@ int main(int argc, char **argv) {
 		}
 
 		fclose(fptr); //fptr is the file pointer associated with file to be closed.
+
+		FILE *raw = fopen("imu.raw", "wb");
+		if (raw == NULL || !ImuLog_WriteHeader(raw, &cal)
+				|| fwrite(records, sizeof(ImuLogRecord), N, raw) != (size_t)N) {
+			printf("Error writing imu.raw!\n");
+		}
+		if (raw != NULL) fclose(raw);
+
 		printf("Finish Collecting Data!\n");
-		printf("Data stored in angles.csv\n");
+		printf("Data stored in angles.csv and imu.raw\n");
 	} else {
 		printf("Error open file!");
 		exit(1);
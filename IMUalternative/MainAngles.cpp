@@ -16,6 +16,7 @@
 #include "ImuRaw.hpp"
 
 #include "miniAHRS.h"
+#include "AttitudePredictor.h"
 
 //#include "Eigen"
 //using namespace Eigen;
@@ -32,6 +33,12 @@ void sigint_handler(int sig);
 #define RAD2DEG 180.0 / PI
 #define DEG2RAD PI / 180.0
 
+// Loop period (gyro rate), minimum spacing of the accel updates and of the
+// logged angles. N rows span N * LOG_PERIOD_US
+#define GYRO_PERIOD_US 1000
+#define ACC_UPDATE_US 10000
+#define LOG_PERIOD_US 10000
+
 int main(int argc, char **argv) {
 
 	int N = 10000;
@@ -61,8 +68,9 @@ int main(int argc, char **argv) {
 	mpu.setAccelRange(MPU9250::ACCEL_RANGE_16G);
 	mpu.setGyroRange(MPU9250::GYRO_RANGE_2000DPS);
 
-	float gyroRes = MPU9250::GYRO_RANGE_2000DPS;
-	float accRes = MPU9250::ACCEL_RANGE_16G;
+	// LSB to rad/s and to g for the selected ranges
+	float gyroRes = 2000.0 / 32768.0 * DEG2RAD;
+	float accRes = 16.0 / 32768.0;
 
 	// Initialize the mpu and power on the
 	ret &= mpu.initialize();
@@ -95,10 +103,11 @@ int main(int argc, char **argv) {
 // Generic intergace for IMU 9 DOF
 	ImuRaw imuraw;
 	imuraw.attachInterface(&mpu, &mpu, &mag);
-	int16_t accdata[3], gyrdata[3], magdata[3];
+	int16_t accdata[3] = {0, 0, 0}, gyrdata[3] = {0, 0, 0}, magdata[3] = {0, 0, 0};
 
 	float accCalData[3], gyrCalData[3], magCalData[3];
 	float bangles[3];
+	float bias[3], rate[3], qnow[4];
 /*
 	float accResX = accRes / 2730.6;
 	float accResY = accRes / 3229.9;
@@ -119,14 +128,26 @@ int main(int argc, char **argv) {
 	    struct timespec ts;
 	    clock_gettime(CLOCK_MONOTONIC, &ts);
 
+		long lastAcc = 0, lastLog = 0;
+		GyroPreintegration preint;
+		GyroPreint_Init(&preint);
+		// Latest estimate for the readers, extrapolated to their own time
+		AttitudePredictor predictor;
+
 		while (!done && i < N) {
 
 				times[i][0] = getCurrentMicroseconds();
 
-				while (!imuraw.isDataMagReady()) { delay(100); }
-				imuraw.getDataMagRaw(magdata);
-				if (imuraw.isDataAccReady()) imuraw.getDataAccRaw(accdata);
-				if (imuraw.isDataGyroReady()) imuraw.getDataGyroRaw(gyrdata);
+				// Each sensor is read only when it has a new sample. The gyro
+				// samples are pre-integrated and the filter runs one
+				// prediction per accel or mag update.
+				bool gyroNew = imuraw.isDataGyroReady();
+				bool accNew = imuraw.isDataAccReady() && times[i][0] - lastAcc >= ACC_UPDATE_US;
+				bool magNew = imuraw.isDataMagReady();
+
+				if (gyroNew) imuraw.getDataGyroRaw(gyrdata);
+				if (accNew) imuraw.getDataAccRaw(accdata);
+				if (magNew) imuraw.getDataMagRaw(magdata);
 
 				times[i][1] = getCurrentMicroseconds();
 /*
@@ -134,13 +155,13 @@ int main(int argc, char **argv) {
 				gyrCalData[Y] = (((float)gyrdata[Y]) - (-19.81)) * gyroRes;
 				gyrCalData[Z] = (((float)gyrdata[Z]) - (-6.555)) * gyroRes;
 
-				accCalData[X] = (((float)gyrdata[X]) - (-192.4)) * accResX;
-				accCalData[Y] = (((float)gyrdata[Y]) - (-94.4)) * accResY;
-				accCalData[Z] = (((float)gyrdata[Z]) - (-1043.5)) * accResZ;
+				accCalData[X] = (((float)accdata[X]) - (-192.4)) * accResX;
+				accCalData[Y] = (((float)accdata[Y]) - (-94.4)) * accResY;
+				accCalData[Z] = (((float)accdata[Z]) - (-1043.5)) * accResZ;
 
-				magCalData[X] = (((float)gyrdata[X]) - (-41.81));
-				magCalData[Y] = (((float)gyrdata[Y]) - (96.24));
-				magCalData[Z] = (((float)gyrdata[Z]) - (-125.2));
+				magCalData[X] = (((float)magdata[X]) - (-41.81));
+				magCalData[Y] = (((float)magdata[Y]) - (96.24));
+				magCalData[Z] = (((float)magdata[Z]) - (-125.2));
 
 				magCalData[X] = 0.981  * magCalData[X] + -0.003 * magCalData[Y] + -0.027 * magCalData[Z];
 				magCalData[Y] = -0.003 * magCalData[X] + 0.981  * magCalData[Y] + 0.0032 * magCalData[Z];
@@ -150,26 +171,59 @@ int main(int argc, char **argv) {
 				gyrCalData[Y] = ((float)gyrdata[Y]) * gyroRes;
 				gyrCalData[Z] = ((float)gyrdata[Z]) * gyroRes;
 
-				accCalData[X] = ((float)gyrdata[X]) * accRes;
-				accCalData[Y] = ((float)gyrdata[Y]) * accRes;
-				accCalData[Z] = ((float)gyrdata[Z]) * accRes;
-
-				magCalData[X] = ((float)gyrdata[X]);
-				magCalData[Y] = ((float)gyrdata[Y]);
-				magCalData[Z] = ((float)gyrdata[Z]);
+				accCalData[X] = ((float)accdata[X]) * accRes;
+				accCalData[Y] = ((float)accdata[Y]) * accRes;
+				accCalData[Z] = ((float)accdata[Z]) * accRes;
 
+				magCalData[X] = ((float)magdata[X]);
+				magCalData[Y] = ((float)magdata[Y]);
+				magCalData[Z] = ((float)magdata[Z]);
 
 				times[i][2] = getCurrentMicroseconds();
 
 				if(init == false){
-					EKF_AHRSUpdate(gyrCalData, accCalData, magCalData, 0.01);
-					EKF_AHRSGetAngle(bangles);
-					angles[i][0] = bangles[0];
-					angles[i][1] = bangles[1];
-					angles[i][2] = bangles[2];
-					i++;
-				} else {
-					EKF_AHRSInit(accCalData,magCalData);
+					// real sample period from the read timestamps
+					if (gyroNew) GyroPreint_AddTimed(&preint, gyrCalData, times[i][1]);
+					if (accNew || magNew) EKF_AHRSPredictPreint(&preint);
+					if (accNew) {
+						lastAcc = times[i][0];
+						EKF_AHRSUpdateAccel(accCalData);
+					}
+					if (magNew) EKF_AHRSUpdateMag(magCalData);
+					if (accNew || magNew) {
+						EKF_AHRSGetQ(qnow);
+						EKF_AHRSGetBias(bias);
+						rate[X] = gyrCalData[X] - bias[X];
+						rate[Y] = gyrCalData[Y] - bias[Y];
+						rate[Z] = gyrCalData[Z] - bias[Z];
+						predictor.publish(qnow, rate, times[i][1]);
+					}
+					// attitude at the time it is logged, in degrees with the yaw
+					// in [0, 360) as EKF_AHRSGetAngle. the filter state until the
+					// first publish
+					if (times[i][0] - lastLog >= LOG_PERIOD_US) {
+						lastLog = times[i][0];
+						if (predictor.getAttitudeAt(getCurrentMicroseconds(), qnow)) {
+							Quaternion_ToEuler(qnow, bangles);
+							if (bangles[2] >= EKF_TWOPI) bangles[2] = 0.0f;
+							bangles[0] = EKF_TODEG(bangles[0]);
+							bangles[1] = EKF_TODEG(bangles[1]);
+							bangles[2] = EKF_TODEG(bangles[2]);
+						} else {
+							EKF_AHRSGetAngle(bangles);
+						}
+						angles[i][0] = bangles[0];
+						angles[i][1] = bangles[1];
+						angles[i][2] = bangles[2];
+						times[i][3] = getCurrentMicroseconds();
+						i++;
+					}
+				} else if (gyroNew && accNew && magNew) {
+					// EKF_AHRSInit takes the up vector, the accel is -C' * [0 0 1]
+					float up[3] = {-accCalData[X], -accCalData[Y], -accCalData[Z]};
+					EKF_AHRSInit(up, magCalData);
+					GyroPreint_Start(&preint, times[i][1]);
+					lastAcc = times[i][0];
 					init = false;
 				}
 /*
@@ -193,8 +247,7 @@ int main(int argc, char **argv) {
 				angles[i][2] = atan2f(mcy, mcx) * RAD2DEG;
 */
 
-				times[i][3] = getCurrentMicroseconds();
-				sleep_until(&ts, 10000);
+				sleep_until(&ts, GYRO_PERIOD_US);
 		}
 
 		N = i;
@@ -0,0 +1,68 @@
+/*
+ * AHRSModel.h
+ *
+ *  Created on: 18 oct. 2026
+ */
+
+#ifndef AHRSMODEL_H_
+#define AHRSMODEL_H_
+
+#include "FastMath.h"
+#include "Quaternion.h"
+
+//////////////////////////////////////////////////////////////////////////
+//the sensor models of miniAHRS.h, accel = -C' * [0 0 1] and
+//mag = C' * [bx 0 bz] where C rotates the body frame to the navigation
+//frame, as plain functions on float arrays. the attitude engines share
+//them without the file-static matrices of the EKF.
+//////////////////////////////////////////////////////////////////////////
+
+//n = v / |v|, returns 0 and leaves n unset for a zero v
+int AHRSModel_Normalize(const float *v, float *n)
+{
+	float norm = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+
+	if (norm == 0.0f){
+		return 0;
+	}
+	norm = FastSqrtI(norm);
+	n[0] = v[0] * norm; n[1] = v[1] * norm; n[2] = v[2] * norm;
+	return 1;
+}
+
+//attitude from one accel and mag sample, the accel as in the model.
+//Quaternion_From6AxisData takes the up vector
+void AHRSModel_Attitude(const float *accel, float *mag, float *q)
+{
+	float up[3] = {-accel[0], -accel[1], -accel[2]};
+
+	Quaternion_From6AxisData(q, up, mag);
+}
+
+//roll, pitch, yaw of q in degrees
+void AHRSModel_Angles(float *q, float *rpy)
+{
+	Quaternion_ToEuler(q, rpy);
+	rpy[0] = RADTODEG(rpy[0]);
+	rpy[1] = RADTODEG(rpy[1]);
+	rpy[2] = RADTODEG(rpy[2]);
+}
+
+//gradient g = J' * f of the joint accel and mag model at q, J are the rows
+//of H in EKF_AHRSUpdate with the reference field bx, bz. for the gradient
+//descent engines, f = u(q) - z
+void AHRSModel_Gradient(const float *q, float bx, float bz, const float *f, float *g)
+{
+	float _2q0 = 2.0f * q[0], _2q1 = 2.0f * q[1], _2q2 = 2.0f * q[2], _2q3 = 2.0f * q[3];
+
+	g[0] = _2q2 * f[0] - _2q1 * f[1] - _2q0 * f[2]
+		+ (bx * _2q0 - bz * _2q2) * f[3] + (bz * _2q1 - bx * _2q3) * f[4] + (bx * _2q2 + bz * _2q0) * f[5];
+	g[1] = -_2q3 * f[0] - _2q0 * f[1] + _2q1 * f[2]
+		+ (bx * _2q1 + bz * _2q3) * f[3] + (bx * _2q2 + bz * _2q0) * f[4] + (bx * _2q3 - bz * _2q1) * f[5];
+	g[2] = _2q0 * f[0] - _2q3 * f[1] + _2q2 * f[2]
+		+ (-bx * _2q2 - bz * _2q0) * f[3] + (bx * _2q1 + bz * _2q3) * f[4] + (bx * _2q0 - bz * _2q2) * f[5];
+	g[3] = -_2q1 * f[0] - _2q2 * f[1] - _2q3 * f[2]
+		+ (bz * _2q1 - bx * _2q3) * f[3] + (bz * _2q2 - bx * _2q0) * f[4] + (bx * _2q1 + bz * _2q3) * f[5];
+}
+
+#endif
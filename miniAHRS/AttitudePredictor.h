@@ -0,0 +1,103 @@
+/*
+ * AttitudePredictor.h
+ *
+ *  Created on: 18 oct. 2026
+ */
+
+#ifndef ATTITUDEPREDICTOR_H_
+#define ATTITUDEPREDICTOR_H_
+
+#include <atomic>
+#include "Quaternion.h"
+
+//////////////////////////////////////////////////////////////////////////
+//latency compensated attitude output. the filter loop publishes its latest
+//quaternion, the bias corrected body rate and the time stamp of the sample
+//they come from. consumers ask for the attitude at their own time with
+//getAttitudeAt, which integrates the published rate forward (or back) over
+//the gap in constant time, q(t) = q * exp(w * (t - t0) / 2). no filter
+//work runs on a query.
+//
+//publish and getAttitudeAt may run on different threads: the snapshot is
+//guarded by a sequence lock, so the writer never waits and a reader only
+//retries if it overlapped a publish. one writer only.
+//////////////////////////////////////////////////////////////////////////
+
+//longest extrapolation (s), older snapshots are held at this horizon
+#ifndef ATTITUDE_PREDICT_MAX_DT
+#define ATTITUDE_PREDICT_MAX_DT 0.05f
+#endif
+
+class AttitudePredictor {
+public:
+	AttitudePredictor() : seq(0), time(0) {
+		for (int i = 0; i < 4; i++) q[i].store(i == 0 ? 1.0f : 0.0f, std::memory_order_relaxed);
+		for (int i = 0; i < 3; i++) w[i].store(0.0f, std::memory_order_relaxed);
+	}
+
+	//attitude (body to navigation), body rate with the gyro bias removed
+	//(rad/s) and the time stamp of their sample (us)
+	void publish(const float *quat, const float *rate, long stamp) {
+		unsigned int s = seq.load(std::memory_order_relaxed);
+
+		seq.store(s + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		for (int i = 0; i < 4; i++) q[i].store(quat[i], std::memory_order_relaxed);
+		for (int i = 0; i < 3; i++) w[i].store(rate[i], std::memory_order_relaxed);
+		time.store(stamp, std::memory_order_relaxed);
+		seq.store(s + 2, std::memory_order_release);
+	}
+
+	//attitude at time stamp t (us). returns 0, and the identity, if nothing
+	//was published yet
+	int getAttitudeAt(long t, float *out) {
+		float q0, q1, q2, q3, w0, w1, w2, phi[3], dq[4];
+		float dt;
+		long stamp;
+		unsigned int s0, s1;
+
+		do {
+			s0 = seq.load(std::memory_order_acquire);
+			q0 = q[0].load(std::memory_order_relaxed);
+			q1 = q[1].load(std::memory_order_relaxed);
+			q2 = q[2].load(std::memory_order_relaxed);
+			q3 = q[3].load(std::memory_order_relaxed);
+			w0 = w[0].load(std::memory_order_relaxed);
+			w1 = w[1].load(std::memory_order_relaxed);
+			w2 = w[2].load(std::memory_order_relaxed);
+			stamp = time.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			s1 = seq.load(std::memory_order_relaxed);
+		} while ((s0 & 1) || s0 != s1);
+
+		if (s0 == 0){
+			out[0] = 1.0f; out[1] = 0.0f; out[2] = 0.0f; out[3] = 0.0f;
+			return 0;
+		}
+
+		dt = (t - stamp) * 1e-6f;
+		if (dt > ATTITUDE_PREDICT_MAX_DT){
+			dt = ATTITUDE_PREDICT_MAX_DT;
+		} else if (dt < -ATTITUDE_PREDICT_MAX_DT){
+			dt = -ATTITUDE_PREDICT_MAX_DT;
+		}
+
+		//dq = exp(phi / 2), phi = w * dt, the exponential map of
+		//EKF_AHRSPredictState. dq is unit, so is out = q * dq
+		phi[0] = w0 * dt; phi[1] = w1 * dt; phi[2] = w2 * dt;
+		Quaternion_FromRotationVector(dq, phi);
+		out[0] = q0 * dq[0] - q1 * dq[1] - q2 * dq[2] - q3 * dq[3];
+		out[1] = q0 * dq[1] + q1 * dq[0] + q2 * dq[3] - q3 * dq[2];
+		out[2] = q0 * dq[2] - q1 * dq[3] + q2 * dq[0] + q3 * dq[1];
+		out[3] = q0 * dq[3] + q1 * dq[2] - q2 * dq[1] + q3 * dq[0];
+		return 1;
+	}
+
+private:
+	std::atomic<unsigned int> seq;
+	std::atomic<float> q[4];
+	std::atomic<float> w[3];
+	std::atomic<long> time;
+};
+
+#endif
@@ -0,0 +1,381 @@
+/*
+ * BatchAHRS.h
+ *
+ *  Created on: 18 oct. 2026
+ */
+
+#ifndef BATCHAHRS_H_
+#define BATCHAHRS_H_
+
+#include "miniAHRS.h"
+#include "AHRSModel.h"
+#include "EKFParameters.h"
+
+//////////////////////////////////////////////////////////////////////////
+//LANES independent copies of the EKF of miniAHRS.h advanced together, for
+//reprocessing many recorded sessions, arrays of IMUs or Monte-Carlo runs.
+//
+//the state and covariance are stored by lane, X[i][l] and P[i][j][l] are
+//entry i (i, j) of filter l, and every step is written as loops over the
+//matrix entries with the lane loop innermost. the lane loop has a fixed
+//trip count and no branches, so the compiler maps it to vector
+//instructions: LANES = 4 fills one SSE/NEON register, 8 one AVX2
+//register and 16 one AVX-512 register or two AVX2 ones, with no
+//intrinsics here. one instruction then advances every filter by one
+//scalar operation, and the cost per filter drops about by the vector
+//width.
+//
+//the math is that of EKF_AHRSUpdate, with the zeros of F and H skipped:
+//  - the quaternion is propagated with the exponential map, through the
+//    branch free Quaternion_ExpPoly in place of Quaternion_FromRotationVector,
+//  - P = F * P * F' + Q * dt / EKF_QDT_NOMINAL only touches the quaternion
+//    rows and columns,
+//  - the innovation covariance is inverted through its LDL' factors
+//    (symmetric positive definite, no pivoting, no square roots),
+//  - the covariance update is P - K * (P * H')', computed on the upper
+//    triangle and mirrored, so P stays symmetric.
+//the measurement update normalizes with FastSqrtI, as the scalar EKF.
+//each lane tracks the scalar EKF to rounding, except for the Joseph form.
+//
+//dt is given per lane, so sessions recorded at different rates can share a
+//batch, and so are the noise parameters (setParameters), so one batch can
+//also replay one session with LANES candidate tunings.
+//////////////////////////////////////////////////////////////////////////
+
+//the lanes are independent filters, no iteration of a lane loop depends on
+//another one. the compiler cannot prove it when a loop reads and writes
+//the same matrix, or the inputs next to the members, and would keep it
+//scalar
+#if defined(__GNUC__) && !defined(__clang__)
+#define BATCH_LANES _Pragma("GCC ivdep")
+#elif defined(__clang__)
+#define BATCH_LANES _Pragma("clang loop vectorize(assume_safety)")
+#else
+#define BATCH_LANES
+#endif
+
+template <int LANES>
+class BatchAHRS {
+public:
+	BatchAHRS() {
+		BATCH_LANES
+		for (int l = 0; l < LANES; l++){
+			X[0][l] = 1.0f;
+		}
+		for (int i = 1; i < EKF_STATE_DIM; i++){
+			BATCH_LANES
+			for (int l = 0; l < LANES; l++){
+				X[i][l] = 0.0f;
+			}
+		}
+		EKF_Parameters p;
+		EKF_ParametersDefault(&p);
+		for (int l = 0; l < LANES; l++){
+			setParameters(l, &p);
+		}
+	}
+
+	//Q, R and the initial P of one lane, before its first update
+	void setParameters(int lane, const EKF_Parameters *p) {
+		for (int i = 0; i < EKF_STATE_DIM; i++){
+			for (int j = 0; j < EKF_STATE_DIM; j++){
+				P[i][j][lane] = i != j ? 0.0f : (i < 4 ? p->pq : p->pwb);
+			}
+		}
+		qq[lane] = p->qq;
+		qwb[lane] = p->qwb;
+		ra[lane] = p->ra;
+		rm[lane] = p->rm;
+	}
+
+	//attitude of one lane from one accel and mag sample. the accel is
+	//expected as in the measurement model, -C' * [0 0 1]
+	void initialize(int lane, float *accel, float *mag) {
+		float q[4];
+
+		AHRSModel_Attitude(accel, mag, q);
+		for (int i = 0; i < 4; i++){
+			X[i][lane] = q[i];
+		}
+	}
+
+	//one EKF_AHRSUpdate per lane. the inputs are stored by lane, gyro[k][l]
+	//is axis k of filter l, and accel and mag are normalized in place
+	void update(float (*gyro)[LANES], float (*accel)[LANES], float (*mag)[LANES], const float *dt) {
+		predict(gyro, dt);
+		correct(accel, mag);
+	}
+
+	void predict(float (*gyro)[LANES], const float *dt) {
+		float qdt[LANES];
+
+		//state, q = q * exp(dt / 2 * (w - b)) as Quaternion_IntegrateExp,
+		//and the quaternion rows of F to first order in dt, F(i, i) = 1
+		//included
+		BATCH_LANES
+		for (int l = 0; l < LANES; l++){
+			float halfdt = 0.5f * dt[l];
+			float q0 = X[0][l], q1 = X[1][l], q2 = X[2][l], q3 = X[3][l];
+			float hx = halfdt * (gyro[0][l] - X[4][l]);
+			float hy = halfdt * (gyro[1][l] - X[5][l]);
+			float hz = halfdt * (gyro[2][l] - X[6][l]);
+			float c, s;
+			Quaternion_ExpPoly(hx * hx + hy * hy + hz * hz, &c, &s);
+			float d1 = s * hx, d2 = s * hy, d3 = s * hz;
+			X[0][l] = q0 * c - q1 * d1 - q2 * d2 - q3 * d3;
+			X[1][l] = q0 * d1 + q1 * c + q2 * d3 - q3 * d2;
+			X[2][l] = q0 * d2 - q1 * d3 + q2 * c + q3 * d1;
+			X[3][l] = q0 * d3 + q1 * d2 - q2 * d1 + q3 * c;
+
+			F[0][0][l] = 1.0f; F[0][1][l] = -hx; F[0][2][l] = -hy; F[0][3][l] = -hz;
+			F[1][0][l] = hx; F[1][1][l] = 1.0f; F[1][2][l] = hz; F[1][3][l] = -hy;
+			F[2][0][l] = hy; F[2][1][l] = -hz; F[2][2][l] = 1.0f; F[2][3][l] = hx;
+			F[3][0][l] = hz; F[3][1][l] = hy; F[3][2][l] = -hx; F[3][3][l] = 1.0f;
+			F[0][4][l] = halfdt * q1; F[0][5][l] = halfdt * q2; F[0][6][l] = halfdt * q3;
+			F[1][4][l] = -halfdt * q0; F[1][5][l] = halfdt * q3; F[1][6][l] = -halfdt * q2;
+			F[2][4][l] = -halfdt * q3; F[2][5][l] = -halfdt * q0; F[2][6][l] = halfdt * q1;
+			F[3][4][l] = halfdt * q2; F[3][5][l] = -halfdt * q1; F[3][6][l] = -halfdt * q0;
+			//process noise is tuned for EKF_QDT_NOMINAL steps
+			qdt[l] = dt[l] / EKF_QDT_NOMINAL;
+		}
+
+		//PX = F * P, the bias rows of F are the identity
+		for (int i = 0; i < 4; i++){
+			for (int j = 0; j < EKF_STATE_DIM; j++){
+				BATCH_LANES
+				for (int l = 0; l < LANES; l++){
+					PX[i][j][l] = F[i][0][l] * P[0][j][l];
+				}
+				for (int k = 1; k < EKF_STATE_DIM; k++){
+					BATCH_LANES
+					for (int l = 0; l < LANES; l++){
+						PX[i][j][l] += F[i][k][l] * P[k][j][l];
+					}
+				}
+			}
+		}
+		//P = PX * F' + Q * qdt, the quaternion block and the cross terms
+		for (int i = 0; i < 4; i++){
+			for (int j = i; j < 4; j++){
+				BATCH_LANES
+				for (int l = 0; l < LANES; l++){
+					P[i][j][l] = PX[i][0][l] * F[j][0][l];
+				}
+				for (int k = 1; k < EKF_STATE_DIM; k++){
+					BATCH_LANES
+					for (int l = 0; l < LANES; l++){
+						P[i][j][l] += PX[i][k][l] * F[j][k][l];
+					}
+				}
+				BATCH_LANES
+				for (int l = 0; l < LANES; l++){
+					P[j][i][l] = P[i][j][l];
+				}
+			}
+			for (int j = 4; j < EKF_STATE_DIM; j++){
+				BATCH_LANES
+				for (int l = 0; l < LANES; l++){
+					P[i][j][l] = PX[i][j][l];
+					P[j][i][l] = PX[i][j][l];
+				}
+			}
+		}
+		for (int i = 0; i < 4; i++){
+			BATCH_LANES
+			for (int l = 0; l < LANES; l++){
+				P[i][i][l] += qq[l] * qdt[l];
+			}
+		}
+		for (int i = 4; i < EKF_STATE_DIM; i++){
+			BATCH_LANES
+			for (int l = 0; l < LANES; l++){
+				P[i][i][l] += qwb[l] * qdt[l];
+			}
+		}
+	}
+
+	void correct(float (*accel)[LANES], float (*mag)[LANES]) {
+		//innovation and the quaternion columns of H
+		BATCH_LANES
+		for (int l = 0; l < LANES; l++){
+			float q0 = X[0][l], q1 = X[1][l], q2 = X[2][l], q3 = X[3][l];
+			float _2q0 = 2.0f * q0, _2q1 = 2.0f * q1, _2q2 = 2.0f * q2, _2q3 = 2.0f * q3;
+			float q0q0 = q0 * q0, q0q1 = q0 * q1, q0q2 = q0 * q2, q0q3 = q0 * q3;
+			float q1q1 = q1 * q1, q1q2 = q1 * q2, q1q3 = q1 * q3;
+			float q2q2 = q2 * q2, q2q3 = q2 * q3, q3q3 = q3 * q3;
+			float ax = accel[0][l], ay = accel[1][l], az = accel[2][l];
+			float mx = mag[0][l], my = mag[1][l], mz = mag[2][l];
+			float norm, hx, hy, bx, bz;
+
+			norm = FastSqrtI(ax * ax + ay * ay + az * az);
+			ax *= norm; ay *= norm; az *= norm;
+			norm = FastSqrtI(mx * mx + my * my + mz * mz);
+			mx *= norm; my *= norm; mz *= norm;
+			accel[0][l] = ax; accel[1][l] = ay; accel[2][l] = az;
+			mag[0][l] = mx; mag[1][l] = my; mag[2][l] = mz;
+
+			//reference field
+			hx = 2.0f * mx * (0.5f - q2q2 - q3q3) + 2.0f * my * (q1q2 - q0q3) + 2.0f * mz * (q1q3 + q0q2);
+			hy = 2.0f * mx * (q1q2 + q0q3) + 2.0f * my * (0.5f - q1q1 - q3q3) + 2.0f * mz * (q2q3 - q0q1);
+			bz = 2.0f * mx * (q1q3 - q0q2) + 2.0f * my * (q2q3 + q0q1) + 2.0f * mz * (0.5f - q1q1 - q2q2);
+			bx = hx * hx + hy * hy;
+			bx *= FastSqrtI(bx);
+
+			Y[0][l] = ax + 2.0f * (q1q3 - q0q2);
+			Y[1][l] = ay + 2.0f * (q2q3 + q0q1);
+			Y[2][l] = az - (1.0f - 2.0f * (q0q0 + q3q3));
+			Y[3][l] = mx - (bx * (1.0f - 2.0f * (q2q2 + q3q3)) + bz * (2.0f * (q1q3 - q0q2)));
+			Y[4][l] = my - (bx * (2.0f * (q1q2 - q0q3)) + bz * (2.0f * (q2q3 + q0q1)));
+			Y[5][l] = mz - (bx * (2.0f * (q1q3 + q0q2)) + bz * (1.0f - 2.0f * (q1q1 + q2q2)));
+
+			H[0][0][l] = _2q2; H[0][1][l] = -_2q3; H[0][2][l] = _2q0; H[0][3][l] = -_2q1;
+			H[1][0][l] = -_2q1; H[1][1][l] = -_2q0; H[1][2][l] = -_2q3; H[1][3][l] = -_2q2;
+			H[2][0][l] = -_2q0; H[2][1][l] = _2q1; H[2][2][l] = _2q2; H[2][3][l] = -_2q3;
+			H[3][0][l] = bx * _2q0 - bz * _2q2; H[3][1][l] = bx * _2q1 + bz * _2q3;
+			H[3][2][l] = -bx * _2q2 - bz * _2q0; H[3][3][l] = bz * _2q1 - bx * _2q3;
+			H[4][0][l] = bz * _2q1 - bx * _2q3; H[4][1][l] = bx * _2q2 + bz * _2q0;
+			H[4][2][l] = bx * _2q1 + bz * _2q3; H[4][3][l] = bz * _2q2 - bx * _2q0;
+			H[5][0][l] = bx * _2q2 + bz * _2q0; H[5][1][l] = bx * _2q3 - bz * _2q1;
+			H[5][2][l] = bx * _2q0 - bz * _2q2; H[5][3][l] = bx * _2q1 + bz * _2q3;
+		}
+
+		//PXY = P * H', the bias columns of H are zero
+		for (int i = 0; i < EKF_STATE_DIM; i++){
+			for (int j = 0; j < EKF_MEASUREMENT_DIM; j++){
+				BATCH_LANES
+				for (int l = 0; l < LANES; l++){
+					PXY[i][j][l] = P[i][0][l] * H[j][0][l] + P[i][1][l] * H[j][1][l]
+							+ P[i][2][l] * H[j][2][l] + P[i][3][l] * H[j][3][l];
+				}
+			}
+		}
+		//S = H * PXY + R, lower triangle
+		for (int i = 0; i < EKF_MEASUREMENT_DIM; i++){
+			for (int j = 0; j <= i; j++){
+				BATCH_LANES
+				for (int l = 0; l < LANES; l++){
+					S[i][j][l] = H[i][0][l] * PXY[0][j][l] + H[i][1][l] * PXY[1][j][l]
+							+ H[i][2][l] * PXY[2][j][l] + H[i][3][l] * PXY[3][j][l];
+				}
+			}
+			BATCH_LANES
+			for (int l = 0; l < LANES; l++){
+				S[i][i][l] += i < 3 ? ra[l] : rm[l];
+			}
+		}
+		//S = L * D * L', L unit lower triangular below the diagonal of S
+		//and 1 / D on it
+		for (int j = 0; j < EKF_MEASUREMENT_DIM; j++){
+			for (int k = 0; k < j; k++){
+				float ljk[LANES];
+				BATCH_LANES
+				for (int l = 0; l < LANES; l++){
+					//S(j, k) still holds L(j, k) * D(k) here
+					ljk[l] = S[j][k][l] * S[k][k][l];
+					S[j][j][l] -= ljk[l] * S[j][k][l];
+				}
+				for (int i = j + 1; i < EKF_MEASUREMENT_DIM; i++){
+					BATCH_LANES
+					for (int l = 0; l < LANES; l++){
+						S[i][j][l] -= S[i][k][l] * ljk[l];
+					}
+				}
+			}
+			for (int k = 0; k < j; k++){
+				BATCH_LANES
+				for (int l = 0; l < LANES; l++){
+					S[j][k][l] *= S[k][k][l];
+				}
+			}
+			BATCH_LANES
+			for (int l = 0; l < LANES; l++){
+				S[j][j][l] = 1.0f / S[j][j][l];
+			}
+		}
+		//K = PXY / S, row i of K solves S * k' = PXY(i, :)'
+		for (int i = 0; i < EKF_STATE_DIM; i++){
+			for (int j = 0; j < EKF_MEASUREMENT_DIM; j++){
+				BATCH_LANES
+				for (int l = 0; l < LANES; l++){
+					K[i][j][l] = PXY[i][j][l];
+				}
+				for (int k = 0; k < j; k++){
+					BATCH_LANES
+					for (int l = 0; l < LANES; l++){
+						K[i][j][l] -= S[j][k][l] * K[i][k][l];
+					}
+				}
+			}
+			for (int j = EKF_MEASUREMENT_DIM - 1; j >= 0; j--){
+				BATCH_LANES
+				for (int l = 0; l < LANES; l++){
+					K[i][j][l] *= S[j][j][l];
+				}
+				for (int k = j + 1; k < EKF_MEASUREMENT_DIM; k++){
+					BATCH_LANES
+					for (int l = 0; l < LANES; l++){
+						K[i][j][l] -= S[k][j][l] * K[i][k][l];
+					}
+				}
+			}
+		}
+
+		//X = X + K * Y
+		for (int i = 0; i < EKF_STATE_DIM; i++){
+			for (int j = 0; j < EKF_MEASUREMENT_DIM; j++){
+				BATCH_LANES
+				for (int l = 0; l < LANES; l++){
+					X[i][l] += K[i][j][l] * Y[j][l];
+				}
+			}
+		}
+		BATCH_LANES
+		for (int l = 0; l < LANES; l++){
+			float norm = FastSqrtI(X[0][l] * X[0][l] + X[1][l] * X[1][l] + X[2][l] * X[2][l] + X[3][l] * X[3][l]);
+			X[0][l] *= norm; X[1][l] *= norm; X[2][l] *= norm; X[3][l] *= norm;
+		}
+
+		//P = P - K * PXY', upper triangle and mirrored
+		for (int i = 0; i < EKF_STATE_DIM; i++){
+			for (int j = i; j < EKF_STATE_DIM; j++){
+				for (int k = 0; k < EKF_MEASUREMENT_DIM; k++){
+					BATCH_LANES
+					for (int l = 0; l < LANES; l++){
+						P[i][j][l] -= K[i][k][l] * PXY[j][k][l];
+					}
+				}
+				BATCH_LANES
+				for (int l = 0; l < LANES; l++){
+					P[j][i][l] = P[i][j][l];
+				}
+			}
+		}
+	}
+
+	void getQuaternion(int lane, float *q) {
+		q[0] = X[0][lane]; q[1] = X[1][lane]; q[2] = X[2][lane]; q[3] = X[3][lane];
+	}
+
+	void getAngles(int lane, float *rpy) {
+		float q[4];
+
+		getQuaternion(lane, q);
+		AHRSModel_Angles(q, rpy);
+	}
+
+private:
+	float X[EKF_STATE_DIM][LANES];
+	float P[EKF_STATE_DIM][EKF_STATE_DIM][LANES];
+	//quaternion rows of F and quaternion columns of H
+	float F[4][EKF_STATE_DIM][LANES];
+	float H[EKF_MEASUREMENT_DIM][4][LANES];
+	float PX[4][EKF_STATE_DIM][LANES];
+	float PXY[EKF_STATE_DIM][EKF_MEASUREMENT_DIM][LANES];
+	float S[EKF_MEASUREMENT_DIM][EKF_MEASUREMENT_DIM][LANES];
+	float K[EKF_STATE_DIM][EKF_MEASUREMENT_DIM][LANES];
+	float Y[EKF_MEASUREMENT_DIM][LANES];
+	//noise parameters
+	float qq[LANES], qwb[LANES], ra[LANES], rm[LANES];
+};
+
+#endif
@@ -0,0 +1,177 @@
+/*
+ * EKFHistory.h
+ *
+ *  Created on: 18 oct. 2026
+ */
+
+#ifndef _EKFHISTORY_H_
+#define _EKFHISTORY_H_
+
+#include "miniAHRS.h"
+
+//////////////////////////////////////////////////////////////////////////
+//delayed and out-of-sequence measurements for the EKF of miniAHRS.h.
+//EKF_AHRSPredictTimed keeps a ring of the last EKF_HISTORY_SIZE predictions:
+//the gyro sample, the interval, the accel and mag samples applied at its
+//end and the state and covariance after them. a late accel or mag sample is
+//applied at the last prediction that ends at or before its time stamp, and
+//the steps after it are replayed with their stored gyro, accel and mag
+//samples, rewriting the ring on the way, so a second late sample sees the
+//corrected history. the fast loop keeps predicting with the gyro and the
+//slow sensors are folded in whenever they arrive.
+//
+//the ring is static, EKF_HISTORY_SIZE * 67 floats. the replay costs one
+//EKF_AHRSPredict per gyro sample of delay plus the updates stored in that
+//time. each step keeps one accel and one mag sample, a second one for the
+//same step is applied but replaces the first in the ring. with
+//EKF_LAZY_COVARIANCE the covariance is propagated for every stored
+//prediction anyway.
+//////////////////////////////////////////////////////////////////////////
+
+//predictions kept, the longest delay is EKF_HISTORY_SIZE gyro samples
+#ifndef EKF_HISTORY_SIZE
+#define EKF_HISTORY_SIZE 32
+#endif
+
+//samples applied at the end of a step
+#define EKF_HISTORY_ACCEL 1
+#define EKF_HISTORY_MAG 2
+
+typedef struct
+{
+	long time;        //end of the prediction interval (us)
+	float gyro[3];    //rad/s
+	float dt;         //s
+	float accel[3];   //normalized
+	float mag[3];     //normalized
+	int updates;      //EKF_HISTORY_ACCEL | EKF_HISTORY_MAG
+	Mat<EKF_STATE_DIM, 1> X;
+	Mat<EKF_STATE_DIM, EKF_STATE_DIM> P;
+} EKF_HistoryEntry;
+
+static EKF_HistoryEntry History[EKF_HISTORY_SIZE];
+static int HistoryNewest = -1;
+static int HistoryCount = 0;
+
+void EKF_HistoryReset(void)
+{
+	HistoryNewest = -1;
+	HistoryCount = 0;
+}
+
+static void EKF_HistoryStore(EKF_HistoryEntry *e)
+{
+	EKF_AHRSFlushCovariance();
+	Mat_Copy(X, e->X);
+	Mat_Copy(P, e->P);
+}
+
+//EKF_AHRSPredict over an interval of dt seconds ending at time (us)
+void EKF_AHRSPredictTimed(float *gyro, float dt, long time)
+{
+	EKF_HistoryEntry *e;
+
+	EKF_AHRSPredict(gyro, dt);
+
+	HistoryNewest = (HistoryNewest + 1) % EKF_HISTORY_SIZE;
+	if (HistoryCount < EKF_HISTORY_SIZE){
+		HistoryCount++;
+	}
+	e = &History[HistoryNewest];
+	e->time = time;
+	e->gyro[0] = gyro[0]; e->gyro[1] = gyro[1]; e->gyro[2] = gyro[2];
+	e->dt = dt;
+	e->updates = 0;
+	EKF_HistoryStore(e);
+}
+
+//steps back from the newest prediction (0) to the last one ending at or
+//before time. returns -1 when time is older than the ring
+static int EKF_HistoryFind(long time)
+{
+	int n, i;
+
+	for (n = 0; n < HistoryCount; n++){
+		i = (HistoryNewest - n + EKF_HISTORY_SIZE) % EKF_HISTORY_SIZE;
+		if (History[i].time <= time){
+			return n;
+		}
+	}
+	return -1;
+}
+
+//restores the filter to n steps back from the newest prediction
+static void EKF_HistoryRewind(int n)
+{
+	EKF_HistoryEntry *e = &History[(HistoryNewest - n + EKF_HISTORY_SIZE) % EKF_HISTORY_SIZE];
+
+	EKF_AHRSFlushCovariance();
+	Mat_Copy(e->X, X);
+	Mat_Copy(e->P, P);
+}
+
+//stores the corrected state at n steps back and replays the steps after it
+static void EKF_HistoryReplay(int n)
+{
+	EKF_HistoryEntry *e;
+	float v[3];
+
+	EKF_HistoryStore(&History[(HistoryNewest - n + EKF_HISTORY_SIZE) % EKF_HISTORY_SIZE]);
+	for (n--; n >= 0; n--){
+		e = &History[(HistoryNewest - n + EKF_HISTORY_SIZE) % EKF_HISTORY_SIZE];
+		EKF_AHRSPredict(e->gyro, e->dt);
+		if (e->updates & EKF_HISTORY_ACCEL){
+			v[0] = e->accel[0]; v[1] = e->accel[1]; v[2] = e->accel[2];
+			EKF_AHRSUpdateAccel(v);
+		}
+		if (e->updates & EKF_HISTORY_MAG){
+			v[0] = e->mag[0]; v[1] = e->mag[1]; v[2] = e->mag[2];
+			EKF_AHRSUpdateMag(v);
+		}
+		EKF_HistoryStore(e);
+	}
+}
+
+//accel sample taken at time (us). returns 0 if it is older than the ring
+//and was dropped
+int EKF_AHRSUpdateAccelAt(float *accel, long time)
+{
+	int n = EKF_HistoryFind(time);
+	EKF_HistoryEntry *e;
+
+	if (n < 0){
+		return 0;
+	}
+	if (n > 0){
+		EKF_HistoryRewind(n);
+	}
+	EKF_AHRSUpdateAccel(accel);
+	e = &History[(HistoryNewest - n + EKF_HISTORY_SIZE) % EKF_HISTORY_SIZE];
+	e->accel[0] = accel[0]; e->accel[1] = accel[1]; e->accel[2] = accel[2];
+	e->updates |= EKF_HISTORY_ACCEL;
+	EKF_HistoryReplay(n);
+	return 1;
+}
+
+//mag sample taken at time (us). returns 0 if it is older than the ring
+//and was dropped
+int EKF_AHRSUpdateMagAt(float *mag, long time)
+{
+	int n = EKF_HistoryFind(time);
+	EKF_HistoryEntry *e;
+
+	if (n < 0){
+		return 0;
+	}
+	if (n > 0){
+		EKF_HistoryRewind(n);
+	}
+	EKF_AHRSUpdateMag(mag);
+	e = &History[(HistoryNewest - n + EKF_HISTORY_SIZE) % EKF_HISTORY_SIZE];
+	e->mag[0] = mag[0]; e->mag[1] = mag[1]; e->mag[2] = mag[2];
+	e->updates |= EKF_HISTORY_MAG;
+	EKF_HistoryReplay(n);
+	return 1;
+}
+
+#endif
@@ -0,0 +1,895 @@
+/*
+ * EKFKernels.h
+ *
+ *  Created on: 18 oct. 2026
+ */
+
+//generated by AHRSTools/ekfCodeGen (MainCodeGen.cpp), do not edit: the
+//models are there, "make codegen" in AHRSTools regenerates this file.
+//
+//straight-line covariance propagation and measurement updates of the 7
+//state EKF of miniAHRS.h, see EKF_GENERATED_KERNELS. each kernel is the
+//Mat_* sequence of the Joseph form path with the zeros and ones of F and
+//H dropped, the shared subexpressions computed once, the inverse of S
+//replaced by an LDL' solve and only the upper triangle of P formed. the
+//inputs are read before any output is written, so P and X are updated
+//in place. P is read from its upper triangle and written in full.
+
+#ifndef _EKFKERNELS_H_
+#define _EKFKERNELS_H_
+
+#include "FastMath.h"
+
+//P = F * P * F' + Q * qdt, F = [A B; 0 I] (rows 0-3 read) and Q diagonal
+//273 multiplications, 235 additions, 0 negations, 0 divisions, 0 rsqrt
+void EKF_GenPropagate(float *P, const float *F, const float *Q, float qdt)
+{
+	const float p00 = P[0], p01 = P[1], p02 = P[2], p03 = P[3], p04 = P[4], p05 = P[5], p06 = P[6];
+	const float p11 = P[8], p12 = P[9], p13 = P[10], p14 = P[11], p15 = P[12], p16 = P[13];
+	const float p22 = P[16], p23 = P[17], p24 = P[18], p25 = P[19], p26 = P[20];
+	const float p33 = P[24], p34 = P[25], p35 = P[26], p36 = P[27];
+	const float p44 = P[32], p45 = P[33], p46 = P[34];
+	const float p55 = P[40], p56 = P[41];
+	const float p66 = P[48];
+	const float f00 = F[0], f01 = F[1], f02 = F[2], f03 = F[3], f04 = F[4], f05 = F[5], f06 = F[6];
+	const float f10 = F[7], f11 = F[8], f12 = F[9], f13 = F[10], f14 = F[11], f15 = F[12], f16 = F[13];
+	const float f20 = F[14], f21 = F[15], f22 = F[16], f23 = F[17], f24 = F[18], f25 = F[19], f26 = F[20];
+	const float f30 = F[21], f31 = F[22], f32 = F[23], f33 = F[24], f34 = F[25], f35 = F[26], f36 = F[27];
+	const float q0 = Q[0], q1 = Q[8], q2 = Q[16], q3 = Q[24], q4 = Q[32], q5 = Q[40], q6 = Q[48];
+
+	const float t0 = p00 * f00 + p01 * f01 + p02 * f02 + p03 * f03 + p04 * f04 + p05 * f05 + p06 * f06;
+	const float t1 = p01 * f00 + p11 * f01 + p12 * f02 + p13 * f03 + p14 * f04 + p15 * f05 + p16 * f06;
+	const float t2 = p02 * f00 + p12 * f01 + p22 * f02 + p23 * f03 + p24 * f04 + p25 * f05 + p26 * f06;
+	const float t3 = p03 * f00 + p13 * f01 + p23 * f02 + p33 * f03 + p34 * f04 + p35 * f05 + p36 * f06;
+	const float t4 = p04 * f00 + p14 * f01 + p24 * f02 + p34 * f03 + p44 * f04 + p45 * f05 + p46 * f06;
+	const float t5 = p05 * f00 + p15 * f01 + p25 * f02 + p35 * f03 + p45 * f04 + p55 * f05 + p56 * f06;
+	const float t6 = p06 * f00 + p16 * f01 + p26 * f02 + p36 * f03 + p46 * f04 + p56 * f05 + p66 * f06;
+	const float t7 = p00 * f10 + p01 * f11 + p02 * f12 + p03 * f13 + p04 * f14 + p05 * f15 + p06 * f16;
+	const float t8 = p01 * f10 + p11 * f11 + p12 * f12 + p13 * f13 + p14 * f14 + p15 * f15 + p16 * f16;
+	const float t9 = p02 * f10 + p12 * f11 + p22 * f12 + p23 * f13 + p24 * f14 + p25 * f15 + p26 * f16;
+	const float t10 = p03 * f10 + p13 * f11 + p23 * f12 + p33 * f13 + p34 * f14 + p35 * f15 + p36 * f16;
+	const float t11 = p04 * f10 + p14 * f11 + p24 * f12 + p34 * f13 + p44 * f14 + p45 * f15 + p46 * f16;
+	const float t12 = p05 * f10 + p15 * f11 + p25 * f12 + p35 * f13 + p45 * f14 + p55 * f15 + p56 * f16;
+	const float t13 = p06 * f10 + p16 * f11 + p26 * f12 + p36 * f13 + p46 * f14 + p56 * f15 + p66 * f16;
+	const float t14 = p00 * f20 + p01 * f21 + p02 * f22 + p03 * f23 + p04 * f24 + p05 * f25 + p06 * f26;
+	const float t15 = p01 * f20 + p11 * f21 + p12 * f22 + p13 * f23 + p14 * f24 + p15 * f25 + p16 * f26;
+	const float t16 = p02 * f20 + p12 * f21 + p22 * f22 + p23 * f23 + p24 * f24 + p25 * f25 + p26 * f26;
+	const float t17 = p03 * f20 + p13 * f21 + p23 * f22 + p33 * f23 + p34 * f24 + p35 * f25 + p36 * f26;
+	const float t18 = p04 * f20 + p14 * f21 + p24 * f22 + p34 * f23 + p44 * f24 + p45 * f25 + p46 * f26;
+	const float t19 = p05 * f20 + p15 * f21 + p25 * f22 + p35 * f23 + p45 * f24 + p55 * f25 + p56 * f26;
+	const float t20 = p06 * f20 + p16 * f21 + p26 * f22 + p36 * f23 + p46 * f24 + p56 * f25 + p66 * f26;
+	const float t21 = p04 * f30 + p14 * f31 + p24 * f32 + p34 * f33 + p44 * f34 + p45 * f35 + p46 * f36;
+	const float t22 = p05 * f30 + p15 * f31 + p25 * f32 + p35 * f33 + p45 * f34 + p55 * f35 + p56 * f36;
+	const float t23 = p06 * f30 + p16 * f31 + p26 * f32 + p36 * f33 + p46 * f34 + p56 * f35 + p66 * f36;
+
+	P[0] = f00 * t0 + f01 * t1 + f02 * t2 + f03 * t3 + f04 * t4 + f05 * t5 + f06 * t6 + qdt * q0;
+	P[1] = P[7] = f10 * t0 + f11 * t1 + f12 * t2 + f13 * t3 + f14 * t4 + f15 * t5 + f16 * t6;
+	P[2] = P[14] = f20 * t0 + f21 * t1 + f22 * t2 + f23 * t3 + f24 * t4 + f25 * t5 + f26 * t6;
+	P[3] = P[21] = f30 * t0 + f31 * t1 + f32 * t2 + f33 * t3 + f34 * t4 + f35 * t5 + f36 * t6;
+	P[4] = P[28] = t4;
+	P[5] = P[35] = t5;
+	P[6] = P[42] = t6;
+	P[8] = f10 * t7 + f11 * t8 + f12 * t9 + f13 * t10 + f14 * t11 + f15 * t12 + f16 * t13 + qdt * q1;
+	P[9] = P[15] = f20 * t7 + f21 * t8 + f22 * t9 + f23 * t10 + f24 * t11 + f25 * t12 + f26 * t13;
+	P[10] = P[22] = f30 * t7 + f31 * t8 + f32 * t9 + f33 * t10 + f34 * t11 + f35 * t12 + f36 * t13;
+	P[11] = P[29] = t11;
+	P[12] = P[36] = t12;
+	P[13] = P[43] = t13;
+	P[16] = f20 * t14 + f21 * t15 + f22 * t16 + f23 * t17 + f24 * t18 + f25 * t19 + f26 * t20 + qdt * q2;
+	P[17] = P[23] = f30 * t14 + f31 * t15 + f32 * t16 + f33 * t17 + f34 * t18 + f35 * t19 + f36 * t20;
+	P[18] = P[30] = t18;
+	P[19] = P[37] = t19;
+	P[20] = P[44] = t20;
+	P[24] = f30 * (p00 * f30 + p01 * f31 + p02 * f32 + p03 * f33 + p04 * f34 + p05 * f35 + p06 * f36)
+		+ f31 * (p01 * f30 + p11 * f31 + p12 * f32 + p13 * f33 + p14 * f34 + p15 * f35 + p16 * f36) + f32 * (p02 * f30
+		+ p12 * f31 + p22 * f32 + p23 * f33 + p24 * f34 + p25 * f35 + p26 * f36) + f33 * (p03 * f30 + p13 * f31
+		+ p23 * f32 + p33 * f33 + p34 * f34 + p35 * f35 + p36 * f36) + f34 * t21 + f35 * t22 + f36 * t23
+		+ qdt * q3;
+	P[25] = P[31] = t21;
+	P[26] = P[38] = t22;
+	P[27] = P[45] = t23;
+	P[32] = p44 + qdt * q4;
+	P[33] = P[39] = p45;
+	P[34] = P[46] = p46;
+	P[40] = p55 + qdt * q5;
+	P[41] = P[47] = p56;
+	P[48] = p66 + qdt * q6;
+}
+
+//the joint accel and mag update of EKF_AHRSUpdate, R = diag(r)
+//1270 multiplications, 1061 additions, 0 negations, 6 divisions, 1 rsqrt
+void EKF_GenUpdate(float *P, float *X, const float *y, const float *r, float bx, float bz)
+{
+	const float p00 = P[0], p01 = P[1], p02 = P[2], p03 = P[3], p04 = P[4], p05 = P[5], p06 = P[6];
+	const float p11 = P[8], p12 = P[9], p13 = P[10], p14 = P[11], p15 = P[12], p16 = P[13];
+	const float p22 = P[16], p23 = P[17], p24 = P[18], p25 = P[19], p26 = P[20];
+	const float p33 = P[24], p34 = P[25], p35 = P[26], p36 = P[27];
+	const float p44 = P[32], p45 = P[33], p46 = P[34];
+	const float p55 = P[40], p56 = P[41];
+	const float p66 = P[48];
+	const float x0 = X[0], x1 = X[1], x2 = X[2], x3 = X[3];
+	const float r0 = r[0], r1 = r[1], r2 = r[2], r3 = r[3], r4 = r[4], r5 = r[5];
+	const float y0 = y[0], y1 = y[1], y2 = y[2], y3 = y[3], y4 = y[4], y5 = y[5];
+	const float x4 = X[4], x5 = X[5], x6 = X[6];
+
+	const float t0 = 2.0f * x0;
+	const float t1 = 2.0f * x1;
+	const float t2 = 2.0f * x2;
+	const float t3 = 2.0f * x3;
+	const float t4 = bz * t2;
+	const float t5 = bx * t0;
+	const float t6 = t5 - t4;
+	const float t7 = bz * t3 + bx * t1;
+	const float t8 = bz * t0 + bx * t2;
+	const float t9 = bx * t3;
+	const float t10 = bz * t1;
+	const float t11 = t10 - t9;
+	const float t12 = t4 - t5;
+	const float t13 = t9 - t10;
+	const float t14 = p02 * t0;
+	const float t15 = p03 * t1;
+	const float t16 = p00 * t2 - p01 * t3 + t14 - t15;
+	const float t17 = p01 * t0;
+	const float t18 = p03 * t2;
+	const float t19 = p00 * t1 + t17 + p02 * t3 + t18;
+	const float t20 = p01 * t1;
+	const float t21 = p02 * t2;
+	const float t22 = t20 - p00 * t0 + t21 - p03 * t3;
+	const float t23 = p02 * t8;
+	const float t24 = p03 * t11;
+	const float t25 = p00 * t6 + p01 * t7 - t23 + t24;
+	const float t26 = p01 * t8;
+	const float t27 = p00 * t11 + t26 + p02 * t7 + p03 * t12;
+	const float t28 = p02 * t6;
+	const float t29 = p00 * t8 + p01 * t13 + t28 + p03 * t7;
+	const float t30 = p12 * t0;
+	const float t31 = p13 * t1;
+	const float t32 = p01 * t2 - p11 * t3 + t30 - t31;
+	const float t33 = p12 * t3;
+	const float t34 = t20 + p11 * t0 + t33 + p13 * t2;
+	const float t35 = p13 * t3;
+	const float t36 = p11 * t1 - t17 + p12 * t2 - t35;
+	const float t37 = p12 * t8;
+	const float t38 = p01 * t6 + p11 * t7 - t37 + p13 * t11;
+	const float t39 = p12 * t7;
+	const float t40 = p01 * t11 + p11 * t8 + t39 + p13 * t12;
+	const float t41 = p13 * t7;
+	const float t42 = t26 + p11 * t13 + p12 * t6 + t41;
+	const float t43 = t21 - t33 + p22 * t0 - p23 * t1;
+	const float t44 = p23 * t2;
+	const float t45 = t30 + p02 * t1 + p22 * t3 + t44;
+	const float t46 = p23 * t3;
+	const float t47 = p12 * t1 - t14 + p22 * t2 - t46;
+	const float t48 = t28 + t39 - p22 * t8 + p23 * t11;
+	const float t49 = t37 + p02 * t11 + p22 * t7 + p23 * t12;
+	const float t50 = p23 * t7;
+	const float t51 = t23 + p12 * t13 + p22 * t6 + t50;
+	const float t52 = t18 - t35 + p23 * t0 - p33 * t1;
+	const float t53 = t46 + (t15 + p13 * t0) + p33 * t2;
+	const float t54 = t44 + (t31 - p03 * t0) - p33 * t3;
+	const float t55 = t41 + p03 * t6 - p23 * t8 + p33 * t11;
+	const float t56 = t50 + (t24 + p13 * t8) + p33 * t12;
+	const float t57 = p03 * t8 + p13 * t13 + p23 * t6 + p33 * t7;
+	const float t58 = p04 * t2 - p14 * t3 + p24 * t0 - p34 * t1;
+	const float t59 = p05 * t2 - p15 * t3 + p25 * t0 - p35 * t1;
+	const float t60 = p06 * t2 - p16 * t3 + p26 * t0 - p36 * t1;
+	const float t61 = t3 * t34 - t2 * t19 - t0 * t45 + t1 * t53;
+	const float t62 = t2 * t22 - t3 * t36 + t0 * t47 - t1 * t54;
+	const float t63 = t2 * t25 - t3 * t38 + t0 * t48 - t1 * t55;
+	const float t64 = t2 * t27 - t3 * t40 + t0 * t49 - t1 * t56;
+	const float t65 = t2 * t29 - t3 * t42 + t0 * t51 - t1 * t57;
+	const float t66 = 1.0f / (r0 + (t2 * t16 - t3 * t32 + t0 * t43 - t1 * t52));
+	const float t67 = t61 * t66;
+	const float t68 = t62 * t66;
+	const float t69 = t63 * t66;
+	const float t70 = t64 * t66;
+	const float t71 = t65 * t66;
+	const float t72 = t1 * t22 + t0 * t36 + t3 * t47 + t2 * t54 + t62 * t67;
+	const float t73 = t1 * t25 + t0 * t38 + t3 * t48 + t2 * t55 + t63 * t67;
+	const float t74 = t1 * t27 + t0 * t40 + t3 * t49 + t2 * t56 + t64 * t67;
+	const float t75 = t1 * t29 + t0 * t42 + t3 * t51 + t2 * t57 + t65 * t67;
+	const float t76 = 1.0f / (r1 + (t1 * t19 + t0 * t34 + t3 * t45 + t2 * t53) - t61 * t67);
+	const float t77 = t72 * t76;
+	const float t78 = t73 * t76;
+	const float t79 = t74 * t76;
+	const float t80 = t75 * t76;
+	const float t81 = t1 * t38 - t0 * t25 + t2 * t48 - t3 * t55 - t63 * t68 - t73 * t77;
+	const float t82 = t1 * t40 - t0 * t27 + t2 * t49 - t3 * t56 - t64 * t68 - t74 * t77;
+	const float t83 = t1 * t42 - t0 * t29 + t2 * t51 - t3 * t57 - t65 * t68 - t75 * t77;
+	const float t84 = 1.0f / (r2 + (t1 * t36 - t0 * t22 + t2 * t47 - t3 * t54) - t62 * t68 - t72 * t77);
+	const float t85 = t81 * t84;
+	const float t86 = t82 * t84;
+	const float t87 = t83 * t84;
+	const float t88 = t6 * t27 + t7 * t40 - t8 * t49 + t11 * t56 - t64 * t69 - t74 * t78 - t82 * t85;
+	const float t89 = t6 * t29 + t7 * t42 - t8 * t51 + t11 * t57 - t65 * t69 - t75 * t78 - t83 * t85;
+	const float t90 = 1.0f / (r3 + (t6 * t25 + t7 * t38 - t8 * t48 + t11 * t55) - t63 * t69 - t73 * t78
+		- t81 * t85);
+	const float t91 = t88 * t90;
+	const float t92 = t89 * t90;
+	const float t93 = t11 * t29 + t8 * t42 + t7 * t51 + t12 * t57 - t65 * t70 - t75 * t79 - t83 * t86
+		- t89 * t91;
+	const float t94 = 1.0f / (r4 + (t11 * t27 + t8 * t40 + t7 * t49 + t12 * t56) - t64 * t70 - t74 * t79
+		- t82 * t86 - t88 * t91);
+	const float t95 = t93 * t94;
+	const float t96 = 1.0f / (r5 + (t8 * t29 + t13 * t42 + t6 * t51 + t7 * t57) - t65 * t71 - t75 * t80
+		- t83 * t87 - t89 * t92 - t93 * t95);
+	const float t97 = t19 + t16 * t67;
+	const float t98 = t22 - t16 * t68 - t77 * t97;
+	const float t99 = t25 - t16 * t69 - t78 * t97 - t85 * t98;
+	const float t100 = t27 - t16 * t70 - t79 * t97 - t86 * t98 - t91 * t99;
+	const float t101 = t96 * (t29 - t16 * t71 - t80 * t97 - t87 * t98 - t92 * t99 - t95 * t100);
+	const float t102 = t94 * t100 - t95 * t101;
+	const float t103 = t90 * t99 - t91 * t102 - t92 * t101;
+	const float t104 = t84 * t98 - t85 * t103 - t86 * t102 - t87 * t101;
+	const float t105 = t77 * t104 - t76 * t97 + t78 * t103 + t79 * t102 + t80 * t101;
+	const float t106 = t16 * t66 - t67 * t105 - t68 * t104 - t69 * t103 - t70 * t102 - t71 * t101;
+	const float t107 = t34 + t32 * t67;
+	const float t108 = t36 - t32 * t68 - t77 * t107;
+	const float t109 = t38 - t32 * t69 - t78 * t107 - t85 * t108;
+	const float t110 = t40 - t32 * t70 - t79 * t107 - t86 * t108 - t91 * t109;
+	const float t111 = t96 * (t42 - t32 * t71 - t80 * t107 - t87 * t108 - t92 * t109 - t95 * t110);
+	const float t112 = t94 * t110 - t95 * t111;
+	const float t113 = t90 * t109 - t91 * t112 - t92 * t111;
+	const float t114 = t84 * t108 - t85 * t113 - t86 * t112 - t87 * t111;
+	const float t115 = t77 * t114 - t76 * t107 + t78 * t113 + t79 * t112 + t80 * t111;
+	const float t116 = t32 * t66 - t67 * t115 - t68 * t114 - t69 * t113 - t70 * t112 - t71 * t111;
+	const float t117 = t45 + t43 * t67;
+	const float t118 = t47 - t43 * t68 - t77 * t117;
+	const float t119 = t48 - t43 * t69 - t78 * t117 - t85 * t118;
+	const float t120 = t49 - t43 * t70 - t79 * t117 - t86 * t118 - t91 * t119;
+	const float t121 = t96 * (t51 - t43 * t71 - t80 * t117 - t87 * t118 - t92 * t119 - t95 * t120);
+	const float t122 = t94 * t120 - t95 * t121;
+	const float t123 = t90 * t119 - t91 * t122 - t92 * t121;
+	const float t124 = t84 * t118 - t85 * t123 - t86 * t122 - t87 * t121;
+	const float t125 = t77 * t124 - t76 * t117 + t78 * t123 + t79 * t122 + t80 * t121;
+	const float t126 = t43 * t66 - t67 * t125 - t68 * t124 - t69 * t123 - t70 * t122 - t71 * t121;
+	const float t127 = t53 + t52 * t67;
+	const float t128 = t54 - t52 * t68 - t77 * t127;
+	const float t129 = t55 - t52 * t69 - t78 * t127 - t85 * t128;
+	const float t130 = t56 - t52 * t70 - t79 * t127 - t86 * t128 - t91 * t129;
+	const float t131 = t96 * (t57 - t52 * t71 - t80 * t127 - t87 * t128 - t92 * t129 - t95 * t130);
+	const float t132 = t94 * t130 - t95 * t131;
+	const float t133 = t90 * t129 - t91 * t132 - t92 * t131;
+	const float t134 = t84 * t128 - t85 * t133 - t86 * t132 - t87 * t131;
+	const float t135 = t77 * t134 - t76 * t127 + t78 * t133 + t79 * t132 + t80 * t131;
+	const float t136 = t52 * t66 - t67 * t135 - t68 * t134 - t69 * t133 - t70 * t132 - t71 * t131;
+	const float t137 = p04 * t1 + p14 * t0 + p24 * t3 + p34 * t2 + t58 * t67;
+	const float t138 = p14 * t1 - p04 * t0 + p24 * t2 - p34 * t3 - t58 * t68 - t77 * t137;
+	const float t139 = p04 * t6 + p14 * t7 - p24 * t8 + p34 * t11 - t58 * t69 - t78 * t137 - t85 * t138;
+	const float t140 = p04 * t11 + p14 * t8 + p24 * t7 + p34 * t12 - t58 * t70 - t79 * t137 - t86 * t138
+		- t91 * t139;
+	const float t141 = t96 * (p04 * t8 + p14 * t13 + p24 * t6 + p34 * t7 - t58 * t71 - t80 * t137 - t87 * t138
+		- t92 * t139 - t95 * t140);
+	const float t142 = t94 * t140 - t95 * t141;
+	const float t143 = t90 * t139 - t91 * t142 - t92 * t141;
+	const float t144 = t84 * t138 - t85 * t143 - t86 * t142 - t87 * t141;
+	const float t145 = t77 * t144 - t76 * t137 + t78 * t143 + t79 * t142 + t80 * t141;
+	const float t146 = t58 * t66 - t67 * t145 - t68 * t144 - t69 * t143 - t70 * t142 - t71 * t141;
+	const float t147 = p05 * t1 + p15 * t0 + p25 * t3 + p35 * t2 + t59 * t67;
+	const float t148 = p15 * t1 - p05 * t0 + p25 * t2 - p35 * t3 - t59 * t68 - t77 * t147;
+	const float t149 = p05 * t6 + p15 * t7 - p25 * t8 + p35 * t11 - t59 * t69 - t78 * t147 - t85 * t148;
+	const float t150 = p05 * t11 + p15 * t8 + p25 * t7 + p35 * t12 - t59 * t70 - t79 * t147 - t86 * t148
+		- t91 * t149;
+	const float t151 = t96 * (p05 * t8 + p15 * t13 + p25 * t6 + p35 * t7 - t59 * t71 - t80 * t147 - t87 * t148
+		- t92 * t149 - t95 * t150);
+	const float t152 = t94 * t150 - t95 * t151;
+	const float t153 = t90 * t149 - t91 * t152 - t92 * t151;
+	const float t154 = t84 * t148 - t85 * t153 - t86 * t152 - t87 * t151;
+	const float t155 = t77 * t154 - t76 * t147 + t78 * t153 + t79 * t152 + t80 * t151;
+	const float t156 = t59 * t66 - t67 * t155 - t68 * t154 - t69 * t153 - t70 * t152 - t71 * t151;
+	const float t157 = p06 * t1 + p16 * t0 + p26 * t3 + p36 * t2 + t60 * t67;
+	const float t158 = p16 * t1 - p06 * t0 + p26 * t2 - p36 * t3 - t60 * t68 - t77 * t157;
+	const float t159 = p06 * t6 + p16 * t7 - p26 * t8 + p36 * t11 - t60 * t69 - t78 * t157 - t85 * t158;
+	const float t160 = p06 * t11 + p16 * t8 + p26 * t7 + p36 * t12 - t60 * t70 - t79 * t157 - t86 * t158
+		- t91 * t159;
+	const float t161 = t96 * (p06 * t8 + p16 * t13 + p26 * t6 + p36 * t7 - t60 * t71 - t80 * t157 - t87 * t158
+		- t92 * t159 - t95 * t160);
+	const float t162 = t94 * t160 - t95 * t161;
+	const float t163 = t90 * t159 - t91 * t162 - t92 * t161;
+	const float t164 = t84 * t158 - t85 * t163 - t86 * t162 - t87 * t161;
+	const float t165 = t77 * t164 - t76 * t157 + t78 * t163 + t79 * t162 + t80 * t161;
+	const float t166 = t60 * t66 - t67 * t165 - t68 * t164 - t69 * t163 - t70 * t162 - t71 * t161;
+	const float t167 = x0 + y0 * t106 + y1 * t105 + y2 * t104 + y3 * t103 + y4 * t102 + y5 * t101;
+	const float t168 = x1 + y0 * t116 + y1 * t115 + y2 * t114 + y3 * t113 + y4 * t112 + y5 * t111;
+	const float t169 = x2 + y0 * t126 + y1 * t125 + y2 * t124 + y3 * t123 + y4 * t122 + y5 * t121;
+	const float t170 = x3 + y0 * t136 + y1 * t135 + y2 * t134 + y3 * t133 + y4 * t132 + y5 * t131;
+	const float t171 = FastSqrtI(t167 * t167 + t168 * t168 + t169 * t169 + t170 * t170);
+	const float t172 = t1 * t104 - (t3 * t106 + t0 * t105) + t7 * t103 + t8 * t102 + t13 * t101;
+	const float t173 = t0 * t106 - t3 * t105 + t2 * t104 - t8 * t103 + t7 * t102 + t6 * t101;
+	const float t174 = t11 * t103 - (t1 * t106 + t2 * t105 + t3 * t104) + t12 * t102 + t7 * t101;
+	const float t175 = t2 * t116 - t1 * t115 - t0 * t114 + t6 * t113 + t11 * t112 + t8 * t111;
+	const float t176 = t0 * t116 - t3 * t115 + t2 * t114 - t8 * t113 + t7 * t112 + t6 * t111;
+	const float t177 = t11 * t113 - (t1 * t116 + t2 * t115 + t3 * t114) + t12 * t112 + t7 * t111;
+	const float t178 = t2 * t126 - t1 * t125 - t0 * t124 + t6 * t123 + t11 * t122 + t8 * t121;
+	const float t179 = t1 * t124 - (t3 * t126 + t0 * t125) + t7 * t123 + t8 * t122 + t13 * t121;
+	const float t180 = t11 * t123 - (t1 * t126 + t2 * t125 + t3 * t124) + t12 * t122 + t7 * t121;
+	const float t181 = t2 * t136 - t1 * t135 - t0 * t134 + t6 * t133 + t11 * t132 + t8 * t131;
+	const float t182 = t1 * t134 - (t3 * t136 + t0 * t135) + t7 * t133 + t8 * t132 + t13 * t131;
+	const float t183 = t0 * t136 - t3 * t135 + t2 * t134 - t8 * t133 + t7 * t132 + t6 * t131;
+	const float t184 = t2 * t146 - t1 * t145 - t0 * t144 + t6 * t143 + t11 * t142 + t8 * t141;
+	const float t185 = t1 * t144 - (t3 * t146 + t0 * t145) + t7 * t143 + t8 * t142 + t13 * t141;
+	const float t186 = t0 * t146 - t3 * t145 + t2 * t144 - t8 * t143 + t7 * t142 + t6 * t141;
+	const float t187 = t11 * t143 - (t1 * t146 + t2 * t145 + t3 * t144) + t12 * t142 + t7 * t141;
+	const float t188 = t2 * t156 - t1 * t155 - t0 * t154 + t6 * t153 + t11 * t152 + t8 * t151;
+	const float t189 = t1 * t154 - (t3 * t156 + t0 * t155) + t7 * t153 + t8 * t152 + t13 * t151;
+	const float t190 = t0 * t156 - t3 * t155 + t2 * t154 - t8 * t153 + t7 * t152 + t6 * t151;
+	const float t191 = t11 * t153 - (t1 * t156 + t2 * t155 + t3 * t154) + t12 * t152 + t7 * t151;
+	const float t192 = t2 * t166 - t1 * t165 - t0 * t164 + t6 * t163 + t11 * t162 + t8 * t161;
+	const float t193 = t1 * t164 - (t3 * t166 + t0 * t165) + t7 * t163 + t8 * t162 + t13 * t161;
+	const float t194 = t0 * t166 - t3 * t165 + t2 * t164 - t8 * t163 + t7 * t162 + t6 * t161;
+	const float t195 = t11 * t163 - (t1 * t166 + t2 * t165 + t3 * t164) + t12 * t162 + t7 * t161;
+	const float t196 = 1.0f - (t2 * t106 - t1 * t105 - t0 * t104 + t6 * t103 + t11 * t102 + t8 * t101);
+	const float t197 = 1.0f - (t1 * t114 - (t3 * t116 + t0 * t115) + t7 * t113 + t8 * t112 + t13 * t111);
+	const float t198 = 1.0f - (t0 * t126 - t3 * t125 + t2 * t124 - t8 * t123 + t7 * t122 + t6 * t121);
+	const float t199 = 1.0f - (t11 * t133 - (t1 * t136 + t2 * t135 + t3 * t134) + t12 * t132 + t7 * t131);
+	const float t200 = p00 * t196 - p01 * t172 - p02 * t173 - p03 * t174;
+	const float t201 = p01 * t196 - p11 * t172 - p12 * t173 - p13 * t174;
+	const float t202 = p02 * t196 - p12 * t172 - p22 * t173 - p23 * t174;
+	const float t203 = p03 * t196 - p13 * t172 - p23 * t173 - p33 * t174;
+	const float t204 = p01 * t197 - p00 * t175 - p02 * t176 - p03 * t177;
+	const float t205 = p11 * t197 - p01 * t175 - p12 * t176 - p13 * t177;
+	const float t206 = p12 * t197 - p02 * t175 - p22 * t176 - p23 * t177;
+	const float t207 = p13 * t197 - p03 * t175 - p23 * t176 - p33 * t177;
+	const float t208 = p02 * t198 - (p00 * t178 + p01 * t179) - p03 * t180;
+	const float t209 = p12 * t198 - (p01 * t178 + p11 * t179) - p13 * t180;
+	const float t210 = p22 * t198 - (p02 * t178 + p12 * t179) - p23 * t180;
+	const float t211 = p23 * t198 - (p03 * t178 + p13 * t179) - p33 * t180;
+	const float t212 = p03 * t199 - (p00 * t181 + p01 * t182 + p02 * t183);
+	const float t213 = p13 * t199 - (p01 * t181 + p11 * t182 + p12 * t183);
+	const float t214 = p23 * t199 - (p02 * t181 + p12 * t182 + p22 * t183);
+	const float t215 = p33 * t199 - (p03 * t181 + p13 * t182 + p23 * t183);
+	const float t216 = p04 - (p00 * t184 + p01 * t185 + p02 * t186 + p03 * t187);
+	const float t217 = p14 - (p01 * t184 + p11 * t185 + p12 * t186 + p13 * t187);
+	const float t218 = p24 - (p02 * t184 + p12 * t185 + p22 * t186 + p23 * t187);
+	const float t219 = p34 - (p03 * t184 + p13 * t185 + p23 * t186 + p33 * t187);
+	const float t220 = p05 - (p00 * t188 + p01 * t189 + p02 * t190 + p03 * t191);
+	const float t221 = p15 - (p01 * t188 + p11 * t189 + p12 * t190 + p13 * t191);
+	const float t222 = p25 - (p02 * t188 + p12 * t189 + p22 * t190 + p23 * t191);
+	const float t223 = p35 - (p03 * t188 + p13 * t189 + p23 * t190 + p33 * t191);
+	const float t224 = r0 * t106;
+	const float t225 = r1 * t105;
+	const float t226 = r2 * t104;
+	const float t227 = r3 * t103;
+	const float t228 = r4 * t102;
+	const float t229 = r5 * t101;
+	const float t230 = r0 * t116;
+	const float t231 = r1 * t115;
+	const float t232 = r2 * t114;
+	const float t233 = r3 * t113;
+	const float t234 = r4 * t112;
+	const float t235 = r5 * t111;
+	const float t236 = r0 * t126;
+	const float t237 = r1 * t125;
+	const float t238 = r2 * t124;
+	const float t239 = r3 * t123;
+	const float t240 = r4 * t122;
+	const float t241 = r5 * t121;
+	const float t242 = r0 * t136;
+	const float t243 = r1 * t135;
+	const float t244 = r2 * t134;
+	const float t245 = r3 * t133;
+	const float t246 = r4 * t132;
+	const float t247 = r5 * t131;
+	const float t248 = r0 * t146;
+	const float t249 = r1 * t145;
+	const float t250 = r2 * t144;
+	const float t251 = r3 * t143;
+	const float t252 = r4 * t142;
+	const float t253 = r5 * t141;
+	const float t254 = r0 * t156;
+	const float t255 = r1 * t155;
+	const float t256 = r2 * t154;
+	const float t257 = r3 * t153;
+	const float t258 = r4 * t152;
+	const float t259 = r5 * t151;
+
+	X[0] = t167 * t171;
+	X[1] = t168 * t171;
+	X[2] = t169 * t171;
+	X[3] = t170 * t171;
+	X[4] = x4 + y0 * t146 + y1 * t145 + y2 * t144 + y3 * t143 + y4 * t142 + y5 * t141;
+	X[5] = x5 + y0 * t156 + y1 * t155 + y2 * t154 + y3 * t153 + y4 * t152 + y5 * t151;
+	X[6] = x6 + y0 * t166 + y1 * t165 + y2 * t164 + y3 * t163 + y4 * t162 + y5 * t161;
+	P[0] = t196 * t200 - t172 * t201 - t173 * t202 - t174 * t203 + (t106 * t224 + t105 * t225 + t104 * t226
+		+ t103 * t227 + t102 * t228 + t101 * t229);
+	P[1] = P[7] = t197 * t201 - t175 * t200 - t176 * t202 - t177 * t203 + (t116 * t224 + t115 * t225 + t114 * t226
+		+ t113 * t227 + t112 * t228 + t111 * t229);
+	P[2] = P[14] = t198 * t202 - (t178 * t200 + t179 * t201) - t180 * t203 + (t126 * t224 + t125 * t225
+		+ t124 * t226 + t123 * t227 + t122 * t228 + t121 * t229);
+	P[3] = P[21] = t199 * t203 - (t181 * t200 + t182 * t201 + t183 * t202) + (t136 * t224 + t135 * t225
+		+ t134 * t226 + t133 * t227 + t132 * t228 + t131 * t229);
+	P[4] = P[28] = p04 * t196 - p14 * t172 - p24 * t173 - p34 * t174 - (t184 * t200 + t185 * t201 + t186 * t202
+		+ t187 * t203) + (t146 * t224 + t145 * t225 + t144 * t226 + t143 * t227 + t142 * t228 + t141 * t229);
+	P[5] = P[35] = p05 * t196 - p15 * t172 - p25 * t173 - p35 * t174 - (t188 * t200 + t189 * t201 + t190 * t202
+		+ t191 * t203) + (t156 * t224 + t155 * t225 + t154 * t226 + t153 * t227 + t152 * t228 + t151 * t229);
+	P[6] = P[42] = p06 * t196 - p16 * t172 - p26 * t173 - p36 * t174 - (t192 * t200 + t193 * t201 + t194 * t202
+		+ t195 * t203) + (t166 * t224 + t165 * t225 + t164 * t226 + t163 * t227 + t162 * t228 + t161 * t229);
+	P[8] = t197 * t205 - t175 * t204 - t176 * t206 - t177 * t207 + (t116 * t230 + t115 * t231 + t114 * t232
+		+ t113 * t233 + t112 * t234 + t111 * t235);
+	P[9] = P[15] = t198 * t206 - (t178 * t204 + t179 * t205) - t180 * t207 + (t126 * t230 + t125 * t231
+		+ t124 * t232 + t123 * t233 + t122 * t234 + t121 * t235);
+	P[10] = P[22] = t199 * t207 - (t181 * t204 + t182 * t205 + t183 * t206) + (t136 * t230 + t135 * t231
+		+ t134 * t232 + t133 * t233 + t132 * t234 + t131 * t235);
+	P[11] = P[29] = p14 * t197 - p04 * t175 - p24 * t176 - p34 * t177 - (t184 * t204 + t185 * t205 + t186 * t206
+		+ t187 * t207) + (t146 * t230 + t145 * t231 + t144 * t232 + t143 * t233 + t142 * t234 + t141 * t235);
+	P[12] = P[36] = p15 * t197 - p05 * t175 - p25 * t176 - p35 * t177 - (t188 * t204 + t189 * t205 + t190 * t206
+		+ t191 * t207) + (t156 * t230 + t155 * t231 + t154 * t232 + t153 * t233 + t152 * t234 + t151 * t235);
+	P[13] = P[43] = p16 * t197 - p06 * t175 - p26 * t176 - p36 * t177 - (t192 * t204 + t193 * t205 + t194 * t206
+		+ t195 * t207) + (t166 * t230 + t165 * t231 + t164 * t232 + t163 * t233 + t162 * t234 + t161 * t235);
+	P[16] = t198 * t210 - (t178 * t208 + t179 * t209) - t180 * t211 + (t126 * t236 + t125 * t237 + t124 * t238
+		+ t123 * t239 + t122 * t240 + t121 * t241);
+	P[17] = P[23] = t199 * t211 - (t181 * t208 + t182 * t209 + t183 * t210) + (t136 * t236 + t135 * t237
+		+ t134 * t238 + t133 * t239 + t132 * t240 + t131 * t241);
+	P[18] = P[30] = p24 * t198 - (p04 * t178 + p14 * t179) - p34 * t180 - (t184 * t208 + t185 * t209 + t186 * t210
+		+ t187 * t211) + (t146 * t236 + t145 * t237 + t144 * t238 + t143 * t239 + t142 * t240 + t141 * t241);
+	P[19] = P[37] = p25 * t198 - (p05 * t178 + p15 * t179) - p35 * t180 - (t188 * t208 + t189 * t209 + t190 * t210
+		+ t191 * t211) + (t156 * t236 + t155 * t237 + t154 * t238 + t153 * t239 + t152 * t240 + t151 * t241);
+	P[20] = P[44] = p26 * t198 - (p06 * t178 + p16 * t179) - p36 * t180 - (t192 * t208 + t193 * t209 + t194 * t210
+		+ t195 * t211) + (t166 * t236 + t165 * t237 + t164 * t238 + t163 * t239 + t162 * t240 + t161 * t241);
+	P[24] = t199 * t215 - (t181 * t212 + t182 * t213 + t183 * t214) + (t136 * t242 + t135 * t243 + t134 * t244
+		+ t133 * t245 + t132 * t246 + t131 * t247);
+	P[25] = P[31] = p34 * t199 - (p04 * t181 + p14 * t182 + p24 * t183) - (t184 * t212 + t185 * t213 + t186 * t214
+		+ t187 * t215) + (t146 * t242 + t145 * t243 + t144 * t244 + t143 * t245 + t142 * t246 + t141 * t247);
+	P[26] = P[38] = p35 * t199 - (p05 * t181 + p15 * t182 + p25 * t183) - (t188 * t212 + t189 * t213 + t190 * t214
+		+ t191 * t215) + (t156 * t242 + t155 * t243 + t154 * t244 + t153 * t245 + t152 * t246 + t151 * t247);
+	P[27] = P[45] = p36 * t199 - (p06 * t181 + p16 * t182 + p26 * t183) - (t192 * t212 + t193 * t213 + t194 * t214
+		+ t195 * t215) + (t166 * t242 + t165 * t243 + t164 * t244 + t163 * t245 + t162 * t246 + t161 * t247);
+	P[32] = p44 - (p04 * t184 + p14 * t185 + p24 * t186 + p34 * t187) - (t184 * t216 + t185 * t217 + t186 * t218
+		+ t187 * t219) + (t146 * t248 + t145 * t249 + t144 * t250 + t143 * t251 + t142 * t252 + t141 * t253);
+	P[33] = P[39] = p45 - (p05 * t184 + p15 * t185 + p25 * t186 + p35 * t187) - (t188 * t216 + t189 * t217
+		+ t190 * t218 + t191 * t219) + (t156 * t248 + t155 * t249 + t154 * t250 + t153 * t251 + t152 * t252
+		+ t151 * t253);
+	P[34] = P[46] = p46 - (p06 * t184 + p16 * t185 + p26 * t186 + p36 * t187) - (t192 * t216 + t193 * t217
+		+ t194 * t218 + t195 * t219) + (t166 * t248 + t165 * t249 + t164 * t250 + t163 * t251 + t162 * t252
+		+ t161 * t253);
+	P[40] = p55 - (p05 * t188 + p15 * t189 + p25 * t190 + p35 * t191) - (t188 * t220 + t189 * t221 + t190 * t222
+		+ t191 * t223) + (t156 * t254 + t155 * t255 + t154 * t256 + t153 * t257 + t152 * t258 + t151 * t259);
+	P[41] = P[47] = p56 - (p06 * t188 + p16 * t189 + p26 * t190 + p36 * t191) - (t192 * t220 + t193 * t221
+		+ t194 * t222 + t195 * t223) + (t166 * t254 + t165 * t255 + t164 * t256 + t163 * t257 + t162 * t258
+		+ t161 * t259);
+	P[48] = p66 - (p06 * t192 + p16 * t193 + p26 * t194 + p36 * t195) - (t192 * (p06 - (p00 * t192 + p01 * t193
+		+ p02 * t194 + p03 * t195)) + t193 * (p16 - (p01 * t192 + p11 * t193 + p12 * t194 + p13 * t195))
+		+ t194 * (p26 - (p02 * t192 + p12 * t193 + p22 * t194 + p23 * t195)) + t195 * (p36 - (p03 * t192
+		+ p13 * t193 + p23 * t194 + p33 * t195))) + (t166 * (r0 * t166) + t165 * (r1 * t165) + t164 * (r2 * t164)
+		+ t163 * (r3 * t163) + t162 * (r4 * t162) + t161 * (r5 * t161));
+}
+
+//the accel update of EKF_AHRSUpdateAccel, R = r * I
+//684 multiplications, 556 additions, 0 negations, 3 divisions, 1 rsqrt
+void EKF_GenUpdateAccel(float *P, float *X, const float *y, float r)
+{
+	const float p00 = P[0], p01 = P[1], p02 = P[2], p03 = P[3], p04 = P[4], p05 = P[5], p06 = P[6];
+	const float p11 = P[8], p12 = P[9], p13 = P[10], p14 = P[11], p15 = P[12], p16 = P[13];
+	const float p22 = P[16], p23 = P[17], p24 = P[18], p25 = P[19], p26 = P[20];
+	const float p33 = P[24], p34 = P[25], p35 = P[26], p36 = P[27];
+	const float p44 = P[32], p45 = P[33], p46 = P[34];
+	const float p55 = P[40], p56 = P[41];
+	const float p66 = P[48];
+	const float x0 = X[0], x1 = X[1], x2 = X[2], x3 = X[3];
+	const float y0 = y[0], y1 = y[1], y2 = y[2];
+	const float x4 = X[4], x5 = X[5], x6 = X[6];
+
+	const float t0 = 2.0f * x0;
+	const float t1 = 2.0f * x1;
+	const float t2 = 2.0f * x2;
+	const float t3 = 2.0f * x3;
+	const float t4 = p02 * t0;
+	const float t5 = p03 * t1;
+	const float t6 = p00 * t2 - p01 * t3 + t4 - t5;
+	const float t7 = p01 * t0;
+	const float t8 = p03 * t2;
+	const float t9 = p00 * t1 + t7 + p02 * t3 + t8;
+	const float t10 = p01 * t1;
+	const float t11 = p02 * t2;
+	const float t12 = t10 - p00 * t0 + t11 - p03 * t3;
+	const float t13 = p12 * t0;
+	const float t14 = p13 * t1;
+	const float t15 = p01 * t2 - p11 * t3 + t13 - t14;
+	const float t16 = p12 * t3;
+	const float t17 = t10 + p11 * t0 + t16 + p13 * t2;
+	const float t18 = p13 * t3;
+	const float t19 = p11 * t1 - t7 + p12 * t2 - t18;
+	const float t20 = t11 - t16 + p22 * t0 - p23 * t1;
+	const float t21 = p23 * t2;
+	const float t22 = t13 + p02 * t1 + p22 * t3 + t21;
+	const float t23 = p23 * t3;
+	const float t24 = p12 * t1 - t4 + p22 * t2 - t23;
+	const float t25 = t8 - t18 + p23 * t0 - p33 * t1;
+	const float t26 = t23 + (t5 + p13 * t0) + p33 * t2;
+	const float t27 = t21 + (t14 - p03 * t0) - p33 * t3;
+	const float t28 = p04 * t2 - p14 * t3 + p24 * t0 - p34 * t1;
+	const float t29 = p05 * t2 - p15 * t3 + p25 * t0 - p35 * t1;
+	const float t30 = p06 * t2 - p16 * t3 + p26 * t0 - p36 * t1;
+	const float t31 = t3 * t17 - t2 * t9 - t0 * t22 + t1 * t26;
+	const float t32 = t2 * t12 - t3 * t19 + t0 * t24 - t1 * t27;
+	const float t33 = 1.0f / (t2 * t6 - t3 * t15 + t0 * t20 - t1 * t25 + r);
+	const float t34 = t31 * t33;
+	const float t35 = t32 * t33;
+	const float t36 = t1 * t12 + t0 * t19 + t3 * t24 + t2 * t27 + t32 * t34;
+	const float t37 = 1.0f / (t1 * t9 + t0 * t17 + t3 * t22 + t2 * t26 + r - t31 * t34);
+	const float t38 = t36 * t37;
+	const float t39 = 1.0f / (t1 * t19 - t0 * t12 + t2 * t24 - t3 * t27 + r - t32 * t35 - t36 * t38);
+	const float t40 = t9 + t6 * t34;
+	const float t41 = t39 * (t12 - t6 * t35 - t38 * t40);
+	const float t42 = t38 * t41 - t37 * t40;
+	const float t43 = t6 * t33 - t34 * t42 - t35 * t41;
+	const float t44 = t17 + t15 * t34;
+	const float t45 = t39 * (t19 - t15 * t35 - t38 * t44);
+	const float t46 = t38 * t45 - t37 * t44;
+	const float t47 = t15 * t33 - t34 * t46 - t35 * t45;
+	const float t48 = t22 + t20 * t34;
+	const float t49 = t39 * (t24 - t20 * t35 - t38 * t48);
+	const float t50 = t38 * t49 - t37 * t48;
+	const float t51 = t20 * t33 - t34 * t50 - t35 * t49;
+	const float t52 = t26 + t25 * t34;
+	const float t53 = t39 * (t27 - t25 * t35 - t38 * t52);
+	const float t54 = t38 * t53 - t37 * t52;
+	const float t55 = t25 * t33 - t34 * t54 - t35 * t53;
+	const float t56 = p04 * t1 + p14 * t0 + p24 * t3 + p34 * t2 + t28 * t34;
+	const float t57 = t39 * (p14 * t1 - p04 * t0 + p24 * t2 - p34 * t3 - t28 * t35 - t38 * t56);
+	const float t58 = t38 * t57 - t37 * t56;
+	const float t59 = t28 * t33 - t34 * t58 - t35 * t57;
+	const float t60 = p05 * t1 + p15 * t0 + p25 * t3 + p35 * t2 + t29 * t34;
+	const float t61 = t39 * (p15 * t1 - p05 * t0 + p25 * t2 - p35 * t3 - t29 * t35 - t38 * t60);
+	const float t62 = t38 * t61 - t37 * t60;
+	const float t63 = t29 * t33 - t34 * t62 - t35 * t61;
+	const float t64 = p06 * t1 + p16 * t0 + p26 * t3 + p36 * t2 + t30 * t34;
+	const float t65 = t39 * (p16 * t1 - p06 * t0 + p26 * t2 - p36 * t3 - t30 * t35 - t38 * t64);
+	const float t66 = t38 * t65 - t37 * t64;
+	const float t67 = t30 * t33 - t34 * t66 - t35 * t65;
+	const float t68 = x0 + y0 * t43 + y1 * t42 + y2 * t41;
+	const float t69 = x1 + y0 * t47 + y1 * t46 + y2 * t45;
+	const float t70 = x2 + y0 * t51 + y1 * t50 + y2 * t49;
+	const float t71 = x3 + y0 * t55 + y1 * t54 + y2 * t53;
+	const float t72 = FastSqrtI(t68 * t68 + t69 * t69 + t70 * t70 + t71 * t71);
+	const float t73 = t1 * t41 - (t3 * t43 + t0 * t42);
+	const float t74 = t0 * t43 - t3 * t42 + t2 * t41;
+	const float t75 = t1 * t43 + t2 * t42 + t3 * t41;
+	const float t76 = t2 * t47 - t1 * t46 - t0 * t45;
+	const float t77 = t0 * t47 - t3 * t46 + t2 * t45;
+	const float t78 = t1 * t47 + t2 * t46 + t3 * t45;
+	const float t79 = t2 * t51 - t1 * t50 - t0 * t49;
+	const float t80 = t1 * t49 - (t3 * t51 + t0 * t50);
+	const float t81 = t1 * t51 + t2 * t50 + t3 * t49;
+	const float t82 = t2 * t55 - t1 * t54 - t0 * t53;
+	const float t83 = t1 * t53 - (t3 * t55 + t0 * t54);
+	const float t84 = t0 * t55 - t3 * t54 + t2 * t53;
+	const float t85 = t2 * t59 - t1 * t58 - t0 * t57;
+	const float t86 = t1 * t57 - (t3 * t59 + t0 * t58);
+	const float t87 = t0 * t59 - t3 * t58 + t2 * t57;
+	const float t88 = t1 * t59 + t2 * t58 + t3 * t57;
+	const float t89 = t2 * t63 - t1 * t62 - t0 * t61;
+	const float t90 = t1 * t61 - (t3 * t63 + t0 * t62);
+	const float t91 = t0 * t63 - t3 * t62 + t2 * t61;
+	const float t92 = t1 * t63 + t2 * t62 + t3 * t61;
+	const float t93 = t2 * t67 - t1 * t66 - t0 * t65;
+	const float t94 = t1 * t65 - (t3 * t67 + t0 * t66);
+	const float t95 = t0 * t67 - t3 * t66 + t2 * t65;
+	const float t96 = t1 * t67 + t2 * t66 + t3 * t65;
+	const float t97 = 1.0f - (t2 * t43 - t1 * t42 - t0 * t41);
+	const float t98 = 1.0f - (t1 * t45 - (t3 * t47 + t0 * t46));
+	const float t99 = 1.0f - (t0 * t51 - t3 * t50 + t2 * t49);
+	const float t100 = 1.0f + (t1 * t55 + t2 * t54 + t3 * t53);
+	const float t101 = p00 * t97 - p01 * t73 - p02 * t74 + p03 * t75;
+	const float t102 = p01 * t97 - p11 * t73 - p12 * t74 + p13 * t75;
+	const float t103 = p02 * t97 - p12 * t73 - p22 * t74 + p23 * t75;
+	const float t104 = p03 * t97 - p13 * t73 - p23 * t74 + p33 * t75;
+	const float t105 = p01 * t98 - p00 * t76 - p02 * t77 + p03 * t78;
+	const float t106 = p11 * t98 - p01 * t76 - p12 * t77 + p13 * t78;
+	const float t107 = p12 * t98 - p02 * t76 - p22 * t77 + p23 * t78;
+	const float t108 = p13 * t98 - p03 * t76 - p23 * t77 + p33 * t78;
+	const float t109 = p02 * t99 - (p00 * t79 + p01 * t80) + p03 * t81;
+	const float t110 = p12 * t99 - (p01 * t79 + p11 * t80) + p13 * t81;
+	const float t111 = p22 * t99 - (p02 * t79 + p12 * t80) + p23 * t81;
+	const float t112 = p23 * t99 - (p03 * t79 + p13 * t80) + p33 * t81;
+	const float t113 = p03 * t100 - (p00 * t82 + p01 * t83 + p02 * t84);
+	const float t114 = p13 * t100 - (p01 * t82 + p11 * t83 + p12 * t84);
+	const float t115 = p23 * t100 - (p02 * t82 + p12 * t83 + p22 * t84);
+	const float t116 = p33 * t100 - (p03 * t82 + p13 * t83 + p23 * t84);
+	const float t117 = p04 + (p03 * t88 - (p00 * t85 + p01 * t86 + p02 * t87));
+	const float t118 = p14 + (p13 * t88 - (p01 * t85 + p11 * t86 + p12 * t87));
+	const float t119 = p24 + (p23 * t88 - (p02 * t85 + p12 * t86 + p22 * t87));
+	const float t120 = p34 + (p33 * t88 - (p03 * t85 + p13 * t86 + p23 * t87));
+	const float t121 = p05 + (p03 * t92 - (p00 * t89 + p01 * t90 + p02 * t91));
+	const float t122 = p15 + (p13 * t92 - (p01 * t89 + p11 * t90 + p12 * t91));
+	const float t123 = p25 + (p23 * t92 - (p02 * t89 + p12 * t90 + p22 * t91));
+	const float t124 = p35 + (p33 * t92 - (p03 * t89 + p13 * t90 + p23 * t91));
+	const float t125 = r * t43;
+	const float t126 = r * t42;
+	const float t127 = r * t41;
+	const float t128 = r * t47;
+	const float t129 = r * t46;
+	const float t130 = r * t45;
+	const float t131 = r * t51;
+	const float t132 = r * t50;
+	const float t133 = r * t49;
+	const float t134 = r * t55;
+	const float t135 = r * t54;
+	const float t136 = r * t53;
+	const float t137 = r * t59;
+	const float t138 = r * t58;
+	const float t139 = r * t57;
+	const float t140 = r * t63;
+	const float t141 = r * t62;
+	const float t142 = r * t61;
+
+	X[0] = t68 * t72;
+	X[1] = t69 * t72;
+	X[2] = t70 * t72;
+	X[3] = t71 * t72;
+	X[4] = x4 + y0 * t59 + y1 * t58 + y2 * t57;
+	X[5] = x5 + y0 * t63 + y1 * t62 + y2 * t61;
+	X[6] = x6 + y0 * t67 + y1 * t66 + y2 * t65;
+	P[0] = t97 * t101 - t73 * t102 - t74 * t103 + t75 * t104 + (t43 * t125 + t42 * t126 + t41 * t127);
+	P[1] = P[7] = t98 * t102 - t76 * t101 - t77 * t103 + t78 * t104 + (t47 * t125 + t46 * t126 + t45 * t127);
+	P[2] = P[14] = t99 * t103 - (t79 * t101 + t80 * t102) + t81 * t104 + (t51 * t125 + t50 * t126 + t49 * t127);
+	P[3] = P[21] = t100 * t104 - (t82 * t101 + t83 * t102 + t84 * t103) + (t55 * t125 + t54 * t126 + t53 * t127);
+	P[4] = P[28] = p04 * t97 - p14 * t73 - p24 * t74 + p34 * t75 + (t88 * t104 - (t85 * t101 + t86 * t102
+		+ t87 * t103)) + (t59 * t125 + t58 * t126 + t57 * t127);
+	P[5] = P[35] = p05 * t97 - p15 * t73 - p25 * t74 + p35 * t75 + (t92 * t104 - (t89 * t101 + t90 * t102
+		+ t91 * t103)) + (t63 * t125 + t62 * t126 + t61 * t127);
+	P[6] = P[42] = p06 * t97 - p16 * t73 - p26 * t74 + p36 * t75 + (t96 * t104 - (t93 * t101 + t94 * t102
+		+ t95 * t103)) + (t67 * t125 + t66 * t126 + t65 * t127);
+	P[8] = t98 * t106 - t76 * t105 - t77 * t107 + t78 * t108 + (t47 * t128 + t46 * t129 + t45 * t130);
+	P[9] = P[15] = t99 * t107 - (t79 * t105 + t80 * t106) + t81 * t108 + (t51 * t128 + t50 * t129 + t49 * t130);
+	P[10] = P[22] = t100 * t108 - (t82 * t105 + t83 * t106 + t84 * t107) + (t55 * t128 + t54 * t129 + t53 * t130);
+	P[11] = P[29] = p14 * t98 - p04 * t76 - p24 * t77 + p34 * t78 + (t88 * t108 - (t85 * t105 + t86 * t106
+		+ t87 * t107)) + (t59 * t128 + t58 * t129 + t57 * t130);
+	P[12] = P[36] = p15 * t98 - p05 * t76 - p25 * t77 + p35 * t78 + (t92 * t108 - (t89 * t105 + t90 * t106
+		+ t91 * t107)) + (t63 * t128 + t62 * t129 + t61 * t130);
+	P[13] = P[43] = p16 * t98 - p06 * t76 - p26 * t77 + p36 * t78 + (t96 * t108 - (t93 * t105 + t94 * t106
+		+ t95 * t107)) + (t67 * t128 + t66 * t129 + t65 * t130);
+	P[16] = t99 * t111 - (t79 * t109 + t80 * t110) + t81 * t112 + (t51 * t131 + t50 * t132 + t49 * t133);
+	P[17] = P[23] = t100 * t112 - (t82 * t109 + t83 * t110 + t84 * t111) + (t55 * t131 + t54 * t132 + t53 * t133);
+	P[18] = P[30] = p24 * t99 - (p04 * t79 + p14 * t80) + p34 * t81 + (t88 * t112 - (t85 * t109 + t86 * t110
+		+ t87 * t111)) + (t59 * t131 + t58 * t132 + t57 * t133);
+	P[19] = P[37] = p25 * t99 - (p05 * t79 + p15 * t80) + p35 * t81 + (t92 * t112 - (t89 * t109 + t90 * t110
+		+ t91 * t111)) + (t63 * t131 + t62 * t132 + t61 * t133);
+	P[20] = P[44] = p26 * t99 - (p06 * t79 + p16 * t80) + p36 * t81 + (t96 * t112 - (t93 * t109 + t94 * t110
+		+ t95 * t111)) + (t67 * t131 + t66 * t132 + t65 * t133);
+	P[24] = t100 * t116 - (t82 * t113 + t83 * t114 + t84 * t115) + (t55 * t134 + t54 * t135 + t53 * t136);
+	P[25] = P[31] = p34 * t100 - (p04 * t82 + p14 * t83 + p24 * t84) + (t88 * t116 - (t85 * t113 + t86 * t114
+		+ t87 * t115)) + (t59 * t134 + t58 * t135 + t57 * t136);
+	P[26] = P[38] = p35 * t100 - (p05 * t82 + p15 * t83 + p25 * t84) + (t92 * t116 - (t89 * t113 + t90 * t114
+		+ t91 * t115)) + (t63 * t134 + t62 * t135 + t61 * t136);
+	P[27] = P[45] = p36 * t100 - (p06 * t82 + p16 * t83 + p26 * t84) + (t96 * t116 - (t93 * t113 + t94 * t114
+		+ t95 * t115)) + (t67 * t134 + t66 * t135 + t65 * t136);
+	P[32] = p44 + (p34 * t88 - (p04 * t85 + p14 * t86 + p24 * t87)) + (t88 * t120 - (t85 * t117 + t86 * t118
+		+ t87 * t119)) + (t59 * t137 + t58 * t138 + t57 * t139);
+	P[33] = P[39] = p45 + (p35 * t88 - (p05 * t85 + p15 * t86 + p25 * t87)) + (t92 * t120 - (t89 * t117
+		+ t90 * t118 + t91 * t119)) + (t63 * t137 + t62 * t138 + t61 * t139);
+	P[34] = P[46] = p46 + (p36 * t88 - (p06 * t85 + p16 * t86 + p26 * t87)) + (t96 * t120 - (t93 * t117
+		+ t94 * t118 + t95 * t119)) + (t67 * t137 + t66 * t138 + t65 * t139);
+	P[40] = p55 + (p35 * t92 - (p05 * t89 + p15 * t90 + p25 * t91)) + (t92 * t124 - (t89 * t121 + t90 * t122
+		+ t91 * t123)) + (t63 * t140 + t62 * t141 + t61 * t142);
+	P[41] = P[47] = p56 + (p36 * t92 - (p06 * t89 + p16 * t90 + p26 * t91)) + (t96 * t124 - (t93 * t121
+		+ t94 * t122 + t95 * t123)) + (t67 * t140 + t66 * t141 + t65 * t142);
+	P[48] = p66 + (p36 * t96 - (p06 * t93 + p16 * t94 + p26 * t95)) + (t96 * (p36 + (p33 * t96 - (p03 * t93
+		+ p13 * t94 + p23 * t95))) - (t93 * (p06 + (p03 * t96 - (p00 * t93 + p01 * t94 + p02 * t95)))
+		+ t94 * (p16 + (p13 * t96 - (p01 * t93 + p11 * t94 + p12 * t95))) + t95 * (p26 + (p23 * t96 - (p02 * t93
+		+ p12 * t94 + p22 * t95))))) + (t67 * (r * t67) + t66 * (r * t66) + t65 * (r * t65));
+}
+
+//the mag update of EKF_AHRSUpdateMag, R = r * I
+//696 multiplications, 562 additions, 0 negations, 3 divisions, 1 rsqrt
+void EKF_GenUpdateMag(float *P, float *X, const float *y, float r, float bx, float bz)
+{
+	const float p00 = P[0], p01 = P[1], p02 = P[2], p03 = P[3], p04 = P[4], p05 = P[5], p06 = P[6];
+	const float p11 = P[8], p12 = P[9], p13 = P[10], p14 = P[11], p15 = P[12], p16 = P[13];
+	const float p22 = P[16], p23 = P[17], p24 = P[18], p25 = P[19], p26 = P[20];
+	const float p33 = P[24], p34 = P[25], p35 = P[26], p36 = P[27];
+	const float p44 = P[32], p45 = P[33], p46 = P[34];
+	const float p55 = P[40], p56 = P[41];
+	const float p66 = P[48];
+	const float x0 = X[0], x1 = X[1], x2 = X[2], x3 = X[3];
+	const float y0 = y[0], y1 = y[1], y2 = y[2];
+	const float x4 = X[4], x5 = X[5], x6 = X[6];
+
+	const float t0 = 2.0f * x0;
+	const float t1 = 2.0f * x1;
+	const float t2 = 2.0f * x2;
+	const float t3 = 2.0f * x3;
+	const float t4 = bz * t2;
+	const float t5 = bx * t0;
+	const float t6 = t5 - t4;
+	const float t7 = bz * t3 + bx * t1;
+	const float t8 = bz * t0 + bx * t2;
+	const float t9 = bx * t3;
+	const float t10 = bz * t1;
+	const float t11 = t10 - t9;
+	const float t12 = t4 - t5;
+	const float t13 = t9 - t10;
+	const float t14 = p02 * t8;
+	const float t15 = p03 * t11;
+	const float t16 = p00 * t6 + p01 * t7 - t14 + t15;
+	const float t17 = p01 * t8;
+	const float t18 = p00 * t11 + t17 + p02 * t7 + p03 * t12;
+	const float t19 = p02 * t6;
+	const float t20 = p00 * t8 + p01 * t13 + t19 + p03 * t7;
+	const float t21 = p12 * t8;
+	const float t22 = p01 * t6 + p11 * t7 - t21 + p13 * t11;
+	const float t23 = p12 * t7;
+	const float t24 = p01 * t11 + p11 * t8 + t23 + p13 * t12;
+	const float t25 = p13 * t7;
+	const float t26 = t17 + p11 * t13 + p12 * t6 + t25;
+	const float t27 = t19 + t23 - p22 * t8 + p23 * t11;
+	const float t28 = t21 + p02 * t11 + p22 * t7 + p23 * t12;
+	const float t29 = p23 * t7;
+	const float t30 = t14 + p12 * t13 + p22 * t6 + t29;
+	const float t31 = t25 + p03 * t6 - p23 * t8 + p33 * t11;
+	const float t32 = t29 + (t15 + p13 * t8) + p33 * t12;
+	const float t33 = p03 * t8 + p13 * t13 + p23 * t6 + p33 * t7;
+	const float t34 = p04 * t6 + p14 * t7 - p24 * t8 + p34 * t11;
+	const float t35 = p05 * t6 + p15 * t7 - p25 * t8 + p35 * t11;
+	const float t36 = p06 * t6 + p16 * t7 - p26 * t8 + p36 * t11;
+	const float t37 = t6 * t18 + t7 * t24 - t8 * t28 + t11 * t32;
+	const float t38 = t6 * t20 + t7 * t26 - t8 * t30 + t11 * t33;
+	const float t39 = 1.0f / (t6 * t16 + t7 * t22 - t8 * t27 + t11 * t31 + r);
+	const float t40 = t37 * t39;
+	const float t41 = t38 * t39;
+	const float t42 = t11 * t20 + t8 * t26 + t7 * t30 + t12 * t33 - t38 * t40;
+	const float t43 = 1.0f / (t11 * t18 + t8 * t24 + t7 * t28 + t12 * t32 + r - t37 * t40);
+	const float t44 = t42 * t43;
+	const float t45 = 1.0f / (t8 * t20 + t13 * t26 + t6 * t30 + t7 * t33 + r - t38 * t41 - t42 * t44);
+	const float t46 = t18 - t16 * t40;
+	const float t47 = t45 * (t20 - t16 * t41 - t44 * t46);
+	const float t48 = t43 * t46 - t44 * t47;
+	const float t49 = t16 * t39 - t40 * t48 - t41 * t47;
+	const float t50 = t24 - t22 * t40;
+	const float t51 = t45 * (t26 - t22 * t41 - t44 * t50);
+	const float t52 = t43 * t50 - t44 * t51;
+	const float t53 = t22 * t39 - t40 * t52 - t41 * t51;
+	const float t54 = t28 - t27 * t40;
+	const float t55 = t45 * (t30 - t27 * t41 - t44 * t54);
+	const float t56 = t43 * t54 - t44 * t55;
+	const float t57 = t27 * t39 - t40 * t56 - t41 * t55;
+	const float t58 = t32 - t31 * t40;
+	const float t59 = t45 * (t33 - t31 * t41 - t44 * t58);
+	const float t60 = t43 * t58 - t44 * t59;
+	const float t61 = t31 * t39 - t40 * t60 - t41 * t59;
+	const float t62 = p04 * t11 + p14 * t8 + p24 * t7 + p34 * t12 - t34 * t40;
+	const float t63 = t45 * (p04 * t8 + p14 * t13 + p24 * t6 + p34 * t7 - t34 * t41 - t44 * t62);
+	const float t64 = t43 * t62 - t44 * t63;
+	const float t65 = t34 * t39 - t40 * t64 - t41 * t63;
+	const float t66 = p05 * t11 + p15 * t8 + p25 * t7 + p35 * t12 - t35 * t40;
+	const float t67 = t45 * (p05 * t8 + p15 * t13 + p25 * t6 + p35 * t7 - t35 * t41 - t44 * t66);
+	const float t68 = t43 * t66 - t44 * t67;
+	const float t69 = t35 * t39 - t40 * t68 - t41 * t67;
+	const float t70 = p06 * t11 + p16 * t8 + p26 * t7 + p36 * t12 - t36 * t40;
+	const float t71 = t45 * (p06 * t8 + p16 * t13 + p26 * t6 + p36 * t7 - t36 * t41 - t44 * t70);
+	const float t72 = t43 * t70 - t44 * t71;
+	const float t73 = t36 * t39 - t40 * t72 - t41 * t71;
+	const float t74 = x0 + y0 * t49 + y1 * t48 + y2 * t47;
+	const float t75 = x1 + y0 * t53 + y1 * t52 + y2 * t51;
+	const float t76 = x2 + y0 * t57 + y1 * t56 + y2 * t55;
+	const float t77 = x3 + y0 * t61 + y1 * t60 + y2 * t59;
+	const float t78 = FastSqrtI(t74 * t74 + t75 * t75 + t76 * t76 + t77 * t77);
+	const float t79 = t7 * t49 + t8 * t48 + t13 * t47;
+	const float t80 = t7 * t48 - t8 * t49 + t6 * t47;
+	const float t81 = t11 * t49 + t12 * t48 + t7 * t47;
+	const float t82 = t6 * t53 + t11 * t52 + t8 * t51;
+	const float t83 = t7 * t52 - t8 * t53 + t6 * t51;
+	const float t84 = t11 * t53 + t12 * t52 + t7 * t51;
+	const float t85 = t6 * t57 + t11 * t56 + t8 * t55;
+	const float t86 = t7 * t57 + t8 * t56 + t13 * t55;
+	const float t87 = t11 * t57 + t12 * t56 + t7 * t55;
+	const float t88 = t6 * t61 + t11 * t60 + t8 * t59;
+	const float t89 = t7 * t61 + t8 * t60 + t13 * t59;
+	const float t90 = t7 * t60 - t8 * t61 + t6 * t59;
+	const float t91 = t6 * t65 + t11 * t64 + t8 * t63;
+	const float t92 = t7 * t65 + t8 * t64 + t13 * t63;
+	const float t93 = t7 * t64 - t8 * t65 + t6 * t63;
+	const float t94 = t11 * t65 + t12 * t64 + t7 * t63;
+	const float t95 = t6 * t69 + t11 * t68 + t8 * t67;
+	const float t96 = t7 * t69 + t8 * t68 + t13 * t67;
+	const float t97 = t7 * t68 - t8 * t69 + t6 * t67;
+	const float t98 = t11 * t69 + t12 * t68 + t7 * t67;
+	const float t99 = t6 * t73 + t11 * t72 + t8 * t71;
+	const float t100 = t7 * t73 + t8 * t72 + t13 * t71;
+	const float t101 = t7 * t72 - t8 * t73 + t6 * t71;
+	const float t102 = t11 * t73 + t12 * t72 + t7 * t71;
+	const float t103 = 1.0f - (t6 * t49 + t11 * t48 + t8 * t47);
+	const float t104 = 1.0f - (t7 * t53 + t8 * t52 + t13 * t51);
+	const float t105 = 1.0f - (t7 * t56 - t8 * t57 + t6 * t55);
+	const float t106 = 1.0f - (t11 * t61 + t12 * t60 + t7 * t59);
+	const float t107 = p00 * t103 - p01 * t79 - p02 * t80 - p03 * t81;
+	const float t108 = p01 * t103 - p11 * t79 - p12 * t80 - p13 * t81;
+	const float t109 = p02 * t103 - p12 * t79 - p22 * t80 - p23 * t81;
+	const float t110 = p03 * t103 - p13 * t79 - p23 * t80 - p33 * t81;
+	const float t111 = p01 * t104 - p00 * t82 - p02 * t83 - p03 * t84;
+	const float t112 = p11 * t104 - p01 * t82 - p12 * t83 - p13 * t84;
+	const float t113 = p12 * t104 - p02 * t82 - p22 * t83 - p23 * t84;
+	const float t114 = p13 * t104 - p03 * t82 - p23 * t83 - p33 * t84;
+	const float t115 = p02 * t105 - (p00 * t85 + p01 * t86) - p03 * t87;
+	const float t116 = p12 * t105 - (p01 * t85 + p11 * t86) - p13 * t87;
+	const float t117 = p22 * t105 - (p02 * t85 + p12 * t86) - p23 * t87;
+	const float t118 = p23 * t105 - (p03 * t85 + p13 * t86) - p33 * t87;
+	const float t119 = p03 * t106 - (p00 * t88 + p01 * t89 + p02 * t90);
+	const float t120 = p13 * t106 - (p01 * t88 + p11 * t89 + p12 * t90);
+	const float t121 = p23 * t106 - (p02 * t88 + p12 * t89 + p22 * t90);
+	const float t122 = p33 * t106 - (p03 * t88 + p13 * t89 + p23 * t90);
+	const float t123 = p04 - (p00 * t91 + p01 * t92 + p02 * t93 + p03 * t94);
+	const float t124 = p14 - (p01 * t91 + p11 * t92 + p12 * t93 + p13 * t94);
+	const float t125 = p24 - (p02 * t91 + p12 * t92 + p22 * t93 + p23 * t94);
+	const float t126 = p34 - (p03 * t91 + p13 * t92 + p23 * t93 + p33 * t94);
+	const float t127 = p05 - (p00 * t95 + p01 * t96 + p02 * t97 + p03 * t98);
+	const float t128 = p15 - (p01 * t95 + p11 * t96 + p12 * t97 + p13 * t98);
+	const float t129 = p25 - (p02 * t95 + p12 * t96 + p22 * t97 + p23 * t98);
+	const float t130 = p35 - (p03 * t95 + p13 * t96 + p23 * t97 + p33 * t98);
+	const float t131 = r * t49;
+	const float t132 = r * t48;
+	const float t133 = r * t47;
+	const float t134 = r * t53;
+	const float t135 = r * t52;
+	const float t136 = r * t51;
+	const float t137 = r * t57;
+	const float t138 = r * t56;
+	const float t139 = r * t55;
+	const float t140 = r * t61;
+	const float t141 = r * t60;
+	const float t142 = r * t59;
+	const float t143 = r * t65;
+	const float t144 = r * t64;
+	const float t145 = r * t63;
+	const float t146 = r * t69;
+	const float t147 = r * t68;
+	const float t148 = r * t67;
+
+	X[0] = t74 * t78;
+	X[1] = t75 * t78;
+	X[2] = t76 * t78;
+	X[3] = t77 * t78;
+	X[4] = x4 + y0 * t65 + y1 * t64 + y2 * t63;
+	X[5] = x5 + y0 * t69 + y1 * t68 + y2 * t67;
+	X[6] = x6 + y0 * t73 + y1 * t72 + y2 * t71;
+	P[0] = t103 * t107 - t79 * t108 - t80 * t109 - t81 * t110 + (t49 * t131 + t48 * t132 + t47 * t133);
+	P[1] = P[7] = t104 * t108 - t82 * t107 - t83 * t109 - t84 * t110 + (t53 * t131 + t52 * t132 + t51 * t133);
+	P[2] = P[14] = t105 * t109 - (t85 * t107 + t86 * t108) - t87 * t110 + (t57 * t131 + t56 * t132 + t55 * t133);
+	P[3] = P[21] = t106 * t110 - (t88 * t107 + t89 * t108 + t90 * t109) + (t61 * t131 + t60 * t132 + t59 * t133);
+	P[4] = P[28] = p04 * t103 - p14 * t79 - p24 * t80 - p34 * t81 - (t91 * t107 + t92 * t108 + t93 * t109
+		+ t94 * t110) + (t65 * t131 + t64 * t132 + t63 * t133);
+	P[5] = P[35] = p05 * t103 - p15 * t79 - p25 * t80 - p35 * t81 - (t95 * t107 + t96 * t108 + t97 * t109
+		+ t98 * t110) + (t69 * t131 + t68 * t132 + t67 * t133);
+	P[6] = P[42] = p06 * t103 - p16 * t79 - p26 * t80 - p36 * t81 - (t99 * t107 + t100 * t108 + t101 * t109
+		+ t102 * t110) + (t73 * t131 + t72 * t132 + t71 * t133);
+	P[8] = t104 * t112 - t82 * t111 - t83 * t113 - t84 * t114 + (t53 * t134 + t52 * t135 + t51 * t136);
+	P[9] = P[15] = t105 * t113 - (t85 * t111 + t86 * t112) - t87 * t114 + (t57 * t134 + t56 * t135 + t55 * t136);
+	P[10] = P[22] = t106 * t114 - (t88 * t111 + t89 * t112 + t90 * t113) + (t61 * t134 + t60 * t135 + t59 * t136);
+	P[11] = P[29] = p14 * t104 - p04 * t82 - p24 * t83 - p34 * t84 - (t91 * t111 + t92 * t112 + t93 * t113
+		+ t94 * t114) + (t65 * t134 + t64 * t135 + t63 * t136);
+	P[12] = P[36] = p15 * t104 - p05 * t82 - p25 * t83 - p35 * t84 - (t95 * t111 + t96 * t112 + t97 * t113
+		+ t98 * t114) + (t69 * t134 + t68 * t135 + t67 * t136);
+	P[13] = P[43] = p16 * t104 - p06 * t82 - p26 * t83 - p36 * t84 - (t99 * t111 + t100 * t112 + t101 * t113
+		+ t102 * t114) + (t73 * t134 + t72 * t135 + t71 * t136);
+	P[16] = t105 * t117 - (t85 * t115 + t86 * t116) - t87 * t118 + (t57 * t137 + t56 * t138 + t55 * t139);
+	P[17] = P[23] = t106 * t118 - (t88 * t115 + t89 * t116 + t90 * t117) + (t61 * t137 + t60 * t138 + t59 * t139);
+	P[18] = P[30] = p24 * t105 - (p04 * t85 + p14 * t86) - p34 * t87 - (t91 * t115 + t92 * t116 + t93 * t117
+		+ t94 * t118) + (t65 * t137 + t64 * t138 + t63 * t139);
+	P[19] = P[37] = p25 * t105 - (p05 * t85 + p15 * t86) - p35 * t87 - (t95 * t115 + t96 * t116 + t97 * t117
+		+ t98 * t118) + (t69 * t137 + t68 * t138 + t67 * t139);
+	P[20] = P[44] = p26 * t105 - (p06 * t85 + p16 * t86) - p36 * t87 - (t99 * t115 + t100 * t116 + t101 * t117
+		+ t102 * t118) + (t73 * t137 + t72 * t138 + t71 * t139);
+	P[24] = t106 * t122 - (t88 * t119 + t89 * t120 + t90 * t121) + (t61 * t140 + t60 * t141 + t59 * t142);
+	P[25] = P[31] = p34 * t106 - (p04 * t88 + p14 * t89 + p24 * t90) - (t91 * t119 + t92 * t120 + t93 * t121
+		+ t94 * t122) + (t65 * t140 + t64 * t141 + t63 * t142);
+	P[26] = P[38] = p35 * t106 - (p05 * t88 + p15 * t89 + p25 * t90) - (t95 * t119 + t96 * t120 + t97 * t121
+		+ t98 * t122) + (t69 * t140 + t68 * t141 + t67 * t142);
+	P[27] = P[45] = p36 * t106 - (p06 * t88 + p16 * t89 + p26 * t90) - (t99 * t119 + t100 * t120 + t101 * t121
+		+ t102 * t122) + (t73 * t140 + t72 * t141 + t71 * t142);
+	P[32] = p44 - (p04 * t91 + p14 * t92 + p24 * t93 + p34 * t94) - (t91 * t123 + t92 * t124 + t93 * t125
+		+ t94 * t126) + (t65 * t143 + t64 * t144 + t63 * t145);
+	P[33] = P[39] = p45 - (p05 * t91 + p15 * t92 + p25 * t93 + p35 * t94) - (t95 * t123 + t96 * t124 + t97 * t125
+		+ t98 * t126) + (t69 * t143 + t68 * t144 + t67 * t145);
+	P[34] = P[46] = p46 - (p06 * t91 + p16 * t92 + p26 * t93 + p36 * t94) - (t99 * t123 + t100 * t124
+		+ t101 * t125 + t102 * t126) + (t73 * t143 + t72 * t144 + t71 * t145);
+	P[40] = p55 - (p05 * t95 + p15 * t96 + p25 * t97 + p35 * t98) - (t95 * t127 + t96 * t128 + t97 * t129
+		+ t98 * t130) + (t69 * t146 + t68 * t147 + t67 * t148);
+	P[41] = P[47] = p56 - (p06 * t95 + p16 * t96 + p26 * t97 + p36 * t98) - (t99 * t127 + t100 * t128
+		+ t101 * t129 + t102 * t130) + (t73 * t146 + t72 * t147 + t71 * t148);
+	P[48] = p66 - (p06 * t99 + p16 * t100 + p26 * t101 + p36 * t102) - (t99 * (p06 - (p00 * t99 + p01 * t100
+		+ p02 * t101 + p03 * t102)) + t100 * (p16 - (p01 * t99 + p11 * t100 + p12 * t101 + p13 * t102))
+		+ t101 * (p26 - (p02 * t99 + p12 * t100 + p22 * t101 + p23 * t102)) + t102 * (p36 - (p03 * t99
+		+ p13 * t100 + p23 * t101 + p33 * t102))) + (t73 * (r * t73) + t72 * (r * t72) + t71 * (r * t71));
+}
+
+#endif
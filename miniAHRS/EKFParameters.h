@@ -0,0 +1,136 @@
+/*
+ * EKFParameters.h
+ *
+ *  Created on: 18 oct. 2026
+ */
+
+#ifndef EKFPARAMETERS_H_
+#define EKFPARAMETERS_H_
+
+#include <stdio.h>
+#include <string.h>
+
+#include "miniAHRS.h"
+
+//////////////////////////////////////////////////////////////////////////
+//noise parameters of the EKF at run time. the EKF_*_INITIAL defines of
+//miniAHRS.h stay the defaults; a parameter file, written by hand or by
+//AHRSTools/tuner, replaces them without recompiling. the file is text, one
+//"name value" pair per line with the names of the defines, '#' starts a
+//comment and a missing name keeps its default:
+//  EKF_QQ_INITIAL 0.0002
+//  EKF_RA_INITIAL 0.0031
+//////////////////////////////////////////////////////////////////////////
+
+typedef struct
+{
+	float pq, pwb;  //initial covariance of the quaternion and the bias
+	float qq, qwb;  //process noise, per EKF_QDT_NOMINAL
+	float ra, rm;   //accel and mag measurement noise
+} EKF_Parameters;
+
+void EKF_ParametersDefault(EKF_Parameters *p)
+{
+	p->pq = EKF_PQ_INITIAL;
+	p->pwb = EKF_PWB_INITIAL;
+	p->qq = EKF_QQ_INITIAL;
+	p->qwb = EKF_QWB_INITIAL;
+	p->ra = EKF_RA_INITIAL;
+	p->rm = EKF_RM_INITIAL;
+}
+
+static float *EKF_ParametersField(EKF_Parameters *p, const char *name)
+{
+	if (strcmp(name, "EKF_PQ_INITIAL") == 0) return &p->pq;
+	if (strcmp(name, "EKF_PWB_INITIAL") == 0) return &p->pwb;
+	if (strcmp(name, "EKF_QQ_INITIAL") == 0) return &p->qq;
+	if (strcmp(name, "EKF_QWB_INITIAL") == 0) return &p->qwb;
+	if (strcmp(name, "EKF_RA_INITIAL") == 0) return &p->ra;
+	if (strcmp(name, "EKF_RM_INITIAL") == 0) return &p->rm;
+	return 0;
+}
+
+//defaults, then the values of the file. returns 0 if the file cannot be
+//read or has a line that is not a known name and a positive value
+int EKF_ParametersLoad(const char *file, EKF_Parameters *p)
+{
+	char line[128], name[64];
+	float value, *field;
+	int ok = 1;
+	FILE *f = fopen(file, "r");
+
+	EKF_ParametersDefault(p);
+	if (f == NULL){
+		return 0;
+	}
+	while (fgets(line, sizeof(line), f) != NULL){
+		char *c = strchr(line, '#');
+		if (c != NULL){
+			*c = 0;
+		}
+		if (sscanf(line, "%63s", name) != 1){
+			continue;
+		}
+		field = EKF_ParametersField(p, name);
+		if (field == 0 || sscanf(line, "%*s %f", &value) != 1 || !(value > 0.0f)){
+			ok = 0;
+			break;
+		}
+		*field = value;
+	}
+	fclose(f);
+	if (!ok){
+		EKF_ParametersDefault(p);
+	}
+	return ok;
+}
+
+//comment goes on the first line, may be 0. returns 0 on a write error
+int EKF_ParametersSave(const char *file, const EKF_Parameters *p, const char *comment)
+{
+	FILE *f = fopen(file, "w");
+	int ok;
+
+	if (f == NULL){
+		return 0;
+	}
+	if (comment != 0){
+		fprintf(f, "# %s\n", comment);
+	}
+	fprintf(f, "EKF_PQ_INITIAL %.9g\n", p->pq);
+	fprintf(f, "EKF_PWB_INITIAL %.9g\n", p->pwb);
+	fprintf(f, "EKF_QQ_INITIAL %.9g\n", p->qq);
+	fprintf(f, "EKF_QWB_INITIAL %.9g\n", p->qwb);
+	fprintf(f, "EKF_RA_INITIAL %.9g\n", p->ra);
+	fprintf(f, "EKF_RM_INITIAL %.9g\n", p->rm);
+	ok = !ferror(f);
+	return fclose(f) == 0 && ok;
+}
+
+//Q and R of the EKF, and P when called before the first update. with
+//EKF_UD_COVARIANCE the diagonal of P is D, and U is still the identity
+void EKF_AHRSSetParameters(const EKF_Parameters *p)
+{
+	for (unsigned int i = 0; i < EKF_STATE_DIM; i++){
+		for (unsigned int j = 0; j < EKF_STATE_DIM; j++){
+			P(i, j) = i != j ? 0.0f : (i < 4 ? p->pq : p->pwb);
+		}
+		Q(i, i) = i < 4 ? p->qq : p->qwb;
+	}
+	for (unsigned int i = 0; i < EKF_MEASUREMENT_DIM; i++){
+		R(i, i) = i < 3 ? p->ra : p->rm;
+	}
+}
+
+//EKF_ParametersLoad and EKF_AHRSSetParameters, the EKF keeps the defaults
+//if the file cannot be used
+int EKF_AHRSLoadParameters(const char *file)
+{
+	EKF_Parameters p;
+	int ok = EKF_ParametersLoad(file, &p);
+
+	EKF_AHRSSetParameters(&p);
+	return ok;
+}
+
+#endif
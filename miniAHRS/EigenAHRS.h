@@ -0,0 +1,179 @@
+/*
+ * EigenAHRS.h
+ *
+ *  Created on: 18 oct. 2026
+ */
+
+#ifndef EIGENAHRS_H_
+#define EIGENAHRS_H_
+
+//////////////////////////////////////////////////////////////////////////
+//same EKF as miniAHRS.h (q0 q1 q2 q3 wxb wyb wzb, exponential map
+//prediction, accel + mag measurement, Joseph covariance update) written with fixed-size Eigen matrices.
+//every matrix lives inside the object, nothing is allocated after
+//construction: the update path runs with Eigen's malloc check disabled
+//so a debug build asserts if a temporary ever reaches the heap. build with
+//-DEIGEN_NO_MALLOC to extend the check to the whole program.
+//Eigen's vectorization is left enabled, the Eigen include path is the
+//libs/Eigen directory as in the Eclipse projects.
+//////////////////////////////////////////////////////////////////////////
+
+#if defined(EIGEN_CORE_H) && !defined(EIGEN_RUNTIME_NO_MALLOC)
+#error "include EigenAHRS.h before any Eigen header or define EIGEN_RUNTIME_NO_MALLOC"
+#endif
+#ifndef EIGEN_RUNTIME_NO_MALLOC
+#define EIGEN_RUNTIME_NO_MALLOC
+#endif
+#include "Dense"
+
+#include "miniAHRS.h"
+#include "AHRSModel.h"
+#include "IAttitudeFilter.h"
+
+class EigenAHRS : public IAttitudeFilter {
+public:
+	typedef Eigen::Matrix<float, EKF_STATE_DIM, 1> StateVector;
+	typedef Eigen::Matrix<float, EKF_MEASUREMENT_DIM, 1> MeasurementVector;
+	typedef Eigen::Matrix<float, EKF_STATE_DIM, EKF_STATE_DIM> StateMatrix;
+	typedef Eigen::Matrix<float, EKF_MEASUREMENT_DIM, EKF_STATE_DIM> MeasurementMatrix;
+	typedef Eigen::Matrix<float, EKF_STATE_DIM, EKF_MEASUREMENT_DIM> GainMatrix;
+	typedef Eigen::Matrix<float, EKF_MEASUREMENT_DIM, EKF_MEASUREMENT_DIM> InnovationMatrix;
+
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+	EigenAHRS() {
+		x.setZero();
+		x(0) = 1.0f;
+		P.setZero();
+		P.diagonal() << EKF_PQ_INITIAL, EKF_PQ_INITIAL, EKF_PQ_INITIAL, EKF_PQ_INITIAL,
+				EKF_PWB_INITIAL, EKF_PWB_INITIAL, EKF_PWB_INITIAL;
+		Q.setZero();
+		Q.diagonal() << EKF_QQ_INITIAL, EKF_QQ_INITIAL, EKF_QQ_INITIAL, EKF_QQ_INITIAL,
+				EKF_QWB_INITIAL, EKF_QWB_INITIAL, EKF_QWB_INITIAL;
+		R.setZero();
+		R.diagonal() << EKF_RA_INITIAL, EKF_RA_INITIAL, EKF_RA_INITIAL,
+				EKF_RM_INITIAL, EKF_RM_INITIAL, EKF_RM_INITIAL;
+		F.setIdentity();
+		H.setZero();
+	}
+
+	void initialize(float *accel, float *mag) {
+		float q[4];
+
+		AHRSModel_Attitude(accel, mag, q);
+		x(0) = q[0]; x(1) = q[1]; x(2) = q[2]; x(3) = q[3];
+	}
+
+	void update(float *gyro, float *accel, float *mag, float dt) {
+#ifdef EIGEN_RUNTIME_NO_MALLOC
+		Eigen::internal::set_is_malloc_allowed(false);
+#endif
+		float halfdt = 0.5f * dt;
+		float halfdx = halfdt * (gyro[0] - x(4));
+		float halfdy = halfdt * (gyro[1] - x(5));
+		float halfdz = halfdt * (gyro[2] - x(6));
+		float q0 = x(0), q1 = x(1), q2 = x(2), q3 = x(3);
+		float q[4] = {q0, q1, q2, q3};
+		float w[3] = {gyro[0] - x(4), gyro[1] - x(5), gyro[2] - x(6)};
+		float a[3], m[3];
+
+		//state time propagation, the exponential map of EKF_AHRSPredictState
+		Quaternion_IntegrateExp(q, w, dt);
+		x(0) = q[0]; x(1) = q[1]; x(2) = q[2]; x(3) = q[3];
+
+		//populate F jacobian, to first order in dt
+		float halfdtq0 = halfdt * q0, halfdtq1 = halfdt * q1, halfdtq2 = halfdt * q2, halfdtq3 = halfdt * q3;
+		F(0, 1) = -halfdx; F(0, 2) = -halfdy; F(0, 3) = -halfdz; F(0, 4) = halfdtq1; F(0, 5) = halfdtq2; F(0, 6) = halfdtq3;
+		F(1, 0) = halfdx; F(1, 2) = halfdz; F(1, 3) = -halfdy; F(1, 4) = -halfdtq0; F(1, 5) = halfdtq3; F(1, 6) = -halfdtq2;
+		F(2, 0) = halfdy; F(2, 1) = -halfdz; F(2, 3) = halfdx; F(2, 4) = -halfdtq3; F(2, 5) = -halfdtq0; F(2, 6) = halfdtq1;
+		F(3, 0) = halfdz; F(3, 1) = halfdy; F(3, 2) = -halfdx; F(3, 4) = halfdtq2; F(3, 5) = -halfdtq1; F(3, 6) = -halfdtq0;
+
+		//P = F*P*F' + Q * dt / EKF_QDT_NOMINAL;
+		PX.noalias() = F * P;
+		P.noalias() = PX * F.transpose();
+		P.noalias() += (dt / EKF_QDT_NOMINAL) * Q;
+
+		//measurement update, without a valid accel or mag the prediction is kept
+		if (!AHRSModel_Normalize(accel, a) || !AHRSModel_Normalize(mag, m)){
+#ifdef EIGEN_RUNTIME_NO_MALLOC
+			Eigen::internal::set_is_malloc_allowed(true);
+#endif
+			return;
+		}
+		float ax = a[0], ay = a[1], az = a[2];
+		float mx = m[0], my = m[1], mz = m[2];
+
+		float _2q0 = 2.0f * x(0), _2q1 = 2.0f * x(1), _2q2 = 2.0f * x(2), _2q3 = 2.0f * x(3);
+		float q0q0 = x(0) * x(0), q0q1 = x(0) * x(1), q0q2 = x(0) * x(2), q0q3 = x(0) * x(3);
+		float q1q1 = x(1) * x(1), q1q2 = x(1) * x(2), q1q3 = x(1) * x(3);
+		float q2q2 = x(2) * x(2), q2q3 = x(2) * x(3);
+		float q3q3 = x(3) * x(3);
+		float _2mx = 2.0f * mx, _2my = 2.0f * my, _2mz = 2.0f * mz;
+
+		//reference field
+		float hx = _2mx * (0.5f - q2q2 - q3q3) + _2my * (q1q2 - q0q3) + _2mz * (q1q3 + q0q2);
+		float hy = _2mx * (q1q2 + q0q3) + _2my * (0.5f - q1q1 - q3q3) + _2mz * (q2q3 - q0q1);
+		float hz = _2mx * (q1q3 - q0q2) + _2my * (q2q3 + q0q1) + _2mz * (0.5f - q1q1 - q2q2);
+		float bx = FastSqrt(hx * hx + hy * hy);
+		float bz = hz;
+
+		y(0) = ax + 2.0f * (q1q3 - q0q2);
+		y(1) = ay + 2.0f * (q2q3 + q0q1);
+		y(2) = az - (1.0f - 2.0f * (q0q0 + q3q3));
+		y(3) = mx - (bx * (1.0f - 2.0f * (q2q2 + q3q3)) + bz * (2.0f * (q1q3 - q0q2)));
+		y(4) = my - (bx * (2.0f * (q1q2 - q0q3)) + bz * (2.0f * (q2q3 + q0q1)));
+		y(5) = mz - (bx * (2.0f * (q1q3 + q0q2)) + bz * (1.0f - 2.0f * (q1q1 + q2q2)));
+
+		//populate H jacobian
+		H(0, 0) = _2q2; H(0, 1) = -_2q3; H(0, 2) = _2q0; H(0, 3) = -_2q1;
+		H(1, 0) = -_2q1; H(1, 1) = -_2q0; H(1, 2) = -_2q3; H(1, 3) = -_2q2;
+		H(2, 0) = -_2q0; H(2, 1) = _2q1; H(2, 2) = _2q2; H(2, 3) = -_2q3;
+		H(3, 0) = bx * _2q0 - bz * _2q2; H(3, 1) = bx * _2q1 + bz * _2q3; H(3, 2) = -bx * _2q2 - bz * _2q0; H(3, 3) = bz * _2q1 - bx * _2q3;
+		H(4, 0) = bz * _2q1 - bx * _2q3; H(4, 1) = bx * _2q2 + bz * _2q0; H(4, 2) = bx * _2q1 + bz * _2q3; H(4, 3) = bz * _2q2 - bx * _2q0;
+		H(5, 0) = bx * _2q2 + bz * _2q0; H(5, 1) = bx * _2q3 - bz * _2q1; H(5, 2) = bx * _2q0 - bz * _2q2; H(5, 3) = bx * _2q1 + bz * _2q3;
+
+		//K = P * H' / (R + H * P * H'), S is symmetric positive definite
+		PXY.noalias() = P * H.transpose();
+		S.noalias() = H * PXY;
+		S += R;
+		llt.compute(S);
+		KT.noalias() = llt.solve(PXY.transpose());
+		K = KT.transpose();
+
+		//X = X + K * Y;
+		x.noalias() += K * y;
+		x.head<4>() *= FastSqrtI(x.head<4>().squaredNorm());
+
+		//P=(I - K*H)*P*(I - K*H)' + K*R*K'
+		IKH.setIdentity();
+		IKH.noalias() -= K * H;
+		PX.noalias() = IKH * P;
+		P.noalias() = PX * IKH.transpose();
+		PXY.noalias() = K * R;
+		P.noalias() += PXY * K.transpose();
+#ifdef EIGEN_RUNTIME_NO_MALLOC
+		Eigen::internal::set_is_malloc_allowed(true);
+#endif
+	}
+
+	void getQuaternion(float *q) {
+		q[0] = x(0); q[1] = x(1); q[2] = x(2); q[3] = x(3);
+	}
+
+	void getAngles(float *rpy) {
+		float q[4] = {x(0), x(1), x(2), x(3)};
+		AHRSModel_Angles(q, rpy);
+	}
+
+private:
+	StateVector x;
+	MeasurementVector y;
+	StateMatrix P, Q, F, PX, IKH;
+	InnovationMatrix R, S;
+	MeasurementMatrix H;
+	GainMatrix PXY, K;
+	Eigen::Matrix<float, EKF_MEASUREMENT_DIM, EKF_STATE_DIM> KT;
+	Eigen::LLT<InnovationMatrix> llt;
+};
+
+#endif
@@ -0,0 +1,227 @@
+/*
+ * ErrorStateAHRS.h
+ *
+ *  Created on: 18 oct. 2026
+ */
+
+#ifndef ERRORSTATEAHRS_H_
+#define ERRORSTATEAHRS_H_
+
+#include "miniAHRS.h"
+#include "AHRSModel.h"
+#include "IAttitudeFilter.h"
+
+//////////////////////////////////////////////////////////////////////////
+//error-state (multiplicative) EKF with the sensor models of miniAHRS.h.
+//the attitude is a nominal unit quaternion q (body to navigation frame)
+//and the filter estimates the error x = [dtheta, dbias], where the true
+//attitude is q * [1, dtheta / 2]. after every update the error is folded
+//into q and the bias and reset to zero, so the quaternion never leaves the
+//unit sphere and the 6x6 covariance has full rank, unlike the 7x7 one of
+//the quaternion state.
+//
+//a measured body vector u = C' * v moves with the error as
+//u(dtheta) = u + [u]x * dtheta, so each sensor block of H is [u]x and the
+//bias columns are zero.
+//////////////////////////////////////////////////////////////////////////
+
+#define ESKF_STATE_DIM 6 //dthetax dthetay dthetaz dwxb dwyb dwzb
+
+//all parameters below need to be tune
+#define ESKF_PTHETA_INITIAL 0.01f //rad^2
+#define ESKF_PBIAS_INITIAL 0.0001f //(rad/s)^2
+
+#define ESKF_QTHETA 0.0001f //rad^2/s, gyro angle random walk
+#define ESKF_QBIAS 0.00000001f //(rad/s)^2/s, bias random walk
+
+#define ESKF_RA EKF_RA_INITIAL
+#define ESKF_RM EKF_RM_INITIAL
+
+class ErrorStateAHRS : public IAttitudeFilter {
+public:
+	ErrorStateAHRS() {
+		q[0] = 1.0f; q[1] = 0.0f; q[2] = 0.0f; q[3] = 0.0f;
+		bias[0] = 0.0f; bias[1] = 0.0f; bias[2] = 0.0f;
+		Mat_Identity(I);
+		Mat_Zero(P);
+		for (unsigned int i = 0; i < 3; i++){
+			P(i, i) = ESKF_PTHETA_INITIAL;
+			P(i + 3, i + 3) = ESKF_PBIAS_INITIAL;
+		}
+		Mat_Identity(F);
+		Mat_Zero(H3);
+	}
+
+	//attitude from one accel and mag sample. the accel is expected as in the
+	//measurement model, -C' * [0 0 1]
+	void initialize(float *accel, float *mag) {
+		AHRSModel_Attitude(accel, mag, q);
+	}
+
+	void predict(float *gyro, float dt) {
+		float w[3], half[3], t[4], norm;
+		float qt = ESKF_QTHETA * dt, qb = ESKF_QBIAS * dt;
+
+		w[0] = (gyro[0] - bias[0]) * dt;
+		w[1] = (gyro[1] - bias[1]) * dt;
+		w[2] = (gyro[2] - bias[2]) * dt;
+		half[0] = 0.5f * w[0]; half[1] = 0.5f * w[1]; half[2] = 0.5f * w[2];
+
+		//nominal state, q = q * [1, w / 2]
+		t[0] = q[0] - half[0] * q[1] - half[1] * q[2] - half[2] * q[3];
+		t[1] = q[1] + half[0] * q[0] - half[1] * q[3] + half[2] * q[2];
+		t[2] = q[2] + half[0] * q[3] + half[1] * q[0] - half[2] * q[1];
+		t[3] = q[3] - half[0] * q[2] + half[1] * q[1] + half[2] * q[0];
+		norm = FastSqrtI(t[0] * t[0] + t[1] * t[1] + t[2] * t[2] + t[3] * t[3]);
+		q[0] = t[0] * norm; q[1] = t[1] * norm; q[2] = t[2] * norm; q[3] = t[3] * norm;
+
+		//error propagation, F = [I - [w]x, -I * dt; 0, I]
+		F(0, 1) = w[2]; F(0, 2) = -w[1]; F(0, 3) = -dt;
+		F(1, 0) = -w[2]; F(1, 2) = w[0]; F(1, 4) = -dt;
+		F(2, 0) = w[1]; F(2, 1) = -w[0]; F(2, 5) = -dt;
+
+		//P = F*P*F' + Q * dt;
+		Mat_Multiply(F, P, PX);
+		Mat_MultiplyTransB(PX, F, P);
+		P(0, 0) += qt; P(1, 1) += qt; P(2, 2) += qt;
+		P(3, 3) += qb; P(4, 4) += qb; P(5, 5) += qb;
+	}
+
+	//without a valid accel the prediction is kept
+	void updateAccel(float *accel) {
+		float a[3], u[3];
+
+		if (!AHRSModel_Normalize(accel, a)){
+			return;
+		}
+		gravity(u);
+		Y3[0] = a[0] - u[0]; Y3[1] = a[1] - u[1]; Y3[2] = a[2] - u[2];
+		setSkew(H3.m, 6, u);
+		updateBlock(ESKF_RA);
+	}
+
+	//without a valid mag the heading follows the gyro
+	void updateMag(float *mag) {
+		float m[3], u[3];
+
+		if (!AHRSModel_Normalize(mag, m)){
+			return;
+		}
+		magnetic(m, u);
+		Y3[0] = m[0] - u[0]; Y3[1] = m[1] - u[1]; Y3[2] = m[2] - u[2];
+		setSkew(H3.m, 6, u);
+		updateBlock(ESKF_RM);
+	}
+
+	//same call as EKF_AHRSUpdate. R is block diagonal, so the accel and mag
+	//blocks are processed one after the other: two 3x3 inverses instead of
+	//a 6x6 one, and the mag block is linearized at the corrected attitude
+	void update(float *gyro, float *accel, float *mag, float dt) {
+		predict(gyro, dt);
+		updateAccel(accel);
+		updateMag(mag);
+	}
+
+	void getQuaternion(float *Q) {
+		Q[0] = q[0]; Q[1] = q[1]; Q[2] = q[2]; Q[3] = q[3];
+	}
+
+	void getBias(float *b) {
+		b[0] = bias[0]; b[1] = bias[1]; b[2] = bias[2];
+	}
+
+	void getAngles(float *rpy) {
+		AHRSModel_Angles(q, rpy);
+	}
+
+	const Mat<ESKF_STATE_DIM, ESKF_STATE_DIM> &getCovariance() const {
+		return P;
+	}
+
+private:
+	//rows of H for a body vector u: [u]x in the attitude columns
+	static void setSkew(float *h, unsigned int stride, const float *u) {
+		h[0] = 0.0f; h[1] = -u[2]; h[2] = u[1];
+		h[stride] = u[2]; h[stride + 1] = 0.0f; h[stride + 2] = -u[0];
+		h[2 * stride] = -u[1]; h[2 * stride + 1] = u[0]; h[2 * stride + 2] = 0.0f;
+	}
+
+	//expected accel, -C' * [0 0 1]
+	void gravity(float *u) {
+		u[0] = -2.0f * (q[1] * q[3] - q[0] * q[2]);
+		u[1] = -2.0f * (q[2] * q[3] + q[0] * q[1]);
+		u[2] = 1.0f - 2.0f * (q[0] * q[0] + q[3] * q[3]);
+	}
+
+	//expected mag, C' * [bx 0 bz] with the reference field taken from the
+	//measurement as in EKF_AHRSUpdate
+	void magnetic(float *mag, float *u) {
+		float q0q1 = q[0] * q[1], q0q2 = q[0] * q[2], q0q3 = q[0] * q[3];
+		float q1q1 = q[1] * q[1], q1q2 = q[1] * q[2], q1q3 = q[1] * q[3];
+		float q2q2 = q[2] * q[2], q2q3 = q[2] * q[3];
+		float q3q3 = q[3] * q[3];
+		float _2mx = 2.0f * mag[0], _2my = 2.0f * mag[1], _2mz = 2.0f * mag[2];
+		float hx = _2mx * (0.5f - q2q2 - q3q3) + _2my * (q1q2 - q0q3) + _2mz * (q1q3 + q0q2);
+		float hy = _2mx * (q1q2 + q0q3) + _2my * (0.5f - q1q1 - q3q3) + _2mz * (q2q3 - q0q1);
+		float hz = _2mx * (q1q3 - q0q2) + _2my * (q2q3 + q0q1) + _2mz * (0.5f - q1q1 - q2q2);
+		float bx = FastSqrt(hx * hx + hy * hy);
+		float bz = hz;
+
+		u[0] = bx * (1.0f - 2.0f * (q2q2 + q3q3)) + bz * (2.0f * (q1q3 - q0q2));
+		u[1] = bx * (2.0f * (q1q2 - q0q3)) + bz * (2.0f * (q2q3 + q0q1));
+		u[2] = bx * (2.0f * (q1q3 + q0q2)) + bz * (1.0f - 2.0f * (q1q1 + q2q2));
+	}
+
+	//measurement update with H3, Y3 and R = r * I
+	void updateBlock(float r) {
+		Mat<3, 3> SI;
+
+		Mat_MultiplyTransB(P, H3, PXY3);
+		Mat_Multiply(H3, PXY3, S3);
+		S3[0] += r; S3[4] += r; S3[8] += r;
+		Mat_Inverse(S3, SI);
+		Mat_Multiply(PXY3, SI, K3);
+		Mat_Multiply(K3, Y3, DX);
+
+		//P=(I - K*H)*P*(I - K*H)' + r*K*K'
+		Mat_Multiply(K3, H3, PX);
+		Mat_Sub(I, PX, PX);
+		Mat_Multiply(PX, P, PXX);
+		Mat_MultiplyTransB(PXX, PX, P);
+		Mat_MultiplyTransB(K3, K3, PX);
+		Mat_Scale(PX, r, PX);
+		Mat_Add(P, PX, P);
+
+		inject();
+	}
+
+	//fold the error into the nominal state, the error is then zero again.
+	//the reset jacobian I - [dtheta / 2]x is taken as identity
+	void inject() {
+		float t[4], norm;
+		float hx = 0.5f * DX[0], hy = 0.5f * DX[1], hz = 0.5f * DX[2];
+
+		t[0] = q[0] - hx * q[1] - hy * q[2] - hz * q[3];
+		t[1] = q[1] + hx * q[0] - hy * q[3] + hz * q[2];
+		t[2] = q[2] + hx * q[3] + hy * q[0] - hz * q[1];
+		t[3] = q[3] - hx * q[2] + hy * q[1] + hz * q[0];
+		norm = FastSqrtI(t[0] * t[0] + t[1] * t[1] + t[2] * t[2] + t[3] * t[3]);
+		q[0] = t[0] * norm; q[1] = t[1] * norm; q[2] = t[2] * norm; q[3] = t[3] * norm;
+
+		bias[0] += DX[3];
+		bias[1] += DX[4];
+		bias[2] += DX[5];
+	}
+
+	float q[4];
+	float bias[3];
+	Mat<ESKF_STATE_DIM, ESKF_STATE_DIM> I, P, F, PX, PXX;
+	Mat<ESKF_STATE_DIM, 1> DX;
+	//single sensor update
+	Mat<3, ESKF_STATE_DIM> H3;
+	Mat<3, 1> Y3;
+	Mat<3, 3> S3;
+	Mat<ESKF_STATE_DIM, 3> PXY3, K3;
+};
+
+#endif
@@ -0,0 +1,268 @@
+/*
+ * FixedMatrix.h
+ *
+ *  Created on: 18 oct. 2026
+ */
+
+#ifndef _FIXEDMATRIX_H_
+#define _FIXEDMATRIX_H_
+
+#include "FastMath.h"
+
+//////////////////////////////////////////////////////////////////////////
+//fixed-size counterparts of the miniMatrix.h routines.
+//the dimensions are template parameters, so every loop has a constant trip
+//count and the compiler can unroll or vectorize it for the shapes the EKF
+//really uses (7x7, 7x6, 6x7, 6x6) instead of walking runtime counters.
+//the products write into a destination that must not alias the sources,
+//the element-wise routines (add, sub, scale) may work in place.
+//////////////////////////////////////////////////////////////////////////
+
+//the EKF shapes are small enough to be fully unrolled even at -O2
+#if defined(__GNUC__) && !defined(__clang__)
+#define MAT_UNROLL _Pragma("GCC unroll 8")
+#elif defined(__clang__)
+#define MAT_UNROLL _Pragma("unroll")
+#else
+#define MAT_UNROLL
+#endif
+
+//row-major storage, same layout as the float arrays used by miniMatrix.h
+template <unsigned short R, unsigned short C>
+struct Mat
+{
+	enum { Rows = R, Cols = C, Size = R * C };
+
+	float m[R * C];
+
+	float &operator[](unsigned int i) { return m[i]; }
+	const float &operator[](unsigned int i) const { return m[i]; }
+
+	float &operator()(unsigned int r, unsigned int c) { return m[r * C + c]; }
+	const float &operator()(unsigned int r, unsigned int c) const { return m[r * C + c]; }
+};
+
+//////////////////////////////////////////////////////////////////////////
+//
+
+template <unsigned short R, unsigned short C>
+void Mat_Zero(Mat<R, C> &A)
+{
+	for (unsigned int i = 0; i < R * C; i++){
+		A.m[i] = 0.0f;
+	}
+}
+
+template <unsigned short N>
+void Mat_Identity(Mat<N, N> &A)
+{
+	for (unsigned int i = 0; i < N * N; i++){
+		A.m[i] = 0.0f;
+	}
+	for (unsigned int i = 0; i < N; i++){
+		A.m[i * N + i] = 1.0f;
+	}
+}
+
+template <unsigned short R, unsigned short C>
+void Mat_Copy(const Mat<R, C> &Src, Mat<R, C> &Dst)
+{
+	for (unsigned int i = 0; i < R * C; i++){
+		Dst.m[i] = Src.m[i];
+	}
+}
+
+//C = A + B
+template <unsigned short R, unsigned short C>
+void Mat_Add(const Mat<R, C> &A, const Mat<R, C> &B, Mat<R, C> &Dst)
+{
+	for (unsigned int i = 0; i < R * C; i++){
+		Dst.m[i] = A.m[i] + B.m[i];
+	}
+}
+
+//C = A - B
+template <unsigned short R, unsigned short C>
+void Mat_Sub(const Mat<R, C> &A, const Mat<R, C> &B, Mat<R, C> &Dst)
+{
+	for (unsigned int i = 0; i < R * C; i++){
+		Dst.m[i] = A.m[i] - B.m[i];
+	}
+}
+
+//C = A * s
+template <unsigned short R, unsigned short C>
+void Mat_Scale(const Mat<R, C> &A, float s, Mat<R, C> &Dst)
+{
+	for (unsigned int i = 0; i < R * C; i++){
+		Dst.m[i] = A.m[i] * s;
+	}
+}
+
+//B = A'
+template <unsigned short R, unsigned short C>
+void Mat_Transpose(const Mat<R, C> &A, Mat<C, R> &Dst)
+{
+	for (unsigned int i = 0; i < R; i++){
+		for (unsigned int j = 0; j < C; j++){
+			Dst.m[j * R + i] = A.m[i * C + j];
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+//C = A * B, portable reference kernel
+//a row of C is accumulated as a linear combination of the rows of B, so the
+//inner loop runs over contiguous memory and every element still sums its
+//products in k order, exactly like the dot product of Matrix_Multiply.
+template <unsigned short R, unsigned short K, unsigned short C>
+void Mat_MultiplyScalar(const Mat<R, K> &A, const Mat<K, C> &B, Mat<R, C> &Dst)
+{
+	const float *__restrict pA = A.m;
+	const float *__restrict pB = B.m;
+	float *__restrict pD = Dst.m;
+
+	for (unsigned int i = 0; i < R; i++){
+		float row[C];
+		MAT_UNROLL
+		for (unsigned int j = 0; j < C; j++){
+			row[j] = 0.0f;
+		}
+		MAT_UNROLL
+		for (unsigned int k = 0; k < K; k++){
+			const float a = pA[i * K + k];
+			MAT_UNROLL
+			for (unsigned int j = 0; j < C; j++){
+				row[j] += a * pB[k * C + j];
+			}
+		}
+		MAT_UNROLL
+		for (unsigned int j = 0; j < C; j++){
+			pD[i * C + j] = row[j];
+		}
+	}
+}
+
+//C = A * B', portable reference kernel
+template <unsigned short R, unsigned short K, unsigned short C>
+void Mat_MultiplyTransBScalar(const Mat<R, K> &A, const Mat<C, K> &B, Mat<R, C> &Dst)
+{
+	const float *__restrict pA = A.m;
+	const float *__restrict pB = B.m;
+	float *__restrict pD = Dst.m;
+
+	for (unsigned int i = 0; i < R; i++){
+		for (unsigned int j = 0; j < C; j++){
+			float sum = 0.0f;
+			MAT_UNROLL
+			for (unsigned int k = 0; k < K; k++){
+				sum += pA[i * K + k] * pB[j * K + k];
+			}
+			pD[i * C + j] = sum;
+		}
+	}
+}
+
+//C = A * B
+//FixedMatrixSimd.h specializes the hot EKF shapes with vector kernels
+template <unsigned short R, unsigned short K, unsigned short C>
+void Mat_Multiply(const Mat<R, K> &A, const Mat<K, C> &B, Mat<R, C> &Dst)
+{
+	Mat_MultiplyScalar(A, B, Dst);
+}
+
+//C = A * B'
+template <unsigned short R, unsigned short K, unsigned short C>
+void Mat_MultiplyTransB(const Mat<R, K> &A, const Mat<C, K> &B, Mat<R, C> &Dst)
+{
+	Mat_MultiplyTransBScalar(A, B, Dst);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//Gauss-Jordan elimination with partial pivoting.
+//unlike Matrix_Inverse the source is left untouched.
+//return 0 on success and -1 if the matrix is singular
+template <unsigned short N>
+int Mat_Inverse(const Mat<N, N> &Src, Mat<N, N> &Dst)
+{
+	float A[N * N];
+	float *pD = Dst.m;
+
+	for (unsigned int i = 0; i < N * N; i++){
+		A[i] = Src.m[i];
+	}
+	Mat_Identity(Dst);
+
+	for (unsigned int l = 0; l < N; l++){
+		//grab the most significant value from column l
+		unsigned int p = l;
+		float maxC = FastAbs(A[l * N + l]);
+		for (unsigned int i = l + 1; i < N; i++){
+			float v = FastAbs(A[i * N + l]);
+			if (v > maxC){
+				maxC = v;
+				p = i;
+			}
+		}
+		if (maxC == 0.0f){
+			return -1;
+		}
+		//exchange the pivot row
+		if (p != l){
+			for (unsigned int j = 0; j < N; j++){
+				float t = A[l * N + j]; A[l * N + j] = A[p * N + j]; A[p * N + j] = t;
+				t = pD[l * N + j]; pD[l * N + j] = pD[p * N + j]; pD[p * N + j] = t;
+			}
+		}
+		//normalize the pivot row
+		float in = 1.0f / A[l * N + l];
+		MAT_UNROLL
+		for (unsigned int j = 0; j < N; j++){
+			A[l * N + j] *= in;
+			pD[l * N + j] *= in;
+		}
+		//clear column l in every other row
+		for (unsigned int i = 0; i < N; i++){
+			if (i == l){
+				continue;
+			}
+			float f = A[i * N + l];
+			MAT_UNROLL
+			for (unsigned int j = 0; j < N; j++){
+				A[i * N + j] -= f * A[l * N + j];
+				pD[i * N + j] -= f * pD[l * N + j];
+			}
+		}
+	}
+	return 0;
+}
+
+//3x3 inverse from the adjugate, used by the per-sensor EKF updates
+template <>
+inline int Mat_Inverse<3>(const Mat<3, 3> &Src, Mat<3, 3> &Dst)
+{
+	const float *a = Src.m;
+	float c0 = a[4] * a[8] - a[5] * a[7];
+	float c1 = a[5] * a[6] - a[3] * a[8];
+	float c2 = a[3] * a[7] - a[4] * a[6];
+	float det = a[0] * c0 + a[1] * c1 + a[2] * c2;
+
+	if (det == 0.0f){
+		return -1;
+	}
+	det = 1.0f / det;
+	Dst.m[0] = c0 * det;
+	Dst.m[1] = (a[2] * a[7] - a[1] * a[8]) * det;
+	Dst.m[2] = (a[1] * a[5] - a[2] * a[4]) * det;
+	Dst.m[3] = c1 * det;
+	Dst.m[4] = (a[0] * a[8] - a[2] * a[6]) * det;
+	Dst.m[5] = (a[2] * a[3] - a[0] * a[5]) * det;
+	Dst.m[6] = c2 * det;
+	Dst.m[7] = (a[1] * a[6] - a[0] * a[7]) * det;
+	Dst.m[8] = (a[0] * a[4] - a[1] * a[3]) * det;
+	return 0;
+}
+
+#include "FixedMatrixSimd.h"
+
+#endif
@@ -0,0 +1,147 @@
+/*
+ * FixedMatrixSimd.h
+ *
+ *  Created on: 18 oct. 2026
+ */
+
+#ifndef _FIXEDMATRIXSIMD_H_
+#define _FIXEDMATRIXSIMD_H_
+
+//////////////////////////////////////////////////////////////////////////
+//vector kernels for the products of EKF_AHRSUpdate:
+//  F * P (7x7 * 7x7), P * H' (7x7 * (6x7)'), H * PXY (6x7 * 7x6),
+//  PXY * SI (7x6 * 6x6) and the Joseph form products,
+//and for the 6x6 products of ErrorStateAHRS.h.
+//the instruction set is selected at compile time (AVX, SSE, NEON) and
+//every other shape, or a build with MAT_NO_SIMD, uses the scalar kernels.
+//
+//each output row is accumulated as sum_k A(i,k) * B(k,:) like the scalar
+//kernel, so the results match it bit for bit as long as both sides make the
+//same multiply-add contraction choice. the 6 and 7 column rows are covered
+//with two overlapping 4-lane windows (SSE/NEON) or one masked 8-lane
+//window (AVX); the overlapped column is computed twice with identical math.
+//////////////////////////////////////////////////////////////////////////
+
+#if !defined(MAT_NO_SIMD)
+#if defined(__AVX__)
+#define MAT_SIMD_AVX
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64)
+#define MAT_SIMD_SSE
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define MAT_SIMD_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+#if defined(MAT_SIMD_AVX) || defined(MAT_SIMD_SSE) || defined(MAT_SIMD_NEON)
+#define MAT_SIMD
+
+#if defined(MAT_SIMD_AVX)
+#define MAT_SIMD_NAME "AVX"
+#elif defined(MAT_SIMD_SSE)
+#define MAT_SIMD_NAME "SSE"
+#else
+#define MAT_SIMD_NAME "NEON"
+#endif
+
+//D(RxC) = A(RxK) * B(KxC) for C = 6 or 7
+template <unsigned short R, unsigned short K, unsigned short C>
+inline void Mat_MultiplyRowsSimd(const float *__restrict pA, const float *__restrict pB, float *__restrict pD)
+{
+#if defined(MAT_SIMD_AVX)
+	const __m256i mask = _mm256_setr_epi32(-1, -1, -1, -1, -1, -1, C > 6 ? -1 : 0, 0);
+	for (unsigned int i = 0; i < R; i++){
+		__m256 acc = _mm256_setzero_ps();
+		MAT_UNROLL
+		for (unsigned int k = 0; k < K; k++){
+			__m256 a = _mm256_set1_ps(pA[i * K + k]);
+			__m256 b = _mm256_maskload_ps(pB + k * C, mask);
+#if defined(__FMA__)
+			acc = _mm256_fmadd_ps(a, b, acc);
+#else
+			acc = _mm256_add_ps(acc, _mm256_mul_ps(a, b));
+#endif
+		}
+		_mm256_maskstore_ps(pD + i * C, mask, acc);
+	}
+#elif defined(MAT_SIMD_SSE)
+	for (unsigned int i = 0; i < R; i++){
+		__m128 acc0 = _mm_setzero_ps();
+		__m128 acc1 = _mm_setzero_ps();
+		MAT_UNROLL
+		for (unsigned int k = 0; k < K; k++){
+			__m128 a = _mm_set1_ps(pA[i * K + k]);
+#if defined(__FMA__)
+			acc0 = _mm_fmadd_ps(a, _mm_loadu_ps(pB + k * C), acc0);
+			acc1 = _mm_fmadd_ps(a, _mm_loadu_ps(pB + k * C + (C - 4)), acc1);
+#else
+			acc0 = _mm_add_ps(acc0, _mm_mul_ps(a, _mm_loadu_ps(pB + k * C)));
+			acc1 = _mm_add_ps(acc1, _mm_mul_ps(a, _mm_loadu_ps(pB + k * C + (C - 4))));
+#endif
+		}
+		_mm_storeu_ps(pD + i * C, acc0);
+		_mm_storeu_ps(pD + i * C + (C - 4), acc1);
+	}
+#else
+	for (unsigned int i = 0; i < R; i++){
+		float32x4_t acc0 = vdupq_n_f32(0.0f);
+		float32x4_t acc1 = vdupq_n_f32(0.0f);
+		MAT_UNROLL
+		for (unsigned int k = 0; k < K; k++){
+			float32x4_t a = vdupq_n_f32(pA[i * K + k]);
+#if defined(__aarch64__)
+			acc0 = vfmaq_f32(acc0, a, vld1q_f32(pB + k * C));
+			acc1 = vfmaq_f32(acc1, a, vld1q_f32(pB + k * C + (C - 4)));
+#else
+			acc0 = vaddq_f32(acc0, vmulq_f32(a, vld1q_f32(pB + k * C)));
+			acc1 = vaddq_f32(acc1, vmulq_f32(a, vld1q_f32(pB + k * C + (C - 4))));
+#endif
+		}
+		vst1q_f32(pD + i * C, acc0);
+		vst1q_f32(pD + i * C + (C - 4), acc1);
+	}
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////
+//A * B
+
+#define MAT_SIMD_MULTIPLY(R, K, C) \
+template <> \
+inline void Mat_Multiply<R, K, C>(const Mat<R, K> &A, const Mat<K, C> &B, Mat<R, C> &Dst) \
+{ \
+	Mat_MultiplyRowsSimd<R, K, C>(A.m, B.m, Dst.m); \
+}
+
+MAT_SIMD_MULTIPLY(7, 7, 7) //F * P, (I - K * H) * P
+MAT_SIMD_MULTIPLY(6, 7, 6) //H * PXY
+MAT_SIMD_MULTIPLY(7, 6, 6) //PXY * SI, K * R
+MAT_SIMD_MULTIPLY(7, 6, 7) //K * H
+MAT_SIMD_MULTIPLY(6, 6, 6) //error state: F * P, (I - K * H) * P, PXY * SI
+MAT_SIMD_MULTIPLY(6, 3, 6) //error state: K * H, single sensor
+
+//////////////////////////////////////////////////////////////////////////
+//A * B'
+//B is transposed into a local first, the column sums keep their k order
+
+#define MAT_SIMD_MULTIPLY_TRANSB(R, K, C) \
+template <> \
+inline void Mat_MultiplyTransB<R, K, C>(const Mat<R, K> &A, const Mat<C, K> &B, Mat<R, C> &Dst) \
+{ \
+	Mat<K, C> BT; \
+	Mat_Transpose(B, BT); \
+	Mat_MultiplyRowsSimd<R, K, C>(A.m, BT.m, Dst.m); \
+}
+
+MAT_SIMD_MULTIPLY_TRANSB(7, 7, 6) //P * H'
+MAT_SIMD_MULTIPLY_TRANSB(7, 7, 7) //PX * F', PXX * (I - K * H)'
+MAT_SIMD_MULTIPLY_TRANSB(7, 6, 7) //(K * R) * K'
+MAT_SIMD_MULTIPLY_TRANSB(6, 6, 6) //error state: PX * F', P * H', (K * R) * K'
+
+#else
+#define MAT_SIMD_NAME "scalar"
+#endif
+
+#endif
@@ -0,0 +1,651 @@
+/*
+ * FixedPointAHRS.h
+ *
+ *  Created on: 18 oct. 2026
+ */
+
+#ifndef FIXEDPOINTAHRS_H_
+#define FIXEDPOINTAHRS_H_
+
+#include <stdint.h>
+
+#include "ImuLog.h"
+
+//////////////////////////////////////////////////////////////////////////
+//integer only attitude engine for cores without an FPU (or with a slow
+//one), where every float op of EKF_AHRSUpdate is a library call. it is the
+//6-state error-state EKF of ErrorStateAHRS.h, same sensor models and same
+//defaults, in 32-bit fixed point with 64-bit products (one SMULL on
+//ARMv7-M):
+//
+//  quaternion, unit vectors, rotation   Q2.30 (1.0 = 1 << 30)
+//  covariance, error state              Q2.30, the bias states scaled by
+//                                       2^FIXED_BIAS_SHIFT
+//  gain                                 Q4.28
+//  gyro bias                            Q2.30 rad/s
+//  body rate                            Q8.24 rad/s
+//  angles                               Q4.28 rad
+//
+//the filter reads the raw int16_t counts of the sensors and a calibration
+//of integers (FixedCalibration), no float is converted or computed on the
+//update path. the only float code is FixedCalibration_FromLog, run once to
+//turn the float calibration of an ImuLogHeader into integers.
+//
+//accel and mag are processed one row at a time (R is diagonal), so the
+//update needs one reciprocal per row instead of a 3x3 inverse, and the
+//reciprocal and the inverse square roots are Newton iterations from a
+//linear guess: no division at all. sums and the covariance saturate
+//instead of wrapping, and the variances are kept positive.
+//////////////////////////////////////////////////////////////////////////
+
+#define FIXED_SHIFT 30
+#define FIXED_ONE (1 << FIXED_SHIFT)
+#define FIXED_ANGLE_SHIFT 28
+#define FIXED_RATE_SHIFT 24
+#define FIXED_GAIN_SHIFT 28
+
+//constant to Q2.30 and Q4.28, folded by the compiler
+#define FIXED_Q30(x) ((int32_t)((x) * 1073741824.0 + ((x) < 0 ? -0.5 : 0.5)))
+#define FIXED_Q28(x) ((int32_t)((x) * 268435456.0 + ((x) < 0 ? -0.5 : 0.5)))
+
+#define FIXED_PI FIXED_Q28(3.14159265358979)
+#define FIXED_PI_2 FIXED_Q28(1.57079632679490)
+#define FIXED_2_PI FIXED_Q28(6.28318530717959)
+
+//////////////////////////////////////////////////////////////////////////
+//saturating Q2.30 arithmetic
+
+static inline int32_t FixedSat(int64_t x)
+{
+	return x > INT32_MAX ? INT32_MAX : (x < INT32_MIN ? INT32_MIN : (int32_t)x);
+}
+
+static inline int32_t FixedAdd(int32_t a, int32_t b)
+{
+	return FixedSat((int64_t)a + b);
+}
+
+static inline int32_t FixedSub(int32_t a, int32_t b)
+{
+	return FixedSat((int64_t)a - b);
+}
+
+//a * b, rounded
+static inline int32_t FixedMul(int32_t a, int32_t b)
+{
+	return FixedSat(((int64_t)a * b + (1 << (FIXED_SHIFT - 1))) >> FIXED_SHIFT);
+}
+
+//sum of products in Q4.60 back to Q2.30
+static inline int32_t FixedRound(int64_t acc)
+{
+	return FixedSat((acc + (1 << (FIXED_SHIFT - 1))) >> FIXED_SHIFT);
+}
+
+//leading zeros of x > 0, the CLZ instruction on ARMv5 and up
+static inline int FixedClz(uint32_t x)
+{
+	return __builtin_clz(x);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//square root, reciprocal and atan
+
+//1 / sqrt(x) of a Q2.30 x in [0.25, 4). x is brought to m in [1, 4) by an
+//even shift, three Newton steps from a linear guess on [1, 2) or [2, 4)
+//(4% off) give ~1e-9
+int32_t FixedRsqrt(uint32_t x)
+{
+	int s = FixedClz(x) & ~1;
+	uint32_t m = x << s;
+	int64_t y, t;
+
+	if (m < (2u << FIXED_SHIFT)){
+		y = FIXED_Q30(1.3) - (((int64_t)m * FIXED_Q30(0.3)) >> FIXED_SHIFT);
+	}
+	else{
+		y = FIXED_Q30(0.92) - (((int64_t)m * FIXED_Q30(0.107)) >> FIXED_SHIFT);
+	}
+	for (int i = 0; i < 3; i++){
+		t = (y * y) >> FIXED_SHIFT;
+		t = ((int64_t)m * t) >> FIXED_SHIFT;
+		y = (y * ((3LL << FIXED_SHIFT) - t)) >> (FIXED_SHIFT + 1);
+	}
+	return FixedSat(y << (s >> 1));
+}
+
+//sqrt of a Q2.30 value, m * FixedRsqrt(m) with x brought to m in [1, 4)
+//by an even shift, half of which is undone at the end
+int32_t FixedSqrt(int32_t x)
+{
+	int s;
+	uint32_t m;
+
+	if (x <= 0){
+		return 0;
+	}
+	s = FixedClz((uint32_t)x) & ~1;
+	m = (uint32_t)x << s;
+	return (int32_t)((((int64_t)m * FixedRsqrt(m)) >> FIXED_SHIFT) >> (s >> 1));
+}
+
+//reciprocal of a Q2.30 x > 0 as y and shift, a / x = (a * y) >> shift.
+//x is brought to m in [0.5, 1), three Newton steps from 48/17 - 32/17 m
+//(1/17 off) give ~1e-9
+uint32_t FixedReciprocal(uint32_t x, int *shift)
+{
+	int lz = FixedClz(x);
+	uint64_t m = (uint64_t)(x << lz);
+	int64_t y = 3031741621LL - (int64_t)((m * FIXED_Q30(32.0 / 17.0)) >> 32); //48/17 is over INT32_MAX
+
+	for (int i = 0; i < 3; i++){
+		y = (y * ((2LL << FIXED_SHIFT) - (int64_t)((m * (uint64_t)y) >> 32))) >> FIXED_SHIFT;
+	}
+	*shift = 32 - lz;
+	return (uint32_t)y;
+}
+
+//a / x with the y and shift of FixedReciprocal, rounded
+static inline int64_t FixedDivide(int32_t a, uint32_t y, int shift)
+{
+	return ((int64_t)a * y + ((int64_t)1 << (shift - 1))) >> shift;
+}
+
+//atan2(y, x) in Q4.28 rad, in [-pi, pi]. the ratio of the smaller to the
+//larger magnitude goes through the polynomial of Abramowitz and Stegun
+//4.4.49 (2e-8 on [0, 1]), then to the octant of (x, y)
+int32_t FixedAtan2(int32_t y, int32_t x)
+{
+	uint32_t ax = x < 0 ? 0u - (uint32_t)x : (uint32_t)x;
+	uint32_t ay = y < 0 ? 0u - (uint32_t)y : (uint32_t)y;
+	uint32_t mn = ax < ay ? ax : ay, mx = ax < ay ? ay : ax, r;
+	int32_t t, t2, p, a;
+	int shift;
+
+	if (mx == 0){
+		return 0;
+	}
+	r = FixedReciprocal(mx, &shift);
+	t = (int32_t)(((uint64_t)mn * r + ((uint64_t)1 << (shift - 1))) >> shift);
+	t2 = FixedMul(t, t);
+	p = FIXED_Q30(-0.0040540580);
+	p = FIXED_Q30(0.0218612288) + FixedMul(t2, p);
+	p = FIXED_Q30(-0.0559098861) + FixedMul(t2, p);
+	p = FIXED_Q30(0.0964200441) + FixedMul(t2, p);
+	p = FIXED_Q30(-0.1390853351) + FixedMul(t2, p);
+	p = FIXED_Q30(0.1994653599) + FixedMul(t2, p);
+	p = FIXED_Q30(-0.3332985605) + FixedMul(t2, p);
+	p = FIXED_Q30(0.9999993329) + FixedMul(t2, p);
+	a = (FixedMul(t, p) + 2) >> (FIXED_SHIFT - FIXED_ANGLE_SHIFT);
+
+	if (ay > ax){
+		a = FIXED_PI_2 - a;
+	}
+	if (x < 0){
+		a = FIXED_PI - a;
+	}
+	return y < 0 ? -a : a;
+}
+
+//asin of a Q2.30 x in Q4.28 rad, as atan2(x, sqrt(1 - x^2))
+int32_t FixedAsin(int32_t x)
+{
+	x = x > FIXED_ONE ? FIXED_ONE : (x < -FIXED_ONE ? -FIXED_ONE : x);
+	return FixedAtan2(x, FixedSqrt(FIXED_ONE - FixedMul(x, x)));
+}
+
+//////////////////////////////////////////////////////////////////////////
+//calibration of the raw counts
+
+typedef struct
+{
+	int32_t gyroScale[3];   //rad/s per count, Q(FIXED_RATE_SHIFT + 16), under 2^-9
+	int32_t gyroOffset[3];  //rad/s, Q8.24
+	int32_t accelScale[3];  //Q2.30, relative to the largest
+	int32_t accelOffset[3]; //counts, Q24.8
+	int32_t magMatrix[9];   //Q2.30, relative to the largest
+	int32_t magOffset[3];   //counts, Q24.8
+} FixedCalibration;
+
+//integer calibration of a log header (ImuLog.h), float code run once.
+//accel and mag only give directions, so their scales are kept relative to
+//the largest one
+void FixedCalibration_FromLog(const ImuLogHeader *h, FixedCalibration *c)
+{
+	float amax = 0.0f, mmax = 0.0f;
+
+	for (int i = 0; i < 3; i++){
+		amax = h->accelScale[i] > amax ? h->accelScale[i] : (-h->accelScale[i] > amax ? -h->accelScale[i] : amax);
+	}
+	for (int i = 0; i < 9; i++){
+		mmax = h->magMatrix[i] > mmax ? h->magMatrix[i] : (-h->magMatrix[i] > mmax ? -h->magMatrix[i] : mmax);
+	}
+	for (int i = 0; i < 3; i++){
+		c->gyroScale[i] = (int32_t)(h->gyroScale[i] * (float)(1LL << (FIXED_RATE_SHIFT + 16)) + 0.5f);
+		c->gyroOffset[i] = (int32_t)(h->gyroOffset[i] * h->gyroScale[i] * (float)(1 << FIXED_RATE_SHIFT));
+		c->accelScale[i] = amax > 0.0f ? FIXED_Q30(h->accelScale[i] / amax) : FIXED_ONE;
+		c->accelOffset[i] = (int32_t)(h->accelOffset[i] * 256.0f);
+		c->magOffset[i] = (int32_t)(h->magOffset[i] * 256.0f);
+	}
+	for (int i = 0; i < 9; i++){
+		c->magMatrix[i] = mmax > 0.0f ? FIXED_Q30(h->magMatrix[i] / mmax) : (i % 4 == 0 ? FIXED_ONE : 0);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+//all parameters below need to be tune, the defaults are those of
+//ErrorStateAHRS.h
+#ifndef FIXED_PTHETA_INITIAL
+#define FIXED_PTHETA_INITIAL 0.01 //rad^2
+#endif
+#ifndef FIXED_PBIAS_INITIAL
+#define FIXED_PBIAS_INITIAL 0.0001 //(rad/s)^2
+#endif
+#ifndef FIXED_QTHETA
+#define FIXED_QTHETA 0.0001 //rad^2/s
+#endif
+#ifndef FIXED_QBIAS
+#define FIXED_QBIAS 0.00000001 //(rad/s)^2/s
+#endif
+#ifndef FIXED_RA
+#define FIXED_RA 0.005346
+#endif
+#ifndef FIXED_RM
+#define FIXED_RM 0.005346
+#endif
+
+//the bias states are b * 2^FIXED_BIAS_SHIFT, which brings their variance
+//(1e-4 at start, ~1e-9 once converged) up to where Q2.30 still has a few
+//digits, while the initial one stays under 2
+#define FIXED_BIAS_SHIFT 6
+
+//smallest variance left by an update
+#define FIXED_P_MIN 1
+
+//us to Q2.30 s, 2^46 / 1e6 then >> 16
+#define FIXED_US_TO_Q30 70368744LL
+
+class FixedPointAHRS {
+public:
+	FixedPointAHRS(const FixedCalibration *calibration) {
+		cal = *calibration;
+		q[0] = FIXED_ONE; q[1] = 0; q[2] = 0; q[3] = 0;
+		bias[0] = 0; bias[1] = 0; bias[2] = 0;
+		for (int i = 0; i < 6; i++){
+			for (int j = 0; j < 6; j++){
+				P[i][j] = 0;
+			}
+		}
+		for (int i = 0; i < 3; i++){
+			P[i][i] = FIXED_Q30(FIXED_PTHETA_INITIAL);
+			P[i + 3][i + 3] = FIXED_Q30(FIXED_PBIAS_INITIAL * (1 << (2 * FIXED_BIAS_SHIFT)));
+		}
+	}
+
+	//attitude from one accel and mag sample, the axes of
+	//Calcultate_RotationMatrix: z up, y = z x mag, x = y x z. returns 0 if
+	//a vector is zero or they are parallel
+	int initialize(const int16_t *accel, const int16_t *mag) {
+		int32_t z[3], m[3], y[3], x[3], c[3], R[9];
+
+		calibrateAccel(accel, c);
+		if (!normalize(c, z)){
+			return 0;
+		}
+		z[0] = -z[0]; z[1] = -z[1]; z[2] = -z[2];
+		calibrateMag(mag, c);
+		if (!normalize(c, m)){
+			return 0;
+		}
+		cross(z, m, c);
+		if (!normalize(c, y)){
+			return 0;
+		}
+		cross(y, z, x);
+		//the axes of the navigation frame in the body frame are the rows of C
+		for (int i = 0; i < 3; i++){
+			R[i] = x[i]; R[3 + i] = y[i]; R[6 + i] = z[i];
+		}
+		fromRotation(R);
+		return 1;
+	}
+
+	void predict(const int16_t *gyro, int32_t dtUs) {
+		int32_t dt = (int32_t)(((int64_t)dtUs * FIXED_US_TO_Q30) >> 16);
+		int32_t w[3], h[3], t[4], A[3][6];
+		int32_t g = dt >> FIXED_BIAS_SHIFT;
+
+		for (int i = 0; i < 3; i++){
+			int32_t rate = (int32_t)(((int64_t)gyro[i] * cal.gyroScale[i]) >> 16) - cal.gyroOffset[i]
+					- (bias[i] >> (FIXED_SHIFT - FIXED_RATE_SHIFT));
+			int64_t a = (int64_t)rate * dt;
+			w[i] = FixedSat((a + (1 << (FIXED_RATE_SHIFT - 1))) >> FIXED_RATE_SHIFT);
+			h[i] = FixedSat((a + (1 << FIXED_RATE_SHIFT)) >> (FIXED_RATE_SHIFT + 1));
+		}
+
+		//nominal state, q = q * [1, w / 2]
+		t[0] = q[0] - FixedMul(h[0], q[1]) - FixedMul(h[1], q[2]) - FixedMul(h[2], q[3]);
+		t[1] = q[1] + FixedMul(h[0], q[0]) - FixedMul(h[1], q[3]) + FixedMul(h[2], q[2]);
+		t[2] = q[2] + FixedMul(h[0], q[3]) + FixedMul(h[1], q[0]) - FixedMul(h[2], q[1]);
+		t[3] = q[3] - FixedMul(h[0], q[2]) + FixedMul(h[1], q[1]) + FixedMul(h[2], q[0]);
+		normalizeQuaternion(t);
+
+		//error propagation, F = [I + W, -I * dt; 0, I] with W = -[w]x, the
+		//bias columns scaled down by 2^FIXED_BIAS_SHIFT. A = F * P is
+		//only new in its first three rows, P = A * F' only in its first
+		//three columns
+		int32_t W[3][3] = {{0, w[2], -w[1]}, {-w[2], 0, w[0]}, {w[1], -w[0], 0}};
+		for (int i = 0; i < 3; i++){
+			for (int j = 0; j < 6; j++){
+				int64_t acc = ((int64_t)P[i][j] << FIXED_SHIFT) - (int64_t)g * P[i + 3][j];
+				for (int k = 0; k < 3; k++){
+					acc += (int64_t)W[i][k] * P[k][j];
+				}
+				A[i][j] = FixedRound(acc);
+			}
+		}
+		for (int i = 0; i < 6; i++){
+			const int32_t *a = i < 3 ? A[i] : P[i];
+			for (int j = i < 3 ? i : 3; j < 6; j++){
+				int32_t v = a[j];
+				if (j < 3){
+					int64_t acc = ((int64_t)a[j] << FIXED_SHIFT) - (int64_t)g * a[j + 3];
+					for (int k = 0; k < 3; k++){
+						acc += (int64_t)a[k] * W[j][k];
+					}
+					v = FixedRound(acc);
+				}
+				P[i][j] = v;
+				P[j][i] = v;
+			}
+		}
+
+		int32_t qt = FixedMul(FIXED_Q30(FIXED_QTHETA), dt);
+		int32_t qb = FixedMul(FIXED_Q30(FIXED_QBIAS * (1 << (2 * FIXED_BIAS_SHIFT))), dt);
+		for (int i = 0; i < 3; i++){
+			P[i][i] = FixedAdd(P[i][i], qt);
+			P[i + 3][i + 3] = FixedAdd(P[i + 3][i + 3], qb);
+		}
+	}
+
+	void updateAccel(const int16_t *accel) {
+		int32_t c[3], z[3], C[9], u[3];
+
+		calibrateAccel(accel, c);
+		if (!normalize(c, z)){
+			return;
+		}
+		rotation(C);
+		//expected accel, -C' * [0 0 1]
+		u[0] = -C[6]; u[1] = -C[7]; u[2] = -C[8];
+		updateBlock(z, u, FIXED_Q30(FIXED_RA));
+	}
+
+	void updateMag(const int16_t *mag) {
+		int32_t c[3], z[3], C[9], u[3], hx, hy, hz, bx;
+
+		calibrateMag(mag, c);
+		if (!normalize(c, z)){
+			return;
+		}
+		rotation(C);
+		//expected mag, C' * [bx 0 bz] with the reference field taken from
+		//the measurement as in EKF_AHRSUpdate
+		hx = FixedRound((int64_t)C[0] * z[0] + (int64_t)C[1] * z[1] + (int64_t)C[2] * z[2]);
+		hy = FixedRound((int64_t)C[3] * z[0] + (int64_t)C[4] * z[1] + (int64_t)C[5] * z[2]);
+		hz = FixedRound((int64_t)C[6] * z[0] + (int64_t)C[7] * z[1] + (int64_t)C[8] * z[2]);
+		bx = FixedSqrt(FixedRound((int64_t)hx * hx + (int64_t)hy * hy));
+		u[0] = FixedRound((int64_t)C[0] * bx + (int64_t)C[6] * hz);
+		u[1] = FixedRound((int64_t)C[1] * bx + (int64_t)C[7] * hz);
+		u[2] = FixedRound((int64_t)C[2] * bx + (int64_t)C[8] * hz);
+		updateBlock(z, u, FIXED_Q30(FIXED_RM));
+	}
+
+	//same call as EKF_AHRSUpdate, with the raw counts of one sample and
+	//the time since the previous one in us
+	void update(const int16_t *gyro, const int16_t *accel, const int16_t *mag, int32_t dtUs) {
+		predict(gyro, dtUs);
+		updateAccel(accel);
+		updateMag(mag);
+	}
+
+	void getQuaternionQ30(int32_t *Q) {
+		Q[0] = q[0]; Q[1] = q[1]; Q[2] = q[2]; Q[3] = q[3];
+	}
+
+	//rad/s in Q2.30
+	void getBiasQ30(int32_t *b) {
+		b[0] = bias[0]; b[1] = bias[1]; b[2] = bias[2];
+	}
+
+	//roll, pitch, yaw in Q4.28 rad as Quaternion_ToEuler, yaw in [0, 2 pi)
+	void getAnglesQ28(int32_t *rpy) {
+		int64_t q00 = (int64_t)q[0] * q[0], q11 = (int64_t)q[1] * q[1], q33 = (int64_t)q[3] * q[3];
+		int32_t r01 = FixedSat(((int64_t)q[1] * q[2] + (int64_t)q[0] * q[3]) >> (FIXED_SHIFT - 1));
+		int32_t r02 = FixedSat(((int64_t)q[1] * q[3] - (int64_t)q[0] * q[2]) >> (FIXED_SHIFT - 1));
+		int32_t r12 = FixedSat(((int64_t)q[2] * q[3] + (int64_t)q[0] * q[1]) >> (FIXED_SHIFT - 1));
+		int32_t r00 = FixedSat(((q00 + q11) >> (FIXED_SHIFT - 1)) - FIXED_ONE);
+		int32_t r22 = FixedSat(((q00 + q33) >> (FIXED_SHIFT - 1)) - FIXED_ONE);
+
+		rpy[0] = FixedAtan2(r12, r22);
+		rpy[1] = FixedAsin(-r02);
+		rpy[2] = FixedAtan2(r01, r00);
+		if (rpy[2] < 0){
+			rpy[2] += FIXED_2_PI;
+		}
+	}
+
+	//float views for logging and comparisons, not used by the filter
+	void getQuaternion(float *Q) {
+		for (int i = 0; i < 4; i++){
+			Q[i] = (float)q[i] * (1.0f / FIXED_ONE);
+		}
+	}
+
+	void getAngles(float *rpy) {
+		int32_t a[3];
+
+		getAnglesQ28(a);
+		for (int i = 0; i < 3; i++){
+			rpy[i] = (float)a[i] * (57.29577951f / (1 << FIXED_ANGLE_SHIFT));
+		}
+	}
+
+	const int32_t (*getCovariance() const)[6] {
+		return P;
+	}
+
+private:
+	//(raw - offset) * scale, in 1/256 counts of the largest scale
+	void calibrateAccel(const int16_t *raw, int32_t *v) {
+		for (int i = 0; i < 3; i++){
+			int64_t c = ((int64_t)raw[i] << 8) - cal.accelOffset[i];
+			v[i] = (int32_t)((c * cal.accelScale[i]) >> FIXED_SHIFT);
+		}
+	}
+
+	void calibrateMag(const int16_t *raw, int32_t *v) {
+		int64_t c[3];
+
+		for (int i = 0; i < 3; i++){
+			c[i] = ((int64_t)raw[i] << 8) - cal.magOffset[i];
+		}
+		for (int i = 0; i < 3; i++){
+			const int32_t *M = &cal.magMatrix[i * 3];
+			v[i] = (int32_t)((c[0] * M[0] + c[1] * M[1] + c[2] * M[2]) >> FIXED_SHIFT);
+		}
+	}
+
+	//unit vector of v in Q2.30, 0 if v is zero. v is first shifted so its
+	//largest component is in [0.5, 1), then |v|^2 is in [0.25, 3), the
+	//domain of FixedRsqrt
+	static int normalize(const int32_t *v, int32_t *u) {
+		uint32_t mx = 0;
+		int64_t s[3], n2 = 0;
+		int32_t y;
+		int shift;
+
+		for (int i = 0; i < 3; i++){
+			uint32_t a = v[i] < 0 ? 0u - (uint32_t)v[i] : (uint32_t)v[i];
+			mx = a > mx ? a : mx;
+		}
+		if (mx == 0){
+			return 0;
+		}
+		shift = FixedClz(mx) - 2;
+		for (int i = 0; i < 3; i++){
+			s[i] = shift >= 0 ? (int64_t)v[i] << shift : (int64_t)v[i] >> -shift;
+			n2 += s[i] * s[i];
+		}
+		y = FixedRsqrt((uint32_t)(n2 >> FIXED_SHIFT));
+		for (int i = 0; i < 3; i++){
+			u[i] = FixedRound(s[i] * y);
+		}
+		return 1;
+	}
+
+	void normalizeQuaternion(const int32_t *t) {
+		int64_t n2 = (int64_t)t[0] * t[0] + (int64_t)t[1] * t[1] + (int64_t)t[2] * t[2] + (int64_t)t[3] * t[3];
+		int32_t y = FixedRsqrt((uint32_t)(n2 >> FIXED_SHIFT));
+
+		for (int i = 0; i < 4; i++){
+			q[i] = FixedMul(t[i], y);
+		}
+	}
+
+	static void cross(const int32_t *a, const int32_t *b, int32_t *c) {
+		c[0] = FixedRound((int64_t)a[1] * b[2] - (int64_t)a[2] * b[1]);
+		c[1] = FixedRound((int64_t)a[2] * b[0] - (int64_t)a[0] * b[2]);
+		c[2] = FixedRound((int64_t)a[0] * b[1] - (int64_t)a[1] * b[0]);
+	}
+
+	//body to navigation rotation of q, row major
+	void rotation(int32_t *C) {
+		int64_t q00 = (int64_t)q[0] * q[0], q11 = (int64_t)q[1] * q[1];
+		int64_t q22 = (int64_t)q[2] * q[2], q33 = (int64_t)q[3] * q[3];
+		int64_t q01 = (int64_t)q[0] * q[1], q02 = (int64_t)q[0] * q[2], q03 = (int64_t)q[0] * q[3];
+		int64_t q12 = (int64_t)q[1] * q[2], q13 = (int64_t)q[1] * q[3], q23 = (int64_t)q[2] * q[3];
+		const int s = FIXED_SHIFT - 1;
+
+		C[0] = FixedSat((q00 + q11 - q22 - q33) >> FIXED_SHIFT);
+		C[1] = FixedSat((q12 - q03) >> s);
+		C[2] = FixedSat((q13 + q02) >> s);
+		C[3] = FixedSat((q12 + q03) >> s);
+		C[4] = FixedSat((q00 - q11 + q22 - q33) >> FIXED_SHIFT);
+		C[5] = FixedSat((q23 - q01) >> s);
+		C[6] = FixedSat((q13 - q02) >> s);
+		C[7] = FixedSat((q23 + q01) >> s);
+		C[8] = FixedSat((q00 - q11 - q22 + q33) >> FIXED_SHIFT);
+	}
+
+	//quaternion of a rotation matrix, from its largest component
+	//(Shepperd): qi^2 = (1 +- R00 +- R11 +- R22) / 4, the others from the
+	//sums and differences of the off diagonal terms over 4 qi
+	void fromRotation(const int32_t *R) {
+		int64_t tr = (int64_t)R[0] + R[4] + R[8];
+		int64_t d[4] = {tr, 2 * (int64_t)R[0] - tr, 2 * (int64_t)R[4] - tr, 2 * (int64_t)R[8] - tr};
+		int64_t o[4];
+		int32_t t[4], r;
+		int k = 0, shift;
+
+		for (int i = 1; i < 4; i++){
+			k = d[i] > d[k] ? i : k;
+		}
+		t[k] = FixedSqrt((int32_t)((FIXED_ONE + d[k]) >> 2));
+		switch (k){
+		case 0:
+			o[1] = (int64_t)R[7] - R[5]; o[2] = (int64_t)R[2] - R[6]; o[3] = (int64_t)R[3] - R[1];
+			break;
+		case 1:
+			o[0] = (int64_t)R[7] - R[5]; o[2] = (int64_t)R[1] + R[3]; o[3] = (int64_t)R[2] + R[6];
+			break;
+		case 2:
+			o[0] = (int64_t)R[2] - R[6]; o[1] = (int64_t)R[1] + R[3]; o[3] = (int64_t)R[5] + R[7];
+			break;
+		default:
+			o[0] = (int64_t)R[3] - R[1]; o[1] = (int64_t)R[2] + R[6]; o[2] = (int64_t)R[5] + R[7];
+			break;
+		}
+		r = FixedReciprocal((uint32_t)t[k], &shift);
+		for (int i = 0; i < 4; i++){
+			if (i != k){
+				t[i] = FixedSat(FixedDivide((int32_t)(o[i] >> 2), r, shift));
+			}
+		}
+		normalizeQuaternion(t);
+	}
+
+	//sequential scalar updates with the rows of H = [u]x, z the measured
+	//and u the expected unit vector, R = r * I. each row is linearized at
+	//the same attitude, so its innovation is corrected by the error dx
+	//estimated from the rows before
+	void updateBlock(const int32_t *z, const int32_t *u, int32_t r) {
+		int32_t H[3][3] = {{0, -u[2], u[1]}, {u[2], 0, -u[0]}, {-u[1], u[0], 0}};
+		int32_t dx[6] = {0, 0, 0, 0, 0, 0}, ph[6], K[6];
+		uint32_t y;
+		int shift;
+
+		for (int row = 0; row < 3; row++){
+			const int32_t *h = H[row];
+			int64_t acc;
+			int32_t s, e;
+
+			for (int i = 0; i < 6; i++){
+				ph[i] = FixedRound((int64_t)P[i][0] * h[0] + (int64_t)P[i][1] * h[1] + (int64_t)P[i][2] * h[2]);
+			}
+			s = FixedAdd(FixedRound((int64_t)h[0] * ph[0] + (int64_t)h[1] * ph[1] + (int64_t)h[2] * ph[2]), r);
+			if (s <= 0){
+				continue;
+			}
+			y = FixedReciprocal((uint32_t)s, &shift);
+			for (int i = 0; i < 6; i++){
+				K[i] = FixedSat(FixedDivide(ph[i], y, shift + (FIXED_SHIFT - FIXED_GAIN_SHIFT)));
+			}
+
+			acc = ((int64_t)z[row] - u[row]) << FIXED_SHIFT;
+			acc -= (int64_t)h[0] * dx[0] + (int64_t)h[1] * dx[1] + (int64_t)h[2] * dx[2];
+			e = FixedRound(acc);
+			for (int i = 0; i < 6; i++){
+				dx[i] = FixedAdd(dx[i], FixedSat(((int64_t)K[i] * e + (1 << (FIXED_GAIN_SHIFT - 1))) >> FIXED_GAIN_SHIFT));
+			}
+
+			//P = P - K * (P * h')', the upper triangle mirrored
+			for (int i = 0; i < 6; i++){
+				for (int j = i; j < 6; j++){
+					int64_t d = ((int64_t)K[i] * ph[j] + (1 << (FIXED_GAIN_SHIFT - 1))) >> FIXED_GAIN_SHIFT;
+					int32_t v = FixedSat((int64_t)P[i][j] - d);
+					if (i == j && v < FIXED_P_MIN){
+						v = FIXED_P_MIN;
+					}
+					P[i][j] = v;
+					P[j][i] = v;
+				}
+			}
+		}
+		inject(dx);
+	}
+
+	//fold the error into the nominal state, the error is then zero again
+	void inject(const int32_t *dx) {
+		int32_t t[4];
+		int32_t hx = dx[0] >> 1, hy = dx[1] >> 1, hz = dx[2] >> 1;
+
+		t[0] = q[0] - FixedMul(hx, q[1]) - FixedMul(hy, q[2]) - FixedMul(hz, q[3]);
+		t[1] = q[1] + FixedMul(hx, q[0]) - FixedMul(hy, q[3]) + FixedMul(hz, q[2]);
+		t[2] = q[2] + FixedMul(hx, q[3]) + FixedMul(hy, q[0]) - FixedMul(hz, q[1]);
+		t[3] = q[3] - FixedMul(hx, q[2]) + FixedMul(hy, q[1]) + FixedMul(hz, q[0]);
+		normalizeQuaternion(t);
+
+		for (int i = 0; i < 3; i++){
+			bias[i] = FixedAdd(bias[i], dx[i + 3] >> FIXED_BIAS_SHIFT);
+		}
+	}
+
+	FixedCalibration cal;
+	int32_t q[4];
+	int32_t bias[3];
+	int32_t P[6][6];
+};
+
+#endif
@@ -0,0 +1,197 @@
+/*
+ * GDKalmanAHRS.h
+ *
+ *  Created on: 18 oct. 2026
+ */
+
+#ifndef GDKALMANAHRS_H_
+#define GDKALMANAHRS_H_
+
+#include "FixedMatrix.h"
+#include "AHRSModel.h"
+#include "IAttitudeFilter.h"
+
+//////////////////////////////////////////////////////////////////////////
+//quaternion Kalman filter with an adaptive-step gradient descent
+//measurement, after L. Wang, Z. Zhang and P. Sun, "Quaternion-Based Kalman
+//Filter for AHRS Using an Adaptive-Step Gradient Descent Algorithm" (the pdf
+//in the repository root).
+//
+//the accel and mag samples are turned into a quaternion by gradient
+//descent on f(q) = u(q) - z, with the sensor models of miniAHRS.h. the step
+//grows with the rotation rate, mu = GDK_STEP_MIN + GDK_STEP_GAIN * |q'| * dt,
+//so the measurement can follow fast motion. the quaternion from the descent
+//is a direct measurement of the state (H = I), which leaves a linear
+//4-state Kalman filter: no measurement jacobian in the gain and a 4x4
+//innovation. the process noise follows from the gyro noise,
+//Q = (dt / 2)^2 * sigma^2 * Xi * Xi' = (dt / 2)^2 * sigma^2 * (I - q * q').
+//
+//two departures from the paper: the descent starts from the predicted
+//quaternion instead of the last estimate, which would lag the motion by
+//one step, and GDK_STEP_MIN keeps correcting at rest, where a purely
+//rate-proportional step never moves and the attitude drifts with the gyro.
+//////////////////////////////////////////////////////////////////////////
+
+//all parameters below need to be tune
+#ifndef GDK_P_INITIAL
+#define GDK_P_INITIAL 0.01f
+#endif
+#ifndef GDK_GYRO_NOISE
+#define GDK_GYRO_NOISE 0.05f //rad/s, also covers the unmodelled gyro bias
+#endif
+#ifndef GDK_R
+#define GDK_R 0.0001f //variance of each measured quaternion component
+#endif
+#ifndef GDK_STEP_GAIN
+#define GDK_STEP_GAIN 2.0f
+#endif
+#ifndef GDK_STEP_MIN
+#define GDK_STEP_MIN 0.005f
+#endif
+#ifndef GDK_ITERATIONS
+#define GDK_ITERATIONS 1
+#endif
+
+class GDKalmanAHRS : public IAttitudeFilter {
+public:
+	GDKalmanAHRS() {
+		X[0] = 1.0f; X[1] = 0.0f; X[2] = 0.0f; X[3] = 0.0f;
+		Mat_Identity(P);
+		Mat_Scale(P, GDK_P_INITIAL, P);
+		Mat_Identity(F);
+	}
+
+	//attitude from one accel and mag sample. the accel is expected as in the
+	//measurement model, -C' * [0 0 1]
+	void initialize(float *accel, float *mag) {
+		AHRSModel_Attitude(accel, mag, X.m);
+	}
+
+	void update(float *gyro, float *accel, float *mag, float dt) {
+		float halfdt = 0.5f * dt;
+		float halfdx = halfdt * gyro[0], halfdy = halfdt * gyro[1], halfdz = halfdt * gyro[2];
+		float q0 = X[0], q1 = X[1], q2 = X[2], q3 = X[3];
+		float z[4], norm, qn;
+		Mat<4, 4> S, SI;
+		Mat<4, 1> Y, KY;
+
+		//state time propagation, X = F * X with F = I + dt / 2 * Omega(w)
+		X[0] = q0 - halfdx * q1 - halfdy * q2 - halfdz * q3;
+		X[1] = q1 + halfdx * q0 - halfdy * q3 + halfdz * q2;
+		X[2] = q2 + halfdx * q3 + halfdy * q0 - halfdz * q1;
+		X[3] = q3 - halfdx * q2 + halfdy * q1 + halfdz * q0;
+		norm = FastSqrtI(X[0] * X[0] + X[1] * X[1] + X[2] * X[2] + X[3] * X[3]);
+		Mat_Scale(X, norm, X);
+
+		F[1] = -halfdx; F[2] = -halfdy; F[3] = -halfdz;
+		F[4] = halfdx; F[6] = halfdz; F[7] = -halfdy;
+		F[8] = halfdy; F[9] = -halfdz; F[11] = halfdx;
+		F[12] = halfdz; F[13] = halfdy; F[14] = -halfdx;
+
+		//P = F*P*F' + Q
+		qn = halfdt * halfdt * GDK_GYRO_NOISE * GDK_GYRO_NOISE;
+		Mat_Multiply(F, P, PX);
+		Mat_MultiplyTransB(PX, F, P);
+		for (unsigned int i = 0; i < 4; i++){
+			for (unsigned int j = 0; j < 4; j++){
+				P(i, j) += qn * ((i == j ? 1.0f : 0.0f) - X[i] * X[j]);
+			}
+		}
+
+		//gradient descent measurement from the prediction, none without a
+		//valid accel
+		if (!measure(accel, mag, FastSqrt(gyro[0] * gyro[0] + gyro[1] * gyro[1] + gyro[2] * gyro[2]) * halfdt, z)){
+			return;
+		}
+
+		//K = P / (P + R), X = X + K * (z - X), P = (I - K) * P
+		Mat_Copy(P, S);
+		S[0] += GDK_R; S[5] += GDK_R; S[10] += GDK_R; S[15] += GDK_R;
+		Mat_Inverse(S, SI);
+		Mat_Multiply(P, SI, K);
+		for (unsigned int i = 0; i < 4; i++){
+			Y[i] = z[i] - X[i];
+		}
+		Mat_Multiply(K, Y, KY);
+		Mat_Add(X, KY, X);
+		norm = FastSqrtI(X[0] * X[0] + X[1] * X[1] + X[2] * X[2] + X[3] * X[3]);
+		Mat_Scale(X, norm, X);
+
+		Mat_Multiply(K, P, PX);
+		Mat_Sub(P, PX, P);
+	}
+
+	void getQuaternion(float *q) {
+		q[0] = X[0]; q[1] = X[1]; q[2] = X[2]; q[3] = X[3];
+	}
+
+	void getAngles(float *rpy) {
+		AHRSModel_Angles(X.m, rpy);
+	}
+
+private:
+	//quaternion from accel and mag by gradient descent, rate is |q'| * dt.
+	//returns 0 for a zero accel, a zero mag leaves the heading to the gyro
+	int measure(float *accel, float *mag, float rate, float *z) {
+		float norm, mu;
+		int useMag;
+		float a[3], m[3] = {0.0f, 0.0f, 0.0f}, f[6], g[4];
+		float q0q0, q0q1, q0q2, q0q3, q1q1, q1q2, q1q3, q2q2, q2q3, q3q3;
+		float _2mx, _2my, _2mz, hx, hy, hz, bx, bz;
+
+		if (!AHRSModel_Normalize(accel, a)){
+			return 0;
+		}
+		useMag = AHRSModel_Normalize(mag, m);
+
+		mu = GDK_STEP_MIN + GDK_STEP_GAIN * rate;
+		z[0] = X[0]; z[1] = X[1]; z[2] = X[2]; z[3] = X[3];
+
+		for (int n = 0; n < GDK_ITERATIONS; n++){
+			q0q0 = z[0] * z[0]; q0q1 = z[0] * z[1]; q0q2 = z[0] * z[2]; q0q3 = z[0] * z[3];
+			q1q1 = z[1] * z[1]; q1q2 = z[1] * z[2]; q1q3 = z[1] * z[3];
+			q2q2 = z[2] * z[2]; q2q3 = z[2] * z[3];
+			q3q3 = z[3] * z[3];
+
+			//reference field
+			_2mx = 2.0f * m[0]; _2my = 2.0f * m[1]; _2mz = 2.0f * m[2];
+			hx = _2mx * (0.5f - q2q2 - q3q3) + _2my * (q1q2 - q0q3) + _2mz * (q1q3 + q0q2);
+			hy = _2mx * (q1q2 + q0q3) + _2my * (0.5f - q1q1 - q3q3) + _2mz * (q2q3 - q0q1);
+			hz = _2mx * (q1q3 - q0q2) + _2my * (q2q3 + q0q1) + _2mz * (0.5f - q1q1 - q2q2);
+			bx = FastSqrt(hx * hx + hy * hy);
+			bz = hz;
+
+			//f = u(q) - z
+			f[0] = -2.0f * (q1q3 - q0q2) - a[0];
+			f[1] = -2.0f * (q2q3 + q0q1) - a[1];
+			f[2] = 1.0f - 2.0f * (q0q0 + q3q3) - a[2];
+			f[3] = bx * (1.0f - 2.0f * (q2q2 + q3q3)) + bz * (2.0f * (q1q3 - q0q2)) - m[0];
+			f[4] = bx * (2.0f * (q1q2 - q0q3)) + bz * (2.0f * (q2q3 + q0q1)) - m[1];
+			f[5] = bx * (2.0f * (q1q3 + q0q2)) + bz * (1.0f - 2.0f * (q1q1 + q2q2)) - m[2];
+
+			//the mag rows drop out without a mag
+			if (!useMag){
+				bx = bz = 0.0f;
+				f[3] = f[4] = f[5] = 0.0f;
+			}
+
+			//gradient J' * f
+			AHRSModel_Gradient(z, bx, bz, f, g);
+
+			norm = g[0] * g[0] + g[1] * g[1] + g[2] * g[2] + g[3] * g[3];
+			if (norm == 0.0f){
+				break;
+			}
+			norm = mu * FastSqrtI(norm);
+			z[0] -= norm * g[0]; z[1] -= norm * g[1]; z[2] -= norm * g[2]; z[3] -= norm * g[3];
+			norm = FastSqrtI(z[0] * z[0] + z[1] * z[1] + z[2] * z[2] + z[3] * z[3]);
+			z[0] *= norm; z[1] *= norm; z[2] *= norm; z[3] *= norm;
+		}
+		return 1;
+	}
+
+	Mat<4, 1> X;
+	Mat<4, 4> P, F, PX, K;
+};
+
+#endif
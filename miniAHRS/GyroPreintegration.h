@@ -0,0 +1,134 @@
+/*
+ * GyroPreintegration.h
+ *
+ *  Created on: 18 oct. 2026
+ */
+
+#ifndef _GYROPREINTEGRATION_H_
+#define _GYROPREINTEGRATION_H_
+
+#include "FastMath.h"
+
+//////////////////////////////////////////////////////////////////////////
+//accumulates the raw gyro samples that arrive between two filter steps
+//into a single rotation vector, so the EKF pays one covariance propagation
+//per filter step (100-200 Hz) while the attitude still follows every gyro
+//sample (1-8 kHz).
+//
+//the rotation vector is the sum of the sample increments plus the coning
+//term of the two-sample algorithm (Savage):
+//  alpha += dtheta_k
+//  beta  += 0.5 * (alpha_k-1 + dtheta_k-1 / 6) x dtheta_k
+//  phi = alpha + beta
+//samples are integrated with zero bias. the filter corrects the summary
+//to first order with the accumulated bias jacobian, phi(b) = phi + J * b,
+//where J = d(phi)/d(b) includes the bias dependency of the coning term.
+//
+//a sample stamped t_k covers the interval (t_k-1, t_k], the time stamp of
+//the last sample is kept across resets so no interval is lost.
+//////////////////////////////////////////////////////////////////////////
+
+typedef struct
+{
+	float alpha[3];   //sum of the angle increments (rad)
+	float beta[3];    //coning correction (rad)
+	float prev[3];    //alpha_k-1 + dtheta_k-1 / 6 of the previous sample
+	float J[9];       //d(phi)/d(bias), row major 3x3
+	float dt;         //integrated time (s)
+	float prevDt;     //-d(prev)/d(bias), elapsed time plus 1/6 of the last dt
+	long lastTime;    //time stamp of the last sample (us), 0 before the first
+	int count;        //samples since the last reset
+} GyroPreintegration;
+
+void GyroPreint_Reset(GyroPreintegration *pi)
+{
+	for (int i = 0; i < 3; i++){
+		pi->alpha[i] = 0.0f;
+		pi->beta[i] = 0.0f;
+		pi->prev[i] = 0.0f;
+	}
+	for (int i = 0; i < 9; i++){
+		pi->J[i] = 0.0f;
+	}
+	pi->dt = 0.0f;
+	pi->prevDt = 0.0f;
+	pi->count = 0;
+}
+
+void GyroPreint_Init(GyroPreintegration *pi)
+{
+	GyroPreint_Reset(pi);
+	pi->lastTime = 0;
+}
+
+//empty interval with the clock started at time (us), the next
+//GyroPreint_AddTimed sample is integrated from there
+void GyroPreint_Start(GyroPreintegration *pi, long time)
+{
+	GyroPreint_Reset(pi);
+	pi->lastTime = time;
+}
+
+//adds a gyro sample (rad/s) held during dt seconds
+void GyroPreint_Add(GyroPreintegration *pi, float *gyro, float dt)
+{
+	float d[3];
+	float *a = pi->prev;
+	float s = pi->prevDt;
+
+	d[0] = gyro[0] * dt;
+	d[1] = gyro[1] * dt;
+	d[2] = gyro[2] * dt;
+
+	//coning term, beta += 0.5 * a x d
+	pi->beta[0] += 0.5f * (a[1] * d[2] - a[2] * d[1]);
+	pi->beta[1] += 0.5f * (a[2] * d[0] - a[0] * d[2]);
+	pi->beta[2] += 0.5f * (a[0] * d[1] - a[1] * d[0]);
+
+	//d(a)/d(b) = -s * I and d(d)/d(b) = -dt * I, so
+	//d(0.5 * a x d)/d(b) = 0.5 * (s * [d]x - dt * [a]x)
+	float hs = 0.5f * s, hdt = 0.5f * dt;
+	pi->J[1] += -hs * d[2] + hdt * a[2];
+	pi->J[2] += hs * d[1] - hdt * a[1];
+	pi->J[3] += hs * d[2] - hdt * a[2];
+	pi->J[5] += -hs * d[0] + hdt * a[0];
+	pi->J[6] += -hs * d[1] + hdt * a[1];
+	pi->J[7] += hs * d[0] - hdt * a[0];
+	//d(alpha)/d(b) = -t * I
+	pi->J[0] -= dt;
+	pi->J[4] -= dt;
+	pi->J[8] -= dt;
+
+	pi->alpha[0] += d[0];
+	pi->alpha[1] += d[1];
+	pi->alpha[2] += d[2];
+	pi->dt += dt;
+
+	//a and s for the next sample
+	a[0] = pi->alpha[0] + d[0] * (1.0f / 6.0f);
+	a[1] = pi->alpha[1] + d[1] * (1.0f / 6.0f);
+	a[2] = pi->alpha[2] + d[2] * (1.0f / 6.0f);
+	pi->prevDt = pi->dt + dt * (1.0f / 6.0f);
+	pi->count++;
+}
+
+//adds a gyro sample stamped in microseconds, the interval is measured from
+//the previous sample. the first sample only starts the clock
+void GyroPreint_AddTimed(GyroPreintegration *pi, float *gyro, long time)
+{
+	if (pi->lastTime != 0){
+		GyroPreint_Add(pi, gyro, (time - pi->lastTime) * 1e-6f);
+	}
+	pi->lastTime = time;
+}
+
+//rotation vector of the interval for the gyro bias b
+void GyroPreint_GetRotation(GyroPreintegration *pi, float *bias, float *phi)
+{
+	for (int i = 0; i < 3; i++){
+		phi[i] = pi->alpha[i] + pi->beta[i]
+			+ pi->J[i * 3] * bias[0] + pi->J[i * 3 + 1] * bias[1] + pi->J[i * 3 + 2] * bias[2];
+	}
+}
+
+#endif
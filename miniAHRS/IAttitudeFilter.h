@@ -0,0 +1,39 @@
+/*
+ * IAttitudeFilter.h
+ *
+ *  Created on: 18 oct. 2026
+ */
+
+#ifndef IATTITUDEFILTER_H_
+#define IATTITUDEFILTER_H_
+
+//////////////////////////////////////////////////////////////////////////
+//common interface of the attitude engines, so a driver can pick one by CPU
+//budget. all of them use the sensor models of miniAHRS.h: gyro in rad/s,
+//accel = -C' * [0 0 1] and mag = C' * [bx 0 bz], where C rotates the body
+//frame to the navigation frame, and AHRSModel.h has the parts of them the
+//engines share. MiniAHRSFilter normalizes the accel and mag arrays in place
+//(EKF_AHRSUpdate), the other engines work on copies and skip the
+//correction of a zero vector. angles are roll, pitch, yaw in degrees.
+//
+//  MadgwickAHRS, MahonyAHRS   complementary, ~100-200 flops
+//  GDKalmanAHRS               gradient descent + 4-state Kalman filter
+//  ErrorStateAHRS             6-state error-state EKF
+//  MiniAHRSFilter             7-state EKF of miniAHRS.h
+//  EigenAHRS                  7-state EKF on Eigen
+//  SRUKFAHRS                  7-state square-root UKF, ~2-3x the EKF
+//
+//FixedPointAHRS (ErrorStateAHRS in fixed point, for cores without an FPU)
+//takes the raw int16_t counts and is not behind this interface.
+//////////////////////////////////////////////////////////////////////////
+
+class IAttitudeFilter // @suppress("Class has a virtual method and non-virtual destructor")
+{
+public:
+	virtual void initialize(float *accel, float *mag) = 0;
+	virtual void update(float *gyro, float *accel, float *mag, float dt) = 0;
+	virtual void getQuaternion(float *q) = 0;
+	virtual void getAngles(float *rpy) = 0;
+};
+
+#endif
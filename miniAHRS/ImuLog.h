@@ -0,0 +1,79 @@
+/*
+ * ImuLog.h
+ *
+ *  Created on: 18 oct. 2026
+ */
+
+#ifndef IMULOG_H_
+#define IMULOG_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+//////////////////////////////////////////////////////////////////////////
+//binary log of the raw IMU samples, recorded by IMU/MainAngles.cpp and
+//replayed offline (AHRSTools/smoother). the header carries the
+//calibration that turns the raw counts into the filter inputs, so a log
+//is reprocessed with the calibration it was recorded with. every field has
+//a fixed size, the file reads the same on the 32-bit ARM target and on a
+//64-bit host (both little endian).
+//////////////////////////////////////////////////////////////////////////
+
+#define IMULOG_MAGIC "IMUL"
+#define IMULOG_VERSION 1
+
+typedef struct
+{
+	char magic[4];
+	uint32_t version;
+	float gyroOffset[3];  //counts
+	float gyroScale[3];   //rad/s per count
+	float accelOffset[3]; //counts
+	float accelScale[3];  //g per count
+	float magOffset[3];   //counts
+	float magMatrix[9];   //soft iron, row major, mag = M * (raw - offset)
+} ImuLogHeader;
+
+typedef struct
+{
+	int64_t time;         //read time stamp (us)
+	int16_t accel[3];
+	int16_t gyro[3];
+	int16_t mag[3];
+	int16_t reserved[3];
+} ImuLogRecord;
+
+//returns 1 on success
+int ImuLog_WriteHeader(FILE *f, ImuLogHeader *h)
+{
+	memcpy(h->magic, IMULOG_MAGIC, 4);
+	h->version = IMULOG_VERSION;
+	return fwrite(h, sizeof(ImuLogHeader), 1, f) == 1;
+}
+
+//returns 1 if the file starts with a header of this version
+int ImuLog_ReadHeader(FILE *f, ImuLogHeader *h)
+{
+	if (fread(h, sizeof(ImuLogHeader), 1, f) != 1){
+		return 0;
+	}
+	return memcmp(h->magic, IMULOG_MAGIC, 4) == 0 && h->version == IMULOG_VERSION;
+}
+
+//gyro (rad/s), accel (g) and mag of one record
+void ImuLog_Calibrate(const ImuLogHeader *h, const ImuLogRecord *r, float *gyro, float *accel, float *mag)
+{
+	float m[3];
+
+	for (int i = 0; i < 3; i++){
+		gyro[i] = ((float)r->gyro[i] - h->gyroOffset[i]) * h->gyroScale[i];
+		accel[i] = ((float)r->accel[i] - h->accelOffset[i]) * h->accelScale[i];
+		m[i] = (float)r->mag[i] - h->magOffset[i];
+	}
+	for (int i = 0; i < 3; i++){
+		mag[i] = h->magMatrix[i * 3] * m[0] + h->magMatrix[i * 3 + 1] * m[1] + h->magMatrix[i * 3 + 2] * m[2];
+	}
+}
+
+#endif
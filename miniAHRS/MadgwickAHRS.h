@@ -0,0 +1,134 @@
+/*
+ * MadgwickAHRS.h
+ *
+ *  Created on: 18 oct. 2026
+ */
+
+#ifndef MADGWICKAHRS_H_
+#define MADGWICKAHRS_H_
+
+#include "AHRSModel.h"
+#include "IAttitudeFilter.h"
+
+//////////////////////////////////////////////////////////////////////////
+//gradient descent complementary filter, after S. Madgwick, "An efficient
+//orientation filter for inertial and inertial/magnetic sensor arrays".
+//the gyro rate is corrected with one normalized gradient step on
+//f(q) = u(q) - z, with the sensor models of miniAHRS.h:
+//  q' = 0.5 * q * [0 w] - MADGWICK_BETA * J' * f / |J' * f|
+//no matrices and no bias state, ~110 flops without mag (updateIMU) and
+//~210 flops with it.
+//////////////////////////////////////////////////////////////////////////
+
+//all parameters below need to be tune
+#ifndef MADGWICK_BETA
+#define MADGWICK_BETA 0.05f //rad/s, gyro measurement error
+#endif
+
+class MadgwickAHRS : public IAttitudeFilter {
+public:
+	MadgwickAHRS() {
+		q[0] = 1.0f; q[1] = 0.0f; q[2] = 0.0f; q[3] = 0.0f;
+	}
+
+	//attitude from one accel and mag sample. the accel is expected as in the
+	//measurement model, -C' * [0 0 1]
+	void initialize(float *accel, float *mag) {
+		AHRSModel_Attitude(accel, mag, q);
+	}
+
+	void update(float *gyro, float *accel, float *mag, float dt) {
+		float a[3], m[3], f[6], g[4];
+		float q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+		float q0q0 = q0 * q0, q0q1 = q0 * q1, q0q2 = q0 * q2, q0q3 = q0 * q3;
+		float q1q1 = q1 * q1, q1q2 = q1 * q2, q1q3 = q1 * q3;
+		float q2q2 = q2 * q2, q2q3 = q2 * q3;
+		float q3q3 = q3 * q3;
+		float _2mx, _2my, _2mz, hx, hy, bx, bz;
+
+		if (!AHRSModel_Normalize(mag, m)){
+			updateIMU(gyro, accel, dt);
+			return;
+		}
+		//without a valid accel only the gyro is integrated
+		if (!AHRSModel_Normalize(accel, a)){
+			g[0] = g[1] = g[2] = g[3] = 0.0f;
+			integrate(gyro, g, dt);
+			return;
+		}
+
+		//reference field
+		_2mx = 2.0f * m[0]; _2my = 2.0f * m[1]; _2mz = 2.0f * m[2];
+		hx = _2mx * (0.5f - q2q2 - q3q3) + _2my * (q1q2 - q0q3) + _2mz * (q1q3 + q0q2);
+		hy = _2mx * (q1q2 + q0q3) + _2my * (0.5f - q1q1 - q3q3) + _2mz * (q2q3 - q0q1);
+		bz = _2mx * (q1q3 - q0q2) + _2my * (q2q3 + q0q1) + _2mz * (0.5f - q1q1 - q2q2);
+		bx = FastSqrt(hx * hx + hy * hy);
+
+		//f = u(q) - z
+		f[0] = -2.0f * (q1q3 - q0q2) - a[0];
+		f[1] = -2.0f * (q2q3 + q0q1) - a[1];
+		f[2] = 1.0f - 2.0f * (q0q0 + q3q3) - a[2];
+		f[3] = bx * (1.0f - 2.0f * (q2q2 + q3q3)) + bz * (2.0f * (q1q3 - q0q2)) - m[0];
+		f[4] = bx * (2.0f * (q1q2 - q0q3)) + bz * (2.0f * (q2q3 + q0q1)) - m[1];
+		f[5] = bx * (2.0f * (q1q3 + q0q2)) + bz * (1.0f - 2.0f * (q1q1 + q2q2)) - m[2];
+
+		//gradient J' * f
+		AHRSModel_Gradient(q, bx, bz, f, g);
+		integrate(gyro, g, dt);
+	}
+
+	//accel only, the heading follows the gyro
+	void updateIMU(float *gyro, float *accel, float dt) {
+		float a[3], f[3], g[4];
+		float q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+		float _2q0 = 2.0f * q0, _2q1 = 2.0f * q1, _2q2 = 2.0f * q2, _2q3 = 2.0f * q3;
+
+		//without a valid accel only the gyro is integrated
+		if (!AHRSModel_Normalize(accel, a)){
+			g[0] = g[1] = g[2] = g[3] = 0.0f;
+			integrate(gyro, g, dt);
+			return;
+		}
+
+		f[0] = -2.0f * (q1 * q3 - q0 * q2) - a[0];
+		f[1] = -2.0f * (q2 * q3 + q0 * q1) - a[1];
+		f[2] = 1.0f - 2.0f * (q0 * q0 + q3 * q3) - a[2];
+
+		g[0] = _2q2 * f[0] - _2q1 * f[1] - _2q0 * f[2];
+		g[1] = -_2q3 * f[0] - _2q0 * f[1] + _2q1 * f[2];
+		g[2] = _2q0 * f[0] - _2q3 * f[1] + _2q2 * f[2];
+		g[3] = -_2q1 * f[0] - _2q2 * f[1] - _2q3 * f[2];
+
+		integrate(gyro, g, dt);
+	}
+
+	void getQuaternion(float *Q) {
+		Q[0] = q[0]; Q[1] = q[1]; Q[2] = q[2]; Q[3] = q[3];
+	}
+
+	void getAngles(float *rpy) {
+		AHRSModel_Angles(q, rpy);
+	}
+
+private:
+	//q = q + (0.5 * q * [0 w] - beta * g / |g|) * dt
+	void integrate(float *gyro, float *g, float dt) {
+		float halfdt = 0.5f * dt, step, norm;
+		float q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+		float hx = halfdt * gyro[0], hy = halfdt * gyro[1], hz = halfdt * gyro[2];
+
+		norm = g[0] * g[0] + g[1] * g[1] + g[2] * g[2] + g[3] * g[3];
+		step = norm > 0.0f ? MADGWICK_BETA * dt * FastSqrtI(norm) : 0.0f;
+
+		q[0] = q0 - hx * q1 - hy * q2 - hz * q3 - step * g[0];
+		q[1] = q1 + hx * q0 - hy * q3 + hz * q2 - step * g[1];
+		q[2] = q2 + hx * q3 + hy * q0 - hz * q1 - step * g[2];
+		q[3] = q3 - hx * q2 + hy * q1 + hz * q0 - step * g[3];
+		norm = FastSqrtI(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+		q[0] *= norm; q[1] *= norm; q[2] *= norm; q[3] *= norm;
+	}
+
+	float q[4];
+};
+
+#endif
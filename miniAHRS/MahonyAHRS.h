@@ -0,0 +1,146 @@
+/*
+ * MahonyAHRS.h
+ *
+ *  Created on: 18 oct. 2026
+ */
+
+#ifndef MAHONYAHRS_H_
+#define MAHONYAHRS_H_
+
+#include "AHRSModel.h"
+#include "IAttitudeFilter.h"
+
+//////////////////////////////////////////////////////////////////////////
+//nonlinear complementary filter, after R. Mahony, T. Hamel and J. Pflimlin,
+//"Nonlinear Complementary Filters on the Special Orthogonal Group". the
+//error between the measured and the expected body vectors,
+//e = z_a x u_a + z_m x u_m with the sensor models of miniAHRS.h, feeds back
+//into the gyro rate through a PI controller:
+//  w = gyro + MAHONY_KP * e + integral(MAHONY_KI * e)
+//the integral term is the gyro bias estimate. no matrices, ~90 flops
+//without mag (updateIMU) and ~170 flops with it.
+//////////////////////////////////////////////////////////////////////////
+
+//all parameters below need to be tune
+#ifndef MAHONY_KP
+#define MAHONY_KP 0.5f //1/s
+#endif
+#ifndef MAHONY_KI
+#define MAHONY_KI 0.01f //1/s^2
+#endif
+
+class MahonyAHRS : public IAttitudeFilter {
+public:
+	MahonyAHRS() {
+		q[0] = 1.0f; q[1] = 0.0f; q[2] = 0.0f; q[3] = 0.0f;
+		integral[0] = 0.0f; integral[1] = 0.0f; integral[2] = 0.0f;
+	}
+
+	//attitude from one accel and mag sample. the accel is expected as in the
+	//measurement model, -C' * [0 0 1]
+	void initialize(float *accel, float *mag) {
+		AHRSModel_Attitude(accel, mag, q);
+	}
+
+	void update(float *gyro, float *accel, float *mag, float dt) {
+		float a[3], m[3], e[3], u[3], w[3];
+		float q0q0 = q[0] * q[0], q0q1 = q[0] * q[1], q0q2 = q[0] * q[2], q0q3 = q[0] * q[3];
+		float q1q1 = q[1] * q[1], q1q2 = q[1] * q[2], q1q3 = q[1] * q[3];
+		float q2q2 = q[2] * q[2], q2q3 = q[2] * q[3];
+		float q3q3 = q[3] * q[3];
+		float hx, hy, bx, bz;
+
+		if (!AHRSModel_Normalize(mag, m)){
+			updateIMU(gyro, accel, dt);
+			return;
+		}
+		//without a valid accel only the gyro is integrated
+		if (!AHRSModel_Normalize(accel, a)){
+			e[0] = e[1] = e[2] = 0.0f;
+			integrate(gyro, e, dt);
+			return;
+		}
+
+		//reference field, hx, hy and bz are half of C * mag
+		hx = m[0] * (0.5f - q2q2 - q3q3) + m[1] * (q1q2 - q0q3) + m[2] * (q1q3 + q0q2);
+		hy = m[0] * (q1q2 + q0q3) + m[1] * (0.5f - q1q1 - q3q3) + m[2] * (q2q3 - q0q1);
+		bz = m[0] * (q1q3 - q0q2) + m[1] * (q2q3 + q0q1) + m[2] * (0.5f - q1q1 - q2q2);
+		bx = FastSqrt(hx * hx + hy * hy);
+
+		//expected accel, -C' * [0 0 1], and mag, C' * [bx 0 bz]
+		u[0] = -2.0f * (q1q3 - q0q2);
+		u[1] = -2.0f * (q2q3 + q0q1);
+		u[2] = 1.0f - 2.0f * (q0q0 + q3q3);
+		w[0] = 2.0f * (bx * (0.5f - q2q2 - q3q3) + bz * (q1q3 - q0q2));
+		w[1] = 2.0f * (bx * (q1q2 - q0q3) + bz * (q2q3 + q0q1));
+		w[2] = 2.0f * (bx * (q1q3 + q0q2) + bz * (0.5f - q1q1 - q2q2));
+
+		e[0] = a[1] * u[2] - a[2] * u[1] + m[1] * w[2] - m[2] * w[1];
+		e[1] = a[2] * u[0] - a[0] * u[2] + m[2] * w[0] - m[0] * w[2];
+		e[2] = a[0] * u[1] - a[1] * u[0] + m[0] * w[1] - m[1] * w[0];
+
+		integrate(gyro, e, dt);
+	}
+
+	//accel only, the heading follows the gyro
+	void updateIMU(float *gyro, float *accel, float dt) {
+		float a[3], e[3], u[3];
+
+		//without a valid accel only the gyro is integrated
+		if (!AHRSModel_Normalize(accel, a)){
+			e[0] = e[1] = e[2] = 0.0f;
+			integrate(gyro, e, dt);
+			return;
+		}
+
+		u[0] = -2.0f * (q[1] * q[3] - q[0] * q[2]);
+		u[1] = -2.0f * (q[2] * q[3] + q[0] * q[1]);
+		u[2] = 1.0f - 2.0f * (q[0] * q[0] + q[3] * q[3]);
+
+		e[0] = a[1] * u[2] - a[2] * u[1];
+		e[1] = a[2] * u[0] - a[0] * u[2];
+		e[2] = a[0] * u[1] - a[1] * u[0];
+
+		integrate(gyro, e, dt);
+	}
+
+	void getQuaternion(float *Q) {
+		Q[0] = q[0]; Q[1] = q[1]; Q[2] = q[2]; Q[3] = q[3];
+	}
+
+	//gyro bias, the opposite of the integral term
+	void getBias(float *b) {
+		b[0] = -integral[0]; b[1] = -integral[1]; b[2] = -integral[2];
+	}
+
+	void getAngles(float *rpy) {
+		AHRSModel_Angles(q, rpy);
+	}
+
+private:
+	//PI feedback on the gyro rate, then q = q * [1, w * dt / 2]
+	void integrate(float *gyro, float *e, float dt) {
+		float halfdt = 0.5f * dt, ki = MAHONY_KI * dt, norm;
+		float q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+		float hx, hy, hz;
+
+		integral[0] += ki * e[0];
+		integral[1] += ki * e[1];
+		integral[2] += ki * e[2];
+		hx = halfdt * (gyro[0] + MAHONY_KP * e[0] + integral[0]);
+		hy = halfdt * (gyro[1] + MAHONY_KP * e[1] + integral[1]);
+		hz = halfdt * (gyro[2] + MAHONY_KP * e[2] + integral[2]);
+
+		q[0] = q0 - hx * q1 - hy * q2 - hz * q3;
+		q[1] = q1 + hx * q0 - hy * q3 + hz * q2;
+		q[2] = q2 + hx * q3 + hy * q0 - hz * q1;
+		q[3] = q3 - hx * q2 + hy * q1 + hz * q0;
+		norm = FastSqrtI(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+		q[0] *= norm; q[1] *= norm; q[2] *= norm; q[3] *= norm;
+	}
+
+	float q[4];
+	float integral[3];
+};
+
+#endif
@@ -0,0 +1,47 @@
+/*
+ * MiniAHRSFilter.h
+ *
+ *  Created on: 18 oct. 2026
+ */
+
+#ifndef MINIAHRSFILTER_H_
+#define MINIAHRSFILTER_H_
+
+#include "miniAHRS.h"
+#include "EKFParameters.h"
+#include "IAttitudeFilter.h"
+
+//////////////////////////////////////////////////////////////////////////
+//the EKF_AHRS* calls of miniAHRS.h behind IAttitudeFilter. the filter state
+//is file-static, so every instance shares the same EKF.
+//////////////////////////////////////////////////////////////////////////
+
+class MiniAHRSFilter : public IAttitudeFilter {
+public:
+	//EKF_AHRSInit takes the up vector, the accel is -C' * [0 0 1]
+	void initialize(float *accel, float *mag) {
+		float up[3] = {-accel[0], -accel[1], -accel[2]};
+		EKF_AHRSInit(up, mag);
+	}
+
+	//tuned noise parameters (EKFParameters.h), before initialize. returns 0
+	//and keeps the defaults if the file cannot be used
+	int loadParameters(const char *file) {
+		return EKF_AHRSLoadParameters(file);
+	}
+
+	void update(float *gyro, float *accel, float *mag, float dt) {
+		EKF_AHRSUpdate(gyro, accel, mag, dt);
+	}
+
+	void getQuaternion(float *q) {
+		EKF_AHRSGetQ(q);
+	}
+
+	//EKF_AHRSGetAngle already returns degrees
+	void getAngles(float *rpy) {
+		EKF_AHRSGetAngle(rpy);
+	}
+};
+
+#endif
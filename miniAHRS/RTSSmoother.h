@@ -0,0 +1,159 @@
+/*
+ * RTSSmoother.h
+ *
+ *  Created on: 18 oct. 2026
+ */
+
+#ifndef RTSSMOOTHER_H_
+#define RTSSMOOTHER_H_
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "miniAHRS.h"
+
+//////////////////////////////////////////////////////////////////////////
+//offline Rauch-Tung-Striebel smoother for the EKF of miniAHRS.h.
+//
+//the forward pass is the EKF itself: after the update of every sample
+//RTS_Record packs the filtered state, the upper triangle of P and the gyro
+//sample and interval of the prediction into that sample, and the caller
+//streams the records to a file. RTS_Smooth then walks the file from the
+//end in blocks of RTS_BLOCK records, so the memory is bounded for any log
+//length, and overwrites each filtered state with the smoothed one:
+//  x(k+1|k) and F from x(k|k) and the gyro of record k + 1
+//  P(k+1|k) = F * P(k|k) * F' + Q * dt / EKF_QDT_NOMINAL
+//  C = P(k|k) * F' / P(k+1|k)
+//  x(k|N) = x(k|k) + C * (x(k+1|N) - x(k+1|k))
+//  P(k|N) = P(k|k) + C * (P(k+1|N) - P(k+1|k)) * C'
+//the predictions are recomputed with EKF_AHRSPredictState instead of
+//stored, which halves the record, and they match the forward pass exactly.
+//RTS_Smooth uses the EKF state and F as scratch, run it after the forward
+//pass.
+//////////////////////////////////////////////////////////////////////////
+
+//records per block of the backward pass
+#ifndef RTS_BLOCK
+#define RTS_BLOCK 4096
+#endif
+
+#define RTS_P_SIZE (EKF_STATE_DIM * (EKF_STATE_DIM + 1) / 2)
+
+typedef struct
+{
+	float x[EKF_STATE_DIM];   //filtered, smoothed after RTS_Smooth
+	float p[RTS_P_SIZE];      //filtered P, upper triangle by rows
+	float gyro[3];            //prediction into this sample
+	float dt;
+	long long time;           //us
+} RTSRecord;
+
+static RTSRecord RTSBlock[RTS_BLOCK];
+
+//the EKF after the update of a sample, predicted with gyro over dt
+void RTS_Record(RTSRecord *r, const float *gyro, float dt, long long time)
+{
+	float cov[EKF_STATE_DIM * EKF_STATE_DIM];
+	unsigned int n = 0;
+
+	EKF_AHRSGetCovariance(cov);
+	for (unsigned int i = 0; i < EKF_STATE_DIM; i++){
+		r->x[i] = X[i];
+		for (unsigned int j = i; j < EKF_STATE_DIM; j++){
+			r->p[n++] = cov[i * EKF_STATE_DIM + j];
+		}
+	}
+	r->gyro[0] = gyro[0]; r->gyro[1] = gyro[1]; r->gyro[2] = gyro[2];
+	r->dt = dt;
+	r->time = time;
+}
+
+static void RTS_Unpack(const RTSRecord *r, Mat<EKF_STATE_DIM, EKF_STATE_DIM> &Pk)
+{
+	unsigned int n = 0;
+
+	for (unsigned int i = 0; i < EKF_STATE_DIM; i++){
+		for (unsigned int j = i; j < EKF_STATE_DIM; j++){
+			Pk(i, j) = r->p[n];
+			Pk(j, i) = r->p[n++];
+		}
+	}
+}
+
+//record k from filtered to smoothed. next is record k + 1, already
+//smoothed, and Ps goes from P(k+1|N) to P(k|N)
+static void RTS_Step(RTSRecord *r, const RTSRecord *next, Mat<EKF_STATE_DIM, EKF_STATE_DIM> &Ps)
+{
+	Mat<EKF_STATE_DIM, EKF_STATE_DIM> Pk, Pp, FP, Pi, Ct, C, T;
+	float gyro[3] = {next->gyro[0], next->gyro[1], next->gyro[2]};
+	float dx[EKF_STATE_DIM], norm;
+
+	RTS_Unpack(r, Pk);
+	for (unsigned int i = 0; i < EKF_STATE_DIM; i++){
+		X[i] = r->x[i];
+	}
+	EKF_AHRSPredictState(gyro, next->dt);
+	Mat_Multiply(F, Pk, FP);
+	Mat_MultiplyTransB(FP, F, Pp);
+	for (unsigned int i = 0; i < EKF_STATE_DIM; i++){
+		Pp(i, i) += Q(i, i) * next->dt / EKF_QDT_NOMINAL;
+		dx[i] = next->x[i] - X[i];
+	}
+
+	//C' = P(k+1|k) \ (F * P(k|k)), P(k+1|k) is symmetric
+	Mat_Inverse(Pp, Pi);
+	Mat_Multiply(Pi, FP, Ct);
+	Mat_Transpose(Ct, C);
+
+	for (unsigned int i = 0; i < EKF_STATE_DIM; i++){
+		float s = r->x[i];
+		for (unsigned int j = 0; j < EKF_STATE_DIM; j++){
+			s += C(i, j) * dx[j];
+		}
+		r->x[i] = s;
+	}
+	norm = FastSqrtI(r->x[0] * r->x[0] + r->x[1] * r->x[1] + r->x[2] * r->x[2] + r->x[3] * r->x[3]);
+	r->x[0] *= norm; r->x[1] *= norm; r->x[2] *= norm; r->x[3] *= norm;
+
+	Mat_Sub(Ps, Pp, Pp);
+	Mat_Multiply(Pp, Ct, T);
+	Mat_Multiply(C, T, Ps);
+	Mat_Add(Pk, Ps, Ps);
+}
+
+//smooths the count records of f in place, block by block from the end.
+//returns 0 on a read or write error
+int RTS_Smooth(FILE *f, long long count)
+{
+	Mat<EKF_STATE_DIM, EKF_STATE_DIM> Ps;
+	RTSRecord next;
+	long long end = count;
+
+	memset(&next, 0, sizeof(next));
+	while (end > 0){
+		long long start = end > RTS_BLOCK ? end - RTS_BLOCK : 0;
+		size_t n = (size_t)(end - start);
+
+		if (fseeko(f, (off_t)(start * sizeof(RTSRecord)), SEEK_SET) != 0 || fread(RTSBlock, sizeof(RTSRecord), n, f) != n){
+			return 0;
+		}
+		for (long long k = end - 1; k >= start; k--){
+			RTSRecord *r = &RTSBlock[k - start];
+			if (k == count - 1){
+				//the last filtered sample is already smoothed
+				RTS_Unpack(r, Ps);
+			} else {
+				RTS_Step(r, &next, Ps);
+			}
+			next = *r;
+		}
+		if (fseeko(f, (off_t)(start * sizeof(RTSRecord)), SEEK_SET) != 0 || fwrite(RTSBlock, sizeof(RTSRecord), n, f) != n){
+			return 0;
+		}
+		end = start;
+	}
+	return fflush(f) == 0;
+}
+
+#endif
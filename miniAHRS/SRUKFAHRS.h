@@ -0,0 +1,440 @@
+/*
+ * SRUKFAHRS.h
+ *
+ *  Created on: 18 oct. 2026
+ */
+
+#ifndef SRUKFAHRS_H_
+#define SRUKFAHRS_H_
+
+#include <math.h>
+
+#include "miniAHRS.h"
+#include "AHRSModel.h"
+#include "IAttitudeFilter.h"
+
+//////////////////////////////////////////////////////////////////////////
+//square-root unscented Kalman filter over the state of miniAHRS.h
+//(q0 q1 q2 q3 wxb wyb wzb) with the same process and sensor models, after
+//R. van der Merwe and E. A. Wan, "The square-root unscented Kalman filter
+//for state and parameter-estimation", ICASSP 2001.
+//
+//the models are evaluated at 2n + 1 sigma points instead of being
+//linearized, so fast rotations do not need a larger Q to hide the
+//linearization error. the filter carries the lower Cholesky factor S of P:
+//every covariance comes out of an LQ factorization of the weighted sigma
+//deviations and the noise, the posterior one from the deviations left
+//after the gain, X - x - K * (Y - y), and K * sqrt(R). there are no
+//downdates (except for a negative center weight), so P = S * S' stays
+//symmetric positive definite in single precision.
+//
+//the sigma points are stored by state component, X[r][l] is component r
+//of sigma point l, padded to SRUKF_LANES. the process and measurement
+//models are then one loop over the lanes per component, which the
+//compiler turns into SIMD code; the padding lane carries the mean with a
+//zero weight. every array is a member, nothing is allocated.
+//
+//the reference field bx, bz is taken once from the measured mag at the
+//predicted mean, as in EKF_AHRSUpdate. the sensor models use the rotation
+//matrix of q / |q| (the quadratic form divided by |q|^2), the sigma points
+//spread off the unit sphere and the plain quadratic form would scale the
+//predicted vectors with |q|^2.
+//////////////////////////////////////////////////////////////////////////
+
+#define SRUKF_N EKF_STATE_DIM
+#define SRUKF_M EKF_MEASUREMENT_DIM
+#define SRUKF_SIGMA (2 * SRUKF_N + 1)
+//sigma points padded to whole SIMD vectors (2 x 8 or 4 x 4 floats)
+#define SRUKF_LANES 16
+//columns of the matrices to triangularize: the sigma deviations and the
+//square root of the noise, padded
+#define SRUKF_COLS (SRUKF_LANES + 8)
+
+//sigma point spread and weights, alpha = 1 and kappa = 0 put the points at
+//sqrt(n) standard deviations, beta = 2 is optimal for a gaussian prior
+#ifndef SRUKF_ALPHA
+#define SRUKF_ALPHA 1.0f
+#endif
+#ifndef SRUKF_BETA
+#define SRUKF_BETA 2.0f
+#endif
+#ifndef SRUKF_KAPPA
+#define SRUKF_KAPPA 0.0f
+#endif
+//process noise per EKF_QDT_NOMINAL step. EKF_QQ_INITIAL also covers the
+//linearization error of the EKF, here it would spread the sigma points
+//far off the unit sphere
+#ifndef SRUKF_QQ
+#define SRUKF_QQ 0.0001f
+#endif
+#ifndef SRUKF_QWB
+#define SRUKF_QWB EKF_QWB_INITIAL
+#endif
+//floor on the variance left by a downdate, rounding can take it below zero
+#define SRUKF_MIN_VARIANCE 1e-12f
+
+class SRUKFAHRS : public IAttitudeFilter {
+public:
+	SRUKFAHRS() {
+		float lambda = SRUKF_ALPHA * SRUKF_ALPHA * (SRUKF_N + SRUKF_KAPPA) - SRUKF_N;
+		float wm0 = lambda / (SRUKF_N + lambda);
+		float w = 0.5f / (SRUKF_N + lambda);
+
+		gamma = sqrtf(SRUKF_N + lambda);
+		wc0 = wm0 + 1.0f - SRUKF_ALPHA * SRUKF_ALPHA + SRUKF_BETA;
+		for (int l = 0; l < SRUKF_LANES; l++){
+			Wm[l] = l == 0 ? wm0 : (l < SRUKF_SIGMA ? w : 0.0f);
+			Wc[l] = l == 0 ? wc0 : Wm[l];
+			//a negative center weight is applied as a downdate instead
+			sqrtWc[l] = Wc[l] > 0.0f ? sqrtf(Wc[l]) : 0.0f;
+		}
+
+		x[0] = 1.0f;
+		for (int i = 1; i < SRUKF_N; i++){
+			x[i] = 0.0f;
+		}
+		for (int i = 0; i < SRUKF_N; i++){
+			for (int j = 0; j < SRUKF_N; j++){
+				S[i][j] = 0.0f;
+			}
+			S[i][i] = sqrtf(i < 4 ? EKF_PQ_INITIAL : EKF_PWB_INITIAL);
+			sqrtQ[i] = sqrtf(i < 4 ? SRUKF_QQ : SRUKF_QWB);
+		}
+		for (int i = 0; i < SRUKF_M; i++){
+			sqrtR[i] = sqrtf(i < 3 ? EKF_RA_INITIAL : EKF_RM_INITIAL);
+		}
+	}
+
+	//attitude from one accel and mag sample. the accel is expected as in the
+	//measurement model, -C' * [0 0 1]
+	void initialize(float *accel, float *mag) {
+		AHRSModel_Attitude(accel, mag, x);
+	}
+
+	void predict(float *gyro, float dt) {
+		float halfdt = 0.5f * dt;
+		//process noise is tuned for EKF_QDT_NOMINAL steps, as in miniAHRS.h
+		float sq = sqrtf(dt / EKF_QDT_NOMINAL);
+
+		sigma();
+		//q = q + dt / 2 * q * (0, w - b), lane by lane
+		for (int l = 0; l < SRUKF_LANES; l++){
+			float q0 = X[0][l], q1 = X[1][l], q2 = X[2][l], q3 = X[3][l];
+			float hx = halfdt * (gyro[0] - X[4][l]);
+			float hy = halfdt * (gyro[1] - X[5][l]);
+			float hz = halfdt * (gyro[2] - X[6][l]);
+			X[0][l] = q0 - hx * q1 - hy * q2 - hz * q3;
+			X[1][l] = q1 + hx * q0 - hy * q3 + hz * q2;
+			X[2][l] = q2 + hx * q3 + hy * q0 - hz * q1;
+			X[3][l] = q3 - hx * q2 + hy * q1 + hz * q0;
+		}
+		mean(X, x, SRUKF_N);
+
+		//S = lq([sqrt(Wc) * (X - x), sqrt(Q)])
+		for (int r = 0; r < SRUKF_N; r++){
+			for (int l = 0; l < SRUKF_LANES; l++){
+				X[r][l] -= x[r];
+				A[r][l] = sqrtWc[l] * X[r][l];
+			}
+			for (int c = SRUKF_LANES; c < SRUKF_COLS; c++){
+				A[r][c] = c - SRUKF_LANES == r ? sqrtQ[r] * sq : 0.0f;
+			}
+		}
+		triangularize(A, SRUKF_N, &S[0][0], SRUKF_N);
+		if (wc0 < 0.0f){
+			centerDowndate(X, &S[0][0], SRUKF_N);
+		}
+		normalize();
+	}
+
+	//without a valid accel or mag the prediction is kept
+	void correct(float *accel, float *mag) {
+		float a[3], m[3], bx, bz;
+		float dy[SRUKF_M];
+
+		if (!AHRSModel_Normalize(accel, a) || !AHRSModel_Normalize(mag, m)){
+			return;
+		}
+		reference(m, &bx, &bz);
+
+		//sigma points of the prediction through the sensor models
+		sigma();
+		for (int l = 0; l < SRUKF_LANES; l++){
+			float q0 = X[0][l], q1 = X[1][l], q2 = X[2][l], q3 = X[3][l];
+			float q0q0 = q0 * q0, q0q1 = q0 * q1, q0q2 = q0 * q2, q0q3 = q0 * q3;
+			float q1q1 = q1 * q1, q1q2 = q1 * q2, q1q3 = q1 * q3;
+			float q2q2 = q2 * q2, q2q3 = q2 * q3, q3q3 = q3 * q3;
+			float n = 2.0f / (q0q0 + q1q1 + q2q2 + q3q3);
+			float c00 = 0.5f * n * (q0q0 + q1q1 - q2q2 - q3q3);
+			float c22 = 0.5f * n * (q0q0 - q1q1 - q2q2 + q3q3);
+			float c20 = n * (q1q3 - q0q2), c21 = n * (q2q3 + q0q1);
+			Y[0][l] = -c20;
+			Y[1][l] = -c21;
+			Y[2][l] = -c22;
+			Y[3][l] = bx * c00 + bz * c20;
+			Y[4][l] = bx * n * (q1q2 - q0q3) + bz * c21;
+			Y[5][l] = bx * n * (q1q3 + q0q2) + bz * c22;
+		}
+		mean(Y, y, SRUKF_M);
+
+		//Sy = lq([sqrt(Wc) * (Y - y), sqrt(R)])
+		for (int r = 0; r < SRUKF_M; r++){
+			for (int l = 0; l < SRUKF_LANES; l++){
+				Y[r][l] -= y[r];
+				A[r][l] = sqrtWc[l] * Y[r][l];
+			}
+			for (int c = SRUKF_LANES; c < SRUKF_COLS; c++){
+				A[r][c] = c - SRUKF_LANES == r ? sqrtR[r] : 0.0f;
+			}
+		}
+		triangularize(A, SRUKF_M, &Sy[0][0], SRUKF_M);
+		if (wc0 < 0.0f){
+			centerDowndate(Y, &Sy[0][0], SRUKF_M);
+		}
+
+		//Pxy' = sum Wc * (Y - y) * (X - x)', the sigma points are symmetric
+		//about x so their mean is x
+		for (int r = 0; r < SRUKF_N; r++){
+			for (int l = 0; l < SRUKF_LANES; l++){
+				X[r][l] -= x[r];
+			}
+		}
+		for (int j = 0; j < SRUKF_M; j++){
+			float wy[SRUKF_LANES];
+			for (int l = 0; l < SRUKF_LANES; l++){
+				wy[l] = Wc[l] * Y[j][l];
+			}
+			for (int i = 0; i < SRUKF_N; i++){
+				K[j][i] = dot<SRUKF_LANES>(X[i], wy);
+			}
+			K[j][SRUKF_N] = 0.0f;
+		}
+
+		//K' = (Sy * Sy') \ Pxy', forward and back substitution on the rows
+		//of K', all the states at once
+		for (int j = 0; j < SRUKF_M; j++){
+			float d = 1.0f / Sy[j][j];
+			for (int c = 0; c < j; c++){
+				for (int i = 0; i < 8; i++){
+					K[j][i] -= Sy[j][c] * K[c][i];
+				}
+			}
+			for (int i = 0; i < 8; i++){
+				K[j][i] *= d;
+			}
+		}
+		for (int j = SRUKF_M - 1; j >= 0; j--){
+			float d = 1.0f / Sy[j][j];
+			for (int c = j + 1; c < SRUKF_M; c++){
+				for (int i = 0; i < 8; i++){
+					K[j][i] -= Sy[c][j] * K[c][i];
+				}
+			}
+			for (int i = 0; i < 8; i++){
+				K[j][i] *= d;
+			}
+		}
+
+		//x = x + K * (z - y)
+		dy[0] = a[0] - y[0]; dy[1] = a[1] - y[1]; dy[2] = a[2] - y[2];
+		dy[3] = m[0] - y[3]; dy[4] = m[1] - y[4]; dy[5] = m[2] - y[5];
+		for (int j = 0; j < SRUKF_M; j++){
+			for (int i = 0; i < SRUKF_N; i++){
+				x[i] += K[j][i] * dy[j];
+			}
+		}
+
+		//S = lq([sqrt(Wc) * (X - x - K * (Y - y)), K * sqrt(R)]), the
+		//posterior covariance P - K * Pyy * K' without downdates
+		for (int r = 0; r < SRUKF_N; r++){
+			for (int j = 0; j < SRUKF_M; j++){
+				for (int l = 0; l < SRUKF_LANES; l++){
+					X[r][l] -= K[j][r] * Y[j][l];
+				}
+			}
+			for (int l = 0; l < SRUKF_LANES; l++){
+				A[r][l] = sqrtWc[l] * X[r][l];
+			}
+			for (int c = SRUKF_LANES; c < SRUKF_COLS; c++){
+				A[r][c] = c - SRUKF_LANES < SRUKF_M ? K[c - SRUKF_LANES][r] * sqrtR[c - SRUKF_LANES] : 0.0f;
+			}
+		}
+		triangularize(A, SRUKF_N, &S[0][0], SRUKF_N);
+		if (wc0 < 0.0f){
+			centerDowndate(X, &S[0][0], SRUKF_N);
+		}
+		normalize();
+	}
+
+	//same call as EKF_AHRSUpdate
+	void update(float *gyro, float *accel, float *mag, float dt) {
+		predict(gyro, dt);
+		correct(accel, mag);
+	}
+
+	void getQuaternion(float *q) {
+		q[0] = x[0]; q[1] = x[1]; q[2] = x[2]; q[3] = x[3];
+	}
+
+	void getBias(float *b) {
+		b[0] = x[4]; b[1] = x[5]; b[2] = x[6];
+	}
+
+	void getAngles(float *rpy) {
+		AHRSModel_Angles(x, rpy);
+	}
+
+	//P = S * S', row major
+	void getCovariance(float *P) {
+		for (int i = 0; i < SRUKF_N; i++){
+			for (int j = 0; j < SRUKF_N; j++){
+				float s = 0.0f;
+				for (int c = 0; c <= (i < j ? i : j); c++){
+					s += S[i][c] * S[j][c];
+				}
+				P[i * SRUKF_N + j] = s;
+			}
+		}
+	}
+
+private:
+	//sum of a[i] * b[i] over a multiple of 8 lanes, accumulated in 8
+	//partial sums and folded as a tree so it vectorizes without reordering
+	//a serial reduction
+	template <int N>
+	static float dot(const float *a, const float *b) {
+		float p[8];
+		for (int l = 0; l < 8; l++){
+			p[l] = a[l] * b[l];
+		}
+		for (int k = 8; k < N; k += 8){
+			for (int l = 0; l < 8; l++){
+				p[l] += a[k + l] * b[k + l];
+			}
+		}
+		for (int l = 0; l < 4; l++){
+			p[l] += p[l + 4];
+		}
+		return (p[0] + p[2]) + (p[1] + p[3]);
+	}
+
+	//X = [x, x + gamma * S, x - gamma * S, x]
+	void sigma() {
+		for (int r = 0; r < SRUKF_N; r++){
+			X[r][0] = x[r];
+			for (int c = 0; c < SRUKF_N; c++){
+				X[r][1 + c] = x[r] + gamma * S[r][c];
+				X[r][1 + SRUKF_N + c] = x[r] - gamma * S[r][c];
+			}
+			for (int l = SRUKF_SIGMA; l < SRUKF_LANES; l++){
+				X[r][l] = x[r];
+			}
+		}
+	}
+
+	void mean(float (*Z)[SRUKF_LANES], float *z, int rows) {
+		for (int r = 0; r < rows; r++){
+			z[r] = dot<SRUKF_LANES>(Wm, Z[r]);
+		}
+	}
+
+	void normalize() {
+		float norm = FastSqrtI(x[0] * x[0] + x[1] * x[1] + x[2] * x[2] + x[3] * x[3]);
+		x[0] *= norm; x[1] *= norm; x[2] *= norm; x[3] *= norm;
+	}
+
+	//bx, bz of the measured mag in the navigation frame at the mean
+	void reference(const float *mag, float *bx, float *bz) {
+		float q0q1 = x[0] * x[1], q0q2 = x[0] * x[2], q0q3 = x[0] * x[3];
+		float q1q1 = x[1] * x[1], q1q2 = x[1] * x[2], q1q3 = x[1] * x[3];
+		float q2q2 = x[2] * x[2], q2q3 = x[2] * x[3], q3q3 = x[3] * x[3];
+		float _2mx = 2.0f * mag[0], _2my = 2.0f * mag[1], _2mz = 2.0f * mag[2];
+		float hx = _2mx * (0.5f - q2q2 - q3q3) + _2my * (q1q2 - q0q3) + _2mz * (q1q3 + q0q2);
+		float hy = _2mx * (q1q2 + q0q3) + _2my * (0.5f - q1q1 - q3q3) + _2mz * (q2q3 - q0q1);
+		*bx = sqrtf(hx * hx + hy * hy);
+		*bz = _2mx * (q1q3 - q0q2) + _2my * (q2q3 + q0q1) + _2mz * (0.5f - q1q1 - q2q2);
+	}
+
+	//lower triangular L (rows x rows, row major) with L * L' = A * A', from
+	//Householder reflections of the rows of A (A = L * Q). A is overwritten.
+	//the reflector of row i is applied to the rows below over the whole
+	//padded width, the entries before column i are zero
+	static void triangularize(float (*M)[SRUKF_COLS], int rows, float *L, int ld) {
+		float v[SRUKF_COLS];
+
+		for (int i = 0; i < rows; i++){
+			float norm, vv, alpha;
+			for (int c = 0; c < SRUKF_COLS; c++){
+				v[c] = c < i ? 0.0f : M[i][c];
+			}
+			norm = sqrtf(dot<SRUKF_COLS>(v, v));
+			if (norm == 0.0f){
+				continue;
+			}
+			//the sign avoids cancellation, L(i, i) = alpha is made positive below
+			alpha = v[i] > 0.0f ? -norm : norm;
+			v[i] -= alpha;
+			vv = 1.0f / (norm * (norm + fabsf(M[i][i])));
+			M[i][i] = alpha;
+			for (int r = i + 1; r < rows; r++){
+				float t = vv * dot<SRUKF_COLS>(M[r], v);
+				for (int c = 0; c < SRUKF_COLS; c++){
+					M[r][c] -= t * v[c];
+				}
+			}
+		}
+		//a column of L can change sign, Q takes the opposite one
+		for (int j = 0; j < rows; j++){
+			float sign = M[j][j] < 0.0f ? -1.0f : 1.0f;
+			for (int i = 0; i < rows; i++){
+				L[i * ld + j] = i < j ? 0.0f : sign * M[i][j];
+			}
+		}
+	}
+
+	//L * L' + sign * v * v' for lower triangular L (n x n, row major), v is
+	//destroyed
+	static void cholUpdate(float *L, int n, float *v, float sign) {
+		for (int k = 0; k < n; k++){
+			float lkk = L[k * n + k];
+			float r2 = lkk * lkk + sign * v[k] * v[k];
+			float r, c, s, ic;
+			if (r2 < SRUKF_MIN_VARIANCE){
+				r2 = SRUKF_MIN_VARIANCE;
+			}
+			r = sqrtf(r2);
+			c = r / lkk;
+			s = v[k] / lkk;
+			ic = lkk / r;
+			L[k * n + k] = r;
+			for (int i = k + 1; i < n; i++){
+				L[i * n + k] = (L[i * n + k] + sign * s * v[i]) * ic;
+				v[i] = c * v[i] - s * L[i * n + k];
+			}
+		}
+	}
+
+	//negative center weight: L * L' - |Wc0| * D0 * D0', D holds the sigma
+	//deviations
+	void centerDowndate(float (*D)[SRUKF_LANES], float *L, int n) {
+		float v[SRUKF_N];
+		float w = sqrtf(-wc0);
+		for (int r = 0; r < n; r++){
+			v[r] = w * D[r][0];
+		}
+		cholUpdate(L, n, v, -1.0f);
+	}
+
+	float gamma, wc0;
+	float Wm[SRUKF_LANES], Wc[SRUKF_LANES], sqrtWc[SRUKF_LANES];
+	float sqrtQ[SRUKF_N], sqrtR[SRUKF_M];
+	float x[SRUKF_N], y[SRUKF_M];
+	float S[SRUKF_N][SRUKF_N], Sy[SRUKF_M][SRUKF_M];
+	//gain, transposed and padded so a row covers the state in one vector
+	float K[SRUKF_M][8];
+	//sigma points by component
+	float X[SRUKF_N][SRUKF_LANES], Y[SRUKF_M][SRUKF_LANES];
+	float A[SRUKF_N][SRUKF_COLS];
+};
+
+#endif
@@ -29,7 +29,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "FastMath.h"
 #include "Quaternion.h"
 #include "miniAHRS.h"
-#include "miniMatrix.h"
+#include "FixedMatrix.h"
+#include "GyroPreintegration.h"
 
 #define EKF_STATE_DIM 7 //q0 q1 q2 q3 wxb wyb wzb
 #define EKF_MEASUREMENT_DIM 6 //ax ay az and mx my mz
@@ -41,7 +42,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 //////////////////////////////////////////////////////////////////////////
 //
-//all parameters below need to be tune
+//all parameters below need to be tune. the noise ones are the defaults,
+//EKF_AHRSLoadParameters (EKFParameters.h) replaces them at run time with a
+//file written by AHRSTools/tuner
 #define EKF_PQ_INITIAL 0.001f
 #define EKF_PWB_INITIAL 0.001f
 
@@ -50,12 +53,74 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #define EKF_RA_INITIAL 0.005346f
 #define EKF_RM_INITIAL 0.005346f
+
+//sample period the process noise above was tuned for, Q is scaled by
+//dt / EKF_QDT_NOMINAL on every prediction
+#define EKF_QDT_NOMINAL 0.01f
+
+//steady-state gain: K is averaged over windows of EKF_SS_SETTLE updates and
+//is converged when two windows in a row differ less than
+//EKF_SS_TOLERANCE * max|K|. the attitude range of a stored gain (cosine of
+//half the angle, 0.99905 ~ 5 deg) and the NIS that sends the filter back to
+//the full update (chi-square, 6 dof, 99.9%)
+#define EKF_SS_SETTLE 50
+#define EKF_SS_TOLERANCE 0.01f
+#define EKF_SS_COS 0.99905f
+#define EKF_SS_NIS_MAX 22.46f
+#define EKF_SS_TABLE_SIZE 8
 //////////////////////////////////////////////////////////////////////////
 //
+//P - K*H*P instead of the Joseph form, cheaper but P drifts away from
+//symmetric positive definite in single precision
+#if !defined(EKF_SIMPLE_COVARIANCE_UPDATE) && !defined(EKF_MIXED_COVARIANCE)
 #define UPDATE_P_COMPLICATED
+#endif
+//P is accumulated in the float-float Double of Double.h: P holds the high
+//words and PL the low ones. the state, the gain and the increments of P
+//stay in float, only their sum into P is emulated, see EKF_AHRSAccumulate
+//#define EKF_MIXED_COVARIANCE
+//P is kept as U*D*U' (U unit upper triangular, D diagonal), propagated with
+//Thornton's weighted Gram-Schmidt and updated one measurement row at a time
+//with Bierman's algorithm, see EKF_AHRSThornton and EKF_AHRSBierman.
+//P stays exactly symmetric, but against the Joseph form on
+//AHRSTools/udBenchmarkUD it is slower (1150 vs 860 ns per update) and
+//farther from the double precision twin (3.7e-3 vs 1.2e-3). the Joseph
+//form keeps its precision with Q scaled down to 1e-12 (2.9e-3 vs 2.1e-3),
+//so the UD form is kept for comparison only
+//#define EKF_UD_COVARIANCE
+//predictions only compose the transition matrix and P is propagated when an
+//update or EKF_AHRSGetCovariance needs it, see EKF_AHRSPropagate
+//#define EKF_LAZY_COVARIANCE
+//EKF_AHRSUpdate freezes K once it has converged and skips P and S until the
+//innovations stop fitting it, see EKF_AHRSSteadyUpdate
+//#define EKF_STEADY_STATE_GAIN
+//the Joseph form path with the straight-line kernels of EKFKernels.h,
+//generated from the models of F and H by AHRSTools/ekfCodeGen ("make
+//codegen"): no products by the zeros and ones of F and H, S solved by LDL'
+//instead of inverted, half of the symmetric products
+//#define EKF_GENERATED_KERNELS
+
+#if defined(EKF_UD_COVARIANCE) && defined(EKF_STEADY_STATE_GAIN)
+#error "EKF_STEADY_STATE_GAIN learns from the innovation covariance, which the UD update never forms"
+#endif
+#if defined(EKF_UD_COVARIANCE) && defined(EKF_MIXED_COVARIANCE)
+#error "EKF_MIXED_COVARIANCE accumulates P itself, the UD update keeps its factors instead"
+#endif
+
+#if defined(EKF_GENERATED_KERNELS) && (defined(EKF_UD_COVARIANCE) || defined(EKF_MIXED_COVARIANCE) \
+	|| defined(EKF_SIMPLE_COVARIANCE_UPDATE) || defined(EKF_STEADY_STATE_GAIN))
+#error "EKF_GENERATED_KERNELS replaces the Joseph form path, the other covariance forms keep their own"
+#endif
+
+#ifdef EKF_MIXED_COVARIANCE
+#include "Double.h"
+#endif
+#ifdef EKF_GENERATED_KERNELS
+#include "EKFKernels.h"
+#endif
 
 #ifdef UPDATE_P_COMPLICATED
-static float I[EKF_STATE_DIM * EKF_STATE_DIM] = {
+static Mat<EKF_STATE_DIM, EKF_STATE_DIM> I = {{
 	1.0f, 0, 0, 0, 0, 0, 0,
 	0, 1.0f, 0, 0, 0, 0, 0,
 	0, 0, 1.0f, 0, 0, 0, 0,
@@ -63,10 +128,13 @@ static float I[EKF_STATE_DIM * EKF_STATE_DIM] = {
 	0, 0, 0, 0, 1.0f, 0, 0,
 	0, 0, 0, 0, 0, 1.0f, 0,
 	0, 0, 0, 0, 0, 0, 1.0f,
-};
+}};
 #endif
 
-static float P[EKF_STATE_DIM * EKF_STATE_DIM] = {
+//with EKF_UD_COVARIANCE P holds the factors packed: D on the diagonal, U'
+//below it (row j holds column j of U) and zeros above. the initial P is
+//diagonal, so U = I
+static Mat<EKF_STATE_DIM, EKF_STATE_DIM> P = {{
 	EKF_PQ_INITIAL, 0, 0, 0, 0, 0, 0,
 	0, EKF_PQ_INITIAL, 0, 0, 0, 0, 0,
 	0, 0, EKF_PQ_INITIAL, 0, 0, 0, 0,
@@ -74,9 +142,15 @@ static float P[EKF_STATE_DIM * EKF_STATE_DIM] = {
 	0, 0, 0, 0, EKF_PWB_INITIAL, 0, 0,
 	0, 0, 0, 0, 0, EKF_PWB_INITIAL, 0,
 	0, 0, 0, 0, 0, 0, EKF_PWB_INITIAL,
-};
+}};
+
+#ifdef EKF_MIXED_COVARIANCE
+//low words of P. anything that writes P alone leaves at most half an ulp
+//of P behind in PL, so it needs no reset
+static Mat<EKF_STATE_DIM, EKF_STATE_DIM> PL;
+#endif
 
-static float Q[EKF_STATE_DIM * EKF_STATE_DIM] = {
+static Mat<EKF_STATE_DIM, EKF_STATE_DIM> Q = {{
 	EKF_QQ_INITIAL, 0, 0, 0, 0, 0, 0,
 	0, EKF_QQ_INITIAL, 0, 0, 0, 0, 0,
 	0, 0, EKF_QQ_INITIAL, 0, 0, 0, 0,
@@ -84,18 +158,18 @@ static float Q[EKF_STATE_DIM * EKF_STATE_DIM] = {
 	0, 0, 0, 0, EKF_QWB_INITIAL, 0, 0,
 	0, 0, 0, 0, 0, EKF_QWB_INITIAL, 0,
 	0, 0, 0, 0, 0, 0, EKF_QWB_INITIAL,
-};
+}};
 
-static float R[EKF_MEASUREMENT_DIM * EKF_MEASUREMENT_DIM] = {
+static Mat<EKF_MEASUREMENT_DIM, EKF_MEASUREMENT_DIM> R = {{
 	EKF_RA_INITIAL, 0, 0, 0, 0, 0,
 	0, EKF_RA_INITIAL, 0, 0, 0, 0,
 	0, 0, EKF_RA_INITIAL, 0, 0, 0,
 	0, 0, 0, EKF_RM_INITIAL, 0, 0,
 	0, 0, 0, 0, EKF_RM_INITIAL, 0,
 	0, 0, 0, 0, 0, EKF_RM_INITIAL,
-};
+}};
 
-static float F[EKF_STATE_DIM * EKF_STATE_DIM] = {
+static Mat<EKF_STATE_DIM, EKF_STATE_DIM> F = {{
 	1.0f, 0, 0, 0, 0, 0, 0,
 	0, 1.0f, 0, 0, 0, 0, 0,
 	0, 0, 1.0f, 0, 0, 0, 0,
@@ -103,30 +177,72 @@ static float F[EKF_STATE_DIM * EKF_STATE_DIM] = {
 	0, 0, 0, 0, 1.0f, 0, 0,
 	0, 0, 0, 0, 0, 1.0f, 0,
 	0, 0, 0, 0, 0, 0, 1.0f,
-};
+}};
 
-static float H[EKF_MEASUREMENT_DIM * EKF_STATE_DIM] = {
+static Mat<EKF_MEASUREMENT_DIM, EKF_STATE_DIM> H = {{
 	0, 0, 0, 0, 0, 0, 0,
 	0, 0, 0, 0, 0, 0, 0,
 	0, 0, 0, 0, 0, 0, 0,
 	0, 0, 0, 0, 0, 0, 0,
 	0, 0, 0, 0, 0, 0, 0,
 	0, 0, 0, 0, 0, 0, 0,
-};
+}};
 
 //state
-static float X[EKF_STATE_DIM];
-static float KY[EKF_STATE_DIM];
+static Mat<EKF_STATE_DIM, 1> X;
+static Mat<EKF_STATE_DIM, 1> KY;
 //measurement
-static float Y[EKF_MEASUREMENT_DIM];
+static Mat<EKF_MEASUREMENT_DIM, 1> Y;
 //
 static float CBn[9];
 //
-static float PX[EKF_STATE_DIM * EKF_STATE_DIM];
-static float PXX[EKF_STATE_DIM * EKF_STATE_DIM];
-static float PXY[EKF_STATE_DIM * EKF_MEASUREMENT_DIM];
-static float K[EKF_STATE_DIM * EKF_MEASUREMENT_DIM];
-static float S[EKF_MEASUREMENT_DIM * EKF_MEASUREMENT_DIM];
+static Mat<EKF_STATE_DIM, EKF_STATE_DIM> PX;
+static Mat<EKF_STATE_DIM, EKF_STATE_DIM> PXX;
+static Mat<EKF_STATE_DIM, EKF_MEASUREMENT_DIM> PXY;
+static Mat<EKF_STATE_DIM, EKF_MEASUREMENT_DIM> K;
+static Mat<EKF_MEASUREMENT_DIM, EKF_MEASUREMENT_DIM> S;
+//single sensor (accel or mag) measurement blocks
+static Mat<3, EKF_STATE_DIM> H3;
+static Mat<3, 1> Y3;
+#ifndef EKF_GENERATED_KERNELS
+static Mat<EKF_STATE_DIM, 3> PXY3;
+static Mat<EKF_STATE_DIM, 3> K3;
+static Mat<3, 3> S3;
+#endif
+#ifdef EKF_LAZY_COVARIANCE
+//rows 0-3 of the transition since the last propagation of P, the bias rows
+//are always [0 I]
+static Mat<4, EKF_STATE_DIM> PHI = {{
+	1.0f, 0, 0, 0, 0, 0, 0,
+	0, 1.0f, 0, 0, 0, 0, 0,
+	0, 0, 1.0f, 0, 0, 0, 0,
+	0, 0, 0, 1.0f, 0, 0, 0,
+}};
+//process noise of the gap, in EKF_QDT_NOMINAL steps
+static float PHIqdt = 0.0f;
+static int PHIcount = 0;
+#endif
+#ifdef EKF_STEADY_STATE_GAIN
+//converged gains by attitude, with the inverse innovation covariance of
+//the same update for the NIS test
+typedef struct
+{
+	float q[4];
+	Mat<EKF_STATE_DIM, EKF_MEASUREMENT_DIM> K;
+	Mat<EKF_MEASUREMENT_DIM, EKF_MEASUREMENT_DIM> SI;
+	int valid;
+} EKF_SteadyGain;
+
+static EKF_SteadyGain SS[EKF_SS_TABLE_SIZE];
+//gain sum of the current window and average of the previous one
+static Mat<EKF_STATE_DIM, EKF_MEASUREMENT_DIM> SSKsum;
+static Mat<EKF_STATE_DIM, EKF_MEASUREMENT_DIM> SSKavg;
+static float SSq[4];
+static int SScount = 0;
+static int SSwindows = 0;
+static int SSnext = 0;
+static int SSlast = -1;
+#endif
 
 static void Calcultate_RotationMatrix(float *accel, float *mag, float *R)
 {
@@ -163,26 +279,327 @@ void EKF_AHRSInit(float *accel, float *mag)
 	float R[9];
 
 	Calcultate_RotationMatrix(accel, mag, R);
-	Quaternion_FromRotationMatrix(R, X);
+	Quaternion_FromRotationMatrix(R, X.m);
 }
 
-void EKF_AHRSUpdate(float *gyro, float *accel, float *mag, float dt)
+#ifdef EKF_UD_COVARIANCE
+//the factors are worked on in a padded copy, row j of U holds column j of
+//U (the part above the diagonal) and is zero from j on. every loop runs over
+//the EKF_STATE_DIM + 1 lanes of a row, fixed trip counts vectorize where
+//the triangular loops of the textbook algorithms do not
+#define EKF_UD_LANES (EKF_STATE_DIM + 1)
+
+static void EKF_AHRSLoadUD(float U[][EKF_UD_LANES], float *D)
 {
-	float norm;
+	for (unsigned int j = 0; j < EKF_STATE_DIM; j++){
+		for (unsigned int i = 0; i < EKF_UD_LANES; i++){
+			U[j][i] = i < j ? P(j, i) : 0.0f;
+		}
+		D[j] = P(j, j);
+	}
+}
+
+static void EKF_AHRSStoreUD(float U[][EKF_UD_LANES], const float *D)
+{
+	for (unsigned int j = 0; j < EKF_STATE_DIM; j++){
+		for (unsigned int i = 0; i < j; i++){
+			P(j, i) = U[j][i];
+		}
+		P(j, j) = D[j];
+	}
+}
+
+//U*D*U' = F*U*D*U'*F' + Q * qdt without forming P. the columns of F*U with
+//the weights D are orthogonalized by modified weighted Gram-Schmidt, from
+//the last row up, which gives the factors of F*P*F' (C. L. Thornton,
+//"Triangular covariance factorizations for Kalman filtering", 1976). Q is
+//diagonal, so it is added as one rank-one update per state (Agee-Turner)
+//instead of widening W with an identity block: the update for state n
+//only touches the first n + 1 columns. D stays non-negative and U unit
+//upper triangular whatever the rounding, so P = U*D*U' stays symmetric
+//positive semi-definite.
+static void EKF_AHRSThornton(float qdt)
+{
+	//W[k] is column k of F*U, W[k][i] its row i
+	float U[EKF_STATE_DIM][EKF_UD_LANES], W[EKF_STATE_DIM][EKF_UD_LANES], FT[EKF_STATE_DIM][EKF_UD_LANES];
+	float D[EKF_STATE_DIM], dw[EKF_STATE_DIM], c[EKF_STATE_DIM], s[EKF_UD_LANES], a[EKF_UD_LANES];
+	float u, d, d0, e;
+	int i, j, k, n;
+
+	EKF_AHRSLoadUD(U, dw);
+
+	//column k of F*U is F(:, k) + sum over n < k of U(n, k) * F(:, n)
+	for (k = 0; k < EKF_STATE_DIM; k++){
+		for (i = 0; i < EKF_UD_LANES; i++){
+			FT[k][i] = i < EKF_STATE_DIM ? F(i, k) : 0.0f;
+		}
+	}
+	for (k = 0; k < EKF_STATE_DIM; k++){
+		for (i = 0; i < EKF_UD_LANES; i++){
+			W[k][i] = FT[k][i];
+		}
+		for (n = 0; n < k; n++){
+			u = U[k][n];
+			for (i = 0; i < EKF_UD_LANES; i++){
+				W[k][i] += u * FT[n][i];
+			}
+		}
+	}
+
+	//the rows below j are finished, their s is zero
+	for (j = EKF_STATE_DIM - 1; j >= 0; j--){
+		d = 0.0f;
+		for (k = 0; k < EKF_STATE_DIM; k++){
+			c[k] = dw[k] * W[k][j];
+			d += W[k][j] * c[k];
+		}
+		for (i = 0; i < EKF_UD_LANES; i++){
+			s[i] = 0.0f;
+		}
+		for (k = 0; k < EKF_STATE_DIM; k++){
+			for (i = 0; i < EKF_UD_LANES; i++){
+				s[i] += W[k][i] * c[k];
+			}
+		}
+		D[j] = d;
+		d = d > 0.0f ? 1.0f / d : 0.0f;
+		for (i = 0; i < EKF_UD_LANES; i++){
+			s[i] = i < j ? s[i] * d : 0.0f;
+			U[j][i] = s[i];
+		}
+		for (k = 0; k < EKF_STATE_DIM; k++){
+			u = W[k][j];
+			for (i = 0; i < EKF_UD_LANES; i++){
+				W[k][i] -= s[i] * u;
+			}
+		}
+	}
+
+	//U*D*U' + c * a * a' with a = e_n, the columns after n see a zero in a
+	//and keep their factors
+	for (n = 0; n < EKF_STATE_DIM; n++){
+		float c = Q(n, n) * qdt;
+
+		for (i = 0; i < EKF_UD_LANES; i++){
+			a[i] = i == n ? 1.0f : 0.0f;
+		}
+		for (j = n; j > 0 && c > 0.0f; j--){
+			e = a[j];
+			d0 = D[j];
+			d = d0 + c * e * e;
+			u = c / d;
+			c = u * d0;
+			u *= e;
+			D[j] = d;
+			for (i = 0; i < EKF_UD_LANES; i++){
+				a[i] -= e * U[j][i];
+				U[j][i] += i < j ? u * a[i] : 0.0f;
+			}
+		}
+		D[0] += c * a[0] * a[0];
+	}
+
+	EKF_AHRSStoreUD(U, D);
+}
+
+//m rows of h (stride EKF_STATE_DIM) with innovations y and uncorrelated
+//noise r, one scalar update each (G. J. Bierman, "Factorization Methods for
+//Discrete Sequential Estimation", 1977). every row is linearized at the
+//same state, the correction of the rows before is taken out of the
+//innovation, so the result is the one of the joint update with no matrix
+//inverse. X is corrected, the quaternion is left to the caller to normalize
+static void EKF_AHRSBierman(const float *h, const float *y, const float *r, unsigned int m)
+{
+	float U[EKF_STATE_DIM][EKF_UD_LANES], D[EKF_STATE_DIM];
+	float f[EKF_STATE_DIM], v[EKF_STATE_DIM], b[EKF_UD_LANES], g[EKF_UD_LANES];
+	float alpha, alpha0, ialpha, ialpha0, lambda, u, e;
+
+	EKF_AHRSLoadUD(U, D);
+	for (unsigned int i = 0; i < EKF_STATE_DIM; i++){
+		KY[i] = 0.0f;
+	}
+	for (unsigned int n = 0; n < m; n++, h += EKF_STATE_DIM){
+		//f = U' * h', v = D * f
+		e = y[n];
+		for (unsigned int i = 0; i < EKF_UD_LANES; i++){
+			g[i] = i < EKF_STATE_DIM ? h[i] : 0.0f;
+		}
+		for (unsigned int j = 0; j < EKF_STATE_DIM; j++){
+			e -= g[j] * KY[j];
+			f[j] = g[j];
+			for (unsigned int i = 0; i < EKF_UD_LANES; i++){
+				f[j] += U[j][i] * g[i];
+			}
+			v[j] = D[j] * f[j];
+		}
+
+		//b accumulates the gain, its entries from j on are still zero and
+		//b(j) starts at v(j)
+		for (unsigned int i = 0; i < EKF_UD_LANES; i++){
+			b[i] = 0.0f;
+		}
+		alpha = r[n];
+		ialpha = 1.0f / alpha;
+		for (unsigned int j = 0; j < EKF_STATE_DIM; j++){
+			alpha0 = alpha;
+			ialpha0 = ialpha;
+			alpha += f[j] * v[j];
+			ialpha = 1.0f / alpha;
+			D[j] *= alpha0 * ialpha;
+			lambda = -f[j] * ialpha0;
+			for (unsigned int i = 0; i < EKF_UD_LANES; i++){
+				u = U[j][i];
+				U[j][i] = u + b[i] * lambda;
+				b[i] += (i == j ? 1.0f : u) * v[j];
+			}
+		}
+
+		//K = b / alpha
+		e *= ialpha;
+		for (unsigned int i = 0; i < EKF_STATE_DIM; i++){
+			KY[i] += b[i] * e;
+		}
+	}
+	EKF_AHRSStoreUD(U, D);
+	Mat_Add(X, KY, X);
+}
+#endif
+
+#ifdef EKF_MIXED_COVARIANCE
+//P(i, j) = P(j, i) += d, the sum in float-float. with increments much
+//smaller than P, as in a converged filter, the float sum would round most
+//of them away
+static inline void EKF_AHRSAccumulate(unsigned int i, unsigned int j, float d)
+{
+	Double s;
+
+	s.hi = P(i, j);
+	s.lo = PL(i, j);
+	s = DoubleAdd(s, floatToDouble(d));
+	P(i, j) = s.hi; PL(i, j) = s.lo;
+	P(j, i) = s.hi; PL(j, i) = s.lo;
+}
+
+//P = F*P*F' + Q * qdt as P += G*P + (G*P)' + G*P*G' + Q * qdt with
+//G = F - I, the increment in float
+static void EKF_AHRSMixedPropagate(float qdt)
+{
+	Mat<EKF_STATE_DIM, EKF_STATE_DIM> G;
+
+	Mat_Copy(F, G);
+	for (unsigned int i = 0; i < EKF_STATE_DIM; i++){
+		G(i, i) = F(i, i) - 1.0f;
+	}
+	Mat_Multiply(G, P, PX);
+	Mat_MultiplyTransB(PX, G, PXX);
+	for (unsigned int i = 0; i < EKF_STATE_DIM; i++){
+		EKF_AHRSAccumulate(i, i, 2.0f * PX(i, i) + PXX(i, i) + Q(i, i) * qdt);
+		for (unsigned int j = i + 1; j < EKF_STATE_DIM; j++){
+			EKF_AHRSAccumulate(i, j, PX(i, j) + PX(j, i) + PXX(i, j));
+		}
+	}
+}
+
+//P = P - K * (P * H')' for the m rows of K and PHt, the upper triangle
+//mirrored
+static void EKF_AHRSMixedUpdate(const float *k, const float *pht, unsigned int m)
+{
+	for (unsigned int i = 0; i < EKF_STATE_DIM; i++){
+		for (unsigned int j = i; j < EKF_STATE_DIM; j++){
+			float d = 0.0f;
+			for (unsigned int l = 0; l < m; l++){
+				d += k[i * m + l] * pht[j * m + l];
+			}
+			EKF_AHRSAccumulate(i, j, -d);
+		}
+	}
+}
+#endif
+
+//P = F*P*F' + Q * qdt with F from EKF_AHRSPredict or EKF_AHRSPredictPreint.
+//with EKF_LAZY_COVARIANCE, F is folded into PHI instead and P waits for
+//EKF_AHRSFlushCovariance. F and PHI keep the block structure [A B; 0 I], so
+//PHI = F * PHI needs A * [A_phi B_phi] + [0 B], 112 products instead of the
+//686 of F*P*F'. the process noise of the gap is added at the end,
+//Q * sum(qdt): A is I + Omega * dt / 2 with Omega skew, so A * Q * A' stays
+//Q up to second order in the rotation of a step. the bias noise that would
+//leak into the quaternion through B within the gap is dropped.
+static void EKF_AHRSPropagate(float qdt)
+{
+#ifdef EKF_LAZY_COVARIANCE
+	float c0, c1, c2, c3;
+
+	//column by column, in place
+	for (unsigned int j = 0; j < EKF_STATE_DIM; j++){
+		c0 = PHI(0, j); c1 = PHI(1, j); c2 = PHI(2, j); c3 = PHI(3, j);
+		PHI(0, j) = F(0, 0) * c0 + F(0, 1) * c1 + F(0, 2) * c2 + F(0, 3) * c3;
+		PHI(1, j) = F(1, 0) * c0 + F(1, 1) * c1 + F(1, 2) * c2 + F(1, 3) * c3;
+		PHI(2, j) = F(2, 0) * c0 + F(2, 1) * c1 + F(2, 2) * c2 + F(2, 3) * c3;
+		PHI(3, j) = F(3, 0) * c0 + F(3, 1) * c1 + F(3, 2) * c2 + F(3, 3) * c3;
+	}
+	for (unsigned int j = 4; j < EKF_STATE_DIM; j++){
+		PHI(0, j) += F(0, j); PHI(1, j) += F(1, j); PHI(2, j) += F(2, j); PHI(3, j) += F(3, j);
+	}
+	PHIqdt += qdt;
+	PHIcount++;
+#elif defined(EKF_UD_COVARIANCE)
+	EKF_AHRSThornton(qdt);
+#elif defined(EKF_MIXED_COVARIANCE)
+	EKF_AHRSMixedPropagate(qdt);
+#elif defined(EKF_GENERATED_KERNELS)
+	EKF_GenPropagate(P.m, F.m, Q.m, qdt);
+#else
+	Mat_Multiply(F, P, PX);
+	Mat_MultiplyTransB(PX, F, P);
+	for (unsigned int i = 0; i < EKF_STATE_DIM; i++){
+		P(i, i) += Q(i, i) * qdt;
+	}
+#endif
+}
+
+//brings P up to date with the predictions since the last update. a no-op
+//without EKF_LAZY_COVARIANCE
+void EKF_AHRSFlushCovariance(void)
+{
+#ifdef EKF_LAZY_COVARIANCE
+	if (PHIcount == 0){
+		return;
+	}
+	//F = [PHI; 0 I], the bias rows of F are never written
+	for (unsigned int i = 0; i < 4 * EKF_STATE_DIM; i++){
+		F[i] = PHI[i];
+		PHI[i] = (i % (EKF_STATE_DIM + 1)) == 0 ? 1.0f : 0.0f;
+	}
+#ifdef EKF_UD_COVARIANCE
+	EKF_AHRSThornton(PHIqdt);
+#elif defined(EKF_MIXED_COVARIANCE)
+	EKF_AHRSMixedPropagate(PHIqdt);
+#elif defined(EKF_GENERATED_KERNELS)
+	EKF_GenPropagate(P.m, F.m, Q.m, PHIqdt);
+#else
+	Mat_Multiply(F, P, PX);
+	Mat_MultiplyTransB(PX, F, P);
+	for (unsigned int i = 0; i < EKF_STATE_DIM; i++){
+		P(i, i) += Q(i, i) * PHIqdt;
+	}
+#endif
+	//EKF_AHRSPredict leaves the diagonal at one
+	F[0] = F[8] = F[16] = F[24] = 1.0f;
+	PHIqdt = 0.0f;
+	PHIcount = 0;
+#endif
+}
+
+//state time propagation and F, without the covariance
+static void EKF_AHRSPredictState(float *gyro, float dt)
+{
+	float w[3];
 	float halfdx, halfdy, halfdz;
 	float neghalfdx, neghalfdy, neghalfdz;
 	float halfdtq0, neghalfdtq0, halfdtq1, neghalfdtq1,
 		halfdtq2, neghalfdtq2, halfdtq3, neghalfdtq3;
 	float halfdt = 0.5f * dt;
-	//////////////////////////////////////////////////////////////////////////
-	float _2q0,_2q1,_2q2,_2q3;
-	float q0q0, q0q1, q0q2, q0q3, q1q1, q1q2, q1q3, q2q2, q2q3, q3q3;
 	float q0, q1, q2, q3;
-	float _2mx, _2my, _2mz;
-	float hx, hy, hz;
-	float bx, bz;
-	//
-	float SI[EKF_MEASUREMENT_DIM * EKF_MEASUREMENT_DIM] = {0};
 	//////////////////////////////////////////////////////////////////////////
 	halfdx = halfdt * (gyro[0] - X[4]);
 	halfdy = halfdt * (gyro[1] - X[5]);
@@ -194,20 +611,12 @@ void EKF_AHRSUpdate(float *gyro, float *accel, float *mag, float dt)
 	//////////////////////////////////////////////////////////////////////////
 	//Extended Kalman Filter: Prediction Step
 	//state time propagation
-	//Update Quaternion with the new gyroscope measurements
-	X[0] = q0 - halfdx * q1 - halfdy * q2 - halfdz * q3;
-	X[1] = q1 + halfdx * q0 - halfdy * q3 + halfdz * q2;
-	X[2] = q2 + halfdx * q3 + halfdy * q0 - halfdz * q1;
-	X[3] = q3 - halfdx * q2 + halfdy * q1 + halfdz * q0;
-
-	//normalize quaternion
-	norm = FastSqrtI(X[0] * X[0] + X[1] * X[1] + X[2] * X[2] + X[3] * X[3]);
-	X[0] *= norm;
-	X[1] *= norm;
-	X[2] *= norm;
-	X[3] *= norm;
+	//Update Quaternion with the new gyroscope measurements, the exponential
+	//map keeps it unit and the updates normalize after their correction
+	w[0] = gyro[0] - X[4]; w[1] = gyro[1] - X[5]; w[2] = gyro[2] - X[6];
+	Quaternion_IntegrateExp(&X[0], w, dt);
 
-	//populate F jacobian
+	//populate F jacobian, to first order in dt
 	halfdtq0 = halfdt * q0; halfdtq1 = halfdt * q1; halfdtq2 = halfdt * q2; halfdtq3 = halfdt * q3;
 	neghalfdtq0 = -halfdtq0; neghalfdtq1 = -halfdtq1; neghalfdtq2 = -halfdtq2; neghalfdtq3 = -halfdtq3;
 
@@ -215,12 +624,197 @@ void EKF_AHRSUpdate(float *gyro, float *accel, float *mag, float dt)
 	F[7] = halfdx; /* F[8] = 1.0f; */ F[9] = halfdz;	F[10] = neghalfdy; F[11] = neghalfdtq0; F[12] = halfdtq3; F[13] = neghalfdtq2;
 	F[14] = halfdy;	F[15] = neghalfdz;	/* F[16] = 1.0f; */ F[17] = halfdx; F[18] = neghalfdtq3; F[19] = neghalfdtq0; F[20] = halfdtq1;
 	F[21] = halfdz; F[22] = halfdy; F[23] = neghalfdx; /* F[24] = 1.0f; */ F[25] = halfdtq2; F[26] = neghalfdtq1; F[27] = neghalfdtq0;
+}
+
+void EKF_AHRSPredict(float *gyro, float dt)
+{
+	EKF_AHRSPredictState(gyro, dt);
 
 	//covariance time propagation
-	//P = F*P*F' + Q;
-	Matrix_Multiply(F, EKF_STATE_DIM, EKF_STATE_DIM, P, EKF_STATE_DIM, PX);
-	Matrix_Multiply_With_Transpose(PX, EKF_STATE_DIM, EKF_STATE_DIM, F, EKF_STATE_DIM, P);
-	Maxtrix_Add(P, EKF_STATE_DIM, EKF_STATE_DIM, Q, P);
+	//P = F*P*F' + Q * dt / EKF_QDT_NOMINAL;
+	//process noise is tuned for EKF_QDT_NOMINAL steps
+	EKF_AHRSPropagate(dt / EKF_QDT_NOMINAL);
+}
+
+//prediction over a whole pre-integrated gyro interval, the summary is
+//reset afterwards so the next samples start a new interval
+void EKF_AHRSPredictPreint(GyroPreintegration *pi)
+{
+	float phi[3], dq[4], M[12];
+	float q0, q1, q2, q3;
+	float qdt;
+
+	if (pi->count == 0){
+		return;
+	}
+	qdt = pi->dt / EKF_QDT_NOMINAL;
+	//rotation vector corrected with the current bias estimate
+	GyroPreint_GetRotation(pi, &X[4], phi);
+
+	//dq = [cos(|phi|/2), sin(|phi|/2) * phi/|phi|]
+	Quaternion_FromRotationVector(dq, phi);
+
+	q0 = X[0]; q1 = X[1]; q2 = X[2]; q3 = X[3];
+
+	//X = X * dq
+	X[0] = q0 * dq[0] - q1 * dq[1] - q2 * dq[2] - q3 * dq[3];
+	X[1] = q0 * dq[1] + q1 * dq[0] + q2 * dq[3] - q3 * dq[2];
+	X[2] = q0 * dq[2] - q1 * dq[3] + q2 * dq[0] + q3 * dq[1];
+	X[3] = q0 * dq[3] + q1 * dq[2] - q2 * dq[1] + q3 * dq[0];
+
+	//populate F jacobian
+	//d(X)/d(q) is the right product matrix of dq
+	/* F[0] = 1.0f; */ F[1] = -dq[1]; F[2] = -dq[2]; F[3] = -dq[3];
+	F[7] = dq[1]; F[9] = dq[3]; F[10] = -dq[2];
+	F[14] = dq[2]; F[15] = -dq[3]; F[17] = dq[1];
+	F[21] = dq[3]; F[22] = dq[2]; F[23] = -dq[1];
+	F[0] = F[8] = F[16] = F[24] = dq[0];
+	//d(X)/d(b) = L(q) * d(dq)/d(phi) * J, d(dq)/d(phi) ~ [-phi'/4; I/2]
+	for (int j = 0; j < 3; j++){
+		M[j] = -0.25f * (phi[0] * pi->J[j] + phi[1] * pi->J[3 + j] + phi[2] * pi->J[6 + j]);
+		M[3 + j] = 0.5f * pi->J[j];
+		M[6 + j] = 0.5f * pi->J[3 + j];
+		M[9 + j] = 0.5f * pi->J[6 + j];
+		F[4 + j] = q0 * M[j] - q1 * M[3 + j] - q2 * M[6 + j] - q3 * M[9 + j];
+		F[11 + j] = q1 * M[j] + q0 * M[3 + j] - q3 * M[6 + j] + q2 * M[9 + j];
+		F[18 + j] = q2 * M[j] + q3 * M[3 + j] + q0 * M[6 + j] - q1 * M[9 + j];
+		F[25 + j] = q3 * M[j] - q2 * M[3 + j] + q1 * M[6 + j] + q0 * M[9 + j];
+	}
+
+	//P = F*P*F' + Q * dt / EKF_QDT_NOMINAL;
+	EKF_AHRSPropagate(qdt);
+	//EKF_AHRSPredict leaves the diagonal at one
+	F[0] = F[8] = F[16] = F[24] = 1.0f;
+
+	GyroPreint_Reset(pi);
+}
+
+#ifdef EKF_STEADY_STATE_GAIN
+//stored gain for the current attitude, -1 if there is none. q and -q are
+//the same attitude but the quaternion rows of K change sign with q, so only
+//the sign the gain was learned with matches
+static int EKF_AHRSSteadyLookup(void)
+{
+	float d;
+
+	for (int n = 0; n < EKF_SS_TABLE_SIZE; n++){
+		if (!SS[n].valid){
+			continue;
+		}
+		d = X[0] * SS[n].q[0] + X[1] * SS[n].q[1] + X[2] * SS[n].q[2] + X[3] * SS[n].q[3];
+		if (d > EKF_SS_COS){
+			return n;
+		}
+	}
+	return -1;
+}
+
+//update with the stored gain n. returns 0, and drops the gain, if the
+//normalized innovation squared Y' * SI * Y is too large for it
+static int EKF_AHRSSteadyUpdate(int n)
+{
+	float norm, nis = 0.0f;
+	Mat<EKF_MEASUREMENT_DIM, 1> SY;
+
+	Mat_Multiply(SS[n].SI, Y, SY);
+	for (unsigned int i = 0; i < EKF_MEASUREMENT_DIM; i++){
+		nis += Y[i] * SY[i];
+	}
+	if (nis > EKF_SS_NIS_MAX){
+		SS[n].valid = 0;
+		SScount = 0;
+		SSwindows = 0;
+		return 0;
+	}
+
+	//X = X + K * Y;
+	Mat_Multiply(SS[n].K, Y, KY);
+	Mat_Add(X, KY, X);
+
+	//normalize quaternion
+	norm = FastSqrtI(X[0] * X[0] + X[1] * X[1] + X[2] * X[2] + X[3] * X[3]);
+	X[0] *= norm;
+	X[1] *= norm;
+	X[2] *= norm;
+	X[3] *= norm;
+	return 1;
+}
+
+//stores the average K of a window of EKF_SS_SETTLE updates when it is
+//within EKF_SS_TOLERANCE of the previous window. a single K jitters with
+//the measurement noise through H, the average does not. the attitude has to
+//stay within EKF_SS_COS of the start of the window, with the same sign
+static void EKF_AHRSSteadyLearn(Mat<EKF_MEASUREMENT_DIM, EKF_MEASUREMENT_DIM> &SI)
+{
+	float d, dmax = 0.0f, kmax = 0.0f;
+	float scale = 1.0f / EKF_SS_SETTLE;
+
+	if (SScount == 0){
+		Mat_Copy(K, SSKsum);
+		SSq[0] = X[0]; SSq[1] = X[1]; SSq[2] = X[2]; SSq[3] = X[3];
+		SScount = 1;
+		return;
+	}
+	d = X[0] * SSq[0] + X[1] * SSq[1] + X[2] * SSq[2] + X[3] * SSq[3];
+	if (d < EKF_SS_COS){
+		SScount = 0;
+		SSwindows = 0;
+		return;
+	}
+	Mat_Add(SSKsum, K, SSKsum);
+	if (++SScount < EKF_SS_SETTLE){
+		return;
+	}
+	SScount = 0;
+
+	for (unsigned int i = 0; i < EKF_STATE_DIM * EKF_MEASUREMENT_DIM; i++){
+		SSKsum[i] *= scale;
+		d = FastAbs(SSKsum[i] - SSKavg[i]);
+		if (d > dmax){
+			dmax = d;
+		}
+		d = FastAbs(SSKsum[i]);
+		if (d > kmax){
+			kmax = d;
+		}
+	}
+	Mat_Copy(SSKsum, SSKavg);
+	if (SSwindows++ == 0 || dmax > EKF_SS_TOLERANCE * kmax){
+		return;
+	}
+	SSwindows = 0;
+	SS[SSnext].q[0] = SSq[0]; SS[SSnext].q[1] = SSq[1]; SS[SSnext].q[2] = SSq[2]; SS[SSnext].q[3] = SSq[3];
+	Mat_Copy(SSKavg, SS[SSnext].K);
+	Mat_Copy(SI, SS[SSnext].SI);
+	SS[SSnext].valid = 1;
+	SSnext = (SSnext + 1) % EKF_SS_TABLE_SIZE;
+}
+#endif
+
+void EKF_AHRSUpdate(float *gyro, float *accel, float *mag, float dt)
+{
+	float norm;
+	//////////////////////////////////////////////////////////////////////////
+	float _2q0,_2q1,_2q2,_2q3;
+	float q0q0, q0q1, q0q2, q0q3, q1q1, q1q2, q1q3, q2q2, q2q3, q3q3;
+	float _2mx, _2my, _2mz;
+	float hx, hy, hz;
+	float bx, bz;
+	//
+	Mat<EKF_MEASUREMENT_DIM, EKF_MEASUREMENT_DIM> SI;
+	//////////////////////////////////////////////////////////////////////////
+#ifdef EKF_STEADY_STATE_GAIN
+	//with a stored gain for this attitude P is left as it is
+	SSlast = EKF_AHRSSteadyLookup();
+	if (SSlast < 0){
+		EKF_AHRSPredict(gyro, dt);
+	} else {
+		EKF_AHRSPredictState(gyro, dt);
+	}
+#else
+	EKF_AHRSPredict(gyro, dt);
+#endif
+	EKF_AHRSFlushCovariance();
 
 	//////////////////////////////////////////////////////////////////////////
 	//measurement update
@@ -265,6 +859,18 @@ void EKF_AHRSUpdate(float *gyro, float *accel, float *mag, float dt)
 	Y[4] = mag[1] - Y[4];
 	Y[5] = mag[2] - Y[5];
 
+#ifdef EKF_STEADY_STATE_GAIN
+	if (SSlast >= 0){
+		if (EKF_AHRSSteadyUpdate(SSlast)){
+			return;
+		}
+		//back to the full update, P picks up this prediction
+		SSlast = -1;
+		EKF_AHRSPropagate(dt / EKF_QDT_NOMINAL);
+		EKF_AHRSFlushCovariance();
+	}
+#endif
+
 	//populate H jacobian
 	H[0] = _2q2; H[1] = -_2q3; H[2] = _2q0; H[3] = -_2q1;
 	H[7] = -_2q1; H[8] = -_2q0; H[9] = -_2q3; H[10] = -_2q2;
@@ -274,19 +880,45 @@ void EKF_AHRSUpdate(float *gyro, float *accel, float *mag, float dt)
 	H[28] = bz * _2q1 - bx * _2q3; H[29] = bx * _2q2 + bz * _2q0;	 H[30] = bx * _2q1 + bz * _2q3; H[31] = bz * _2q2 - bx * _2q0;
 	H[35] = bx * _2q2 + bz * _2q0; H[36] = bx * _2q3 - bz * _2q1; H[37] = bx * _2q0 - bz * _2q2; H[38] = bx * _2q1 + bz * _2q3;
 
+#ifdef EKF_UD_COVARIANCE
+	{
+		float r[EKF_MEASUREMENT_DIM] = {R[0], R[7], R[14], R[21], R[28], R[35]};
+
+		EKF_AHRSBierman(H.m, Y.m, r, EKF_MEASUREMENT_DIM);
+		norm = FastSqrtI(X[0] * X[0] + X[1] * X[1] + X[2] * X[2] + X[3] * X[3]);
+		X[0] *= norm;
+		X[1] *= norm;
+		X[2] *= norm;
+		X[3] *= norm;
+		return;
+	}
+#endif
+#ifdef EKF_GENERATED_KERNELS
+	{
+		float r[EKF_MEASUREMENT_DIM] = {R[0], R[7], R[14], R[21], R[28], R[35]};
+
+		//the kernel builds its H from X, bx and bz as above
+		EKF_GenUpdate(P.m, X.m, Y.m, r, bx, bz);
+		return;
+	}
+#endif
+
 	//kalman gain calculation
 	//K = P * H' / (R + H * P * H')
 	//acceleration of gravity
-	Matrix_Multiply_With_Transpose(P, EKF_STATE_DIM, EKF_STATE_DIM, H, EKF_MEASUREMENT_DIM, PXY);
-	Matrix_Multiply(H, EKF_MEASUREMENT_DIM, EKF_STATE_DIM, PXY, EKF_MEASUREMENT_DIM, S);
-	Maxtrix_Add(S, EKF_MEASUREMENT_DIM, EKF_MEASUREMENT_DIM, R, S);
-	Matrix_Inverse(S, EKF_MEASUREMENT_DIM, SI);
-	Matrix_Multiply(PXY, EKF_STATE_DIM, EKF_MEASUREMENT_DIM, SI, EKF_MEASUREMENT_DIM, K);
+	Mat_MultiplyTransB(P, H, PXY);
+	Mat_Multiply(H, PXY, S);
+	Mat_Add(S, R, S);
+	Mat_Inverse(S, SI);
+	Mat_Multiply(PXY, SI, K);
+#ifdef EKF_STEADY_STATE_GAIN
+	EKF_AHRSSteadyLearn(SI);
+#endif
 
 	//update state vector
 	//X = X + K * Y;
-	Matrix_Multiply(K, EKF_STATE_DIM, EKF_MEASUREMENT_DIM, Y, 1, KY);
-	Maxtrix_Add(X, EKF_STATE_DIM, 1, KY, X);
+	Mat_Multiply(K, Y, KY);
+	Mat_Add(X, KY, X);
 
 	//normalize quaternion
 	norm = FastSqrtI(X[0] * X[0] + X[1] * X[1] + X[2] * X[2] + X[3] * X[3]);
@@ -300,18 +932,170 @@ void EKF_AHRSUpdate(float *gyro, float *accel, float *mag, float dt)
 	//P = P - K * H * P
 	//or
 	//P=(I - K*H)*P*(I - K*H)' + K*R*K'
-#ifndef UPDATE_P_COMPLICATED
-	Matrix_Multiply(K, EKF_STATE_DIM, EKF_MEASUREMENT_DIM, H, EKF_STATE_DIM, PX);
-	Matrix_Multiply(PX, EKF_STATE_DIM, EKF_STATE_DIM, P, EKF_STATE_DIM, PXX);
-	Maxtrix_Add(P, EKF_STATE_DIM, EKF_STATE_DIM, PXX, P);
+#if defined(EKF_MIXED_COVARIANCE)
+	EKF_AHRSMixedUpdate(K.m, PXY.m, EKF_MEASUREMENT_DIM);
+#elif !defined(UPDATE_P_COMPLICATED)
+	Mat_Multiply(K, H, PX);
+	Mat_Multiply(PX, P, PXX);
+	Mat_Sub(P, PXX, P);
 #else
-	Matrix_Multiply(K, EKF_STATE_DIM, EKF_MEASUREMENT_DIM, H, EKF_STATE_DIM, PX);
-	Maxtrix_Sub(I, EKF_STATE_DIM, EKF_STATE_DIM, PX, PX);
-	Matrix_Multiply(PX, EKF_STATE_DIM, EKF_STATE_DIM, P, EKF_STATE_DIM, PXX);
-	Matrix_Multiply_With_Transpose(PXX, EKF_STATE_DIM, EKF_STATE_DIM, PX, EKF_STATE_DIM, P);
-	Matrix_Multiply(K, EKF_STATE_DIM, EKF_MEASUREMENT_DIM, R, EKF_MEASUREMENT_DIM, PXY);
-	Matrix_Multiply_With_Transpose(PXY, EKF_STATE_DIM, EKF_MEASUREMENT_DIM, K, EKF_STATE_DIM, PX);
-	Maxtrix_Add(P, EKF_STATE_DIM, EKF_STATE_DIM, PX, P);
+	Mat_Multiply(K, H, PX);
+	Mat_Sub(I, PX, PX);
+	Mat_Multiply(PX, P, PXX);
+	Mat_MultiplyTransB(PXX, PX, P);
+	Mat_Multiply(K, R, PXY);
+	Mat_MultiplyTransB(PXY, K, PX);
+	Mat_Add(P, PX, P);
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////
+//multi-rate interface: EKF_AHRSPredict at the gyro rate and the sensor
+//updates below only when a new accel or mag sample arrives. each update
+//uses its 3-row block of H, so the gain needs a 3x3 inverse only.
+//EKF_AHRSUpdate is a prediction followed by the joint 6-row update.
+
+#ifndef EKF_GENERATED_KERNELS
+//measurement update with H3, Y3 and R = r * I
+static void EKF_AHRSUpdateBlock(float r)
+{
+	float norm;
+	Mat<3, 3> SI;
+
+	EKF_AHRSFlushCovariance();
+
+#ifdef EKF_UD_COVARIANCE
+	{
+		float rr[3] = {r, r, r};
+
+		EKF_AHRSBierman(H3.m, Y3.m, rr, 3);
+		norm = FastSqrtI(X[0] * X[0] + X[1] * X[1] + X[2] * X[2] + X[3] * X[3]);
+		X[0] *= norm;
+		X[1] *= norm;
+		X[2] *= norm;
+		X[3] *= norm;
+		return;
+	}
+#endif
+
+	//K = P * H' / (R + H * P * H')
+	Mat_MultiplyTransB(P, H3, PXY3);
+	Mat_Multiply(H3, PXY3, S3);
+	S3[0] += r; S3[4] += r; S3[8] += r;
+	Mat_Inverse(S3, SI);
+	Mat_Multiply(PXY3, SI, K3);
+
+	//X = X + K * Y;
+	Mat_Multiply(K3, Y3, KY);
+	Mat_Add(X, KY, X);
+
+	//normalize quaternion
+	norm = FastSqrtI(X[0] * X[0] + X[1] * X[1] + X[2] * X[2] + X[3] * X[3]);
+	X[0] *= norm;
+	X[1] *= norm;
+	X[2] *= norm;
+	X[3] *= norm;
+
+	//covariance estimate update
+#if defined(EKF_MIXED_COVARIANCE)
+	EKF_AHRSMixedUpdate(K3.m, PXY3.m, 3);
+#elif !defined(UPDATE_P_COMPLICATED)
+	Mat_Multiply(K3, H3, PX);
+	Mat_Multiply(PX, P, PXX);
+	Mat_Sub(P, PXX, P);
+#else
+	//P=(I - K*H)*P*(I - K*H)' + r*K*K'
+	Mat_Multiply(K3, H3, PX);
+	Mat_Sub(I, PX, PX);
+	Mat_Multiply(PX, P, PXX);
+	Mat_MultiplyTransB(PXX, PX, P);
+	Mat_MultiplyTransB(K3, K3, PX);
+	Mat_Scale(PX, r, PX);
+	Mat_Add(P, PX, P);
+#endif
+}
+#endif
+
+void EKF_AHRSUpdateAccel(float *accel)
+{
+	float norm;
+	float _2q0 = 2.0f * X[0], _2q1 = 2.0f * X[1], _2q2 = 2.0f * X[2], _2q3 = 2.0f * X[3];
+
+	norm = FastSqrtI(accel[0] * accel[0] + accel[1] * accel[1] + accel[2] * accel[2]);
+	accel[0] *= norm;
+	accel[1] *= norm;
+	accel[2] *= norm;
+
+	Y3[0] = accel[0] + 2.0f * (X[1] * X[3] - X[0] * X[2]);
+	Y3[1] = accel[1] + 2.0f * (X[2] * X[3] + X[0] * X[1]);
+	Y3[2] = accel[2] - (1.0f - 2.0f * (X[0] * X[0] + X[3] * X[3]));
+
+	//rows 0-2 of H, the bias columns stay zero
+	H3[0] = _2q2; H3[1] = -_2q3; H3[2] = _2q0; H3[3] = -_2q1;
+	H3[7] = -_2q1; H3[8] = -_2q0; H3[9] = -_2q3; H3[10] = -_2q2;
+	H3[14] = -_2q0; H3[15] = _2q1; H3[16] = _2q2; H3[17] = -_2q3;
+
+#ifdef EKF_GENERATED_KERNELS
+	EKF_AHRSFlushCovariance();
+	EKF_GenUpdateAccel(P.m, X.m, Y3.m, R(0, 0));
+#else
+	EKF_AHRSUpdateBlock(R(0, 0));
+#endif
+}
+
+void EKF_AHRSUpdateMag(float *mag)
+{
+	float norm;
+	float _2q0,_2q1,_2q2,_2q3;
+	float q0q1, q0q2, q0q3, q1q1, q1q2, q1q3, q2q2, q2q3, q3q3;
+	float _2mx, _2my, _2mz;
+	float hx, hy, hz;
+	float bx, bz;
+
+	norm = FastSqrtI(mag[0] * mag[0] + mag[1] * mag[1] + mag[2] * mag[2]);
+	mag[0] *= norm;
+	mag[1] *= norm;
+	mag[2] *= norm;
+
+	_2q0 = 2.0f * X[0]; _2q1 = 2.0f * X[1]; _2q2 = 2.0f * X[2]; _2q3 = 2.0f * X[3];
+	//
+	q0q1 = X[0] * X[1]; q0q2 = X[0] * X[2]; q0q3 = X[0] * X[3];
+	q1q1 = X[1] * X[1]; q1q2 = X[1] * X[2]; q1q3 = X[1] * X[3];
+	q2q2 = X[2] * X[2]; q2q3 = X[2] * X[3];
+	q3q3 = X[3] * X[3];
+
+	//reference field
+	_2mx = 2.0f * mag[0]; _2my = 2.0f * mag[1]; _2mz = 2.0f * mag[2];
+	hx = _2mx * (0.5f - q2q2 - q3q3) + _2my * (q1q2 - q0q3) + _2mz *(q1q3 + q0q2);
+	hy = _2mx * (q1q2 + q0q3) + _2my * (0.5f - q1q1 - q3q3) + _2mz * (q2q3 - q0q1);
+	hz = _2mx * (q1q3 - q0q2) + _2my * (q2q3 + q0q1) + _2mz *(0.5f - q1q1 - q2q2);
+	bx = FastSqrt(hx * hx + hy * hy);
+	bz = hz;
+
+	Y3[0] = mag[0] - (bx * (1.0f - 2.0f * (q2q2 + q3q3)) + bz * ( 2.0f * (q1q3 - q0q2)));
+	Y3[1] = mag[1] - (bx * (2.0f * (q1q2 - q0q3)) + bz * (2.0f * (q2q3 + q0q1)));
+	Y3[2] = mag[2] - (bx * (2.0f * (q1q3 + q0q2)) + bz * (1.0f - 2.0f * (q1q1 + q2q2)));
+
+	//rows 3-5 of H, the bias columns stay zero
+	H3[0] = bx * _2q0 - bz * _2q2; H3[1] = bx * _2q1 + bz * _2q3; H3[2] = -bx * _2q2 - bz * _2q0; H3[3] = bz * _2q1 - bx * _2q3;
+	H3[7] = bz * _2q1 - bx * _2q3; H3[8] = bx * _2q2 + bz * _2q0;	 H3[9] = bx * _2q1 + bz * _2q3; H3[10] = bz * _2q2 - bx * _2q0;
+	H3[14] = bx * _2q2 + bz * _2q0; H3[15] = bx * _2q3 - bz * _2q1; H3[16] = bx * _2q0 - bz * _2q2; H3[17] = bx * _2q1 + bz * _2q3;
+
+#ifdef EKF_GENERATED_KERNELS
+	EKF_AHRSFlushCovariance();
+	EKF_GenUpdateMag(P.m, X.m, Y3.m, R(3, 3), bx, bz);
+#else
+	EKF_AHRSUpdateBlock(R(3, 3));
+#endif
+}
+
+//1 if the last EKF_AHRSUpdate used a stored steady-state gain
+int EKF_AHRSIsSteady(void)
+{
+#ifdef EKF_STEADY_STATE_GAIN
+	return SSlast >= 0;
+#else
+	return 0;
 #endif
 }
 
@@ -323,6 +1107,39 @@ void EKF_AHRSGetQ(float* Q)
 	Q[3] = X[3];
 }
 
+//gyro bias estimate (rad/s)
+void EKF_AHRSGetBias(float *b)
+{
+	b[0] = X[4];
+	b[1] = X[5];
+	b[2] = X[6];
+}
+
+//P row major, propagated first if it is lazy and rebuilt from U and D
+//with EKF_UD_COVARIANCE
+void EKF_AHRSGetCovariance(float *cov)
+{
+	EKF_AHRSFlushCovariance();
+#ifdef EKF_UD_COVARIANCE
+	//P(i, j) = sum over k >= max(i, j) of U(i, k) * D(k) * U(j, k), U(i, k)
+	//is stored at P(k, i)
+	for (unsigned int i = 0; i < EKF_STATE_DIM; i++){
+		for (unsigned int j = i; j < EKF_STATE_DIM; j++){
+			float s = P(j, j) * (i == j ? 1.0f : P(j, i));
+			for (unsigned int k = j + 1; k < EKF_STATE_DIM; k++){
+				s += P(k, i) * P(k, k) * P(k, j);
+			}
+			cov[i * EKF_STATE_DIM + j] = s;
+			cov[j * EKF_STATE_DIM + i] = s;
+		}
+	}
+#else
+	for (unsigned int i = 0; i < EKF_STATE_DIM * EKF_STATE_DIM; i++){
+		cov[i] = P[i];
+	}
+#endif
+}
+
 void EKF_AHRSGetAngle(float* rpy)
 {
 	float q0q0 = X[0] * X[0];